@@ -0,0 +1,626 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "test.h"
+#include "tests/sphere_stack.h"
+#include "tests/capsule_stack.h"
+#include "tests/box_stack.h"
+#include "tests/sheet_stack.h"
+#include "tests/shape_stack.h"
+#include "tests/jenga.h"
+#include "tests/pyramid.h"
+#include "tests/pyramids.h"
+#include "tests/tumbler.h"
+#include "tests/ragdoll.h"
+#include "tests/hinge_chain.h"
+#include "tests/newton_cradle.h"
+#include "tests/mesh_contact_test.h"
+
+#include <bounce/common/profiler.h>
+#include <bounce/rope/rope_batch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+// This program steps the testbed scenes without a window and 
+// reports the time spent in each profiler scope and the throughput in body steps per second.
+// The profiler only records the scopes executed by the calling thread. 
+// Therefore, when running with a thread pool, the scopes executed by the 
+// other workers aren't included.
+// With --worlds the program instead steps many copies of each scene at the same time, 
+// each on its own thread, and checks that they match a serial run bit-for-bit.
+// With --ropes the program steps a set of ropes as b3Rope objects and as a b3RopeBatch 
+// and reports the time of each and the largest difference between the link positions.
+
+TestSettings* g_testSettings = nullptr;
+
+struct Scene
+{
+	const char* name;
+	TestCreate create;
+};
+
+static Scene s_scenes[] =
+{
+	{ "Sphere Stack", &SphereStack::Create },
+	{ "Capsule Stack", &CapsuleStack::Create },
+	{ "Box Stack", &BoxStack::Create },
+	{ "Sheet Stack", &SheetStack::Create },
+	{ "Shape Stack", &ShapeStack::Create },
+	{ "Jenga", &Jenga::Create },
+	{ "Pyramid", &Pyramid::Create },
+	{ "Pyramids", &Pyramids::Create },
+	{ "Tumbler", &Tumbler::Create },
+	{ "Ragdoll", &Ragdoll::Create },
+	{ "Hinge Chain", &HingeChain::Create },
+	{ "Newton's Cradle", &NewtonCradle::Create },
+	{ "Mesh Contact Test", &MeshContactTest::Create },
+};
+
+const u32 e_sceneCount = sizeof(s_scenes) / sizeof(Scene);
+
+const u32 e_maxScopes = 32;
+
+// Time spent in a profiler scope over all frames.
+struct ScopeTime
+{
+	const char* name;
+	double elapsed;
+	u32 callCount;
+};
+
+struct SceneResult
+{
+	const char* name;
+	u32 frameCount;
+	u32 bodyCount;
+	u32 jointCount;
+	u32 contactCount;
+	double elapsed; // total wall time of the steps in ms
+	double bodySteps; // sum of the body count of each step
+	ScopeTime scopes[e_maxScopes];
+	u32 scopeCount;
+};
+
+struct Options
+{
+	u32 frameCount;
+	u32 threadCount;
+	u32 worldCount;
+	u32 ropeCount;
+	const char* scene;
+	const char* jsonPath;
+};
+
+// Add the elapsed time of a profiler node and its children to the scene result.
+// Nodes having the same name in different branches are merged.
+static void AddScopeTimes(SceneResult* result, const b3ProfilerNode* node)
+{
+	ScopeTime* scope = nullptr;
+	for (u32 i = 0; i < result->scopeCount; ++i)
+	{
+		if (strcmp(result->scopes[i].name, node->name) == 0)
+		{
+			scope = result->scopes + i;
+			break;
+		}
+	}
+
+	if (scope == nullptr && result->scopeCount < e_maxScopes)
+	{
+		scope = result->scopes + result->scopeCount++;
+		scope->name = node->name;
+		scope->elapsed = 0.0;
+		scope->callCount = 0;
+	}
+
+	if (scope)
+	{
+		scope->elapsed += node->elapsed;
+		scope->callCount += node->callCount;
+	}
+
+	for (const b3ProfilerNode* c = node->childHead; c; c = c->childNext)
+	{
+		AddScopeTimes(result, c);
+	}
+}
+
+static void RunScene(SceneResult* result, const Scene& scene, const Options& options, b3TaskExecutor* executor)
+{
+	// Some scenes use random numbers.
+	srand(0);
+
+	Test* test = scene.create();
+	test->m_world.SetTaskExecutor(executor);
+
+	result->name = scene.name;
+	result->frameCount = options.frameCount;
+	result->elapsed = 0.0;
+	result->bodySteps = 0.0;
+	result->scopeCount = 0;
+
+	b3Profiler profiler;
+	b3Profiler_profiler = &profiler;
+
+	b3Time timer;
+	for (u32 i = 0; i < options.frameCount; ++i)
+	{
+		profiler.Begin();
+		
+		timer.Update();
+		test->Step();
+		timer.Update();
+		
+		result->elapsed += timer.GetElapsedMilis();
+		result->bodySteps += double(test->m_world.GetBodyList().m_count);
+
+		if (profiler.GetRoot())
+		{
+			AddScopeTimes(result, profiler.GetRoot());
+		}
+
+		profiler.End();
+	}
+
+	b3Profiler_profiler = nullptr;
+
+	result->bodyCount = test->m_world.GetBodyList().m_count;
+	result->jointCount = test->m_world.GetJointList().m_count;
+	result->contactCount = test->m_world.GetContactList().m_count;
+
+	delete test;
+}
+
+// The state of a body compared by the determinism check.
+// This has no padding, so the states can be compared with memcmp.
+struct BodyState
+{
+	b3Vec3 position;
+	b3Quat orientation;
+	b3Vec3 linearVelocity;
+	b3Vec3 angularVelocity;
+};
+
+// Create a scene. The scenes use random numbers, so they must be created one at a time.
+static Test* CreateScene(const Scene& scene)
+{
+	srand(0);
+	return scene.create();
+}
+
+static void StepScene(Test* test, u32 frameCount)
+{
+	for (u32 i = 0; i < frameCount; ++i)
+	{
+		test->Step();
+	}
+}
+
+// Copy the state of the bodies of a scene in the order of the body list.
+static BodyState* GetBodyStates(Test* test, u32* count)
+{
+	const b3List<b3Body>& bodies = test->m_world.GetBodyList();
+
+	BodyState* states = (BodyState*)malloc(b3Max(bodies.m_count, 1u) * sizeof(BodyState));
+	
+	u32 stateCount = 0;
+	for (b3Body* b = bodies.m_head; b; b = b->GetNext())
+	{
+		BodyState* state = states + stateCount++;
+		state->position = b->GetPosition();
+		state->orientation = b->GetOrientation();
+		state->linearVelocity = b->GetLinearVelocity();
+		state->angularVelocity = b->GetAngularVelocity();
+	}
+
+	*count = stateCount;
+	return states;
+}
+
+// Step copies of a scene concurrently and count the copies that differ from a serial run.
+// Each copy has its own thread, allocation context, and optional thread pool.
+static u32 RunDeterminism(const Scene& scene, const Options& options)
+{
+	Test* reference = CreateScene(scene);
+	StepScene(reference, options.frameCount);
+
+	u32 referenceCount;
+	BodyState* referenceStates = GetBodyStates(reference, &referenceCount);
+
+	delete reference;
+
+	u32 worldCount = options.worldCount;
+	Test** tests = (Test**)malloc(worldCount * sizeof(Test*));
+	b3ThreadPool** threadPools = (b3ThreadPool**)malloc(worldCount * sizeof(b3ThreadPool*));
+	for (u32 i = 0; i < worldCount; ++i)
+	{
+		tests[i] = CreateScene(scene);
+		tests[i]->m_world.SetAllocContext(tests[i]);
+
+		threadPools[i] = nullptr;
+		if (options.threadCount > 0)
+		{
+			threadPools[i] = new b3ThreadPool(options.threadCount);
+			tests[i]->m_world.SetTaskExecutor(threadPools[i]);
+		}
+	}
+
+	b3Time timer;
+	
+	std::thread* threads = new std::thread[worldCount];
+	for (u32 i = 0; i < worldCount; ++i)
+	{
+		threads[i] = std::thread(StepScene, tests[i], options.frameCount);
+	}
+
+	for (u32 i = 0; i < worldCount; ++i)
+	{
+		threads[i].join();
+	}
+
+	timer.Update();
+
+	delete[] threads;
+
+	u32 mismatchCount = 0;
+	for (u32 i = 0; i < worldCount; ++i)
+	{
+		u32 count;
+		BodyState* states = GetBodyStates(tests[i], &count);
+		
+		if (count != referenceCount || memcmp(states, referenceStates, count * sizeof(BodyState)) != 0)
+		{
+			++mismatchCount;
+		}
+
+		free(states);
+
+		delete tests[i];
+		delete threadPools[i];
+	}
+
+	printf("%s\n", scene.name);
+	printf("  %u worlds, %u steps each in %.3f ms, %u differ from the serial run\n", 
+		worldCount, options.frameCount, timer.GetElapsedMilis(), mismatchCount);
+
+	free(threadPools);
+	free(tests);
+	free(referenceStates);
+
+	return mismatchCount;
+}
+
+// Step ropes one at a time and as a batch and compare the link positions.
+static void RunRopes(const Options& options, b3TaskExecutor* executor)
+{
+	const u32 e_maxLinks = 24;
+	const scalar dt = scalar(1) / scalar(60);
+	const b3Vec3 gravity(scalar(0), scalar(-9.8), scalar(0));
+
+	u32 ropeCount = options.ropeCount;
+
+	// Ropes with different link counts fill the packets of the batch unevenly.
+	b3RopeDef* defs = (b3RopeDef*)malloc(ropeCount * sizeof(b3RopeDef));
+	b3Vec3* vertices = (b3Vec3*)malloc(ropeCount * e_maxLinks * sizeof(b3Vec3));
+	scalar* masses = (scalar*)malloc(ropeCount * e_maxLinks * sizeof(scalar));
+	for (u32 i = 0; i < ropeCount; ++i)
+	{
+		b3RopeDef* def = defs + i;
+		*def = b3RopeDef();
+		def->count = 8 + (7 * i) % (e_maxLinks - 7);
+		def->vertices = vertices + i * e_maxLinks;
+		def->masses = masses + i * e_maxLinks;
+
+		for (u32 j = 0; j < def->count; ++j)
+		{
+			def->vertices[j].Set(scalar(i % 32), scalar(20) - scalar(0.25) * scalar(j), scalar(i / 32) + scalar(0.1) * scalar(j));
+			
+			// The base link of a rope is static.
+			def->masses[j] = j == 0 ? scalar(0) : scalar(1);
+		}
+	}
+
+	b3Rope** ropes = (b3Rope**)malloc(ropeCount * sizeof(b3Rope*));
+	for (u32 i = 0; i < ropeCount; ++i)
+	{
+		ropes[i] = new b3Rope(defs[i]);
+		ropes[i]->SetGravity(gravity);
+	}
+
+	b3RopeBatch batch(defs, ropeCount);
+	batch.SetGravity(gravity);
+	batch.SetTaskExecutor(executor);
+
+	b3Time timer;
+	for (u32 i = 0; i < options.frameCount; ++i)
+	{
+		for (u32 j = 0; j < ropeCount; ++j)
+		{
+			ropes[j]->Step(dt);
+		}
+	}
+	timer.Update();
+	double ropeElapsed = timer.GetElapsedMilis();
+
+	timer.Update();
+	for (u32 i = 0; i < options.frameCount; ++i)
+	{
+		batch.Step(dt);
+	}
+	timer.Update();
+	double batchElapsed = timer.GetElapsedMilis();
+
+	scalar maxDistance = scalar(0);
+	for (u32 i = 0; i < ropeCount; ++i)
+	{
+		for (u32 j = 0; j < defs[i].count; ++j)
+		{
+			b3Vec3 p1 = ropes[i]->GetLinkTransform(j).translation;
+			b3Vec3 p2 = batch.GetLinkTransform(i, j).translation;
+			maxDistance = b3Max(maxDistance, b3Length(p1 - p2));
+		}
+	}
+
+	printf("Ropes\n");
+	printf("  %u ropes, %u steps\n", ropeCount, options.frameCount);
+	printf("  b3Rope      %10.3f ms %10.4f ms/step\n", ropeElapsed, ropeElapsed / double(options.frameCount));
+	printf("  b3RopeBatch %10.3f ms %10.4f ms/step (%.2fx)\n", batchElapsed, batchElapsed / double(options.frameCount), 
+		batchElapsed > 0.0 ? ropeElapsed / batchElapsed : 0.0);
+	printf("  maximum link position difference %g\n", double(maxDistance));
+
+	for (u32 i = 0; i < ropeCount; ++i)
+	{
+		delete ropes[i];
+	}
+	free(ropes);
+	free(masses);
+	free(vertices);
+	free(defs);
+}
+
+static double GetBodyStepsPerSecond(const SceneResult& result)
+{
+	if (result.elapsed > 0.0)
+	{
+		return 1000.0 * result.bodySteps / result.elapsed;
+	}
+	return 0.0;
+}
+
+static void PrintResult(const SceneResult& result)
+{
+	printf("%s\n", result.name);
+	printf("  bodies %u, joints %u, contacts %u\n", result.bodyCount, result.jointCount, result.contactCount);
+	printf("  %u steps in %.3f ms (%.4f ms/step), %.0f body steps/s\n", 
+		result.frameCount, result.elapsed, result.elapsed / double(result.frameCount), GetBodyStepsPerSecond(result));
+
+	for (u32 i = 0; i < result.scopeCount; ++i)
+	{
+		const ScopeTime& scope = result.scopes[i];
+		printf("  %-28s %10.3f ms %10.4f ms/step %8u calls\n", 
+			scope.name, scope.elapsed, scope.elapsed / double(result.frameCount), scope.callCount);
+	}
+}
+
+static bool WriteJson(const char* path, const SceneResult* results, u32 resultCount, const Options& options)
+{
+	FILE* file = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"frames\": %u,\n", options.frameCount);
+	fprintf(file, "  \"threads\": %u,\n", options.threadCount);
+	fprintf(file, "  \"scalar_size\": %u,\n", u32(sizeof(scalar)));
+	fprintf(file, "  \"scenes\": [\n");
+	for (u32 i = 0; i < resultCount; ++i)
+	{
+		const SceneResult& result = results[i];
+
+		fprintf(file, "    {\n");
+		fprintf(file, "      \"name\": \"%s\",\n", result.name);
+		fprintf(file, "      \"bodies\": %u,\n", result.bodyCount);
+		fprintf(file, "      \"joints\": %u,\n", result.jointCount);
+		fprintf(file, "      \"contacts\": %u,\n", result.contactCount);
+		fprintf(file, "      \"total_ms\": %.6f,\n", result.elapsed);
+		fprintf(file, "      \"step_ms\": %.6f,\n", result.elapsed / double(result.frameCount));
+		fprintf(file, "      \"body_steps_per_second\": %.3f,\n", GetBodyStepsPerSecond(result));
+		fprintf(file, "      \"scopes\": {");
+		for (u32 j = 0; j < result.scopeCount; ++j)
+		{
+			const ScopeTime& scope = result.scopes[j];
+			fprintf(file, "%s\n        \"%s\": { \"total_ms\": %.6f, \"step_ms\": %.6f, \"calls\": %u }", 
+				j > 0 ? "," : "", scope.name, scope.elapsed, scope.elapsed / double(result.frameCount), scope.callCount);
+		}
+		fprintf(file, "\n      }\n");
+		fprintf(file, "    }%s\n", i + 1 < resultCount ? "," : "");
+	}
+	fprintf(file, "  ]\n");
+	fprintf(file, "}\n");
+
+	if (file != stdout)
+	{
+		fclose(file);
+	}
+
+	return true;
+}
+
+static void PrintUsage()
+{
+	printf("Usage: bounce_benchmark [options]\n");
+	printf("  --frames <count>   number of steps per scene (default 600)\n");
+	printf("  --threads <count>  run the steps on a thread pool with this many workers (default 0, no pool)\n");
+	printf("  --worlds <count>   step this many copies of each scene on their own threads and compare them\n");
+	printf("                     bit-for-bit with a serial run. Each copy gets its own pool of --threads workers\n");
+	printf("  --ropes <count>    step this many ropes as b3Rope objects and as a b3RopeBatch and compare them\n");
+	printf("  --scene <name>     run only the scenes whose name contains this string\n");
+	printf("  --json <path>      write the results as JSON to this file, or to stdout if the path is -\n");
+	printf("  --list             list the scenes\n");
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	options.frameCount = 600;
+	options.threadCount = 0;
+	options.worldCount = 0;
+	options.ropeCount = 0;
+	options.scene = nullptr;
+	options.jsonPath = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (strcmp(arg, "--list") == 0)
+		{
+			for (u32 j = 0; j < e_sceneCount; ++j)
+			{
+				printf("%s\n", s_scenes[j].name);
+			}
+			return 0;
+		}
+
+		if (value == nullptr)
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		if (strcmp(arg, "--frames") == 0)
+		{
+			options.frameCount = u32(atoi(value));
+		}
+		else if (strcmp(arg, "--threads") == 0)
+		{
+			options.threadCount = u32(atoi(value));
+		}
+		else if (strcmp(arg, "--worlds") == 0)
+		{
+			options.worldCount = u32(atoi(value));
+		}
+		else if (strcmp(arg, "--ropes") == 0)
+		{
+			options.ropeCount = u32(atoi(value));
+		}
+		else if (strcmp(arg, "--scene") == 0)
+		{
+			options.scene = value;
+		}
+		else if (strcmp(arg, "--json") == 0)
+		{
+			options.jsonPath = value;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		++i;
+	}
+
+	if (options.frameCount == 0)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	TestSettings settings;
+	g_testSettings = &settings;
+
+	if (options.worldCount > 0)
+	{
+		u32 mismatchCount = 0;
+		for (u32 i = 0; i < e_sceneCount; ++i)
+		{
+			const Scene& scene = s_scenes[i];
+			if (options.scene && strstr(scene.name, options.scene) == nullptr)
+			{
+				continue;
+			}
+
+			mismatchCount += RunDeterminism(scene, options);
+		}
+
+		g_testSettings = nullptr;
+
+		return mismatchCount > 0 ? 1 : 0;
+	}
+
+	b3ThreadPool* threadPool = nullptr;
+	if (options.threadCount > 0)
+	{
+		threadPool = new b3ThreadPool(options.threadCount);
+	}
+
+	if (options.ropeCount > 0)
+	{
+		RunRopes(options, threadPool);
+
+		delete threadPool;
+		g_testSettings = nullptr;
+
+		return 0;
+	}
+
+	SceneResult* results = (SceneResult*)malloc(e_sceneCount * sizeof(SceneResult));
+	u32 resultCount = 0;
+
+	// Keep stdout valid JSON if the results are written there.
+	bool printResults = options.jsonPath == nullptr || strcmp(options.jsonPath, "-") != 0;
+
+	for (u32 i = 0; i < e_sceneCount; ++i)
+	{
+		const Scene& scene = s_scenes[i];
+		if (options.scene && strstr(scene.name, options.scene) == nullptr)
+		{
+			continue;
+		}
+
+		SceneResult* result = results + resultCount++;
+		RunScene(result, scene, options, threadPool);
+		
+		if (printResults)
+		{
+			PrintResult(*result);
+		}
+	}
+
+	int status = 0;
+	if (options.jsonPath)
+	{
+		if (WriteJson(options.jsonPath, results, resultCount, options) == false)
+		{
+			fprintf(stderr, "Couldn't write %s\n", options.jsonPath);
+			status = 1;
+		}
+	}
+
+	free(results);
+	delete threadPool;
+	g_testSettings = nullptr;
+
+	return status;
+}
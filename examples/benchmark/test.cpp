@@ -0,0 +1,57 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "test.h"
+#include <stdlib.h>
+
+float RandomFloat(float a, float b)
+{
+	float r = float(rand()) / float(RAND_MAX);
+	float d = b - a;
+	return a + r * d;
+}
+
+void DrawString(const b3Color& color, const char* string, ...)
+{
+	B3_NOT_USED(color);
+	B3_NOT_USED(string);
+}
+
+Test::Test()
+{
+	m_world.SetContactListener(this);
+
+	m_groundHull.SetExtents(50.0f, 1.0f, 50.0f);
+
+	m_groundMesh.BuildTree();
+	m_groundMesh.BuildAdjacency();
+}
+
+Test::~Test()
+{
+}
+
+void Test::Step()
+{
+	scalar dt = g_testSettings->inv_hertz;
+
+	m_world.SetSleeping(g_testSettings->sleep);
+	m_world.SetWarmStart(g_testSettings->warmStart);
+	m_world.SetConvexCache(g_testSettings->convexCache);
+	m_world.Step(dt, g_testSettings->velocityIterations, g_testSettings->positionIterations);
+}
@@ -0,0 +1,83 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef TEST_H
+#define TEST_H
+
+// Only the key codes are used by the scenes. 
+// Nothing is linked against GLFW.
+#define GLFW_INCLUDE_NONE
+#include "GLFW/glfw3.h"
+
+#include <bounce/bounce.h>
+
+// A headless version of the testbed test. 
+// This lets the benchmark build the testbed scenes without a window.
+
+struct TestSettings
+{
+	TestSettings()
+	{
+		hertz = 60.0f;
+		inv_hertz = 1.0f / hertz;
+		velocityIterations = 8;
+		positionIterations = 2;
+		sleep = false;
+		warmStart = true;
+		convexCache = true;
+	}
+
+	float hertz, inv_hertz;
+	int velocityIterations;
+	int positionIterations;
+	bool sleep;
+	bool warmStart;
+	bool convexCache;
+};
+
+extern TestSettings* g_testSettings;
+
+float RandomFloat(float a, float b);
+
+// Text isn't drawn.
+void DrawString(const b3Color& color, const char* string, ...);
+
+class Test : public b3ContactListener
+{
+public:
+	Test();
+	virtual ~Test();
+
+	virtual void Step();
+
+	virtual void KeyDown(int) { }
+	virtual void KeyUp(int) { }
+
+	void BeginContact(b3Contact*) override { }
+	void EndContact(b3Contact*) override { }
+	void PreSolve(b3Contact*) override { }
+
+	b3World m_world;
+
+	b3BoxHull m_groundHull;
+	b3GridMesh<50, 50> m_groundMesh;
+};
+
+typedef Test* (*TestCreate)();
+
+#endif
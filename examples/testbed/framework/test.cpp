@@ -23,11 +23,6 @@ extern "C"
 #include <quickhull/quickhull.h>
 }
 
-extern u32 b3_allocCalls, b3_maxAllocCalls;
-extern u32 b3_convexCalls, b3_convexCacheHits;
-extern u32 b3_gjkCalls, b3_gjkIters, b3_gjkMaxIters;
-extern bool b3_convexCache;
-
 float RandomFloat(float a, float b)
 {
 	float r = float(rand()) / float(RAND_MAX);
@@ -101,9 +96,9 @@ Test::Test() :
 	
 	b3Draw_draw = &m_draw;
 	b3Profiler_profiler = g_profiler;
-	b3_convexCache = g_testSettings->convexCache;
 
 	m_world.SetContactListener(this);
+	m_world.SetStepStats(true);
 
 	m_ray.origin.SetZero();
 	m_ray.direction.Set(0.0f, 0.0f, -1.0f);
@@ -123,13 +118,13 @@ Test::~Test()
 
 void Test::Step()
 {
-	b3_convexCache = g_testSettings->convexCache;
-
 	// Step
 	scalar dt = g_testSettings->inv_hertz;
 
 	m_world.SetSleeping(g_testSettings->sleep);
 	m_world.SetWarmStart(g_testSettings->warmStart);
+	m_world.SetConvexCache(g_testSettings->convexCache);
+	m_world.SetContinuous(g_testSettings->continuous);
 	m_world.Step(dt, g_testSettings->velocityIterations, g_testSettings->positionIterations);
 
 	// Draw
@@ -157,24 +152,29 @@ void Test::Step()
 		DrawString(b3Color_white, "Joints %d", m_world.GetJointList().m_count);
 		DrawString(b3Color_white, "Contacts %d", m_world.GetContactList().m_count);
 
+		const b3StepStats& stats = m_world.GetStepStats();
+
+		DrawString(b3Color_white, "Islands %d", stats.islandCount);
+
 		scalar avgGjkIters = 0.0f;
-		if (b3_gjkCalls > 0)
+		if (stats.gjkCalls > 0)
 		{
-			avgGjkIters = scalar(b3_gjkIters) / scalar(b3_gjkCalls);
+			avgGjkIters = scalar(stats.gjkIters) / scalar(stats.gjkCalls);
 		}
 
-		DrawString(b3Color_white, "GJK Calls %d", b3_gjkCalls);
-		DrawString(b3Color_white, "GJK Iterations %d (%d) (%f)", b3_gjkIters, b3_gjkMaxIters, avgGjkIters);
+		DrawString(b3Color_white, "GJK Calls %d", stats.gjkCalls);
+		DrawString(b3Color_white, "GJK Iterations %d (%d) (%f)", stats.gjkIters, stats.gjkMaxIters, avgGjkIters);
 
 		scalar convexCacheHitRatio = 0.0f;
-		if (b3_convexCalls > 0)
+		if (stats.convexCalls > 0)
 		{
-			convexCacheHitRatio = scalar(b3_convexCacheHits) / scalar(b3_convexCalls);
+			convexCacheHitRatio = scalar(stats.convexCacheHits) / scalar(stats.convexCalls);
 		}
 
-		DrawString(b3Color_white, "Convex Calls %d", b3_convexCalls);
-		DrawString(b3Color_white, "Convex Cache Hits %d (%f)", b3_convexCacheHits, convexCacheHitRatio);
-		DrawString(b3Color_white, "Frame Allocations %d (%d)", b3_allocCalls, b3_maxAllocCalls);
+		DrawString(b3Color_white, "Convex Calls %d", stats.convexCalls);
+		DrawString(b3Color_white, "Convex Cache Hits %d (%f)", stats.convexCacheHits, convexCacheHitRatio);
+		DrawString(b3Color_white, "TOI Events %d", stats.toiEvents);
+		DrawString(b3Color_white, "Frame Allocations %d", stats.allocCalls);
 	}
 }
 
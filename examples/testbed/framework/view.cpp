@@ -374,6 +374,7 @@ void View::Interface()
 	ImGui::Checkbox("Sleep", &testSettings.sleep);
 	ImGui::Checkbox("Convex Cache", &testSettings.convexCache);
 	ImGui::Checkbox("Warm Start", &testSettings.warmStart);
+	ImGui::Checkbox("Continuous", &testSettings.continuous);
 
 	ImGui::PopItemWidth();
 
@@ -72,6 +72,7 @@
 #include "tests/multiple_pendulum.h"
 #include "tests/conveyor_belt.h"
 #include "tests/rope_test.h"
+#include "tests/articulation_test.h"
 
 TestSettings* g_testSettings = nullptr;
 Settings* g_settings = nullptr;
@@ -157,6 +158,7 @@ ViewModel::ViewModel(Model* model, View* view)
 	m_settings.RegisterTest("Multiple Pendulum", &MultiplePendulum::Create );
 	m_settings.RegisterTest("Conveyor Belt", &ConveyorBelt::Create );
 	m_settings.RegisterTest("Rope", &Rope::Create);
+	m_settings.RegisterTest("Articulation", &ArticulationTest::Create);
 }
 
 ViewModel::~ViewModel()
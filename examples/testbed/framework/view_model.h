@@ -64,6 +64,7 @@ struct TestSettings
 		sleep = false;
 		warmStart = true;
 		convexCache = true;
+		continuous = true;
 		drawCenterOfMasses = true;
 		drawShapes = true;
 		drawBounds = false;
@@ -80,6 +81,7 @@ struct TestSettings
 	bool sleep;
 	bool warmStart;
 	bool convexCache;
+	bool continuous;
 
 	bool drawCenterOfMasses;
 	bool drawBounds;
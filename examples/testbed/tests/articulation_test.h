@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef ARTICULATION_TEST_H
+#define ARTICULATION_TEST_H
+
+#include <bounce/rope/articulation.h>
+
+// A puppet hanging from a fixed base link.
+// Shoulders and hips are spherical joints. Elbows, knees, and the neck are revolute joints.
+class ArticulationTest : public Test
+{
+public:
+	enum
+	{
+		e_count = 11
+	};
+
+	ArticulationTest()
+	{
+		b3ArticulationLinkDef links[e_count];
+
+		// Base
+		links[0].position.Set(0.0f, 15.0f, 0.0f);
+		links[0].mass = 0.0f;
+
+		// Torso
+		links[1].parent = 0;
+		links[1].jointType = e_sphericalArticulationJoint;
+		links[1].position.Set(0.0f, 12.0f, 0.0f);
+		links[1].anchor.Set(0.0f, 15.0f, 0.0f);
+		links[1].mass = 5.0f;
+		links[1].inertia = b3Mat33Diagonal(2.0f);
+
+		// Head
+		links[2].parent = 1;
+		links[2].jointType = e_revoluteArticulationJoint;
+		links[2].position.Set(0.0f, 14.0f, 0.0f);
+		links[2].anchor.Set(0.0f, 13.5f, 0.0f);
+		links[2].axis.Set(1.0f, 0.0f, 0.0f);
+
+		// Arms
+		AddLimb(links, 3, b3Vec3(-1.0f, 13.0f, 0.0f), b3Vec3(-1.0f, 0.0f, 0.0f));
+		AddLimb(links, 5, b3Vec3(1.0f, 13.0f, 0.0f), b3Vec3(1.0f, 0.0f, 0.0f));
+
+		// Legs
+		AddLimb(links, 7, b3Vec3(-0.5f, 11.0f, 0.0f), b3Vec3(0.0f, -1.0f, 0.0f));
+		AddLimb(links, 9, b3Vec3(0.5f, 11.0f, 0.0f), b3Vec3(0.0f, -1.0f, 0.0f));
+
+		b3ArticulationDef def;
+		def.count = e_count;
+		def.links = links;
+		def.linearDamping = 0.1f;
+		def.angularDamping = 0.1f;
+
+		m_articulation = new b3Articulation(def);
+
+		m_articulation->SetGravity(b3Vec3(0.0f, -10.0f, 0.0f));
+		m_articulation->SetJointVelocity(1, b3Vec3(0.0f, 0.0f, 1.0f));
+	}
+
+	~ArticulationTest()
+	{
+		delete m_articulation;
+	}
+
+	// Add an upper and a lower limb to the torso starting at an anchor point and extending along a direction.
+	static void AddLimb(b3ArticulationLinkDef* links, u32 index, const b3Vec3& anchor, const b3Vec3& direction)
+	{
+		b3ArticulationLinkDef* upper = links + index;
+		upper->parent = 1;
+		upper->jointType = e_sphericalArticulationJoint;
+		upper->position = anchor + direction;
+		upper->anchor = anchor;
+
+		b3ArticulationLinkDef* lower = links + index + 1;
+		lower->parent = index;
+		lower->jointType = e_revoluteArticulationJoint;
+		lower->position = anchor + scalar(2) * direction;
+		lower->anchor = anchor + scalar(1.5) * direction;
+		lower->axis.Set(0.0f, 0.0f, 1.0f);
+	}
+
+	void Step()
+	{
+		Test::Step();
+
+		m_articulation->Step(g_testSettings->inv_hertz);
+
+		m_articulation->Draw();
+	}
+
+	static Test* Create()
+	{
+		return new ArticulationTest();
+	}
+
+	void KeyDown(int button)
+	{
+		if (button == GLFW_KEY_UP)
+		{
+			m_articulation->SetGravity(b3Vec3(0.0f, 10.0f, 0.0f));
+		}
+
+		if (button == GLFW_KEY_DOWN)
+		{
+			m_articulation->SetGravity(b3Vec3(0.0f, -10.0f, 0.0f));
+		}
+
+		if (button == GLFW_KEY_LEFT)
+		{
+			m_articulation->SetGravity(b3Vec3(-10.0f, 0.0f, 0.0f));
+		}
+
+		if (button == GLFW_KEY_RIGHT)
+		{
+			m_articulation->SetGravity(b3Vec3(10.0f, 0.0f, 0.0f));
+		}
+	}
+
+	b3Articulation* m_articulation;
+};
+
+#endif
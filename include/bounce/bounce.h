@@ -28,6 +28,8 @@
 
 #include <bounce/common/math/math.h>
 
+#include <bounce/common/thread/thread_pool.h>
+
 #include <bounce/collision/gjk/gjk.h>
 #include <bounce/collision/sat/sat.h>
 #include <bounce/collision/collision.h>
@@ -67,5 +69,6 @@
 #include <bounce/dynamics/fixture.h>
 #include <bounce/dynamics/world.h>
 #include <bounce/dynamics/world_listeners.h>
+#include <bounce/dynamics/world_snapshot.h>
 
 #endif
@@ -19,11 +19,13 @@
 #ifndef B3_BROAD_PHASE_H
 #define B3_BROAD_PHASE_H
 
-#include <bounce/collision/trees/dynamic_tree.h>
-#include <algorithm>
+#include <bounce/collision/geometry/aabb.h>
+#include <bounce/collision/collision.h>
 
 #define B3_NULL_PROXY B3_MAX_U32
 
+class b3TaskExecutor;
+
 // A pair of broad-phase proxies.
 struct b3Pair
 {
@@ -31,17 +33,70 @@ struct b3Pair
 	u32 proxy2;
 };
 
+// The broad-phase algorithms.
+enum b3BroadPhaseType
+{
+	e_dynamicTreeBroadPhase,
+	// AABB queries and ray casts are linear in the number of proxies.
+	e_sweepAndPruneBroadPhase,
+};
+
+// The callback functions used to notify a client of the broad-phase.
+typedef bool b3QueryProxyFcn(void* context, u32 proxyId);
+typedef scalar b3RayCastProxyFcn(void* context, const b3RayCastInput& input, u32 proxyId);
+typedef scalar b3RayCastPacketProxyFcn(void* context, const b3RayCastInput& input, u32 rayIndex, u32 proxyId);
+typedef void b3AddPairFcn(void* context, void* userDataA, void* userDataB);
+
+template<class T>
+inline bool b3QueryProxy(void* context, u32 proxyId)
+{
+	return ((T*)context)->Report(proxyId);
+}
+
+template<class T>
+inline scalar b3RayCastProxy(void* context, const b3RayCastInput& input, u32 proxyId)
+{
+	return ((T*)context)->Report(input, proxyId);
+}
+
+template<class T>
+inline scalar b3RayCastPacketProxy(void* context, const b3RayCastInput& input, u32 rayIndex, u32 proxyId)
+{
+	return ((T*)context)->Report(input, rayIndex, proxyId);
+}
+
+template<class T>
+inline void b3AddPair(void* context, void* userDataA, void* userDataB)
+{
+	((T*)context)->AddPair(userDataA, userDataB);
+}
+
 // The broad-phase interface. 
 // It is used to perform ray casts, volume queries, and overlapping queries 
 // against AABBs.
+// Implement this interface to add a new broad-phase algorithm.
 class b3BroadPhase 
 {
 public:
-	b3BroadPhase();
-	~b3BroadPhase();
+	// Create a broad-phase using a given algorithm.
+	static b3BroadPhase* Create(b3BroadPhaseType type);
+
+	// Destroy a broad-phase created with Create.
+	static void Destroy(b3BroadPhase* broadPhase);
+
+	virtual ~b3BroadPhase() { }
+
+	// Get the algorithm of this broad-phase.
+	b3BroadPhaseType GetType() const;
+
+	// Set the task executor used to find the overlapping pairs in parallel. 
+	// Pass nullptr to find the pairs on the calling thread.
+	void SetTaskExecutor(b3TaskExecutor* executor);
 
 	// Create a proxy and return a index to it.
-	u32 CreateProxy(const b3AABB& aabb, void* userData);
+	// Static proxies are expected to rarely move. 
+	// Pairs of static proxies are never reported.
+	u32 CreateProxy(const b3AABB& aabb, void* userData, bool isStatic);
 	
 	// Destroy a given proxy and remove it from the broadphase.
 	void DestroyProxy(u32 proxyId);
@@ -52,19 +107,19 @@ public:
 	bool MoveProxy(u32 proxyId, const b3AABB& aabb, const b3Vec3& displacement);
 
 	// Force move the proxy
-	void TouchProxy(u32 proxyId);
+	virtual void TouchProxy(u32 proxyId) = 0;
 
 	// Get the AABB of a given proxy.
-	const b3AABB& GetAABB(u32 proxyId) const;
+	virtual const b3AABB& GetAABB(u32 proxyId) const = 0;
 
 	// Get the user data attached to a proxy.
-	void* GetUserData(u32 proxyId) const;
+	virtual void* GetUserData(u32 proxyId) const = 0;
 
 	// Get the number of proxies.
 	u32 GetProxyCount() const;
 
 	// Test if two proxy AABBs are overlapping.
-	bool TestOverlap(u32 proxy1, u32 proxy2) const;
+	virtual bool TestOverlap(u32 proxy1, u32 proxy2) const = 0;
 	
 	// Notify the client callback the AABBs that are overlapping with the passed AABB.
 	template<class T>
@@ -75,53 +130,82 @@ public:
 	template<class T>
 	void RayCast(T* callback, const b3RayCastInput& input) const;
 
+	// Notify the client callback the AABBs that are overlapping the 
+	// passed packet of rays.
+	template<class T>
+	void RayCastPacket(T* callback, const b3RayCastInput* inputs, u32 count) const;
+
 	// Find and store overlapping AABB pairs.
 	// Notify the client callback the AABB pairs that are overlapping.
 	// The client must store the notified pairs.
 	template<class T>
 	void FindPairs(T* callback);
 
+	// Query the AABBs that are overlapping with the passed AABB.
+	// The callback must return false to stop the query.
+	virtual void QueryAABB(b3QueryProxyFcn* fcn, void* context, const b3AABB& aabb) const = 0;
+
+	// Query the AABBs that are overlapping the passed ray.
+	// The callback must return the new ray fraction or zero to stop the query.
+	virtual void RayCast(b3RayCastProxyFcn* fcn, void* context, const b3RayCastInput& input) const = 0;
+
+	// Query the AABBs that are overlapping a packet of up to b3_rayPacketSize rays.
+	// The callback must return the new fraction of a ray or zero to stop the ray.
+	// By default the rays are cast one by one.
+	virtual void RayCastPacket(b3RayCastPacketProxyFcn* fcn, void* context, const b3RayCastInput* inputs, u32 count) const;
+
+	// Notify the callback the AABB pairs that started overlapping since the last call.
+	virtual void FindPairs(b3AddPairFcn* fcn, void* context) = 0;
+
+	// Reinsert up to a given number of proxies to improve the proxy tree.
+	// Call this periodically if the tree degrades over time.
+	// By default this does nothing.
+	virtual void Optimize(u32 maxProxyCount);
+
+	// Get the height of the proxy tree. 
+	// By default this returns zero.
+	virtual u32 GetTreeHeight() const;
+
+	// Get the maximum height difference between the children of a node of the proxy tree.
+	// By default this returns zero.
+	virtual u32 GetTreeBalance() const;
+
+	// Get the ratio of the sum of the node areas to the root area of the proxy tree.
+	// This grows as the tree quality degrades. By default this returns zero.
+	virtual scalar GetTreeQuality() const;
+
 	// Draw the proxy AABBs.
-	void Draw() const;
-private :
-	friend class b3DynamicTree;
+	virtual void Draw() const = 0;
+protected:
+	b3BroadPhase(b3BroadPhaseType type);
 
-	void BufferMove(u32 proxyId);
-	void UnbufferMove(u32 proxyId);
-	
-	// The client callback used to add an overlapping pair
-	// to the overlapping pair buffer.
-	bool Report(u32 proxyId);
-	
-	// The dynamic tree.
-	b3DynamicTree m_tree;
+	// Insert a proxy with a fat AABB and return its index.
+	virtual u32 InsertProxy(const b3AABB& aabb, void* userData, bool isStatic) = 0;
 
-	// Number of proxies
-	u32 m_proxyCount;
+	// Remove a proxy.
+	virtual void RemoveProxy(u32 proxyId) = 0;
 
-	// The current proxy being queried for overlap with another proxies. 
-	// It is used to avoid a proxy overlap with itself.
-	u32 m_queryProxyId;
+	// Update a proxy with a fat AABB.
+	virtual void UpdateProxy(u32 proxyId, const b3AABB& aabb) = 0;
 
-	// The objects that have moved in a step.
-	u32* m_moveBuffer;
-	u32 m_moveBufferCount;
-	u32 m_moveBufferCapacity;
+	// Algorithm
+	b3BroadPhaseType m_type;
 
-	// The buffer holding the unique overlapping AABB pairs.
-	b3Pair* m_pairs;
-	u32 m_pairCapacity;
-	u32 m_pairCount;
+	// Task executor
+	b3TaskExecutor* m_executor;
+
+	// Number of proxies
+	u32 m_proxyCount;
 };
 
-inline const b3AABB& b3BroadPhase::GetAABB(u32 proxyId) const 
+inline b3BroadPhaseType b3BroadPhase::GetType() const
 {
-	return m_tree.GetAABB(proxyId);
+	return m_type;
 }
 
-inline void* b3BroadPhase::GetUserData(u32 proxyId) const 
+inline void b3BroadPhase::SetTaskExecutor(b3TaskExecutor* executor)
 {
-	return m_tree.GetUserData(proxyId);
+	m_executor = executor;
 }
 
 inline u32 b3BroadPhase::GetProxyCount() const
@@ -132,84 +216,25 @@ inline u32 b3BroadPhase::GetProxyCount() const
 template<class T>
 inline void b3BroadPhase::QueryAABB(T* callback, const b3AABB& aabb) const 
 {
-	return m_tree.QueryAABB(callback, aabb);
+	QueryAABB(b3QueryProxy<T>, callback, aabb);
 }
 
 template<class T>
 inline void b3BroadPhase::RayCast(T* callback, const b3RayCastInput& input) const 
 {
-	return m_tree.RayCast(callback, input);
+	RayCast(b3RayCastProxy<T>, callback, input);
 }
 
-static B3_FORCE_INLINE bool operator<(const b3Pair& pair1, const b3Pair& pair2) 
+template<class T>
+inline void b3BroadPhase::RayCastPacket(T* callback, const b3RayCastInput* inputs, u32 count) const 
 {
-	if (pair1.proxy1 < pair2.proxy1) 
-	{
-		return true;
-	}
-
-	if (pair1.proxy1 == pair2.proxy1) 
-	{
-		return pair1.proxy2 < pair2.proxy2;
-	}
-
-	return false;
+	RayCastPacket(b3RayCastPacketProxy<T>, callback, inputs, count);
 }
 
 template<class T>
 inline void b3BroadPhase::FindPairs(T* callback) 
 {
-	// Reset the overlapping pairs buffer count for the current step.
-	m_pairCount = 0;
-
-	// Notifying this class with QueryCallback(), gets the (duplicated) overlapping pair buffer.
-	for (u32 i = 0; i < m_moveBufferCount; ++i) 
-	{
-		// Keep the current queried proxy ID to avoid self overlapping.
-		m_queryProxyId = m_moveBuffer[i];
-
-		if (m_queryProxyId == B3_NULL_PROXY)
-		{
-			// Proxy was unbuffered
-			continue;
-		}
-
-		const b3AABB& aabb = m_tree.GetAABB(m_queryProxyId);
-		m_tree.QueryAABB(this, aabb);
-	}
-
-	// Reset the move buffer for the next step.
-	m_moveBufferCount = 0;
-
-	// Sort the (duplicated) overlapping pair buffer to prune duplicated pairs.
-	std::sort(m_pairs, m_pairs + m_pairCount);
-
-	// Skip duplicated overlapping pairs.
-	u32 index = 0;
-	while (index < m_pairCount) 
-	{
-		const b3Pair* primaryPair = m_pairs + index;
-
-		// Report an unique overlapping pair to the client.
-		callback->AddPair(m_tree.GetUserData(primaryPair->proxy1), m_tree.GetUserData(primaryPair->proxy2));
-
-		// Skip all duplicated pairs until an unique pair is found.
-		++index;
-		while (index < m_pairCount) 
-		{
-			const b3Pair* secondaryPair = m_pairs + index;
-			if (secondaryPair->proxy1 != primaryPair->proxy1 || secondaryPair->proxy2 != primaryPair->proxy2) 
-			{
-				break;
-			}
-			++index;
-		}
-	}
-}
-
-inline void b3BroadPhase::Draw() const
-{
-	m_tree.Draw();
+	FindPairs(b3AddPair<T>, callback);
 }
 
-#endif
\ No newline at end of file
+#endif
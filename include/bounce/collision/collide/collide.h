@@ -59,53 +59,68 @@ bool b3TestOverlap(const b3Transform& xf1, u32 index1, const b3Shape* shape1,
 	const b3Transform& xf2, u32 index2, const b3Shape* shape2,
 	b3ConvexCache* cache);
 
+// The manifold functions below also build the points of shapes that are separated by 
+// at most the given margin. These points have a positive separation and are used 
+// by speculative contacts.
+
 // Compute a manifold for two spheres.
 void b3CollideSphereAndSphere(b3Manifold& manifold, 
 	const b3Transform& xf1, const b3SphereShape* shape1, 
-	const b3Transform& xf2, const b3SphereShape* shape2);
+	const b3Transform& xf2, const b3SphereShape* shape2,
+	scalar margin = scalar(0));
 
 // Compute a manifold for a capsule and a sphere.
 void b3CollideCapsuleAndSphere(b3Manifold& manifold,
 	const b3Transform& xf1, const b3CapsuleShape* shape1,
-	const b3Transform& xf2, const b3SphereShape* shape2);
+	const b3Transform& xf2, const b3SphereShape* shape2,
+	scalar margin = scalar(0));
 
 // Compute a manifold for two capsules.
 void b3CollideCapsuleAndCapsule(b3Manifold& manifold, 
 	const b3Transform& xf1, const b3CapsuleShape* shape1, 
-	const b3Transform& xf2, const b3CapsuleShape* shape2);
+	const b3Transform& xf2, const b3CapsuleShape* shape2,
+	scalar margin = scalar(0));
 
 // Compute a manifold for a triangle and a sphere.
 void b3CollideTriangleAndSphere(b3Manifold& manifold,
 	const b3Transform& xf1, const b3TriangleShape* shape1,
-	const b3Transform& xf2, const b3SphereShape* shape2);
+	const b3Transform& xf2, const b3SphereShape* shape2,
+	scalar margin = scalar(0));
 
 // Compute a manifold for a triangle and a capsule.
 void b3CollideTriangleAndCapsule(b3Manifold& manifold,
 	const b3Transform& xf1, const b3TriangleShape* shape1,
-	const b3Transform& xf2, const b3CapsuleShape* shape2);
+	const b3Transform& xf2, const b3CapsuleShape* shape2,
+	scalar margin = scalar(0));
 
 // Compute a manifold for a triangle and a hull.
+// The cache is optional.
 void b3CollideTriangleAndHull(b3Manifold& manifold,
 	const b3Transform& xf1, const b3TriangleShape* shape1,
 	const b3Transform& xf2, const b3HullShape* shape2,
 	b3ConvexCache* cache, 
-	const b3Transform& xf01, const b3Transform& xf02);
+	const b3Transform& xf01, const b3Transform& xf02,
+	scalar margin = scalar(0));
 
 // Compute a manifold for a hull and a sphere.
 void b3CollideHullAndSphere(b3Manifold& manifold,
 	const b3Transform& xf1, const b3HullShape* shape1,
-	const b3Transform& xf2, const b3SphereShape* shape2);
+	const b3Transform& xf2, const b3SphereShape* shape2,
+	scalar margin = scalar(0));
 
 // Compute a manifold for a hull and a capsule.
 void b3CollideHullAndCapsule(b3Manifold& manifold,
 	const b3Transform& xf1, const b3HullShape* shape1,
-	const b3Transform& xf2, const b3CapsuleShape* shape2);
+	const b3Transform& xf2, const b3CapsuleShape* shape2,
+	scalar margin = scalar(0));
 
 // Compute a manifold for two hulls. 
+// The cache is optional.
 void b3CollideHullAndHull(b3Manifold& manifold, 
 	const b3Transform& xf1, const b3HullShape* shape1, 
 	const b3Transform& xf2, const b3HullShape* shape2,
 	b3ConvexCache* cache, 
-	const b3Transform& xf01, const b3Transform& xf02);
+	const b3Transform& xf01, const b3Transform& xf02,
+	scalar margin = scalar(0));
 
 #endif
\ No newline at end of file
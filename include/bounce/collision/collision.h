@@ -19,7 +19,12 @@
 #ifndef B3_COLLISION_H
 #define B3_COLLISION_H
 
-#include <bounce/common/math/vec3.h>
+#include <bounce/common/math/simd.h>
+
+// The maximum number of rays in a packet. 
+// The rays of a packet are tested against a node at once. 
+// This is the lane count of the build settings. See simd.h.
+const u32 b3_rayPacketSize = B3_SIMD_WIDTH;
 
 // Input for a ray cast.
 struct b3RayCastInput
@@ -24,6 +24,21 @@
 
 #define B3_NULL_VERTEX B3_MAX_U32
 
+class b3TaskExecutor;
+
+// The version of the mesh blob format. 
+// This is increased when the format of a mesh or a static tree changes.
+const u32 b3_meshBlobVersion = 3;
+
+// Minimum number of triangles to build the mesh adjacency in parallel.
+const u32 b3_minParallelAdjacencyCount = 4096;
+
+// Number of buckets the edges are distributed to when building the mesh adjacency in parallel.
+const u32 b3_meshAdjacencyBucketCount = 256;
+
+// Number of triangle chunks per executor worker when building the mesh adjacency in parallel.
+const u32 b3_meshAdjacencyChunksPerWorker = 4;
+
 // Mesh triangle.
 struct b3MeshTriangle
 {
@@ -62,15 +77,26 @@ struct b3Mesh
 
 	b3StaticTree tree;
 
+	// The blob this mesh points into, if any. 
+	// The vertices, triangles, wings and tree are owned by the blob if this is set.
+	const void* blob;
+
 	b3Mesh();
 	~b3Mesh();
 
 	// Build the static AABB tree. 
 	void BuildTree();
 
+	// Build the static AABB tree using the given parameters.
+	// Set the executor of the parameters to build the tree in parallel.
+	// Optionally output the build statistics.
+	void BuildTree(const b3StaticTreeDef& def, b3StaticTreeStats* stats = nullptr);
+
 	// Build mesh adjacency.
+	// Optionally pass a task executor to build the adjacency in parallel. 
+	// The adjacency is the same as the one built on the calling thread.
 	// This won't work properly if there are non-manifold edges.
-	void BuildAdjacency();
+	void BuildAdjacency(b3TaskExecutor* executor = nullptr);
 
 	const b3Vec3& GetVertex(u32 index) const;
 	const b3MeshTriangle* GetTriangle(u32 index) const;
@@ -79,6 +105,20 @@ struct b3Mesh
 	
 	u32 GetSize() const;
 
+	// Get the size in bytes of this mesh when written to a blob.
+	u32 GetBlobSize() const;
+
+	// Write this mesh, its adjacency and its tree to a blob of GetBlobSize() bytes.
+	// The blob must be aligned to b3_blobAlignment.
+	void WriteBlob(void* blob) const;
+
+	// Use a mesh written to a blob without copying or rebuilding it. 
+	// The blob can be a read-only file mapped into memory and shared by many meshes.
+	// The blob must not change until this mesh is destroyed. 
+	// This mesh must not be transformed after this.
+	// Return false if the blob is not a valid mesh for this platform.
+	bool ReadBlob(const void* blob, u32 size);
+
 	void Scale(const b3Vec3& scale);
 	void Rotate(const b3Quat& rotation);
 	void Translate(const b3Vec3& translation);
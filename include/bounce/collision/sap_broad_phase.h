@@ -0,0 +1,195 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SAP_BROAD_PHASE_H
+#define B3_SAP_BROAD_PHASE_H
+
+#include <bounce/collision/broad_phase.h>
+
+// An incremental sweep-and-prune broad-phase.
+// The proxy bounds are kept sorted on the three axes. 
+// A moved proxy is re-sorted using insertion sort, and 
+// the swaps of its bounds report the pairs that began overlapping. 
+// A pair is buffered when its last axis starts overlapping, so the pairs 
+// are reported without sorting them.
+// This is fast when the proxies move coherently but 
+// AABB queries and ray casts are linear in the number of proxies.
+// New proxies are appended unsorted. Their bounds are sorted and merged 
+// all at once in the next call to FindPairs, which then finds their pairs 
+// with a single sweep on the first axis.
+// Removed proxies are only flagged. Their bounds are removed all at once 
+// in the next call to FindPairs, or when a new proxy needs room.
+// Pairs that stop overlapping aren't buffered. 
+// The client must use TestOverlap to find them.
+class b3SAPBroadPhase : public b3BroadPhase
+{
+public:
+	b3SAPBroadPhase();
+	~b3SAPBroadPhase();
+
+	using b3BroadPhase::QueryAABB;
+	using b3BroadPhase::RayCast;
+	using b3BroadPhase::FindPairs;
+
+	void TouchProxy(u32 proxyId);
+
+	const b3AABB& GetAABB(u32 proxyId) const;
+
+	void* GetUserData(u32 proxyId) const;
+
+	bool TestOverlap(u32 proxy1, u32 proxy2) const;
+
+	// This is linear in the number of proxies.
+	void QueryAABB(b3QueryProxyFcn* fcn, void* context, const b3AABB& aabb) const;
+
+	// This is linear in the number of proxies.
+	void RayCast(b3RayCastProxyFcn* fcn, void* context, const b3RayCastInput& input) const;
+
+	void FindPairs(b3AddPairFcn* fcn, void* context);
+
+	void Draw() const;
+protected:
+	u32 InsertProxy(const b3AABB& aabb, void* userData, bool isStatic);
+	
+	void RemoveProxy(u32 proxyId);
+	
+	void UpdateProxy(u32 proxyId, const b3AABB& aabb);
+private:
+	// A bound of a proxy on an axis.
+	struct b3Endpoint
+	{
+		// Is this the upper bound?
+		bool IsMax() const
+		{
+			return (data & 1) != 0;
+		}
+
+		// The proxy of this bound.
+		u32 GetProxy() const
+		{
+			return data >> 1;
+		}
+
+		// The order of the bounds on an axis.
+		// A lower bound comes before an upper bound of the same value 
+		// because the overlap test is inclusive.
+		bool operator<(const b3Endpoint& other) const
+		{
+			if (value < other.value)
+			{
+				return true;
+			}
+			return value == other.value && IsMax() == false && other.IsMax();
+		}
+
+		scalar value;
+		u32 data;
+	};
+
+	struct b3Proxy
+	{
+		// The fat AABB.
+		b3AABB aabb;
+		
+		// The associated user data.
+		void* userData;
+		
+		// The indices of the bounds in the endpoint arrays.
+		// min[0] is B3_NULL_PROXY if the proxy is free.
+		u32 min[3];
+		u32 max[3];
+
+		// Is this a static proxy?
+		bool isStatic;
+
+		// Must this proxy find all its overlapping proxies in the next call to FindPairs?
+		bool isTouched;
+
+		// Was this proxy removed? 
+		// Its bounds are still in the endpoint arrays.
+		bool isRemoved;
+
+		// Next free or removed proxy.
+		u32 next;
+	};
+
+	// Sort an endpoint into place and buffer the pairs that began overlapping.
+	void SortEndpoint(u32 axis, u32 index);
+
+	// Sort the bounds of the new proxies and merge them with the sorted bounds.
+	void MergeNewEndpoints();
+
+	// Sweep the first axis and report the pairs of the touched proxies.
+	void FindTouchedPairs(b3AddPairFcn* fcn, void* context);
+
+	// Test if the bounds of two proxies overlap in the current order.
+	bool TestOrder(const b3Proxy* proxy1, const b3Proxy* proxy2) const;
+
+	// Remove the bounds of the removed proxies in a single pass and free the proxies.
+	void FreeRemovedProxies();
+
+	void BufferPair(u32 proxy1, u32 proxy2);
+	void BufferTouch(u32 proxyId);
+
+	// Proxies
+	b3Proxy* m_proxies;
+	u32 m_proxyCapacity;
+	u32 m_freeList;
+
+	// The removed proxies whose bounds are still in the endpoint arrays.
+	u32 m_removedList;
+	u32 m_removedCount;
+
+	// Bounds per axis. 
+	// The first m_sortedCount bounds are sorted. The bounds of the new proxies follow.
+	b3Endpoint* m_endpoints[3];
+	u32 m_endpointCount;
+	u32 m_sortedCount;
+	u32 m_endpointCapacity;
+
+	// The touched proxies.
+	u32* m_touchBuffer;
+	u32 m_touchCount;
+	u32 m_touchCapacity;
+
+	// The pairs that began overlapping since the last call to FindPairs.
+	b3Pair* m_pairs;
+	u32 m_pairCount;
+	u32 m_pairCapacity;
+};
+
+inline const b3AABB& b3SAPBroadPhase::GetAABB(u32 proxyId) const 
+{
+	B3_ASSERT(proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].aabb;
+}
+
+inline void* b3SAPBroadPhase::GetUserData(u32 proxyId) const 
+{
+	B3_ASSERT(proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].userData;
+}
+
+inline bool b3SAPBroadPhase::TestOverlap(u32 proxy1, u32 proxy2) const 
+{
+	B3_ASSERT(proxy1 < m_proxyCapacity);
+	B3_ASSERT(proxy2 < m_proxyCapacity);
+	return b3TestOverlap(m_proxies[proxy1].aabb, m_proxies[proxy2].aabb);
+}
+
+#endif
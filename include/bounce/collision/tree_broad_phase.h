@@ -0,0 +1,175 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_TREE_BROAD_PHASE_H
+#define B3_TREE_BROAD_PHASE_H
+
+#include <bounce/collision/broad_phase.h>
+#include <bounce/collision/trees/dynamic_tree.h>
+
+// The minimum number of static proxies inserted before the static tree is rebuilt.
+const u32 b3_minStaticTreeRebuildCount = 64;
+
+// The minimum number of moved proxies to find the pairs in parallel.
+const u32 b3_minParallelMoveCount = 256;
+
+// The minimum number of moved proxies queried by a task.
+const u32 b3_minMoveTaskRange = 32;
+
+struct b3PairBuffer;
+
+// A broad-phase that keeps the proxies in dynamic AABB trees.
+// Static and dynamic proxies are stored in separate trees. 
+// The proxies that have moved are queried against the trees to find 
+// the overlapping pairs. Static proxies are only queried against the dynamic tree.
+// The static tree is rebuilt top-down after many static proxies have been inserted.
+// If a task executor is set, the moved proxies are queried in parallel into 
+// per-worker pair buffers. The buffers are sorted and merged so the pairs are 
+// reported in the same order regardless of the number of workers.
+// Optimize and the tree getters refer to the tree of non-static proxies, 
+// because the static tree is rebuilt instead.
+class b3TreeBroadPhase : public b3BroadPhase
+{
+public:
+	b3TreeBroadPhase();
+	~b3TreeBroadPhase();
+
+	using b3BroadPhase::QueryAABB;
+	using b3BroadPhase::RayCast;
+	using b3BroadPhase::RayCastPacket;
+	using b3BroadPhase::FindPairs;
+
+	void TouchProxy(u32 proxyId);
+
+	const b3AABB& GetAABB(u32 proxyId) const;
+
+	void* GetUserData(u32 proxyId) const;
+
+	bool TestOverlap(u32 proxy1, u32 proxy2) const;
+
+	void QueryAABB(b3QueryProxyFcn* fcn, void* context, const b3AABB& aabb) const;
+
+	void RayCast(b3RayCastProxyFcn* fcn, void* context, const b3RayCastInput& input) const;
+
+	void RayCastPacket(b3RayCastPacketProxyFcn* fcn, void* context, const b3RayCastInput* inputs, u32 count) const;
+
+	void FindPairs(b3AddPairFcn* fcn, void* context);
+
+	void Optimize(u32 maxProxyCount);
+
+	u32 GetTreeHeight() const;
+
+	u32 GetTreeBalance() const;
+
+	scalar GetTreeQuality() const;
+
+	void Draw() const;
+protected:
+	u32 InsertProxy(const b3AABB& aabb, void* userData, bool isStatic);
+	
+	void RemoveProxy(u32 proxyId);
+	
+	void UpdateProxy(u32 proxyId, const b3AABB& aabb);
+private:
+	// A proxy is a node in one of the trees. 
+	// The lowest bit tells if the node is in the static tree.
+	static u32 MakeProxyId(u32 node, bool isStatic);
+	static bool IsStatic(u32 proxyId);
+	static u32 GetNode(u32 proxyId);
+
+	const b3DynamicTree* GetTree(u32 proxyId) const;
+	b3DynamicTree* GetTree(u32 proxyId);
+
+	void BufferMove(u32 proxyId);
+	void UnbufferMove(u32 proxyId);
+	
+	// Query the moved proxies in the range [begin, end) and add 
+	// the overlapping pairs to a pair buffer.
+	void QueryPairs(u32 begin, u32 end, b3PairBuffer* buffer) const;
+
+	// Task functions
+	static void QueryPairsTask(u32 begin, u32 end, u32 workerIndex, void* context);
+	static void SortPairsTask(u32 begin, u32 end, u32 workerIndex, void* context);
+	
+	// The tree of static proxies.
+	b3DynamicTree m_staticTree;
+
+	// The tree of non-static proxies.
+	b3DynamicTree m_dynamicTree;
+
+	// The number of static proxies.
+	u32 m_staticProxyCount;
+
+	// The number of static proxies inserted since the last static tree rebuild.
+	u32 m_staticInsertCount;
+
+	// Has the static tree changed since the last pair search?
+	bool m_staticTreeChanged;
+
+	// The objects that have moved in a step.
+	u32* m_moveBuffer;
+	u32 m_moveBufferCount;
+	u32 m_moveBufferCapacity;
+
+	// The buffers holding the (duplicated) overlapping AABB pairs. 
+	// There is one buffer per executor worker.
+	b3PairBuffer* m_pairBuffers;
+	u32 m_pairBufferCount;
+};
+
+inline u32 b3TreeBroadPhase::MakeProxyId(u32 node, bool isStatic)
+{
+	return (node << 1) | (isStatic ? 1 : 0);
+}
+
+inline bool b3TreeBroadPhase::IsStatic(u32 proxyId)
+{
+	return (proxyId & 1) != 0;
+}
+
+inline u32 b3TreeBroadPhase::GetNode(u32 proxyId)
+{
+	return proxyId >> 1;
+}
+
+inline const b3DynamicTree* b3TreeBroadPhase::GetTree(u32 proxyId) const
+{
+	return IsStatic(proxyId) ? &m_staticTree : &m_dynamicTree;
+}
+
+inline b3DynamicTree* b3TreeBroadPhase::GetTree(u32 proxyId)
+{
+	return IsStatic(proxyId) ? &m_staticTree : &m_dynamicTree;
+}
+
+inline const b3AABB& b3TreeBroadPhase::GetAABB(u32 proxyId) const 
+{
+	return GetTree(proxyId)->GetAABB(GetNode(proxyId));
+}
+
+inline void* b3TreeBroadPhase::GetUserData(u32 proxyId) const 
+{
+	return GetTree(proxyId)->GetUserData(GetNode(proxyId));
+}
+
+inline bool b3TreeBroadPhase::TestOverlap(u32 proxy1, u32 proxy2) const 
+{
+	return b3TestOverlap(GetAABB(proxy1), GetAABB(proxy2));
+}
+
+#endif
@@ -22,6 +22,7 @@
 #include <bounce/common/template/stack.h>
 #include <bounce/collision/geometry/aabb.h>
 #include <bounce/collision/collision.h>
+#include <bounce/collision/trees/wide_tree.h>
 
 #define B3_NULL_NODE_D B3_MAX_U32
 
@@ -63,12 +64,51 @@ public:
 	template<class T>
 	void RayCast(T* callback, const b3RayCastInput& input) const;
 
+	// Cast a packet of up to b3_rayPacketSize rays through this tree.
+	// The rays are tested against a node at once with SIMD. 
+	// The client callback is notified of the rays overlapping a leaf and 
+	// must return the new intersection fraction of the ray.
+	// If the fraction == 0 then the ray is stopped.
+	// A ray with a negative maximum fraction is skipped.
+	template<class T>
+	void RayCastPacket(T* callback, const b3RayCastInput* inputs, u32 count) const;
+
+	// Rebuild the hierarchy from the leaves using the binned SAH builder of b3StaticTree.
+	// This gives a higher quality tree than incremental insertions for 
+	// proxies that don't move. The leaf indices are preserved.
+	void RebuildTopDown();
+
+	// Collapse this tree into a wide tree. 
+	// The queries use the wide tree until this tree changes.
+	// This speeds up the queries on a tree that rarely changes.
+	void BuildWideTree();
+
+	// Is there a wide tree for the current state of this tree?
+	bool HasWideTree() const;
+
+	// Reinsert up to a given number of leaves into this tree.
+	// The leaves are visited in round-robin order across calls. 
+	// Call this periodically to improve a tree that degraded over time.
+	// The leaf indices are preserved.
+	void Optimize(u32 maxLeafCount);
+
+	// Get the height of this tree.
+	u32 GetHeight() const;
+
+	// Get the ratio of the sum of the node areas to the root area.
+	// This grows as the tree quality degrades.
+	scalar GetAreaRatio() const;
+
+	// Get the maximum height difference between the children of a node.
+	u32 GetMaxBalance() const;
+
 	// Validate a given node of this tree.
 	void Validate(u32 node) const;
 
 	// Draw this tree.
 	void Draw() const;
 private:
+
 	struct b3Node
 	{
 		// Is this node a leaf?
@@ -105,7 +145,8 @@ private:
 	void RemoveLeaf(u32 node);
 
 	// Rebuild the hierarchy starting from the given node.
-	void Refit(u32 node);
+	// Optionally rotate the nodes to reduce their surface area.
+	void Refit(u32 node, bool rotate);
 
 	// Pick the best node that can be merged with a given AABB.
 	u32 PickBest(const b3AABB& aabb) const;
@@ -123,6 +164,10 @@ private:
 	// Balance the tree.
 	u32 Balance(u32 index);
 
+	// Swap a child of a node with a grandchild if this 
+	// reduces the surface area of the node children.
+	void Rotate(u32 index);
+
 	// The root of this tree.
 	u32 m_root;
 
@@ -131,8 +176,142 @@ private:
 	u32 m_nodeCount;
 	u32 m_nodeCapacity;
 	u32 m_freeList;
+
+	// The next node visited by Optimize.
+	u32 m_optimizeCursor;
+
+	// The wide tree, if any. 
+	// This is cleared when this tree changes.
+	b3WideTree m_wideTree;
 };
 
+template<class T>
+inline void b3DynamicTree::RayCastPacket(T* callback, const b3RayCastInput* inputs, u32 count) const
+{
+	b3CheckSIMDWidth();
+	B3_ASSERT(count <= b3_rayPacketSize);
+
+	if (m_root == B3_NULL_NODE_D)
+	{
+		return;
+	}
+
+	// Store the rays in lanes.
+	// The unused lanes have a negative fraction, so they never overlap a node.
+	scalar px[b3_rayPacketSize], py[b3_rayPacketSize], pz[b3_rayPacketSize];
+	scalar ix[b3_rayPacketSize], iy[b3_rayPacketSize], iz[b3_rayPacketSize];
+	scalar maxFractions[b3_rayPacketSize];
+	for (u32 i = 0; i < b3_rayPacketSize; ++i)
+	{
+		if (i < count)
+		{
+			const b3RayCastInput& input = inputs[i];
+
+			b3Vec3 d = input.p2 - input.p1;
+			B3_ASSERT(b3LengthSquared(d) > scalar(0));
+
+			px[i] = input.p1.x;
+			py[i] = input.p1.y;
+			pz[i] = input.p1.z;
+
+			// A zero direction gets a large finite inverse, so no NaN is produced.
+			ix[i] = d.x != scalar(0) ? scalar(1) / d.x : B3_MAX_SCALAR;
+			iy[i] = d.y != scalar(0) ? scalar(1) / d.y : B3_MAX_SCALAR;
+			iz[i] = d.z != scalar(0) ? scalar(1) / d.z : B3_MAX_SCALAR;
+
+			maxFractions[i] = input.maxFraction;
+		}
+		else
+		{
+			px[i] = py[i] = pz[i] = scalar(0);
+			ix[i] = iy[i] = iz[i] = scalar(1);
+			maxFractions[i] = scalar(-1);
+		}
+	}
+
+	b3FloatW pxW = b3LoadW(px), pyW = b3LoadW(py), pzW = b3LoadW(pz);
+	b3FloatW ixW = b3LoadW(ix), iyW = b3LoadW(iy), izW = b3LoadW(iz);
+	b3FloatW maxFractionW = b3LoadW(maxFractions);
+	b3FloatW zero = b3SplatW(scalar(0));
+
+	b3Stack<u32, 256> stack;
+	stack.Push(m_root);
+
+	while (stack.IsEmpty() == false)
+	{
+		u32 nodeIndex = stack.Top();
+		stack.Pop();
+
+		const b3Node* node = m_nodes + nodeIndex;
+		
+		// Intersect the slabs of the node with all rays in the segment parameter.
+		const b3AABB& aabb = node->aabb;
+		b3FloatW tx1 = (b3SplatW(aabb.lowerBound.x) - pxW) * ixW;
+		b3FloatW tx2 = (b3SplatW(aabb.upperBound.x) - pxW) * ixW;
+		b3FloatW ty1 = (b3SplatW(aabb.lowerBound.y) - pyW) * iyW;
+		b3FloatW ty2 = (b3SplatW(aabb.upperBound.y) - pyW) * iyW;
+		b3FloatW tz1 = (b3SplatW(aabb.lowerBound.z) - pzW) * izW;
+		b3FloatW tz2 = (b3SplatW(aabb.upperBound.z) - pzW) * izW;
+
+		b3FloatW tmin = b3MaxW(b3MaxW(b3MinW(tx1, tx2), b3MinW(ty1, ty2)), b3MaxW(b3MinW(tz1, tz2), zero));
+		b3FloatW tmax = b3MinW(b3MinW(b3MaxW(tx1, tx2), b3MaxW(ty1, ty2)), b3MinW(b3MaxW(tz1, tz2), maxFractionW));
+
+		u32 bits = b3GetMaskBitsW(b3LessEqualW(tmin, tmax));
+		if (bits == 0)
+		{
+			continue;
+		}
+
+		if (node->IsLeaf() == false)
+		{
+			stack.Push(node->child1);
+			stack.Push(node->child2);
+			continue;
+		}
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			if ((bits & (1 << i)) == 0)
+			{
+				continue;
+			}
+
+			b3RayCastInput subInput;
+			subInput.p1 = inputs[i].p1;
+			subInput.p2 = inputs[i].p2;
+			subInput.maxFraction = maxFractions[i];
+
+			scalar newMaxFraction = callback->Report(subInput, i, nodeIndex);
+
+			if (newMaxFraction == scalar(0))
+			{
+				// The client has stopped the ray.
+				maxFractions[i] = scalar(-1);
+			}
+			else if (newMaxFraction > scalar(0))
+			{
+				maxFractions[i] = newMaxFraction;
+			}
+		}
+
+		maxFractionW = b3LoadW(maxFractions);
+	}
+}
+
+inline bool b3DynamicTree::HasWideTree() const
+{
+	return m_wideTree.GetNodeCount() > 0;
+}
+
+inline u32 b3DynamicTree::GetHeight() const
+{
+	if (m_root == B3_NULL_NODE_D)
+	{
+		return 0;
+	}
+	return m_nodes[m_root].height;
+}
+
 inline const b3AABB& b3DynamicTree::GetAABB(u32 proxyId) const
 {
 	B3_ASSERT(proxyId != B3_NULL_NODE_D && proxyId < m_nodeCapacity);
@@ -155,6 +334,13 @@ inline bool b3DynamicTree::TestOverlap(u32 proxy1, u32 proxy2) const
 template<class T>
 inline void b3DynamicTree::QueryAABB(T* callback, const b3AABB& aabb) const
 {
+	if (m_wideTree.GetNodeCount() > 0)
+	{
+		// The leaves of the wide tree are the proxies.
+		m_wideTree.QueryAABB(callback, aabb);
+		return;
+	}
+
 	b3Stack<u32, 256> stack;
 	stack.Push(m_root);
 
@@ -191,6 +377,12 @@ inline void b3DynamicTree::QueryAABB(T* callback, const b3AABB& aabb) const
 template<class T>
 inline void b3DynamicTree::RayCast(T* callback, const b3RayCastInput& input) const
 {
+	if (m_wideTree.GetNodeCount() > 0)
+	{
+		m_wideTree.RayCast(callback, input);
+		return;
+	}
+
 	b3Vec3 p1 = input.p1;
 	b3Vec3 p2 = input.p2;
 	b3Vec3 r = p2 - p1;
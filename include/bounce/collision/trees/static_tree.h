@@ -20,27 +20,125 @@
 #define B3_STATIC_TREE_H
 
 #include <bounce/common/template/stack.h>
+#include <bounce/common/memory/blob.h>
+#include <bounce/collision/trees/wide_tree.h>
 #include <bounce/collision/geometry/aabb.h>
 #include <bounce/collision/collision.h>
 
 #define B3_NULL_NODE_S B3_MAX_U32
 
+class b3TaskExecutor;
+
+// Maximum number of bins per axis used to build a static tree.
+const u32 b3_maxStaticTreeBins = 64;
+
+// Minimum number of AABBs to build a static tree in parallel.
+const u32 b3_minParallelTreeBuildCount = 4096;
+
+// Minimum number of AABBs in a node to bin them in parallel.
+const u32 b3_minParallelTreeBinCount = 8192;
+
+// Minimum number of AABBs binned by a task.
+const u32 b3_minTreeBinTaskRange = 1024;
+
+// Number of subtrees built per executor worker.
+const u32 b3_treeSubtreesPerWorker = 4;
+
+// Maximum number of AABBs in a leaf of a quantized or wide static tree.
+const u32 b3_maxCompressedLeafSize = 16;
+
+// Maximum number of AABBs in a quantized or wide static tree.
+const u32 b3_maxCompressedProxyCount = 1 << 27;
+
+// Static tree build parameters.
+struct b3StaticTreeDef
+{
+	b3StaticTreeDef()
+	{
+		maxLeafSize = 4;
+		binCount = 16;
+		traversalCost = scalar(1);
+		executor = nullptr;
+		quantize = false;
+		wide = false;
+	}
+
+	// The maximum number of AABBs in a leaf. 
+	// A set of AABBs becomes a leaf if it is not larger than this.
+	u32 maxLeafSize;
+
+	// The number of bins per axis used to evaluate the split candidates.
+	// This must be in the range [2, b3_maxStaticTreeBins].
+	u32 binCount;
+
+	// The cost of visiting a node relative to the cost of testing an AABB.
+	// This is used to compute the SAH cost of the tree.
+	scalar traversalCost;
+
+	// Optional task executor used to build the tree in parallel. 
+	// The tree is the same as the one built on the calling thread.
+	b3TaskExecutor* executor;
+
+	// Store the bounds of the nodes and AABBs using 16-bit integers. 
+	// This makes the nodes half as large with floats and a quarter as large with doubles.
+	// The stored bounds are slightly larger than the original bounds, so no overlap is missed.
+	// The maximum leaf size must not exceed b3_maxCompressedLeafSize.
+	bool quantize;
+
+	// Collapse the tree into a wide tree after it is built.
+	// A node of a wide tree tests the AABBs of b3_wideTreeWidth children at once using SIMD.
+	// The maximum leaf size must not exceed b3_maxCompressedLeafSize.
+	// This can't be combined with quantization.
+	bool wide;
+};
+
+// Static tree build statistics.
+struct b3StaticTreeStats
+{
+	// The expected cost of a query according to the surface area heuristic. 
+	scalar sahCost;
+
+	// The depth of the deepest leaf. The root has depth zero.
+	u32 depth;
+
+	// The number of nodes.
+	u32 nodeCount;
+
+	// The number of leaves.
+	u32 leafCount;
+};
+
 // AABB tree for static AABBs.
+// The tree is built top-down using the surface area heuristic (SAH) and 
+// each leaf can store many AABBs.
 class b3StaticTree 
 {
 public:
 	b3StaticTree();
 	~b3StaticTree();
 
-	// Build this tree from a list of AABBs.
+	// Build this tree from a list of AABBs using the default parameters.
 	void Build(const b3AABB* aabbs, u32 count);
 
+	// Build this tree from a list of AABBs. 
+	// Optionally output the build statistics.
+	void Build(const b3AABB* aabbs, u32 count, const b3StaticTreeDef& def, b3StaticTreeStats* stats = nullptr);
+
+	// Free the nodes of this tree so it can be built again.
+	void Clear();
+
 	// Get the AABB of a given proxy.
-	const b3AABB& GetAABB(u32 proxyId) const;
+	// This contains the AABB passed to Build if the tree is quantized.
+	b3AABB GetAABB(u32 proxyId) const;
 
 	// Get the user data associated with a given proxy.
+	// This is the index of the AABB passed to Build.
 	u32 GetUserData(u32 proxyId) const;
 
+	// Get the number of proxies in this tree.
+	// This is the number of AABBs passed to Build.
+	u32 GetProxyCount() const;
+
 	// Report the client callback all AABBs that are overlapping with
 	// the given AABB. The client callback must return true if the query 
 	// must be stopped or false to continue looking for more overlapping pairs.
@@ -58,47 +156,308 @@ public:
 
 	// Get the size in bytes of this tree.
 	u32 GetSize() const;
+
+	// Get the size in bytes of this tree when written to a blob.
+	u32 GetBlobSize() const;
+
+	// Write this tree to a blob of GetBlobSize() bytes.
+	// The blob must be aligned to b3_blobAlignment.
+	void WriteBlob(void* blob) const;
+
+	// Use a tree written to a blob without copying it. 
+	// The blob must not change until this tree is destroyed.
+	// Return false if the blob doesn't contain a valid tree.
+	// The nodes must form a tree whose leaves reference the proxies of the blob.
+	bool ReadBlob(const void* blob, u32 size);
 private :
+	friend struct b3StaticTreeBuilder;
+	friend class b3DynamicTree;
+
 	// A node in a static tree.
+	// The nodes are stored in depth-first order, so 
+	// the first child of an internal node is the next node.
 	struct b3Node
 	{
 		b3AABB aabb;
-		u32 child1;
 		union
 		{
 			u32 child2;
 			u32 index;
 		};
 
+		// Number of proxies in a leaf. This is zero for internal nodes.
+		u32 count;
+
 		// Is this node a leaf?
 		bool IsLeaf() const
 		{
-			return child1 == B3_NULL_NODE_S;
+			return count > 0;
 		}
 	};
 
-	// Build this tree recursively.
-	void BuildRecursively(const b3AABB* set, b3Node* node, u32* indices, u32 count, u32 minObjectsPerLeaf, u32 nodeCapacity, u32& leafCount, u32& internalCount);
-	
+	// A quantized AABB. 
+	// The bounds are stored as distances from the bounds of an enclosing AABB.
+	struct b3QuantizedAABB
+	{
+		u16 lower[3];
+		u16 upper[3];
+	};
+
+	// A quantized node in a static tree. 
+	// The AABB of a node is relative to the AABB of its parent.
+	struct b3QuantizedNode
+	{
+		b3QuantizedAABB aabb;
+		
+		// The second child of an internal node or the proxies of a leaf.
+		u32 data;
+
+		// Is this node a leaf?
+		bool IsLeaf() const
+		{
+			return (data & 0x80000000) != 0;
+		}
+
+		// Get the second child of an internal node.
+		u32 GetChild2() const
+		{
+			return data;
+		}
+
+		// Get the first proxy of a leaf.
+		u32 GetIndex() const
+		{
+			return GetLeafIndex(data);
+		}
+
+		// Get the number of proxies of a leaf.
+		u32 GetCount() const
+		{
+			return GetLeafCount(data);
+		}
+	};
+
+	// A node to visit in a quantized tree and its decoded AABB.
+	struct b3QuantizedStackNode
+	{
+		u32 node;
+		b3AABB aabb;
+	};
+
+	// Get the scale used to decode AABBs relative to a given AABB.
+	static b3Vec3 GetQuantizationScale(const b3AABB& aabb);
+
+	// Decode an AABB relative to a given AABB. 
+	static b3AABB Decode(const b3AABB& parent, const b3Vec3& scale, const b3QuantizedAABB& aabb);
+
+	// Convert the nodes and the proxy AABBs of this tree to quantized ones.
+	void Quantize();
+
+	// Collapse the nodes of this tree into a wide tree.
+	void Widen();
+
+	// Pack the proxies of a leaf into an integer.
+	// Check that the nodes of a blob form a tree and that the leaves 
+	// reference a given number of proxies. Either node array is given.
+	static bool CheckNodes(const b3Node* nodes, const b3QuantizedNode* quantizedNodes, u32 nodeCount, u32 proxyCount);
+
+	static u32 PackLeaf(u32 index, u32 count);
+	static u32 GetLeafIndex(u32 leaf);
+	static u32 GetLeafCount(u32 leaf);
+
+	// Adapt the callbacks of the queries to the leaves of the wide tree.
+	template<class T>
+	struct b3WideQueryCallback;
+
+	template<class T>
+	struct b3WideRayCastCallback;
+
+	template<class T>
+	void QueryQuantizedAABB(T* callback, const b3AABB& aabb) const;
+
+	template<class T>
+	void RayCastQuantized(T* callback, const b3RayCastInput& input) const;
+
+	// Compute the statistics of this tree.
+	void ComputeStats(b3StaticTreeStats* stats, scalar traversalCost) const;
+
+	// Test if a segment is overlapping with an AABB.
+	static bool TestSegment(const b3Vec3& p1, const b3Vec3& q2, const b3Vec3& r, const b3AABB& aabb);
+
 	// The root of this tree.
 	u32 m_root;
 
 	// The nodes of this tree stored in an array.
 	u32 m_nodeCount;
 	b3Node* m_nodes;
+
+	// The proxies of this tree. 
+	// The proxies in a leaf are stored contiguously.
+	u32 m_proxyCount;
+	b3AABB* m_proxyAABBs;
+	u32* m_proxyIndices;
+
+	// The quantized nodes and proxy AABBs of this tree, if it is quantized. 
+	// The nodes and proxy AABBs above are not used if this is set.
+	b3QuantizedNode* m_quantizedNodes;
+	b3QuantizedAABB* m_quantizedProxyAABBs;
+	b3AABB m_rootAABB;
+
+	// The wide tree, if this tree is wide. 
+	// The nodes above are not used if this is not empty.
+	b3WideTree m_wideTree;
+
+	// The blob containing the nodes and proxies, if any. 
+	// This tree doesn't own its memory if this is set.
+	const void* m_blob;
+};
+
+inline b3AABB b3StaticTree::GetAABB(u32 proxyId) const
+{
+	B3_ASSERT(proxyId < m_proxyCount);
+	if (m_quantizedNodes)
+	{
+		return Decode(m_rootAABB, GetQuantizationScale(m_rootAABB), m_quantizedProxyAABBs[proxyId]);
+	}
+	return m_proxyAABBs[proxyId];
+}
+
+inline u32 b3StaticTree::PackLeaf(u32 index, u32 count)
+{
+	B3_ASSERT(index < b3_maxCompressedProxyCount);
+	B3_ASSERT(count > 0 && count <= b3_maxCompressedLeafSize);
+	return ((count - 1) << 27) | index;
+}
+
+inline u32 b3StaticTree::GetLeafIndex(u32 leaf)
+{
+	return leaf & 0x07FFFFFF;
+}
+
+inline u32 b3StaticTree::GetLeafCount(u32 leaf)
+{
+	return ((leaf >> 27) & 0xF) + 1;
+}
+
+template<class T>
+struct b3StaticTree::b3WideQueryCallback
+{
+	bool Report(u32 leaf)
+	{
+		u32 index = GetLeafIndex(leaf);
+		u32 count = GetLeafCount(leaf);
+		for (u32 i = 0; i < count; ++i)
+		{
+			u32 proxyId = index + i;
+
+			if (b3TestOverlap(tree->m_proxyAABBs[proxyId], *aabb) == false)
+			{
+				continue;
+			}
+
+			if (callback->Report(proxyId) == false)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const b3StaticTree* tree;
+	T* callback;
+	const b3AABB* aabb;
 };
 
-inline const b3AABB& b3StaticTree::GetAABB(u32 proxyId) const
+template<class T>
+struct b3StaticTree::b3WideRayCastCallback
 {
-	B3_ASSERT(proxyId < m_nodeCount);
-	return m_nodes[proxyId].aabb;
+	scalar Report(const b3RayCastInput& input, u32 leaf)
+	{
+		b3Vec3 p1 = input.p1;
+		b3Vec3 p2 = input.p2;
+		b3Vec3 r = p2 - p1;
+		r.Normalize();
+
+		scalar maxFraction = input.maxFraction;
+		bool clipped = false;
+
+		u32 index = GetLeafIndex(leaf);
+		u32 count = GetLeafCount(leaf);
+		for (u32 i = 0; i < count; ++i)
+		{
+			u32 proxyId = index + i;
+			const b3AABB& proxyAABB = tree->m_proxyAABBs[proxyId];
+
+			b3Vec3 q2 = p1 + maxFraction * (p2 - p1);
+			
+			b3AABB segmentAABB;
+			segmentAABB.lowerBound = b3Min(p1, q2);
+			segmentAABB.upperBound = b3Max(p1, q2);
+
+			if (b3TestOverlap(segmentAABB, proxyAABB) == false)
+			{
+				continue;
+			}
+
+			if (TestSegment(p1, q2, r, proxyAABB) == false)
+			{
+				continue;
+			}
+
+			b3RayCastInput subInput;
+			subInput.p1 = input.p1;
+			subInput.p2 = input.p2;
+			subInput.maxFraction = maxFraction;
+
+			scalar newMaxFraction = callback->Report(subInput, proxyId);
+
+			if (newMaxFraction == scalar(0))
+			{
+				// The client has stopped the query.
+				return scalar(0);
+			}
+
+			if (newMaxFraction > scalar(0))
+			{
+				maxFraction = newMaxFraction;
+				clipped = true;
+			}
+		}
+
+		return clipped ? maxFraction : scalar(-1);
+	}
+
+	const b3StaticTree* tree;
+	T* callback;
+};
+
+inline b3Vec3 b3StaticTree::GetQuantizationScale(const b3AABB& aabb)
+{
+	return (scalar(1) / scalar(B3_MAX_U16)) * (aabb.upperBound - aabb.lowerBound);
+}
+
+inline b3AABB b3StaticTree::Decode(const b3AABB& parent, const b3Vec3& scale, const b3QuantizedAABB& aabb)
+{
+	// The upper bound is measured downwards from the upper bound of the parent, 
+	// so the AABBs touching the parent bounds are decoded exactly.
+	b3Vec3 lower(scalar(aabb.lower[0]), scalar(aabb.lower[1]), scalar(aabb.lower[2]));
+	b3Vec3 upper(scalar(aabb.upper[0]), scalar(aabb.upper[1]), scalar(aabb.upper[2]));
+
+	b3AABB result;
+	result.lowerBound = parent.lowerBound + b3Mul(scale, lower);
+	result.upperBound = parent.upperBound - b3Mul(scale, upper);
+	return result;
 }
 
 inline u32 b3StaticTree::GetUserData(u32 proxyId) const
 {
-	B3_ASSERT(proxyId < m_nodeCount);
-	B3_ASSERT(m_nodes[proxyId].IsLeaf());
-	return m_nodes[proxyId].index;
+	B3_ASSERT(proxyId < m_proxyCount);
+	return m_proxyIndices[proxyId];
+}
+
+inline u32 b3StaticTree::GetProxyCount() const
+{
+	return m_proxyCount;
 }
 
 template<class T>
@@ -109,6 +468,23 @@ inline void b3StaticTree::QueryAABB(T* callback, const b3AABB& aabb) const
 		return;
 	}
 
+	if (m_quantizedNodes)
+	{
+		QueryQuantizedAABB(callback, aabb);
+		return;
+	}
+
+	if (m_wideTree.GetNodeCount() > 0)
+	{
+		b3WideQueryCallback<T> wideCallback;
+		wideCallback.tree = this;
+		wideCallback.callback = callback;
+		wideCallback.aabb = &aabb;
+
+		m_wideTree.QueryAABB(&wideCallback, aabb);
+		return;
+	}
+
 	b3Stack<u32, 256> stack;
 	stack.Push(m_root);
 
@@ -116,11 +492,6 @@ inline void b3StaticTree::QueryAABB(T* callback, const b3AABB& aabb) const
 	{
 		u32 nodeIndex = stack.Top();
 
-		if (nodeIndex == B3_NULL_NODE_S)
-		{
-			continue;
-		}
-
 		stack.Pop();
 
 		const b3Node* node = m_nodes + nodeIndex;
@@ -129,20 +500,99 @@ inline void b3StaticTree::QueryAABB(T* callback, const b3AABB& aabb) const
 		{
 			if (node->IsLeaf() == true) 
 			{
-				if (callback->Report(nodeIndex) == false) 
+				for (u32 i = 0; i < node->count; ++i)
 				{
-					return;
+					u32 proxyId = node->index + i;
+
+					if (b3TestOverlap(m_proxyAABBs[proxyId], aabb) == false)
+					{
+						continue;
+					}
+
+					if (callback->Report(proxyId) == false) 
+					{
+						return;
+					}
 				}
 			}
 			else 
 			{
-				stack.Push(node->child1);
+				stack.Push(nodeIndex + 1);
 				stack.Push(node->child2);
 			}
 		}
 	}
 }
 
+inline bool b3StaticTree::TestSegment(const b3Vec3& p1, const b3Vec3& q2, const b3Vec3& r, const b3AABB& aabb)
+{
+	// Separating axis for segment (Gino, p80).
+	b3Vec3 c = aabb.GetCenter();
+	b3Vec3 h = aabb.GetExtents();
+
+	b3Vec3 s = p1 - c;
+	b3Vec3 t = q2 - c;
+
+	// |sigma + tau| > |sigma - tau| + 2 * eta
+	scalar sigma_1 = s.x;
+	scalar tau_1 = t.x;
+	scalar eta_1 = h.x;
+
+	scalar s1 = b3Abs(sigma_1 + tau_1) - (b3Abs(sigma_1 - tau_1) + scalar(2) * eta_1);
+	if (s1 > scalar(0))
+	{
+		return false;
+	}
+
+	scalar sigma_2 = s.y;
+	scalar tau_2 = t.y;
+	scalar eta_2 = h.y;
+
+	scalar s2 = b3Abs(sigma_2 + tau_2) - (b3Abs(sigma_2 - tau_2) + scalar(2) * eta_2);
+	if (s2 > scalar(0))
+	{
+		return false;
+	}
+
+	scalar sigma_3 = s.z;
+	scalar tau_3 = t.z;
+	scalar eta_3 = h.z;
+
+	scalar s3 = b3Abs(sigma_3 + tau_3) - (b3Abs(sigma_3 - tau_3) + scalar(2) * eta_3);
+	if (s3 > scalar(0))
+	{
+		return false;
+	}
+
+	// v = cross(ei, r)
+	// |dot(v, s)| > dot(|v|, h)
+	b3Vec3 v1 = b3Cross(b3Vec3_x, r);
+	b3Vec3 abs_v1 = b3Abs(v1);
+	scalar s4 = b3Abs(b3Dot(v1, s)) - b3Dot(abs_v1, h);
+	if (s4 > scalar(0))
+	{
+		return false;
+	}
+
+	b3Vec3 v2 = b3Cross(b3Vec3_y, r);
+	b3Vec3 abs_v2 = b3Abs(v2);
+	scalar s5 = b3Abs(b3Dot(v2, s)) - b3Dot(abs_v2, h);
+	if (s5 > scalar(0))
+	{
+		return false;
+	}
+
+	b3Vec3 v3 = b3Cross(b3Vec3_z, r);
+	b3Vec3 abs_v3 = b3Abs(v3);
+	scalar s6 = b3Abs(b3Dot(v3, s)) - b3Dot(abs_v3, h);
+	if (s6 > scalar(0))
+	{
+		return false;
+	}
+
+	return true;
+}
+
 template<class T>
 inline void b3StaticTree::RayCast(T* callback, const b3RayCastInput& input) const 
 {
@@ -151,6 +601,22 @@ inline void b3StaticTree::RayCast(T* callback, const b3RayCastInput& input) cons
 		return;
 	}
 
+	if (m_quantizedNodes)
+	{
+		RayCastQuantized(callback, input);
+		return;
+	}
+
+	if (m_wideTree.GetNodeCount() > 0)
+	{
+		b3WideRayCastCallback<T> wideCallback;
+		wideCallback.tree = this;
+		wideCallback.callback = callback;
+
+		m_wideTree.RayCast(&wideCallback, input);
+		return;
+	}
+
 	b3Vec3 p1 = input.p1;
 	b3Vec3 p2 = input.p2;
 	b3Vec3 r = p2 - p1;
@@ -168,10 +634,6 @@ inline void b3StaticTree::RayCast(T* callback, const b3RayCastInput& input) cons
 		segmentAABB.upperBound = b3Max(p1, q2);
 	}
 
-	b3Vec3 e1 = b3Vec3_x;
-	b3Vec3 e2 = b3Vec3_y;
-	b3Vec3 e3 = b3Vec3_z;
-
 	b3Stack<u32, 256> stack;
 	stack.Push(m_root);
 	
@@ -181,110 +643,241 @@ inline void b3StaticTree::RayCast(T* callback, const b3RayCastInput& input) cons
 
 		stack.Pop();
 
-		if (nodeIndex == B3_NULL_NODE_S)
+		const b3Node* node = m_nodes + nodeIndex;
+
+		if (b3TestOverlap(segmentAABB, node->aabb) == false)
 		{
 			continue;
 		}
 
-		const b3Node* node = m_nodes + nodeIndex;
-
-		if (b3TestOverlap(segmentAABB, node->aabb) == false)
+		if (TestSegment(p1, q2, r, node->aabb) == false)
 		{
 			continue;
 		}
 
-		// Separating axis for segment (Gino, p80).
-		b3Vec3 c = node->aabb.GetCenter();
-		b3Vec3 h = node->aabb.GetExtents();
+		if (node->IsLeaf() == true)
+		{
+			for (u32 i = 0; i < node->count; ++i)
+			{
+				u32 proxyId = node->index + i;
+				const b3AABB& proxyAABB = m_proxyAABBs[proxyId];
 
-		b3Vec3 s = p1 - c;
-		b3Vec3 t = q2 - c;
+				if (b3TestOverlap(segmentAABB, proxyAABB) == false)
+				{
+					continue;
+				}
 
-		// |sigma + tau| > |sigma - tau| + 2 * eta
-		scalar sigma_1 = s.x;
-		scalar tau_1 = t.x;
-		scalar eta_1 = h.x;
+				if (TestSegment(p1, q2, r, proxyAABB) == false)
+				{
+					continue;
+				}
 
-		scalar s1 = b3Abs(sigma_1 + tau_1) - (b3Abs(sigma_1 - tau_1) + scalar(2) * eta_1);
-		if (s1 > scalar(0))
-		{
-			continue;
-		}
+				b3RayCastInput subInput;
+				subInput.p1 = input.p1;
+				subInput.p2 = input.p2;
+				subInput.maxFraction = maxFraction;
 
-		scalar sigma_2 = s.y;
-		scalar tau_2 = t.y;
-		scalar eta_2 = h.y;
+				scalar newMaxFraction = callback->Report(subInput, proxyId);
 
-		scalar s2 = b3Abs(sigma_2 + tau_2) - (b3Abs(sigma_2 - tau_2) + scalar(2) * eta_2);
-		if (s2 > scalar(0))
+				if (newMaxFraction == scalar(0))
+				{
+					// The client has stopped the query.
+					return;
+				}
+
+				if (newMaxFraction > scalar(0))
+				{
+					// Update the segment AABB.
+					maxFraction = newMaxFraction;
+					q2 = p1 + maxFraction * (p2 - p1);
+					segmentAABB.lowerBound = b3Min(p1, q2);
+					segmentAABB.upperBound = b3Max(p1, q2);
+				}
+			}
+		}
+		else
 		{
-			continue;
+			stack.Push(nodeIndex + 1);
+			stack.Push(node->child2);
 		}
+	}
+}
+
+template<class T>
+inline void b3StaticTree::QueryQuantizedAABB(T* callback, const b3AABB& aabb) const
+{
+	if (b3TestOverlap(m_rootAABB, aabb) == false)
+	{
+		return;
+	}
 
-		scalar sigma_3 = s.z;
-		scalar tau_3 = t.z;
-		scalar eta_3 = h.z;
+	b3Vec3 rootScale = GetQuantizationScale(m_rootAABB);
 
-		scalar s3 = b3Abs(sigma_3 + tau_3) - (b3Abs(sigma_3 - tau_3) + scalar(2) * eta_3);
-		if (s3 > scalar(0))
+	b3Stack<b3QuantizedStackNode, 256> stack;
+	
+	b3QuantizedStackNode root;
+	root.node = m_root;
+	root.aabb = m_rootAABB;
+	stack.Push(root);
+
+	while (stack.IsEmpty() == false)
+	{
+		b3QuantizedStackNode stackNode = stack.Top();
+
+		stack.Pop();
+
+		const b3QuantizedNode* node = m_quantizedNodes + stackNode.node;
+
+		if (node->IsLeaf() == true)
 		{
-			continue;
-		}
+			u32 index = node->GetIndex();
+			u32 count = node->GetCount();
+			for (u32 i = 0; i < count; ++i)
+			{
+				u32 proxyId = index + i;
+
+				b3AABB proxyAABB = Decode(m_rootAABB, rootScale, m_quantizedProxyAABBs[proxyId]);
+				if (b3TestOverlap(proxyAABB, aabb) == false)
+				{
+					continue;
+				}
 
-		// v = cross(ei, r)
-		// |dot(v, s)| > dot(|v|, h)
-		b3Vec3 v1 = b3Cross(e1, r);
-		b3Vec3 abs_v1 = b3Abs(v1);
-		scalar s4 = b3Abs(b3Dot(v1, s)) - b3Dot(abs_v1, h);
-		if (s4 > scalar(0))
+				if (callback->Report(proxyId) == false)
+				{
+					return;
+				}
+			}
+		}
+		else
 		{
-			continue;
+			// The children are decoded and tested before they are pushed.
+			b3Vec3 scale = GetQuantizationScale(stackNode.aabb);
+
+			u32 child2 = node->GetChild2();
+			b3QuantizedStackNode stackNode2;
+			stackNode2.node = child2;
+			stackNode2.aabb = Decode(stackNode.aabb, scale, m_quantizedNodes[child2].aabb);
+			if (b3TestOverlap(stackNode2.aabb, aabb) == true)
+			{
+				stack.Push(stackNode2);
+			}
+
+			u32 child1 = stackNode.node + 1;
+			b3QuantizedStackNode stackNode1;
+			stackNode1.node = child1;
+			stackNode1.aabb = Decode(stackNode.aabb, scale, m_quantizedNodes[child1].aabb);
+			if (b3TestOverlap(stackNode1.aabb, aabb) == true)
+			{
+				stack.Push(stackNode1);
+			}
 		}
+	}
+}
+
+template<class T>
+inline void b3StaticTree::RayCastQuantized(T* callback, const b3RayCastInput& input) const
+{
+	b3Vec3 p1 = input.p1;
+	b3Vec3 p2 = input.p2;
+	b3Vec3 r = p2 - p1;
+	B3_ASSERT(b3LengthSquared(r) > scalar(0));
+	r.Normalize();
+
+	scalar maxFraction = input.maxFraction;
+
+	// Build an AABB for the segment.
+	b3Vec3 q2;
+	b3AABB segmentAABB;
+	{
+		q2 = p1 + maxFraction * (p2 - p1);
+		segmentAABB.lowerBound = b3Min(p1, q2);
+		segmentAABB.upperBound = b3Max(p1, q2);
+	}
+
+	b3Vec3 rootScale = GetQuantizationScale(m_rootAABB);
 
-		b3Vec3 v2 = b3Cross(e2, r);
-		b3Vec3 abs_v2 = b3Abs(v2);
-		scalar s5 = b3Abs(b3Dot(v2, s)) - b3Dot(abs_v2, h);
-		if (s5 > scalar(0))
+	b3Stack<b3QuantizedStackNode, 256> stack;
+
+	b3QuantizedStackNode root;
+	root.node = m_root;
+	root.aabb = m_rootAABB;
+	stack.Push(root);
+
+	while (stack.IsEmpty() == false)
+	{
+		b3QuantizedStackNode stackNode = stack.Top();
+
+		stack.Pop();
+
+		if (b3TestOverlap(segmentAABB, stackNode.aabb) == false)
 		{
 			continue;
 		}
 
-		b3Vec3 v3 = b3Cross(e3, r);
-		b3Vec3 abs_v3 = b3Abs(v3);
-		scalar s6 = b3Abs(b3Dot(v3, s)) - b3Dot(abs_v3, h);
-		if (s6 > scalar(0))
+		if (TestSegment(p1, q2, r, stackNode.aabb) == false)
 		{
 			continue;
 		}
 
+		const b3QuantizedNode* node = m_quantizedNodes + stackNode.node;
+
 		if (node->IsLeaf() == true)
 		{
-			b3RayCastInput subInput;
-			subInput.p1 = input.p1;
-			subInput.p2 = input.p2;
-			subInput.maxFraction = maxFraction;
+			u32 index = node->GetIndex();
+			u32 count = node->GetCount();
+			for (u32 i = 0; i < count; ++i)
+			{
+				u32 proxyId = index + i;
+				b3AABB proxyAABB = Decode(m_rootAABB, rootScale, m_quantizedProxyAABBs[proxyId]);
 
-			scalar newMaxFraction = callback->Report(subInput, nodeIndex);
+				if (b3TestOverlap(segmentAABB, proxyAABB) == false)
+				{
+					continue;
+				}
 
-			if (newMaxFraction == scalar(0))
-			{
-				// The client has stopped the query.
-				return;
-			}
+				if (TestSegment(p1, q2, r, proxyAABB) == false)
+				{
+					continue;
+				}
 
-			if (newMaxFraction > scalar(0))
-			{
-				// Update the segment AABB.
-				maxFraction = newMaxFraction;
-				q2 = p1 + maxFraction * (p2 - p1);
-				segmentAABB.lowerBound = b3Min(p1, q2);
-				segmentAABB.upperBound = b3Max(p1, q2);
+				b3RayCastInput subInput;
+				subInput.p1 = input.p1;
+				subInput.p2 = input.p2;
+				subInput.maxFraction = maxFraction;
+
+				scalar newMaxFraction = callback->Report(subInput, proxyId);
+
+				if (newMaxFraction == scalar(0))
+				{
+					// The client has stopped the query.
+					return;
+				}
+
+				if (newMaxFraction > scalar(0))
+				{
+					// Update the segment AABB.
+					maxFraction = newMaxFraction;
+					q2 = p1 + maxFraction * (p2 - p1);
+					segmentAABB.lowerBound = b3Min(p1, q2);
+					segmentAABB.upperBound = b3Max(p1, q2);
+				}
 			}
 		}
 		else
 		{
-			stack.Push(node->child1);
-			stack.Push(node->child2);
+			b3Vec3 scale = GetQuantizationScale(stackNode.aabb);
+			
+			u32 child2 = node->GetChild2();
+			b3QuantizedStackNode stackNode2;
+			stackNode2.node = child2;
+			stackNode2.aabb = Decode(stackNode.aabb, scale, m_quantizedNodes[child2].aabb);
+			stack.Push(stackNode2);
+
+			u32 child1 = stackNode.node + 1;
+			b3QuantizedStackNode stackNode1;
+			stackNode1.node = child1;
+			stackNode1.aabb = Decode(stackNode.aabb, scale, m_quantizedNodes[child1].aabb);
+			stack.Push(stackNode1);
 		}
 	}
 }
@@ -293,7 +886,22 @@ inline u32 b3StaticTree::GetSize() const
 {
 	u32 size = 0;
 	size += sizeof(b3StaticTree);
-	size += m_nodeCount * sizeof(b3Node);
+	if (m_quantizedNodes)
+	{
+		size += m_nodeCount * sizeof(b3QuantizedNode);
+		size += m_proxyCount * sizeof(b3QuantizedAABB);
+	}
+	else if (m_wideTree.GetNodeCount() > 0)
+	{
+		size += m_wideTree.GetSize() - sizeof(b3WideTree);
+		size += m_proxyCount * sizeof(b3AABB);
+	}
+	else
+	{
+		size += m_nodeCount * sizeof(b3Node);
+		size += m_proxyCount * sizeof(b3AABB);
+	}
+	size += m_proxyCount * sizeof(u32);
 	return size;
 }
 
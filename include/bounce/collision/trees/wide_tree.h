@@ -0,0 +1,373 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_WIDE_TREE_H
+#define B3_WIDE_TREE_H
+
+#include <bounce/common/template/stack.h>
+#include <bounce/common/math/simd.h>
+#include <bounce/common/memory/blob.h>
+#include <bounce/collision/geometry/aabb.h>
+#include <bounce/collision/collision.h>
+
+#define B3_NULL_NODE_W B3_MAX_U32
+
+// The number of children of a node in a wide tree. 
+// This is the lane count of the build settings. See simd.h.
+const u32 b3_wideTreeWidth = B3_SIMD_WIDTH;
+
+// The largest leaf value that can be stored in a wide tree.
+const u32 b3_maxWideTreeLeaf = 0x7FFFFFFF;
+
+// A node of a binary tree used to build a wide tree.
+struct b3WideTreeSourceNode
+{
+	// Is this node a leaf?
+	bool IsLeaf() const
+	{
+		return child1 == B3_NULL_NODE_W;
+	}
+
+	b3AABB aabb;
+	u32 child1, child2;
+
+	// The value reported for a leaf. This must not exceed b3_maxWideTreeLeaf.
+	u32 leaf;
+};
+
+// AABB tree where each node has b3_wideTreeWidth children. 
+// A wide tree is built by collapsing a binary tree. 
+// The bounds of the children of a node are stored in SIMD lanes, so 
+// the children are tested at once when the node is visited.
+class b3WideTree
+{
+public:
+	b3WideTree();
+	~b3WideTree();
+
+	// Build this tree from a binary tree. 
+	// The nodes of the binary tree are indexed by their children.
+	void Build(const b3WideTreeSourceNode* nodes, u32 nodeCount, u32 root);
+
+	// Remove all nodes of this tree.
+	void Clear();
+
+	// Report the client callback the leaves whose AABB overlaps with
+	// the given AABB. The client callback must return false if the query 
+	// must be stopped or true to continue.
+	template<class T>
+	void QueryAABB(T* callback, const b3AABB& aabb) const;
+
+	// Report the client callback the leaves whose AABB overlaps with
+	// the given segment. The client callback must return the new intersection fraction. 
+	// If the fraction == 0 then the query is cancelled immediately.
+	template<class T>
+	void RayCast(T* callback, const b3RayCastInput& input) const;
+
+	// Get the number of nodes of this tree.
+	u32 GetNodeCount() const;
+
+	// Get the size in bytes of this tree.
+	u32 GetSize() const;
+
+	// Get the size in bytes of this tree when written to a blob.
+	u32 GetBlobSize() const;
+
+	// Write this tree to a blob of GetBlobSize() bytes.
+	// The blob must be aligned to b3_blobAlignment.
+	void WriteBlob(void* blob) const;
+
+	// Use a tree written to a blob without copying it. 
+	// The blob must not change until this tree is destroyed.
+	// Return false if the blob doesn't contain a valid tree.
+	// The children of the nodes are checked, the leaves are not.
+	bool ReadBlob(const void* blob, u32 size);
+
+	// Report the client callback the value of each leaf of this tree. 
+	// The client callback must return false to stop.
+	// Return false if the callback has stopped.
+	template<class T>
+	bool ReportLeaves(T* callback) const;
+
+	// Draw this tree.
+	void Draw() const;
+private:
+	// A node in a wide tree. 
+	// The empty children have an empty AABB, so they never overlap.
+	struct b3WideNode
+	{
+		// The AABBs of the children.
+		scalar lowerX[b3_wideTreeWidth];
+		scalar lowerY[b3_wideTreeWidth];
+		scalar lowerZ[b3_wideTreeWidth];
+		scalar upperX[b3_wideTreeWidth];
+		scalar upperY[b3_wideTreeWidth];
+		scalar upperZ[b3_wideTreeWidth];
+
+		// The children. A child is either a node, a leaf or null.
+		u32 children[b3_wideTreeWidth];
+	};
+
+	// Is a child a leaf?
+	static bool IsLeaf(u32 child);
+
+	// Get the value of a leaf child.
+	static u32 GetLeaf(u32 child);
+
+	// Get the children of a node overlapping with an AABB as bits.
+	static u32 TestOverlap(const b3WideNode* node, const b3AABB& aabb);
+
+	// The nodes of this tree. The root is the first node.
+	u32 m_nodeCount;
+	b3WideNode* m_nodes;
+
+	// The blob containing the nodes, if any. 
+	// This tree doesn't own its memory if this is set.
+	const void* m_blob;
+};
+
+inline u32 b3WideTree::GetNodeCount() const
+{
+	return m_nodeCount;
+}
+
+inline u32 b3WideTree::GetSize() const
+{
+	return sizeof(b3WideTree) + m_nodeCount * sizeof(b3WideNode);
+}
+
+inline bool b3WideTree::IsLeaf(u32 child)
+{
+	return child != B3_NULL_NODE_W && (child & 0x80000000) != 0;
+}
+
+inline u32 b3WideTree::GetLeaf(u32 child)
+{
+	return child & b3_maxWideTreeLeaf;
+}
+
+inline u32 b3WideTree::TestOverlap(const b3WideNode* node, const b3AABB& aabb)
+{
+	// d1 = b.lower - a.upper 
+	// d2 = a.lower - b.upper
+	// The AABBs overlap if all components of d1 and d2 are non-positive.
+	b3FloatW mask = b3LessEqualW(b3LoadW(node->lowerX), b3SplatW(aabb.upperBound.x));
+	mask = b3AndW(mask, b3LessEqualW(b3LoadW(node->lowerY), b3SplatW(aabb.upperBound.y)));
+	mask = b3AndW(mask, b3LessEqualW(b3LoadW(node->lowerZ), b3SplatW(aabb.upperBound.z)));
+	mask = b3AndW(mask, b3LessEqualW(b3SplatW(aabb.lowerBound.x), b3LoadW(node->upperX)));
+	mask = b3AndW(mask, b3LessEqualW(b3SplatW(aabb.lowerBound.y), b3LoadW(node->upperY)));
+	mask = b3AndW(mask, b3LessEqualW(b3SplatW(aabb.lowerBound.z), b3LoadW(node->upperZ)));
+	return b3GetMaskBitsW(mask);
+}
+
+template<class T>
+inline bool b3WideTree::ReportLeaves(T* callback) const
+{
+	for (u32 i = 0; i < m_nodeCount; ++i)
+	{
+		const b3WideNode* node = m_nodes + i;
+		for (u32 lane = 0; lane < b3_wideTreeWidth; ++lane)
+		{
+			u32 child = node->children[lane];
+			if (IsLeaf(child) == false)
+			{
+				continue;
+			}
+
+			if (callback->Report(GetLeaf(child)) == false)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+template<class T>
+inline void b3WideTree::QueryAABB(T* callback, const b3AABB& aabb) const
+{
+	b3CheckSIMDWidth();
+
+	if (m_nodeCount == 0)
+	{
+		return;
+	}
+
+	b3Stack<u32, 256> stack;
+	stack.Push(0);
+
+	while (stack.IsEmpty() == false)
+	{
+		u32 nodeIndex = stack.Top();
+		stack.Pop();
+
+		const b3WideNode* node = m_nodes + nodeIndex;
+
+		u32 bits = TestOverlap(node, aabb);
+
+		// Visit the children in order. 
+		// The nodes are pushed in reverse order.
+		for (u32 i = 0; i < b3_wideTreeWidth; ++i)
+		{
+			u32 lane = b3_wideTreeWidth - 1 - i;
+			if ((bits & (1 << lane)) == 0)
+			{
+				continue;
+			}
+
+			u32 child = node->children[lane];
+			if (IsLeaf(child) == false)
+			{
+				stack.Push(child);
+			}
+		}
+
+		for (u32 lane = 0; lane < b3_wideTreeWidth; ++lane)
+		{
+			if ((bits & (1 << lane)) == 0)
+			{
+				continue;
+			}
+
+			u32 child = node->children[lane];
+			if (IsLeaf(child) == true)
+			{
+				if (callback->Report(GetLeaf(child)) == false)
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
+template<class T>
+inline void b3WideTree::RayCast(T* callback, const b3RayCastInput& input) const
+{
+	b3CheckSIMDWidth();
+
+	if (m_nodeCount == 0)
+	{
+		return;
+	}
+
+	b3Vec3 p1 = input.p1;
+	b3Vec3 p2 = input.p2;
+	b3Vec3 d = p2 - p1;
+	B3_ASSERT(b3LengthSquared(d) > scalar(0));
+
+	scalar maxFraction = input.maxFraction;
+
+	// Build an AABB for the segment.
+	b3Vec3 q2;
+	b3AABB segmentAABB;
+	{
+		q2 = p1 + maxFraction * d;
+		segmentAABB.lowerBound = b3Min(p1, q2);
+		segmentAABB.upperBound = b3Max(p1, q2);
+	}
+
+	// The slabs are intersected in the segment parameter. 
+	// A zero direction gets a large finite inverse, so no NaN is produced.
+	b3Vec3 invD;
+	for (u32 i = 0; i < 3; ++i)
+	{
+		invD[i] = d[i] != scalar(0) ? scalar(1) / d[i] : B3_MAX_SCALAR;
+	}
+
+	b3FloatW px = b3SplatW(p1.x), py = b3SplatW(p1.y), pz = b3SplatW(p1.z);
+	b3FloatW ix = b3SplatW(invD.x), iy = b3SplatW(invD.y), iz = b3SplatW(invD.z);
+	b3FloatW zero = b3SplatW(scalar(0));
+
+	b3Stack<u32, 256> stack;
+	stack.Push(0);
+
+	while (stack.IsEmpty() == false)
+	{
+		u32 nodeIndex = stack.Top();
+		stack.Pop();
+
+		const b3WideNode* node = m_nodes + nodeIndex;
+
+		b3FloatW tx1 = (b3LoadW(node->lowerX) - px) * ix;
+		b3FloatW tx2 = (b3LoadW(node->upperX) - px) * ix;
+		b3FloatW ty1 = (b3LoadW(node->lowerY) - py) * iy;
+		b3FloatW ty2 = (b3LoadW(node->upperY) - py) * iy;
+		b3FloatW tz1 = (b3LoadW(node->lowerZ) - pz) * iz;
+		b3FloatW tz2 = (b3LoadW(node->upperZ) - pz) * iz;
+
+		b3FloatW tmin = b3MaxW(b3MaxW(b3MinW(tx1, tx2), b3MinW(ty1, ty2)), b3MaxW(b3MinW(tz1, tz2), zero));
+		b3FloatW tmax = b3MinW(b3MinW(b3MaxW(tx1, tx2), b3MaxW(ty1, ty2)), b3MinW(b3MaxW(tz1, tz2), b3SplatW(maxFraction)));
+
+		// The AABB test discards the empty children.
+		u32 bits = TestOverlap(node, segmentAABB) & b3GetMaskBitsW(b3LessEqualW(tmin, tmax));
+
+		for (u32 i = 0; i < b3_wideTreeWidth; ++i)
+		{
+			u32 lane = b3_wideTreeWidth - 1 - i;
+			if ((bits & (1 << lane)) == 0)
+			{
+				continue;
+			}
+
+			u32 child = node->children[lane];
+			if (IsLeaf(child) == false)
+			{
+				stack.Push(child);
+			}
+		}
+
+		for (u32 lane = 0; lane < b3_wideTreeWidth; ++lane)
+		{
+			if ((bits & (1 << lane)) == 0)
+			{
+				continue;
+			}
+
+			u32 child = node->children[lane];
+			if (IsLeaf(child) == false)
+			{
+				continue;
+			}
+
+			b3RayCastInput subInput;
+			subInput.p1 = input.p1;
+			subInput.p2 = input.p2;
+			subInput.maxFraction = maxFraction;
+
+			scalar newMaxFraction = callback->Report(subInput, GetLeaf(child));
+
+			if (newMaxFraction == scalar(0))
+			{
+				// The client has stopped the query.
+				return;
+			}
+
+			if (newMaxFraction > scalar(0))
+			{
+				// Update the segment AABB.
+				maxFraction = newMaxFraction;
+				q2 = p1 + maxFraction * d;
+				segmentAABB.lowerBound = b3Min(p1, q2);
+				segmentAABB.upperBound = b3Max(p1, q2);
+			}
+		}
+	}
+}
+
+#endif
@@ -50,6 +50,7 @@
 // as you know what you're doing.
 
 #define	B3_MAX_U8 (0xFF)
+#define	B3_MAX_U16 (0xFFFF)
 #define	B3_MAX_U32 (0xFFFFFFFF)
 
 #ifdef B3_USE_DOUBLE
@@ -105,6 +106,9 @@
 #define B3_MAX_ROTATION (scalar(0.5) * B3_PI)
 #define B3_MAX_ROTATION_SQUARED (B3_MAX_ROTATION * B3_MAX_ROTATION)
 
+// Maximum number of sub-steps per body used by continuous collision.
+#define B3_MAX_SUB_STEPS (8)
+
 // The maximum position correction used when solving constraints. This helps to
 // prevent overshoot.
 #define B3_MAX_LINEAR_CORRECTION scalar(0.2)
@@ -90,8 +90,9 @@ public:
 	virtual void DrawTransform(const b3Transform& xf, bool depthEnabled = true) = 0;
 };
 
-// The debug drawer interface used by Bounce. 
+// The debug drawer interface used by Bounce on the current thread. 
 // Set this to an implementation before calling any debug drawing function.
-extern b3Draw* b3Draw_draw;
+// Each thread has its own drawer, so worlds can be drawn from different threads.
+extern thread_local b3Draw* b3Draw_draw;
 
 #endif
@@ -0,0 +1,558 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SIMD_H
+#define B3_SIMD_H
+
+#include <bounce/common/math/mat33.h>
+#include <bounce/common/common.h>
+
+// Select the SIMD instruction set at build time.
+// SIMD is only used for single precision. 
+// The lane count is part of the layout of the wide trees, ray packets, and rope packets, 
+// so it only depends on the build settings and not on the instruction set 
+// enabled for the translation unit including this file. 
+// Define B3_USE_AVX when building the library and the client to use 8 lanes. 
+// Otherwise, 4 lanes are used with SSE2 or processed one by one if SSE2 is not available.
+#if !defined(B3_USE_DOUBLE) && defined(B3_USE_AVX)
+	#if !defined(__AVX__)
+		#error "B3_USE_AVX is defined but AVX is not enabled for this translation unit."
+	#endif
+	#define B3_SIMD
+	#define B3_SIMD_AVX
+	#define B3_SIMD_WIDTH 8
+	#include <immintrin.h>
+#elif !defined(B3_USE_DOUBLE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define B3_SIMD
+	#define B3_SIMD_SSE2
+	#define B3_SIMD_WIDTH 4
+	#include <emmintrin.h>
+#else
+	#define B3_SIMD_WIDTH 4
+#endif
+
+// The number of lanes the library was built with. 
+// This must be equal to B3_SIMD_WIDTH. See b3CheckSIMDWidth.
+extern const u32 b3_simdWidth;
+
+// Check that the client and the library were built with the same lane count. 
+// The inline functions that depend on the lane count call this.
+inline void b3CheckSIMDWidth()
+{
+	B3_ASSERT(b3_simdWidth == B3_SIMD_WIDTH);
+}
+
+// A vector of B3_SIMD_WIDTH scalars.
+// This is only meant to live in registers or on the stack. 
+// Use arrays of scalars to store the lanes in memory.
+struct b3FloatW
+{
+#if defined(B3_SIMD_AVX)
+	__m256 v;
+#elif defined(B3_SIMD_SSE2)
+	__m128 v;
+#else
+	scalar v[B3_SIMD_WIDTH];
+#endif
+};
+
+// Load the lanes from an array of B3_SIMD_WIDTH scalars.
+// The array doesn't need to be aligned.
+inline b3FloatW b3LoadW(const scalar* p)
+{
+	b3FloatW r;
+#if defined(B3_SIMD_AVX)
+	r.v = _mm256_loadu_ps(p);
+#elif defined(B3_SIMD_SSE2)
+	r.v = _mm_loadu_ps(p);
+#else
+	for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+	{
+		r.v[i] = p[i];
+	}
+#endif
+	return r;
+}
+
+// Store the lanes to an array of B3_SIMD_WIDTH scalars.
+inline void b3StoreW(scalar* p, const b3FloatW& a)
+{
+#if defined(B3_SIMD_AVX)
+	_mm256_storeu_ps(p, a.v);
+#elif defined(B3_SIMD_SSE2)
+	_mm_storeu_ps(p, a.v);
+#else
+	for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+	{
+		p[i] = a.v[i];
+	}
+#endif
+}
+
+// Set all lanes to a scalar.
+inline b3FloatW b3SplatW(scalar s)
+{
+	b3FloatW r;
+#if defined(B3_SIMD_AVX)
+	r.v = _mm256_set1_ps(s);
+#elif defined(B3_SIMD_SSE2)
+	r.v = _mm_set1_ps(s);
+#else
+	for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+	{
+		r.v[i] = s;
+	}
+#endif
+	return r;
+}
+
+#if defined(B3_SIMD_AVX)
+
+#define B3_SIMD_OP(name, intrinsic) \
+inline b3FloatW name(const b3FloatW& a, const b3FloatW& b) \
+{ \
+	b3FloatW r; \
+	r.v = intrinsic(a.v, b.v); \
+	return r; \
+}
+
+B3_SIMD_OP(operator+, _mm256_add_ps)
+B3_SIMD_OP(operator-, _mm256_sub_ps)
+B3_SIMD_OP(operator*, _mm256_mul_ps)
+B3_SIMD_OP(operator/, _mm256_div_ps)
+B3_SIMD_OP(b3MinW, _mm256_min_ps)
+B3_SIMD_OP(b3MaxW, _mm256_max_ps)
+
+#elif defined(B3_SIMD_SSE2)
+
+#define B3_SIMD_OP(name, intrinsic) \
+inline b3FloatW name(const b3FloatW& a, const b3FloatW& b) \
+{ \
+	b3FloatW r; \
+	r.v = intrinsic(a.v, b.v); \
+	return r; \
+}
+
+B3_SIMD_OP(operator+, _mm_add_ps)
+B3_SIMD_OP(operator-, _mm_sub_ps)
+B3_SIMD_OP(operator*, _mm_mul_ps)
+B3_SIMD_OP(operator/, _mm_div_ps)
+B3_SIMD_OP(b3MinW, _mm_min_ps)
+B3_SIMD_OP(b3MaxW, _mm_max_ps)
+
+#else
+
+#define B3_SIMD_OP(name, expression) \
+inline b3FloatW name(const b3FloatW& a, const b3FloatW& b) \
+{ \
+	b3FloatW r; \
+	for (u32 i = 0; i < B3_SIMD_WIDTH; ++i) \
+	{ \
+		scalar x = a.v[i], y = b.v[i]; \
+		r.v[i] = expression; \
+	} \
+	return r; \
+}
+
+B3_SIMD_OP(operator+, x + y)
+B3_SIMD_OP(operator-, x - y)
+B3_SIMD_OP(operator*, x * y)
+B3_SIMD_OP(operator/, x / y)
+B3_SIMD_OP(b3MinW, b3Min(x, y))
+B3_SIMD_OP(b3MaxW, b3Max(x, y))
+
+#endif
+
+#undef B3_SIMD_OP
+
+// Negate all lanes.
+inline b3FloatW operator-(const b3FloatW& a)
+{
+	return b3SplatW(scalar(0)) - a;
+}
+
+// Square root of all lanes.
+inline b3FloatW b3SqrtW(const b3FloatW& a)
+{
+	b3FloatW r;
+#if defined(B3_SIMD_AVX)
+	r.v = _mm256_sqrt_ps(a.v);
+#elif defined(B3_SIMD_SSE2)
+	r.v = _mm_sqrt_ps(a.v);
+#else
+	for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+	{
+		r.v[i] = b3Sqrt(a.v[i]);
+	}
+#endif
+	return r;
+}
+
+// Select a lane from x if the lane of a is greater than the lane of b. 
+// Otherwise, select the lane from y.
+inline b3FloatW b3SelectGreaterW(const b3FloatW& a, const b3FloatW& b, const b3FloatW& x, const b3FloatW& y)
+{
+	b3FloatW r;
+#if defined(B3_SIMD_AVX)
+	__m256 mask = _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ);
+	r.v = _mm256_blendv_ps(y.v, x.v, mask);
+#elif defined(B3_SIMD_SSE2)
+	__m128 mask = _mm_cmpgt_ps(a.v, b.v);
+	r.v = _mm_or_ps(_mm_and_ps(mask, x.v), _mm_andnot_ps(mask, y.v));
+#else
+	for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+	{
+		r.v[i] = a.v[i] > b.v[i] ? x.v[i] : y.v[i];
+	}
+#endif
+	return r;
+}
+
+// Compare all lanes. 
+// The lanes where a is less than or equal to b are set in the returned mask.
+inline b3FloatW b3LessEqualW(const b3FloatW& a, const b3FloatW& b)
+{
+	b3FloatW r;
+#if defined(B3_SIMD_AVX)
+	r.v = _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ);
+#elif defined(B3_SIMD_SSE2)
+	r.v = _mm_cmple_ps(a.v, b.v);
+#else
+	for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+	{
+		r.v[i] = a.v[i] <= b.v[i] ? scalar(1) : scalar(0);
+	}
+#endif
+	return r;
+}
+
+// Intersect two masks.
+inline b3FloatW b3AndW(const b3FloatW& a, const b3FloatW& b)
+{
+	b3FloatW r;
+#if defined(B3_SIMD_AVX)
+	r.v = _mm256_and_ps(a.v, b.v);
+#elif defined(B3_SIMD_SSE2)
+	r.v = _mm_and_ps(a.v, b.v);
+#else
+	for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+	{
+		r.v[i] = a.v[i] != scalar(0) && b.v[i] != scalar(0) ? scalar(1) : scalar(0);
+	}
+#endif
+	return r;
+}
+
+// Convert a mask to an integer with one bit per lane. 
+// The first lane is the lowest bit.
+inline u32 b3GetMaskBitsW(const b3FloatW& a)
+{
+#if defined(B3_SIMD_AVX)
+	return u32(_mm256_movemask_ps(a.v));
+#elif defined(B3_SIMD_SSE2)
+	return u32(_mm_movemask_ps(a.v));
+#else
+	u32 bits = 0;
+	for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+	{
+		if (a.v[i] != scalar(0))
+		{
+			bits |= 1 << i;
+		}
+	}
+	return bits;
+#endif
+}
+
+// Clamp all lanes to [low, high].
+inline b3FloatW b3ClampW(const b3FloatW& a, const b3FloatW& low, const b3FloatW& high)
+{
+	return b3MaxW(low, b3MinW(a, high));
+}
+
+// A 3D vector of B3_SIMD_WIDTH lanes.
+struct b3Vec3W
+{
+	b3FloatW x, y, z;
+};
+
+// The lanes of a 3D vector stored in memory.
+struct b3Vec3Lanes
+{
+	scalar x[B3_SIMD_WIDTH];
+	scalar y[B3_SIMD_WIDTH];
+	scalar z[B3_SIMD_WIDTH];
+
+	// Write a vector to a lane.
+	void Set(u32 lane, const b3Vec3& v)
+	{
+		x[lane] = v.x;
+		y[lane] = v.y;
+		z[lane] = v.z;
+	}
+
+	// Read a vector from a lane.
+	b3Vec3 Get(u32 lane) const
+	{
+		return b3Vec3(x[lane], y[lane], z[lane]);
+	}
+};
+
+// Set all lanes to a vector.
+inline b3Vec3W b3SplatW(const b3Vec3& v)
+{
+	b3Vec3W r;
+	r.x = b3SplatW(v.x);
+	r.y = b3SplatW(v.y);
+	r.z = b3SplatW(v.z);
+	return r;
+}
+
+inline b3Vec3W b3LoadW(const b3Vec3Lanes& p)
+{
+	b3Vec3W r;
+	r.x = b3LoadW(p.x);
+	r.y = b3LoadW(p.y);
+	r.z = b3LoadW(p.z);
+	return r;
+}
+
+inline void b3StoreW(b3Vec3Lanes& p, const b3Vec3W& a)
+{
+	b3StoreW(p.x, a.x);
+	b3StoreW(p.y, a.y);
+	b3StoreW(p.z, a.z);
+}
+
+inline b3Vec3W operator+(const b3Vec3W& a, const b3Vec3W& b)
+{
+	b3Vec3W r;
+	r.x = a.x + b.x;
+	r.y = a.y + b.y;
+	r.z = a.z + b.z;
+	return r;
+}
+
+inline b3Vec3W operator-(const b3Vec3W& a, const b3Vec3W& b)
+{
+	b3Vec3W r;
+	r.x = a.x - b.x;
+	r.y = a.y - b.y;
+	r.z = a.z - b.z;
+	return r;
+}
+
+inline b3Vec3W operator-(const b3Vec3W& a)
+{
+	b3Vec3W r;
+	r.x = -a.x;
+	r.y = -a.y;
+	r.z = -a.z;
+	return r;
+}
+
+inline b3Vec3W operator*(const b3FloatW& s, const b3Vec3W& a)
+{
+	b3Vec3W r;
+	r.x = s * a.x;
+	r.y = s * a.y;
+	r.z = s * a.z;
+	return r;
+}
+
+inline b3FloatW b3Dot(const b3Vec3W& a, const b3Vec3W& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline b3Vec3W b3Cross(const b3Vec3W& a, const b3Vec3W& b)
+{
+	b3Vec3W r;
+	r.x = a.y * b.z - a.z * b.y;
+	r.y = a.z * b.x - a.x * b.z;
+	r.z = a.x * b.y - a.y * b.x;
+	return r;
+}
+
+// A 3-by-3 matrix of B3_SIMD_WIDTH lanes stored in column-major order.
+struct b3Mat33W
+{
+	b3Vec3W x, y, z;
+};
+
+// The lanes of a 3-by-3 matrix stored in memory.
+struct b3Mat33Lanes
+{
+	b3Vec3Lanes x, y, z;
+
+	// Write a matrix to a lane.
+	void Set(u32 lane, const b3Mat33& m)
+	{
+		x.Set(lane, m.x);
+		y.Set(lane, m.y);
+		z.Set(lane, m.z);
+	}
+
+	// Read a matrix from a lane.
+	b3Mat33 Get(u32 lane) const
+	{
+		return b3Mat33(x.Get(lane), y.Get(lane), z.Get(lane));
+	}
+};
+
+inline b3Mat33W b3LoadW(const b3Mat33Lanes& p)
+{
+	b3Mat33W r;
+	r.x = b3LoadW(p.x);
+	r.y = b3LoadW(p.y);
+	r.z = b3LoadW(p.z);
+	return r;
+}
+
+inline void b3StoreW(b3Mat33Lanes& p, const b3Mat33W& A)
+{
+	b3StoreW(p.x, A.x);
+	b3StoreW(p.y, A.y);
+	b3StoreW(p.z, A.z);
+}
+
+inline b3Vec3W operator*(const b3Mat33W& A, const b3Vec3W& v)
+{
+	return v.x * A.x + v.y * A.y + v.z * A.z;
+}
+
+// A^T * v
+inline b3Vec3W b3MulT(const b3Mat33W& A, const b3Vec3W& v)
+{
+	b3Vec3W r;
+	r.x = b3Dot(A.x, v);
+	r.y = b3Dot(A.y, v);
+	r.z = b3Dot(A.z, v);
+	return r;
+}
+
+inline b3Mat33W operator+(const b3Mat33W& A, const b3Mat33W& B)
+{
+	b3Mat33W r;
+	r.x = A.x + B.x;
+	r.y = A.y + B.y;
+	r.z = A.z + B.z;
+	return r;
+}
+
+inline b3Mat33W operator-(const b3Mat33W& A, const b3Mat33W& B)
+{
+	b3Mat33W r;
+	r.x = A.x - B.x;
+	r.y = A.y - B.y;
+	r.z = A.z - B.z;
+	return r;
+}
+
+inline b3Mat33W operator*(const b3FloatW& s, const b3Mat33W& A)
+{
+	b3Mat33W r;
+	r.x = s * A.x;
+	r.y = s * A.y;
+	r.z = s * A.z;
+	return r;
+}
+
+inline b3Mat33W operator*(const b3Mat33W& A, const b3Mat33W& B)
+{
+	b3Mat33W r;
+	r.x = A * B.x;
+	r.y = A * B.y;
+	r.z = A * B.z;
+	return r;
+}
+
+inline b3Mat33W b3Transpose(const b3Mat33W& A)
+{
+	b3Mat33W r;
+	r.x.x = A.x.x;
+	r.x.y = A.y.x;
+	r.x.z = A.z.x;
+	r.y.x = A.x.y;
+	r.y.y = A.y.y;
+	r.y.z = A.z.y;
+	r.z.x = A.x.z;
+	r.z.y = A.y.z;
+	r.z.z = A.z.z;
+	return r;
+}
+
+// skew(v) * w = cross(v, w)
+inline b3Mat33W b3Skew(const b3Vec3W& v)
+{
+	b3FloatW zero = b3SplatW(scalar(0));
+
+	b3Mat33W r;
+	r.x.x = zero;
+	r.x.y = v.z;
+	r.x.z = -v.y;
+	r.y.x = -v.z;
+	r.y.y = zero;
+	r.y.z = v.x;
+	r.z.x = v.y;
+	r.z.y = -v.x;
+	r.z.z = zero;
+	return r;
+}
+
+// a * b^T
+inline b3Mat33W b3Outer(const b3Vec3W& a, const b3Vec3W& b)
+{
+	b3Mat33W r;
+	r.x = b.x * a;
+	r.y = b.y * a;
+	r.z = b.z * a;
+	return r;
+}
+
+// Invert a symmetric matrix in all lanes. 
+// The lanes of a singular matrix are set to zero.
+inline b3Mat33W b3SymInverse(const b3Mat33W& A)
+{
+	b3FloatW det = b3Dot(A.x, b3Cross(A.y, A.z));
+	
+	b3FloatW zero = b3SplatW(scalar(0));
+	det = b3SelectGreaterW(det * det, zero, b3SplatW(scalar(1)) / det, zero);
+
+	b3FloatW a11 = A.x.x, a12 = A.y.x, a13 = A.z.x;
+	b3FloatW a22 = A.y.y, a23 = A.z.y;
+	b3FloatW a33 = A.z.z;
+
+	b3Mat33W M;
+
+	M.x.x = det * (a22 * a33 - a23 * a23);
+	M.x.y = det * (a13 * a23 - a12 * a33);
+	M.x.z = det * (a12 * a23 - a13 * a22);
+
+	M.y.x = M.x.y;
+	M.y.y = det * (a11 * a33 - a13 * a13);
+	M.y.z = det * (a13 * a12 - a11 * a23);
+
+	M.z.x = M.x.z;
+	M.z.y = M.y.z;
+	M.z.z = det * (a11 * a22 - a12 * a12);
+
+	return M;
+}
+
+#endif
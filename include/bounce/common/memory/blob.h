@@ -0,0 +1,54 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_BLOB_H
+#define B3_BLOB_H
+
+#include <bounce/common/settings.h>
+#include <stdint.h>
+
+// A blob is a block of memory holding serialized data that can be used in place, 
+// for example a file mapped into memory. 
+// The data in a blob is only valid on platforms having the same endianness and scalar type 
+// as the platform that wrote it.
+
+// Alignment in bytes of a blob and of the sections in a blob.
+const u32 b3_blobAlignment = 16;
+
+// Value written to a blob to detect the endianness of the platform that wrote it.
+const u32 b3_blobEndianTag = 0x01020304;
+
+// Round a size up to the blob alignment.
+inline u32 b3AlignBlob(u32 size)
+{
+	return (size + b3_blobAlignment - 1) & ~(b3_blobAlignment - 1);
+}
+
+// Is the given memory aligned to the blob alignment?
+inline bool b3IsBlobAligned(const void* p)
+{
+	return (uintptr_t(p) & (b3_blobAlignment - 1)) == 0;
+}
+
+// Is a section inside a blob of a given size?
+inline bool b3IsBlobSection(u32 offset, u64 sectionSize, u32 blobSize)
+{
+	return (offset & (b3_blobAlignment - 1)) == 0 && offset <= blobSize && sectionSize <= blobSize - offset;
+}
+
+#endif
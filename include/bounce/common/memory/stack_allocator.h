@@ -21,11 +21,14 @@
 
 #include <bounce/common/settings.h>
 
-// Allocate 1 MiB from the stack. 
-// Increase as you want.
-const u32 b3_maxStackSize = B3_MiB(1);
+// The size of the first chunk of a stack allocator.
+// The allocator grows with new chunks as needed.
+const u32 b3_stackChunkSize = B3_MiB(1);
 
 // A stack allocator.
+// The memory is stored in chunks that are kept until the allocator is destroyed, 
+// so the allocator stops calling b3Alloc once it reached its high-water mark.
+// A stack allocator must be used by one thread at a time.
 class b3StackAllocator 
 {
 public :
@@ -34,20 +37,37 @@ public :
 
 	void* Allocate(u32 size);
 	void Free(void* p);
+
+	// Get the number of bytes reserved by this allocator.
+	u32 GetCapacity() const;
 private :
+	struct b3Chunk
+	{
+		u8* memory;
+		u32 capacity;
+		u32 allocatedSize; // marker
+		b3Chunk* next;
+	};
+
 	struct b3Block 
 	{
 		u32 size;
 		u8* data;
-		bool parent;
+		b3Chunk* chunk;
 	};
 	
 	u32 m_blockCapacity;
 	b3Block* m_blocks;
 	u32 m_blockCount;
 
-	u32 m_allocatedSize; // marker
-	u8 m_memory[b3_maxStackSize];
+	b3Chunk* m_chunks;
+	b3Chunk* m_chunk;
+	u32 m_capacity;
 };
 
+inline u32 b3StackAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
+
 #endif
@@ -85,8 +85,10 @@ private:
 	b3ProfilerNodeStats* m_statsHead; // list of permanent statistics
 };
 
-// The profiler used by Bounce. 
-extern b3Profiler* b3Profiler_profiler;
+// The profiler used by Bounce on the current thread. 
+// Each thread has its own profiler, so blocks executed by worker threads 
+// aren't recorded unless a profiler is set on the worker thread.
+extern thread_local b3Profiler* b3Profiler_profiler;
 
 #define B3_JOIN(a, b) a##b
 #define B3_CONCATENATE(a, b) B3_JOIN(a, b)
@@ -21,6 +21,12 @@
 
 #include <bounce/common/types.h>
 
+// The memory allocation context of the calling thread. This is null by default.
+// Custom allocation functions can use this to route the allocations of each world 
+// to its own heap. 
+// The tasks executed while stepping a world use the context of the thread that called b3World::Step.
+extern thread_local void* b3_allocContext;
+
 #ifdef B3_USER_SETTINGS
 
 // This is a user file that includes custom definitions of the macros, structs, and functions
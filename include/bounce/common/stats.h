@@ -0,0 +1,67 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_STATS_H
+#define B3_STATS_H
+
+#include <bounce/common/settings.h>
+
+// Statistics collected during a world step.
+struct b3StepStats
+{
+	// Set all counters to zero.
+	void Reset();
+
+	// Add the counters collected by another thread.
+	void Merge(const b3StepStats& other);
+
+	// Memory allocations
+	u32 allocCalls;
+
+	// GJK
+	u32 gjkCalls;
+	u32 gjkIters;
+	u32 gjkMaxIters;
+	u32 gjkCacheHits;
+
+	// Convex hull collision
+	u32 convexCalls;
+	u32 convexCacheHits;
+
+	// Time of impact
+	u32 toiCalls;
+	u32 toiMaxIters;
+	u32 toiEvents;
+
+	// Pairs reported by the broad-phase
+	u32 pairCount;
+
+	// Islands and the touching contacts in them
+	u32 islandCount;
+	u32 contactCount;
+
+	// Solver iterations summed over all islands
+	u32 velocityIterations;
+	u32 positionIterations;
+};
+
+// The statistics of the calling thread.
+// This is null if the statistics are not being collected.
+extern thread_local b3StepStats* b3_stepStats;
+
+#endif
@@ -0,0 +1,49 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_STEP_TASK_EXECUTOR_H
+#define B3_STEP_TASK_EXECUTOR_H
+
+#include <bounce/common/thread/task_executor.h>
+
+struct b3StepStats;
+
+// A task executor used by a world during a time step. 
+// The workers of an executor can be threads that never called into Bounce, 
+// so this forwards the per-thread state of the thread that started a loop 
+// to the worker executing each range. 
+// This makes each worker use the allocation context of the stepping thread and 
+// collect statistics into its own b3StepStats.
+class b3StepTaskExecutor : public b3TaskExecutor
+{
+public:
+	b3StepTaskExecutor();
+
+	// Set the executor that runs the tasks and the statistics of each of its workers.
+	// The statistics can be null if they aren't being collected.
+	void Set(b3TaskExecutor* executor, b3StepStats* workerStats);
+
+	u32 GetWorkerCount() const override;
+
+	void ParallelFor(u32 count, u32 minRange, b3TaskFcn* task, void* context) override;
+private:
+	b3TaskExecutor* m_executor;
+	b3StepStats* m_workerStats;
+};
+
+#endif
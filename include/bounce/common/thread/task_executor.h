@@ -0,0 +1,49 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_TASK_EXECUTOR_H
+#define B3_TASK_EXECUTOR_H
+
+#include <bounce/common/settings.h>
+
+// A task function processes the items in the range [begin, end).
+// The worker index is in the range [0, b3TaskExecutor::GetWorkerCount()) 
+// and identifies the worker executing the range. 
+// Two ranges are never executed concurrently by the same worker, therefore 
+// the worker index can be used to access per-worker data without locking.
+typedef void b3TaskFcn(u32 begin, u32 end, u32 workerIndex, void* context);
+
+// Bounce runs its parallel loops through this interface. 
+// Implement it to plug your own job scheduler into Bounce or 
+// use the default b3ThreadPool.
+class b3TaskExecutor
+{
+public:
+	virtual ~b3TaskExecutor() { }
+
+	// Get the maximum number of workers that can execute ranges concurrently. 
+	virtual u32 GetWorkerCount() const = 0;
+
+	// Execute the task over the items in the range [0, count) and return when all items 
+	// have been processed. 
+	// The implementation can split the range into sub-ranges having at least 
+	// minRange items. Each item must be processed exactly once.
+	virtual void ParallelFor(u32 count, u32 minRange, b3TaskFcn* task, void* context) = 0;
+};
+
+#endif
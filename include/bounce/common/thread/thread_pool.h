@@ -0,0 +1,99 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_THREAD_POOL_H
+#define B3_THREAD_POOL_H
+
+#include <bounce/common/thread/task_executor.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Maximum number of ranges a loop is split into per worker.
+const u32 b3_maxTaskRangesPerWorker = 4;
+
+// The default task executor. 
+// This is a pool of threads that execute a parallel loop using work-stealing. 
+// A loop is split into a small number of ranges per worker. Each worker processes 
+// its own ranges first and then steals ranges from the other workers until 
+// there is no work left. 
+// The calling thread is worker zero and participates in the loop.
+// A loop must not be started from inside a task or concurrently from two threads.
+class b3ThreadPool : public b3TaskExecutor
+{
+public:
+	// Create the pool. This creates threadCount - 1 threads. 
+	// If the thread count is zero then the number of hardware threads is used.
+	b3ThreadPool(u32 threadCount = 0);
+	~b3ThreadPool();
+
+	// Get the number of workers, including the calling thread.
+	u32 GetWorkerCount() const override;
+
+	// Execute a parallel loop.
+	void ParallelFor(u32 count, u32 minRange, b3TaskFcn* task, void* context) override;
+private:
+	struct b3TaskRange
+	{
+		u32 begin;
+		u32 end;
+	};
+
+	// A worker and its queue of ranges.
+	// The owner pops ranges from the front and thieves from the back.
+	struct b3Worker
+	{
+		std::thread thread;
+		std::mutex mutex;
+		b3TaskRange ranges[b3_maxTaskRangesPerWorker];
+		u32 head;
+		u32 tail;
+	};
+
+	void WorkerMain(u32 workerIndex);
+	
+	void Execute(u32 workerIndex);
+
+	bool Pop(u32 workerIndex, b3TaskRange* range);
+	
+	bool Steal(u32 workerIndex, b3TaskRange* range);
+
+	b3Worker* m_workers;
+	u32 m_workerCount;
+
+	// Current loop
+	b3TaskFcn* m_task;
+	void* m_context;
+	
+	// Used to wake up the workers when a loop starts.
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	u64 m_generation;
+	bool m_quit;
+
+	// Number of threads still working on the current loop.
+	std::atomic<u32> m_busyCount;
+};
+
+inline u32 b3ThreadPool::GetWorkerCount() const
+{
+	return m_workerCount;
+}
+
+#endif
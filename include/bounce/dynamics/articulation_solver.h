@@ -0,0 +1,49 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_ARTICULATION_SOLVER_H
+#define B3_ARTICULATION_SOLVER_H
+
+#include <bounce/common/math/vec3.h>
+
+class b3BroadPhase;
+class b3Articulation;
+
+// The articulation solver. 
+// This couples the base link of an articulation to its attached body, 
+// resolves the contacts between the links and the fixtures in the broad-phase, 
+// steps the articulation, and applies the reaction of the base link to the body.
+// The links of an articulation don't collide with each other or 
+// with the links of other articulations.
+class b3ArticulationSolver
+{
+public:
+	b3ArticulationSolver(const b3BroadPhase* broadPhase, const b3Vec3& gravity, scalar dt);
+
+	// Solve an articulation for the time step.
+	// The impulses of the contacts are applied to the bodies of the touched fixtures.
+	void Solve(b3Articulation* articulation) const;
+private:
+	struct ContactSolver;
+
+	const b3BroadPhase* m_broadPhase;
+	b3Vec3 m_gravity;
+	scalar m_dt;
+};
+
+#endif
@@ -56,6 +56,8 @@ struct b3BodyDef
 		fixedRotationX = false;
 		fixedRotationY = false;
 		fixedRotationZ = false;
+		bullet = false;
+		speculative = false;
 		userData = nullptr;
 		position.SetZero();
 		orientation.SetIdentity();
@@ -86,6 +88,15 @@ struct b3BodyDef
 	
 	// If enabled the body is constrained to rotate only around the z-axis.
 	bool fixedRotationZ;
+
+	// Is this a fast moving body that should be prevented from tunneling through 
+	// other moving bodies? Fast bodies never tunnel through static and kinematic bodies 
+	// when continuous collision is enabled.
+	bool bullet;
+
+	// Should this body use speculative contacts instead of time of impact sub-stepping? 
+	// Speculative contacts are cheaper but might stop the body slightly before the actual impact.
+	bool speculative;
 	
 	// The user data. This pointer usually stores an address to a game entity.
 	void* userData;
@@ -345,6 +356,18 @@ public:
 	// Is automatic sleeping allowed?
 	bool IsSleepingAllowed() const;
 
+	// Should this body be treated like a bullet for continuous collision?
+	void SetBullet(bool flag);
+
+	// Is this body treated like a bullet for continuous collision?
+	bool IsBullet() const;
+
+	// Should this body use speculative contacts for continuous collision?
+	void SetSpeculative(bool flag);
+
+	// Does this body use speculative contacts for continuous collision?
+	bool IsSpeculative() const;
+
 	// Get the next body in the world body list.
 	const b3Body* GetNext() const;
 	b3Body* GetNext();
@@ -354,6 +377,8 @@ public:
 private:
 	friend class b3World;
 	friend class b3Island;
+	friend class b3TOISolver;
+	friend class b3ArticulationSolver;
 
 	friend class b3Contact;
 	friend class b3ConvexContact;
@@ -385,7 +410,9 @@ private:
 		e_autoSleepFlag = 0x0004,
 		e_fixedRotationX = 0x0008,
 		e_fixedRotationY = 0x0010,
-		e_fixedRotationZ = 0x0020
+		e_fixedRotationZ = 0x0020,
+		e_bulletFlag = 0x0040,
+		e_speculativeFlag = 0x0080
 	};
 
 	b3Body(const b3BodyDef& def, b3World* world);
@@ -403,6 +430,9 @@ private:
 	void SynchronizeTransform();
 	void SynchronizeFixtures();
 
+	// Compute the extents of the fixtures about the center of mass.
+	void ComputeExtents();
+
 	// Check if this body should collide with another.
 	bool ShouldCollide(const b3Body* other) const;
 
@@ -451,6 +481,12 @@ private:
 	// Motion proxy for CCD.
 	b3Sweep m_sweep;
 
+	// The smallest distance from the center of a fixture to its surface and 
+	// the largest distance from the center of mass to the fixtures surfaces. 
+	// These are used for detecting fast motion.
+	scalar m_minExtent;
+	scalar m_maxExtent;
+
 	// The body origin transform. 
 	b3Transform m_xf;
 		
@@ -883,4 +919,38 @@ inline bool b3Body::IsSleepingAllowed() const
 	return (m_flags & e_autoSleepFlag) == e_autoSleepFlag;
 }
 
+inline void b3Body::SetBullet(bool flag)
+{
+	if (flag)
+	{
+		m_flags |= e_bulletFlag;
+	}
+	else
+	{
+		m_flags &= ~e_bulletFlag;
+	}
+}
+
+inline bool b3Body::IsBullet() const
+{
+	return (m_flags & e_bulletFlag) == e_bulletFlag;
+}
+
+inline void b3Body::SetSpeculative(bool flag)
+{
+	if (flag)
+	{
+		m_flags |= e_speculativeFlag;
+	}
+	else
+	{
+		m_flags &= ~e_speculativeFlag;
+	}
+}
+
+inline bool b3Body::IsSpeculative() const
+{
+	return (m_flags & e_speculativeFlag) == e_speculativeFlag;
+}
+
 #endif
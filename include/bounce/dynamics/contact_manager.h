@@ -27,12 +27,28 @@ class b3Shape;
 class b3ContactFilter;
 class b3ContactListener;
 class b3BlockAllocator;
+class b3StackAllocator;
+class b3TaskExecutor;
+
+// The minimum number of contacts to update in parallel.
+const u32 b3_minParallelContactCount = 64;
+
+// The minimum number of contacts updated by a task.
+const u32 b3_minContactTaskRange = 16;
+
+// A contact being updated by the narrow-phase.
+struct b3ContactUpdate
+{
+	b3Contact* contact;
+	bool wasTouching;
+};
 
 // Contact delegator for b3World.
 class b3ContactManager 
 {
 public:
 	b3ContactManager();
+	~b3ContactManager();
 
 	// The broad-phase callback.
 	void AddPair(void* proxyDataA, void* proxyDataB);
@@ -45,16 +61,36 @@ public:
 	void FindNewContacts();
 	
 	// Perform narrow-phase collision detection.
+	// The active contacts are gathered first and then collided. 
+	// If a task executor is set they are collided in parallel. 
+	// The listener is notified on the calling thread afterwards.
 	void UpdateContacts();
 
+	// Return false if a contact must be destroyed.
+	bool FilterContact(b3Contact* c) const;
+
+	// Return true if at least one body in a contact is awake and not static.
+	bool IsContactActive(b3Contact* c) const;
+
+	static void UpdateContactsTask(u32 begin, u32 end, u32 workerIndex, void* context);
+
 	b3Contact* Create(b3Fixture* fixtureA, b3Fixture* fixtureB);
 	void Destroy(b3Contact* c);
 
-	b3BroadPhase m_broadPhase;	
+	b3BroadPhase* m_broadPhase;
 	b3List<b3Contact> m_contactList;
 	b3ContactFilter* m_contactFilter;
 	b3ContactListener* m_contactListener;
 	b3BlockAllocator* m_allocator;
+	b3StackAllocator* m_stackAllocator;
+	
+	// Task executor and a stack allocator per executor worker.
+	b3TaskExecutor* m_executor;
+	b3StackAllocator* m_workerAllocators;
+
+	// The contacts being updated by the narrow-phase.
+	b3ContactUpdate* m_updates;
+	u32 m_updateCapacity;
 };
 
 #endif
\ No newline at end of file
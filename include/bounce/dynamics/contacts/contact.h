@@ -32,6 +32,7 @@ class b3Body;
 class b3Contact;
 class b3ContactListener;
 class b3BlockAllocator;
+class b3StackAllocator;
 struct b3ConvexCache;
 
 // A contact edge for the contact graph, 
@@ -93,8 +94,13 @@ public:
 	void GetWorldManifold(b3WorldManifold* out, u32 index) const;
 	
 	// Are the shapes in this contact overlapping?
+	// Speculative contacts also overlap when the shapes might touch during the next time step.
 	bool IsOverlapping() const;
 
+	// Are the shapes in this contact touching?
+	// The speculative points of separated shapes don't count.
+	bool IsTouching() const;
+
 	// Has this contact at least one sensor shape?
 	bool IsSensorContact() const;
 
@@ -117,6 +123,7 @@ protected:
 	{
 		e_overlapFlag = 0x0001,
 		e_islandFlag = 0x0002,
+		e_touchingFlag = 0x0004,
 	};
 
 	b3Contact(b3Fixture* fixtureA, b3Fixture* fixtureB);
@@ -136,11 +143,24 @@ protected:
 	// Factory destroy.
 	static void Destroy(b3Contact* contact, b3BlockAllocator* allocator);
 
-	// Update the contact state.
-	void Update(b3ContactListener* listener);
+	// Update the contact points and the overlap state.
+	// This doesn't modify the bodies, so contacts can be updated in parallel 
+	// as long as each thread uses its own allocator.
+	void UpdateOverlap(b3StackAllocator* allocator);
+
+	// Wake the bodies and notify the listener about the overlap state.
+	void ReportOverlap(bool wasTouching, b3ContactListener* listener);
+
+	// Should the convex contact algorithms use the feature cache? 
+	// This is a setting of the world.
+	bool UseConvexCache() const;
+
+	// Compute the distance below which the shapes might touch during the next time step.
+	// This is zero unless one of the bodies is speculative.
+	scalar ComputeSpeculativeMargin() const;
 
 	// Collide function.
-	virtual void Collide() = 0;
+	virtual void Collide(b3StackAllocator* allocator) = 0;
 
 	// Test if the shapes in this contact are overlapping.
 	virtual bool TestOverlap() = 0;
@@ -161,6 +181,14 @@ protected:
 	b3Manifold* m_manifolds;
 	u32 m_manifoldCount;
 
+	// The speculative margin used by the last collision.
+	scalar m_speculativeMargin;
+
+	// Solver indices of the bodies. 
+	// These are set when the contact is added to an island.
+	u32 m_indexA;
+	u32 m_indexB;
+
 	// Links to the world contact list.
 	b3Contact* m_prev;
 	b3Contact* m_next;
@@ -213,6 +241,11 @@ inline bool b3Contact::IsOverlapping() const
 	return (m_flags & e_overlapFlag) != 0;
 }
 
+inline bool b3Contact::IsTouching() const 
+{
+	return (m_flags & e_touchingFlag) != 0;
+}
+
 inline const b3Contact* b3Contact::GetNext() const
 {
 	return m_next;
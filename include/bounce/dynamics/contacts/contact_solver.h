@@ -21,6 +21,7 @@
 
 #include <bounce/common/math/vec2.h>
 #include <bounce/common/math/mat22.h>
+#include <bounce/common/math/simd.h>
 #include <bounce/dynamics/time_step.h>
 #include <bounce/collision/collide/manifold.h>
 
@@ -105,6 +106,56 @@ struct b3ContactVelocityConstraint
 	u32 manifoldCount;
 };
 
+// A contact point of B3_SIMD_WIDTH manifolds.
+struct b3VelocityConstraintPointW
+{
+	b3Vec3Lanes rA;
+	b3Vec3Lanes rB;
+
+	b3Vec3Lanes normal;
+	scalar normalMass[B3_SIMD_WIDTH];
+	scalar normalImpulse[B3_SIMD_WIDTH];
+	scalar velocityBias[B3_SIMD_WIDTH];
+};
+
+// A batch of up to B3_SIMD_WIDTH contact manifolds stored in SoA layout.
+// The manifolds of a batch don't share bodies, therefore 
+// they can be solved at once using SIMD.
+// The unused points and lanes have zero mass.
+struct b3VelocityConstraintManifoldW
+{
+	u32 indexA[B3_SIMD_WIDTH];
+	u32 indexB[B3_SIMD_WIDTH];
+	b3VelocityConstraintManifold* manifolds[B3_SIMD_WIDTH];
+	u32 laneCount;
+	u32 pointCount;
+
+	scalar invMassA[B3_SIMD_WIDTH];
+	b3Mat33Lanes invIA;
+	scalar invMassB[B3_SIMD_WIDTH];
+	b3Mat33Lanes invIB;
+	scalar friction[B3_SIMD_WIDTH];
+
+	b3Vec3Lanes rA;
+	b3Vec3Lanes rB;
+
+	b3Vec3Lanes normal;
+
+	scalar motorImpulse[B3_SIMD_WIDTH];
+	scalar motorMass[B3_SIMD_WIDTH];
+	scalar motorSpeed[B3_SIMD_WIDTH];
+
+	b3Vec3Lanes tangent1;
+	scalar tangentSpeed1[B3_SIMD_WIDTH];
+	b3Vec3Lanes tangent2;
+	scalar tangentSpeed2[B3_SIMD_WIDTH];
+	b3Vec3Lanes tangentMass; // (k11, k12, k22) of the symmetric inverse 
+	scalar tangentImpulse1[B3_SIMD_WIDTH];
+	scalar tangentImpulse2[B3_SIMD_WIDTH];
+
+	b3VelocityConstraintPointW points[B3_MAX_MANIFOLD_POINTS];
+};
+
 struct b3ContactSolverDef 
 {
 	b3Position* positions;
@@ -114,6 +165,13 @@ struct b3ContactSolverDef
 	u32 count;
 	b3StackAllocator* allocator;
 	scalar dt;
+	bool simd; // solve the velocity constraints using SIMD
+	
+	// The SIMD batches only hold contacts of the same range. The ranges are 
+	// consecutive and given by their number of contacts. 
+	// If this is null then all contacts are in a single range.
+	const u32* rangeCounts;
+	u32 rangeCount;
 };
 
 // The idea is to allow anything to bounce off an inelastic surface.
@@ -141,7 +199,25 @@ public:
 	void StoreImpulses();
 
 	bool SolvePositionConstraints();
+
+	// These functions only touch the constraints in the range [begin, end). 
+	// Ranges of constraints that don't share bodies can be solved concurrently.
+	void WarmStart(u32 begin, u32 end);
+	void SolveVelocityConstraints(u32 begin, u32 end);
+	bool SolvePositionConstraints(u32 begin, u32 end);
+
+	// Get the SIMD batches [begin, end) of a range of contacts given in the definition. 
+	// This requires the SIMD solver.
+	void GetWideRange(u32 range, u32* begin, u32* end) const;
+
+	// Solve the velocity constraints of the SIMD batches in the range [begin, end). 
+	// The batches of a contact range don't share bodies if its contacts don't, 
+	// so these can be solved concurrently too.
+	void SolveWideVelocityConstraints(u32 begin, u32 end);
 protected:
+	void InitializeWideConstraints();
+	void StoreWideImpulses();
+
 	b3Position* m_positions;
 	b3Velocity* m_velocities;
 	b3Mat33* m_inertias;
@@ -151,6 +227,14 @@ protected:
 	u32 m_count;
 	scalar m_dt, m_invDt;
 	b3StackAllocator* m_allocator;
+	
+	bool m_simd;
+	const u32* m_rangeCounts;
+	u32 m_rangeCount;
+	b3VelocityConstraintManifoldW* m_wideConstraints;
+	u32 m_wideCount;
+	u32* m_wideRangeStarts;
+	u32* m_batchIndices;
 };
 
 #endif
@@ -31,7 +31,7 @@ public:
 
 	bool TestOverlap() override;
 
-	void Collide() override;
+	void Collide(b3StackAllocator* allocator) override;
 
 	virtual void Evaluate(b3Manifold& manifold, const b3Transform& xfA, const b3Transform& xfB) = 0;
 
@@ -45,7 +45,7 @@ public:
 
 	void FindPairs() override;
 
-	void Collide() override;
+	void Collide(b3StackAllocator* allocator) override;
 
 	virtual void Evaluate(b3Manifold& manifold, const b3Transform& xfA, const b3Transform& xfB, u32 cacheIndex) = 0;
 
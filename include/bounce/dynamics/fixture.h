@@ -155,6 +155,7 @@ protected:
 	friend class b3ContactManager;
 	friend class b3MeshContact;
 	friend class b3ContactSolver;
+	friend class b3TOISolver;
 	friend class b3List<b3Fixture>;
 	
 	b3Fixture();
@@ -22,58 +22,108 @@
 #include <bounce/common/math/mat33.h>
 
 class b3StackAllocator;
-class b3ContactListener;
+class b3TaskExecutor;
 class b3Contact;
 class b3Joint;
 class b3Body;
 struct b3Velocity;
 struct b3Position;
 struct b3Profile;
+struct b3GraphColor;
+
+class b3JointSolver;
+class b3ContactSolver;
 
 struct b3ContactVelocityConstraint;
 
+// The constraint graph of an island with at least this number of constraints is colored. 
+// The colors are solved in parallel if a task executor is available.
+const u32 b3_minParallelIslandConstraints = 128;
+
+// Small islands are merged into a batch until the batch has at least this number 
+// of bodies and constraints. A batch is solved as a single island.
+const u32 b3_islandBatchSize = 64;
+
+// Maximum number of colors of the constraint graph of an island.
+// The constraints that can't be colored are solved by a single thread.
+const u32 b3_maxGraphColors = 16;
+
+// Minimum number of constraints solved by a thread at once.
+const u32 b3_minSolverBlockSize = 8;
+
+// The number of bodies and constraints of an island in a batch of islands.
+struct b3IslandCounts
+{
+	u32 bodyCount;
+	u32 contactCount;
+	u32 jointCount;
+};
+
+// An island is a set of bodies connected by contacts and joints. 
+// The island doesn't own the arrays of bodies and constraints.
+// The solver indices of the bodies and constraints must be set before solving the island. 
+// Static bodies are only read by the island solver, therefore two islands 
+// can be solved concurrently, even if they share static bodies.
+// The constraint graph of a large island is colored, which reorders the constraints 
+// of the island. If a task executor is given then the constraints of each color are 
+// solved in parallel. The order doesn't depend on the executor, so an island gives 
+// the same result with any number of threads.
+// An island can be a batch of independent islands stored one after the other. 
+// The number of bodies and constraints of each island in the batch is given so that 
+// the position constraints of each island stop when they are solved, and the islands 
+// can sleep independently. A batch that is colored must contain a single island.
 class b3Island 
 {
 public :
-	b3Island(b3StackAllocator* stack, u32 bodyCapacity, u32 contactCapacity, u32 jointCapacity, b3ContactListener* listener);
+	b3Island(b3StackAllocator* allocator, 
+		b3Body** bodies, u32 bodyCount, 
+		b3Contact** contacts, u32 contactCount, 
+		b3Joint** joints, u32 jointCount,
+		const b3IslandCounts* islandCounts, u32 islandCount,
+		b3TaskExecutor* executor);
 	~b3Island();
 
-	void Clear();
-	
-	void Add(b3Body* body);
-	void Add(b3Contact* contact);
-	void Add(b3Joint* joint);
-	
 	void Solve(const b3Vec3& gravity, scalar dt, u32 velocityIterations, u32 positionIterations, u32 flags);
 private :
 	enum 
 	{
 		e_warmStartBit = 0x0001,
-		e_sleepBit = 0x0002
+		e_sleepBit = 0x0002,
+		e_simdBit = 0x0004
 	};
 
 	friend class b3World;
+	friend struct b3GraphSolverContext;
 
-	void Report();
+	void IntegratePositions(u32 begin, u32 end, scalar h);
+	
+	u32 ColorGraph(b3GraphColor* colors);
+
+	bool SolveGraph(b3JointSolver* jointSolver, b3ContactSolver* contactSolver, 
+		const b3GraphColor* colors, u32 colorCount, 
+		scalar h, u32 velocityIterations, u32 positionIterations, bool warmStart, bool simd);
 
 	b3StackAllocator* m_allocator;
-	b3ContactListener* m_listener;
+	b3TaskExecutor* m_executor;
 
 	b3Body** m_bodies;
-	u32 m_bodyCapacity;
 	u32 m_bodyCount;
 
 	b3Contact** m_contacts;
-	u32 m_contactCapacity;
 	u32 m_contactCount;
 
 	b3Joint** m_joints;
-	u32 m_jointCapacity;
 	u32 m_jointCount;
+
+	const b3IslandCounts* m_islandCounts;
+	u32 m_islandCount;
 	
 	b3Position* m_positions;
 	b3Velocity* m_velocities;
 	b3Mat33* m_invInertias;
+
+	// Has each island of the batch solved its position constraints?
+	bool* m_positionsSolved;
 };
 
 #endif
\ No newline at end of file
@@ -138,8 +138,6 @@ private:
 	bool m_enableTwistLimit;
 
 	// Solver temp
-	u32 m_indexA;
-	u32 m_indexB;
 	scalar m_mA;
 	scalar m_mB;
 	b3Mat33 m_iA;
@@ -161,6 +161,11 @@ protected:
 	void* m_userData;
 	bool m_collideLinked;
 
+	// Solver indices of the bodies. 
+	// These are set when the joint is added to an island.
+	u32 m_indexA;
+	u32 m_indexB;
+
 	// Links to the world joint list.
 	b3Joint* m_prev;
 	b3Joint* m_next;
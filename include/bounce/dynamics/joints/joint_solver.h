@@ -51,6 +51,12 @@ public :
 	void WarmStart();
 	void SolveVelocityConstraints();	
 	bool SolvePositionConstraints();
+
+	// These functions only touch the joints in the range [begin, end). 
+	// Ranges of joints that don't share bodies can be solved concurrently.
+	void WarmStart(u32 begin, u32 end);
+	void SolveVelocityConstraints(u32 begin, u32 end);
+	bool SolvePositionConstraints(u32 begin, u32 end);
 private :
 	b3SolverData m_solverData;
 	b3Joint** m_joints;
@@ -118,7 +118,6 @@ private:
 	b3Vec3 m_bias;
 
 	// Solver temp
-	u32 m_indexB;
 	scalar m_mB;
 	b3Mat33 m_iB;
 	b3Vec3 m_localCenterB;
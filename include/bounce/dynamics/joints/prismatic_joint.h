@@ -174,8 +174,6 @@ protected:
 	b3LimitState m_limitState;
 
 	// Solver temp
-	u32 m_indexA;
-	u32 m_indexB;
 	b3Vec3 m_localCenterA;
 	b3Vec3 m_localCenterB;
 	b3Mat33 m_localInvIA;
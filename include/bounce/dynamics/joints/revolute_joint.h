@@ -164,8 +164,6 @@ private:
 	scalar m_upperAngle;
 
 	// Solver temp
-	u32 m_indexA;
-	u32 m_indexB;
 	scalar m_mA;
 	scalar m_mB;
 	b3Mat33 m_iA;
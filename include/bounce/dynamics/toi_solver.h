@@ -0,0 +1,63 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_TOI_SOLVER_H
+#define B3_TOI_SOLVER_H
+
+#include <bounce/common/math/vec3.h>
+
+class b3BroadPhase;
+class b3ContactFilter;
+class b3Body;
+
+// An impulse that a fast body applies to a dynamic body at an impact.
+struct b3TOIImpulse
+{
+	b3Body* body;
+	b3Vec3 point;
+	b3Vec3 impulse;
+};
+
+// The continuous collision solver. 
+// This moves a fast body through its time of impact events in time order. 
+// At each impact the body is moved to the time of impact, its normal velocity 
+// relative to the other body is removed or reflected, and the remaining time of the step 
+// is swept with the new velocity. The other bodies are at rest at their final transforms.
+// Non-bullets are swept against static and kinematic bodies. 
+// Bullets are also swept against non-bullet dynamic bodies. The impulse of such impact 
+// is shared by both bodies according to their effective masses. The share of the other body 
+// is returned so that it can be applied after all bullets have been solved.
+class b3TOISolver
+{
+public:
+	b3TOISolver(const b3BroadPhase* broadPhase, b3ContactFilter* contactFilter, scalar dt);
+
+	// Sweep a fast body through the step.
+	// This only writes to the given body. The impulses on the other dynamic bodies 
+	// are written to the given array, which must have room for B3_MAX_SUB_STEPS impulses.
+	// Return the number of time of impact events.
+	u32 Solve(b3Body* body, b3TOIImpulse* impulses, u32* impulseCount) const;
+private:
+	struct QueryCallback;
+
+	const b3BroadPhase* m_broadPhase;
+	b3ContactFilter* m_contactFilter;
+	scalar m_dt;
+};
+
+#endif
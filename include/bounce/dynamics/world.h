@@ -22,14 +22,21 @@
 #include <bounce/common/memory/stack_allocator.h>
 #include <bounce/common/memory/block_allocator.h>
 #include <bounce/common/template/list.h>
+#include <bounce/common/stats.h>
+#include <bounce/common/thread/step_task_executor.h>
 #include <bounce/dynamics/time_step.h>
 #include <bounce/dynamics/joint_manager.h>
 #include <bounce/dynamics/contact_manager.h>
+#include <atomic>
 
 struct b3BodyDef;
 
 class b3Body;
 
+struct b3ArticulationDef;
+
+class b3Articulation;
+
 class b3QueryListener;
 class b3QueryFilter;
 
@@ -42,7 +49,14 @@ class b3ShapeCastFilter;
 class b3ContactListener;
 class b3ContactFilter;
 
-// Output of b3World::RayCastSingle
+class b3TaskExecutor;
+
+class b3WorldSnapshot;
+
+// The minimum number of ray packets cast by a task in b3World::RayCastBatch.
+const u32 b3_minRayPacketTaskRange = 8;
+
+// Output of b3World::RayCastSingle and b3World::RayCastBatch
 struct b3RayCastSingleOutput
 {
 	b3Fixture* fixture; // fixture
@@ -89,12 +103,82 @@ public:
 	// touching with each other.
 	void SetContactListener(b3ContactListener* listener);
 	
+	// Set the task executor used to run the time step in parallel. 
+	// Pass nullptr to run the time step on the calling thread. This is the default.
+	// The executor must exist until it is replaced or this world is destroyed.
+	void SetTaskExecutor(b3TaskExecutor* executor);
+
+	// Set the allocation context installed in b3_allocContext while this world is stepped. 
+	// The previous context of the calling thread is restored when Step returns. 
+	// Pass nullptr to keep the context of the calling thread. This is the default.
+	void SetAllocContext(void* context);
+
+	// Get the allocation context of this world.
+	void* GetAllocContext() const;
+
+	// Set the broad-phase algorithm used to find new contacts. 
+	// This must be called before any fixture is created. 
+	// The default is the dynamic tree broad-phase.
+	void SetBroadPhase(b3BroadPhaseType type);
+
+	// Reinsert up to a given number of proxies into the broad-phase tree. 
+	// The leaves are visited in round-robin order across calls. 
+	// Call this once per step with a small count to keep the tree from degrading 
+	// in a long simulation. This does nothing for the sweep-and-prune broad-phase.
+	void OptimizeBroadPhase(u32 maxProxyCount);
+
+	// Get the height of the broad-phase tree.
+	u32 GetTreeHeight() const;
+
+	// Get the maximum height difference between the children of a node of the broad-phase tree.
+	u32 GetTreeBalance() const;
+
+	// Get the ratio of the sum of the node areas to the root area of the broad-phase tree.
+	// This grows as the tree quality degrades.
+	scalar GetTreeQuality() const;
+
 	// Enable body sleeping. This improves performance.
 	void SetSleeping(bool flag);
 
 	// Enable warm-starting for the constraint solvers. This improves stability significantly.
 	void SetWarmStart(bool flag);
+
+	// Enable the SIMD contact velocity solver. This improves performance on scenes with many contacts.
+	// The SIMD instruction set is chosen at build time. See simd.h.
+	void SetSIMD(bool flag);
+
+	// Enable the feature cache of the convex contact algorithms. This improves performance.
+	void SetConvexCache(bool flag);
+
+	// Enable continuous collision. This prevents fast bodies from tunneling 
+	// through static and kinematic bodies, and bullets from tunneling through other bodies.
+	// Speculative bodies are skipped because their contacts already prevent tunneling.
+	void SetContinuous(bool flag);
 	
+	// Enable the collection of statistics during a time step. 
+	// This is disabled by default and costs nothing when disabled.
+	void SetStepStats(bool flag);
+
+	// Get the statistics collected during the last time step.
+	const b3StepStats& GetStepStats() const;
+
+	// Enable the publication of a query snapshot at the end of each time step. 
+	// This is disabled by default.
+	void SetQuerySnapshot(bool flag);
+
+	// Acquire the last published query snapshot. 
+	// This can be called from any thread, also while this world is stepped, and never blocks.
+	// Return nullptr if there is no snapshot. A snapshot is withdrawn when a fixture is destroyed 
+	// until the next time step.
+	// The fixtures, shapes, and bodies reachable from an acquired snapshot stay valid until 
+	// the snapshot is released, even if they are destroyed in the meantime. Their memory is 
+	// freed at the end of the first time step during which no snapshot is acquired.
+	// Release the snapshot with ReleaseSnapshot when done with it.
+	const b3WorldSnapshot* AcquireSnapshot() const;
+
+	// Release a snapshot acquired with AcquireSnapshot.
+	void ReleaseSnapshot(const b3WorldSnapshot* snapshot) const;
+
 	// Set the acceleration due to the gravity force between this world and each dynamic 
 	// body in the world. 
 	// The acceleration has units of m/s^2.
@@ -114,6 +198,15 @@ public:
 
 	// Remove a joint from the world and deallocate it from the memory.
 	void DestroyJoint(b3Joint* joint);
+
+	// Create a new articulation. 
+	// The links of the articulation collide with the fixtures in this world, 
+	// but not with the links of other articulations.
+	// Articulations are stepped after the rigid bodies, so they don't enter the constraint solvers.
+	b3Articulation* CreateArticulation(const b3ArticulationDef& def);
+
+	// Destroy an existing articulation.
+	void DestroyArticulation(b3Articulation* articulation);
 	 
 	// Simulate a physics step.
 	// The function parameters are the ammount of time to simulate, 
@@ -139,6 +232,19 @@ public:
 	// and the intersection fraction.
 	bool RayCastSingle(b3RayCastSingleOutput* output, b3RayCastFilter* filter, const b3Vec3& p1, const b3Vec3& p2) const;
 
+	// Perform a batch of ray casts with the world.
+	// The closest intersection of each ray is written to its output. 
+	// If a ray doesn't intersect with a shape then its output fixture is nullptr.
+	// Consecutive rays are cast together in packets of b3_rayPacketSize rays, 
+	// so keep rays with close origins and directions next to each other.
+	// If a task executor is set then the packets are cast in parallel and 
+	// the filter must be safe to call from multiple threads.
+	// The executor runs one loop at a time, so if a batch called from another thread 
+	// is using it then the packets are cast on the calling thread instead. 
+	// Don't call this from a task of the world executor.
+	// This must not be called during a time step.
+	void RayCastBatch(b3RayCastSingleOutput* outputs, b3RayCastFilter* filter, const b3RayCastInput* inputs, u32 count) const;
+
 	// Perform a shape cast with the world. This only works for given convex shapes.
 	// You must supply a listener, filter, the shape, its transform and the displacement of the shape.
 	// The shape must belong to this world.
@@ -175,6 +281,10 @@ public:
 	const b3List<b3Contact>& GetContactList() const;
 	b3List<b3Contact>& GetContactList();
 
+	// Get the list of articulations in this world.
+	const b3List<b3Articulation>& GetArticulationList() const;
+	b3List<b3Articulation>& GetArticulationList();
+
 	// Set the draw flags.
 	void SetDrawFlags(u32 flags);
 	
@@ -206,10 +316,45 @@ private:
 
 	void Solve(scalar dt, u32 velocityIterations, u32 positionIterations);
 
+	// Sub-step the fast bodies to their times of impact.
+	void SolveTOI(scalar dt);
+
+	// Store the velocities of the bodies the articulations are attached to.
+	void PrepareArticulations();
+
+	// Step the articulations and resolve the contacts between their links and the fixtures.
+	void SolveArticulations(scalar dt);
+
+	// Get the executor used to run the time step.
+	// This wraps the task executor so that the workers use the state of the stepping thread.
+	b3TaskExecutor* GetExecutor();
+
+	// Pass the executor to the broad-phase and the contact manager.
+	void UpdateExecutors();
+
+	// Build a snapshot in a snapshot not in use and publish it.
+	void PublishSnapshot();
+
+	// Withdraw the published snapshot.
+	void WithdrawSnapshot();
+
+	// Return true if a thread holds a snapshot.
+	bool IsSnapshotAcquired() const;
+
+	// Free the destroyed fixtures and bodies that the acquired snapshots might have referenced.
+	void FreeRetired();
+
 	bool m_sleeping;
 	bool m_warmStarting;
+	bool m_simd;
+	bool m_convexCache;
+	bool m_continuous;
+	bool m_collectStats;
 	u32 m_flags;
 	b3Vec3 m_gravity;
+
+	// The current time step. Speculative contacts use it to predict the motion of the bodies.
+	scalar m_dt;
 	
 	// Debug draw flags.
 	u32 m_drawFlags;
@@ -220,6 +365,26 @@ private:
 	// Block allocator
 	b3BlockAllocator m_blockAllocator;
 
+	// Allocation context used during a time step
+	void* m_allocContext;
+
+	// Task executor
+	b3TaskExecutor* m_taskExecutor;
+
+	// Is a ray cast batch running on the task executor?
+	mutable std::atomic<bool> m_executorBusy;
+
+	// Stack allocator per executor worker
+	b3StackAllocator* m_workerAllocators;
+	u32 m_workerCount;
+
+	// Statistics of the last step and per executor worker
+	b3StepStats m_stepStats;
+	b3StepStats* m_workerStats;
+	
+	// Task executor used during a time step
+	b3StepTaskExecutor m_stepExecutor;
+
 	// List of bodies
 	b3List<b3Body> m_bodyList;
 	
@@ -228,8 +393,30 @@ private:
 	
 	// List of contacts
 	b3ContactManager m_contactMan;
+
+	// List of articulations
+	b3List<b3Articulation> m_articulationList;
+
+	// Query snapshots
+	bool m_querySnapshot;
+	std::atomic<b3WorldSnapshot*> m_snapshot;
+	b3WorldSnapshot* m_snapshotList;
+
+	// Fixtures and bodies destroyed while a snapshot was acquired
+	b3List<b3Fixture> m_retiredFixtures;
+	b3List<b3Body> m_retiredBodies;
 };
 
+inline void b3World::SetAllocContext(void* context)
+{
+	m_allocContext = context;
+}
+
+inline void* b3World::GetAllocContext() const
+{
+	return m_allocContext;
+}
+
 inline void b3World::SetContactListener(b3ContactListener* listener)
 {
 	m_contactMan.m_contactListener = listener;
@@ -250,11 +437,51 @@ inline const b3Vec3& b3World::GetGravity() const
 	return m_gravity;
 }
 
+inline void b3World::OptimizeBroadPhase(u32 maxProxyCount)
+{
+	m_contactMan.m_broadPhase->Optimize(maxProxyCount);
+}
+
+inline u32 b3World::GetTreeHeight() const
+{
+	return m_contactMan.m_broadPhase->GetTreeHeight();
+}
+
+inline u32 b3World::GetTreeBalance() const
+{
+	return m_contactMan.m_broadPhase->GetTreeBalance();
+}
+
+inline scalar b3World::GetTreeQuality() const
+{
+	return m_contactMan.m_broadPhase->GetTreeQuality();
+}
+
 inline void b3World::SetWarmStart(bool flag)
 {
 	m_warmStarting = flag;
 }
 
+inline void b3World::SetSIMD(bool flag)
+{
+	m_simd = flag;
+}
+
+inline void b3World::SetConvexCache(bool flag)
+{
+	m_convexCache = flag;
+}
+
+inline void b3World::SetContinuous(bool flag)
+{
+	m_continuous = flag;
+}
+
+inline const b3StepStats& b3World::GetStepStats() const
+{
+	return m_stepStats;
+}
+
 inline const b3List<b3Body>& b3World::GetBodyList() const
 {
 	return m_bodyList;
@@ -265,6 +492,16 @@ inline b3List<b3Body>& b3World::GetBodyList()
 	return m_bodyList;
 }
 
+inline const b3List<b3Articulation>& b3World::GetArticulationList() const
+{
+	return m_articulationList;
+}
+
+inline b3List<b3Articulation>& b3World::GetArticulationList()
+{
+	return m_articulationList;
+}
+
 inline const b3List<b3Joint>& b3World::GetJointList() const
 {
 	return m_jointMan.m_jointList;
@@ -100,19 +100,21 @@ class b3ContactListener
 public:
 	virtual ~b3ContactListener() { }
 
-	// Called when two shapes begin to overlap.
+	// Called when two shapes begin to touch.
+	// The speculative points of separated shapes don't begin a contact.
 	virtual void BeginContact(b3Contact* contact) 
 	{
 		B3_NOT_USED(contact);
 	}
 
-	// Called when two shapes cease to overlap.
+	// Called when two shapes cease to touch.
 	virtual void EndContact(b3Contact* contact)
 	{
 		B3_NOT_USED(contact);
 	}
 	
 	// Called after a dynamic contact is updated.
+	// This is also called for speculative contacts whose shapes are not touching yet.
 	virtual void PreSolve(b3Contact* contact)
 	{
 		B3_NOT_USED(contact);
@@ -0,0 +1,99 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_WORLD_SNAPSHOT_H
+#define B3_WORLD_SNAPSHOT_H
+
+#include <bounce/dynamics/world.h>
+#include <bounce/collision/trees/static_tree.h>
+#include <atomic>
+
+// A fixture stored in a world snapshot.
+struct b3SnapshotFixture
+{
+	b3Fixture* fixture; // fixture
+	b3Transform xf; // body transform when the snapshot was taken
+};
+
+// An immutable copy of the fixture AABBs and body transforms of a world 
+// taken at the end of a time step.
+// The world queries can run on a snapshot from any number of threads 
+// while the world is stepped on another thread.
+// The fixtures and shapes are referenced, not copied. A fixture destroyed while 
+// an acquired snapshot contains it is freed after the snapshot is released. 
+// Don't change the shape of a fixture while an acquired snapshot contains the fixture.
+// See b3World::AcquireSnapshot.
+class b3WorldSnapshot
+{
+public:
+	// Get the number of fixtures in this snapshot.
+	u32 GetFixtureCount() const;
+
+	// Get the fixtures in this snapshot.
+	const b3SnapshotFixture* GetFixtures() const;
+
+	// Same as b3World::RayCast but on this snapshot.
+	void RayCast(b3RayCastListener* listener, b3RayCastFilter* filter, const b3Vec3& p1, const b3Vec3& p2) const;
+
+	// Same as b3World::RayCastSingle but on this snapshot.
+	bool RayCastSingle(b3RayCastSingleOutput* output, b3RayCastFilter* filter, const b3Vec3& p1, const b3Vec3& p2) const;
+
+	// Same as b3World::ShapeCast but on this snapshot.
+	void ShapeCast(b3ShapeCastListener* listener, b3ShapeCastFilter* filter, const b3Shape* shape, const b3Transform& xf, const b3Vec3& displacement) const;
+
+	// Same as b3World::ShapeCastSingle but on this snapshot.
+	bool ShapeCastSingle(b3ShapeCastSingleOutput* output, b3ShapeCastFilter* filter, const b3Shape* shape, const b3Transform& xf, const b3Vec3& displacement) const;
+
+	// Same as b3World::QueryAABB but on this snapshot.
+	void QueryAABB(b3QueryListener* listener, b3QueryFilter* filter, const b3AABB& aabb) const;
+private:
+	friend class b3World;
+
+	b3WorldSnapshot();
+	~b3WorldSnapshot();
+
+	// Copy the fixtures of a world and build the tree.
+	void Build(b3World* world, b3TaskExecutor* executor);
+
+	// The fixtures and their AABBs.
+	u32 m_fixtureCount;
+	u32 m_fixtureCapacity;
+	b3SnapshotFixture* m_fixtures;
+	b3AABB* m_aabbs;
+
+	// The tree of fixture AABBs.
+	b3StaticTree m_tree;
+
+	// The number of threads using this snapshot.
+	mutable std::atomic<u32> m_referenceCount;
+
+	// The next snapshot in the world's list.
+	b3WorldSnapshot* m_next;
+};
+
+inline u32 b3WorldSnapshot::GetFixtureCount() const
+{
+	return m_fixtureCount;
+}
+
+inline const b3SnapshotFixture* b3WorldSnapshot::GetFixtures() const
+{
+	return m_fixtures;
+}
+
+#endif
@@ -0,0 +1,338 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_ARTICULATION_H
+#define B3_ARTICULATION_H
+
+#include <bounce/common/math/transform.h>
+#include <bounce/common/template/list.h>
+
+struct b3ArticulationLink;
+
+class b3Body;
+class b3World;
+
+// The joint types.
+enum b3ArticulationJointType
+{
+	e_revoluteArticulationJoint,
+	e_sphericalArticulationJoint,
+	e_prismaticArticulationJoint
+};
+
+// Articulation link definition.
+// The link frame must be located at the center of mass of the link.
+struct b3ArticulationLinkDef
+{
+	b3ArticulationLinkDef()
+	{
+		parent = B3_MAX_U32;
+		jointType = e_sphericalArticulationJoint;
+		position.SetZero();
+		orientation.SetIdentity();
+		mass = scalar(1);
+		inertia = b3Mat33Diagonal(scalar(0.4));
+		anchor.SetZero();
+		axis = b3Vec3_x;
+		radius = scalar(0);
+	}
+
+	// Index of the parent link. 
+	// The parent index must be smaller than the index of this link.
+	// The base link has no parent.
+	u32 parent;
+
+	// The type of the joint connecting this link to its parent link.
+	b3ArticulationJointType jointType;
+
+	// Initial position of the link in world coordinates.
+	b3Vec3 position;
+
+	// Initial orientation of the link in world coordinates.
+	b3Quat orientation;
+
+	// Mass of the link in kg. Set the mass of the base link to zero to fix it.
+	scalar mass;
+
+	// Rotational inertia of the link about its center of mass in the link frame.
+	b3Mat33 inertia;
+
+	// Joint anchor point in world coordinates.
+	b3Vec3 anchor;
+
+	// Joint axis in world coordinates. Used by revolute and prismatic joints.
+	b3Vec3 axis;
+
+	// Collision radius of the link. 
+	// The collision shape is a capsule from the joint anchor to the link position, 
+	// or a sphere at the link position for the base link.
+	// Links only collide with the fixtures of a world. They don't collide with the other links 
+	// of the articulation or with the links of other articulations. Zero disables collision.
+	scalar radius;
+};
+
+// Articulation definition.
+struct b3ArticulationDef
+{
+	b3ArticulationDef()
+	{
+		count = 0;
+		links = nullptr;
+		linearDamping = scalar(0.6);
+		angularDamping = scalar(0.6);
+		friction = scalar(0.6);
+		body = nullptr;
+	}
+
+	// Number of links.
+	u32 count;
+
+	// Link definitions. The first link is the base link.
+	const b3ArticulationLinkDef* links;
+
+	// Linear coefficient of damping.
+	scalar linearDamping;
+
+	// Angular coefficient of damping.
+	scalar angularDamping;
+
+	// Coefficient of friction of the links.
+	scalar friction;
+
+	// The body the base link is attached to when the articulation is created by a world.
+	// The base link then follows the body and the links pull the body back.
+	// The base link keeps its initial position and orientation relative to the body.
+	b3Body* body;
+};
+
+// This class represents an articulation as a tree of links connected to a base link.
+// Each link is connected to its parent link by a revolute, spherical, or prismatic joint.
+// The simulation is performed in reduced coordinates using the articulated body algorithm, 
+// which runs in linear time on the number of links. Therefore, the joints never drift apart 
+// and don't require solver iterations.
+// Suggestion: Tune the coefficients of damping and take smaller time steps for improving stability.
+class b3Articulation
+{
+public:
+	// Construct this articulation from a definition.
+	b3Articulation(const b3ArticulationDef& def);
+
+	// Articulation destructor.
+	~b3Articulation();
+
+	// Set the acceleration of gravity.
+	void SetGravity(const b3Vec3& gravity);
+
+	// Get the acceleration of gravity.
+	const b3Vec3& GetGravity() const;
+
+	// Set the position of the base link.
+	void SetPosition(const b3Vec3& position);
+
+	// Get the position of the base link.
+	const b3Vec3& GetPosition() const;
+
+	// Set the linear velocity of the base link.
+	void SetLinearVelocity(const b3Vec3& linearVelocity);
+
+	// Get the linear velocity of the base link.
+	b3Vec3 GetLinearVelocity() const;
+
+	// Set the angular velocity of the base link.
+	void SetAngularVelocity(const b3Vec3& angularVelocity);
+
+	// Get the angular velocity of the base link.
+	b3Vec3 GetAngularVelocity() const;
+
+	// Get the number of links.
+	u32 GetLinkCount() const;
+
+	// Get the link transform given the link index.
+	const b3Transform& GetLinkTransform(u32 index) const;
+
+	// Get the type of the joint connecting a link to its parent link.
+	b3ArticulationJointType GetJointType(u32 index) const;
+
+	// Get the joint angle or translation of a revolute or prismatic joint.
+	scalar GetJointPosition(u32 index) const;
+
+	// Set the joint velocity of a link.
+	// Only the first component is used by revolute and prismatic joints.
+	// The angular velocity of a spherical joint is expressed in the frame of the link.
+	void SetJointVelocity(u32 index, const b3Vec3& velocity);
+
+	// Get the joint velocity of a link.
+	const b3Vec3& GetJointVelocity(u32 index) const;
+
+	// Set the joint force of a link. 
+	// This is the torque of a revolute or spherical joint, or the force of a prismatic joint.
+	// The force persists until it is changed.
+	void SetJointForce(u32 index, const b3Vec3& force);
+
+	// Apply a force at a world point to a link. 
+	// The force is cleared after the next time step.
+	void ApplyForce(u32 index, const b3Vec3& force, const b3Vec3& point);
+
+	// Get the linear velocity of the origin of a link in world coordinates.
+	b3Vec3 GetLinkLinearVelocity(u32 index) const;
+
+	// Get the angular velocity of a link in world coordinates.
+	b3Vec3 GetLinkAngularVelocity(u32 index) const;
+
+	// Get the mass of a link.
+	scalar GetLinkMass(u32 index) const;
+
+	// Get the rotational inertia of a link about its center of mass in world coordinates.
+	b3Mat33 GetLinkInertia(u32 index) const;
+
+	// Get the collision radius of a link.
+	scalar GetLinkRadius(u32 index) const;
+
+	// Get the joint anchor point of a link in the link frame.
+	// This is the origin for the base link.
+	b3Vec3 GetLinkAnchor(u32 index) const;
+
+	// Get the coefficient of friction of the links.
+	scalar GetFriction() const;
+
+	// Get the body the base link is attached to.
+	b3Body* GetBody();
+	const b3Body* GetBody() const;
+
+	// Get the force the base link applied to the attached body during the last time step 
+	// in world coordinates.
+	const b3Vec3& GetReactionForce() const;
+
+	// Get the torque about the base link origin that the base link applied to the attached body 
+	// during the last time step in world coordinates.
+	const b3Vec3& GetReactionTorque() const;
+
+	// Get the next articulation in the world articulation list.
+	b3Articulation* GetNext();
+	const b3Articulation* GetNext() const;
+
+	// Perform a time-step.
+	void Step(scalar dt);
+
+	// Debug draw the links and joints.
+	void Draw() const;
+private:
+	friend class b3World;
+	friend class b3ArticulationSolver;
+	friend class b3List<b3Articulation>;
+
+	// Couple the base link to a rigid body during the next time step. 
+	// The velocities and accelerations of the base link are the ones of the body without the articulation.
+	// The body mass properties are its mass, rotational inertia about its center of mass, and 
+	// center of mass. Zero mass prescribes the motion of the base link.
+	// Everything is in world coordinates.
+	void SetBaseMotion(const b3Transform& xf, const b3Vec3& v, const b3Vec3& w, const b3Vec3& a, const b3Vec3& alpha, 
+		scalar mass, const b3Mat33& I, const b3Vec3& center);
+
+	// Acceleration of gravity.
+	b3Vec3 m_gravity;
+
+	// Linear coefficient of damping.
+	scalar m_linearDamping;
+
+	// Angular coefficient of damping.
+	scalar m_angularDamping;
+
+	// Coefficient of friction.
+	scalar m_friction;
+
+	// Links. The base link is the first link.
+	u32 m_linkCount;
+	b3ArticulationLink* m_links;
+
+	// Prescribed motion of the base link.
+	bool m_baseMotion;
+
+	// Mass properties of the body coupled to the base link in the base link frame.
+	scalar m_baseMass;
+	b3Mat33 m_baseInertia;
+	b3Vec3 m_baseCenter;
+
+	// Reaction on the attached body.
+	b3Vec3 m_reactionForce;
+	b3Vec3 m_reactionTorque;
+
+	// World attachment
+	b3Body* m_body;
+	b3Transform m_localFrame;
+
+	// Base velocity at the beginning of a world time step.
+	b3Vec3 m_baseVelocity0;
+	b3Vec3 m_baseAngularVelocity0;
+
+	// World articulation list
+	b3Articulation* m_prev;
+	b3Articulation* m_next;
+};
+
+inline void b3Articulation::SetGravity(const b3Vec3& gravity)
+{
+	m_gravity = gravity;
+}
+
+inline const b3Vec3& b3Articulation::GetGravity() const
+{
+	return m_gravity;
+}
+
+inline u32 b3Articulation::GetLinkCount() const
+{
+	return m_linkCount;
+}
+
+inline scalar b3Articulation::GetFriction() const
+{
+	return m_friction;
+}
+
+inline b3Body* b3Articulation::GetBody()
+{
+	return m_body;
+}
+
+inline const b3Body* b3Articulation::GetBody() const
+{
+	return m_body;
+}
+
+inline const b3Vec3& b3Articulation::GetReactionForce() const
+{
+	return m_reactionForce;
+}
+
+inline const b3Vec3& b3Articulation::GetReactionTorque() const
+{
+	return m_reactionTorque;
+}
+
+inline b3Articulation* b3Articulation::GetNext()
+{
+	return m_next;
+}
+
+inline const b3Articulation* b3Articulation::GetNext() const
+{
+	return m_next;
+}
+
+#endif
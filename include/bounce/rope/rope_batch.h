@@ -0,0 +1,130 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_ROPE_BATCH_H
+#define B3_ROPE_BATCH_H
+
+#include <bounce/rope/rope.h>
+
+class b3TaskExecutor;
+
+struct b3RopePacket;
+struct b3RopeLane;
+
+// The minimum number of rope packets stepped by a task.
+const u32 b3_minRopePacketTaskRange = 4;
+
+// This class steps many ropes at once. 
+// The ropes are grouped into packets of B3_SIMD_WIDTH ropes having similar link counts. 
+// The packets are only touched by the library, so their layout follows the lane count of the library build. 
+// The links of a packet are stored in SoA layout, one rope per SIMD lane. 
+// Therefore, the recursions of a packet run for all of its ropes at the same time.
+// The simulation of each rope is the same as the simulation of a b3Rope.
+class b3RopeBatch
+{
+public:
+	// Construct this batch from an array of rope definitions.
+	b3RopeBatch(const b3RopeDef* defs, u32 count);
+
+	// Rope batch destructor.
+	~b3RopeBatch();
+
+	// Set the task executor used to step the packets in parallel. 
+	// The executor can be null.
+	void SetTaskExecutor(b3TaskExecutor* executor);
+
+	// Set the acceleration of gravity.
+	void SetGravity(const b3Vec3& gravity);
+
+	// Get the acceleration of gravity.
+	const b3Vec3& GetGravity() const;
+
+	// Get the number of ropes.
+	u32 GetRopeCount() const;
+
+	// Set the position of the base link of a rope.
+	void SetPosition(u32 rope, const b3Vec3& position);
+
+	// Get the position of the base link of a rope.
+	b3Vec3 GetPosition(u32 rope) const;
+
+	// Set the linear velocity of the base link of a rope.
+	void SetLinearVelocity(u32 rope, const b3Vec3& linearVelocity);
+
+	// Get the linear velocity of the base link of a rope.
+	b3Vec3 GetLinearVelocity(u32 rope) const;
+
+	// Set the angular velocity of the base link of a rope.
+	void SetAngularVelocity(u32 rope, const b3Vec3& angularVelocity);
+
+	// Get the angular velocity of the base link of a rope.
+	b3Vec3 GetAngularVelocity(u32 rope) const;
+
+	// Get the number of links of a rope.
+	u32 GetLinkCount(u32 rope) const;
+
+	// Get the transform of a link of a rope.
+	b3Transform GetLinkTransform(u32 rope, u32 index) const;
+
+	// Perform a time-step.
+	void Step(scalar dt);
+
+	// Debug draw the links using their transforms.
+	void Draw() const;
+private:
+	friend struct b3RopeBatchContext;
+
+	// Step the packets in the range [begin, end).
+	void StepPackets(u32 begin, u32 end, scalar dt);
+
+	// Acceleration of gravity.
+	b3Vec3 m_gravity;
+
+	// Task executor.
+	b3TaskExecutor* m_executor;
+
+	// Lane of each rope.
+	u32 m_ropeCount;
+	b3RopeLane* m_ropes;
+
+	// Packets.
+	u32 m_packetCount;
+	b3RopePacket* m_packets;
+};
+
+inline void b3RopeBatch::SetTaskExecutor(b3TaskExecutor* executor)
+{
+	m_executor = executor;
+}
+
+inline void b3RopeBatch::SetGravity(const b3Vec3& gravity)
+{
+	m_gravity = gravity;
+}
+
+inline const b3Vec3& b3RopeBatch::GetGravity() const
+{
+	return m_gravity;
+}
+
+inline u32 b3RopeBatch::GetRopeCount() const
+{
+	return m_ropeCount;
+}
+
+#endif
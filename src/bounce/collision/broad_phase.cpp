@@ -17,88 +17,113 @@
 */
 
 #include <bounce/collision/broad_phase.h>
+#include <bounce/collision/tree_broad_phase.h>
+#include <bounce/collision/sap_broad_phase.h>
 
-b3BroadPhase::b3BroadPhase() 
+b3BroadPhase* b3BroadPhase::Create(b3BroadPhaseType type)
 {
-	m_proxyCount = 0;
+	switch (type)
+	{
+	case e_dynamicTreeBroadPhase:
+	{
+		void* mem = b3Alloc(sizeof(b3TreeBroadPhase));
+		return new (mem) b3TreeBroadPhase();
+	}
+	case e_sweepAndPruneBroadPhase:
+	{
+		void* mem = b3Alloc(sizeof(b3SAPBroadPhase));
+		return new (mem) b3SAPBroadPhase();
+	}
+	default:
+	{
+		B3_ASSERT(false);
+		return nullptr;
+	}
+	}
+}
 
-	m_moveBufferCapacity = 16;
-	m_moveBuffer = (u32*)b3Alloc(m_moveBufferCapacity * sizeof(u32));
-	memset(m_moveBuffer, 0, m_moveBufferCapacity * sizeof(u32));
-	m_moveBufferCount = 0;
+void b3BroadPhase::Destroy(b3BroadPhase* broadPhase)
+{
+	broadPhase->~b3BroadPhase();
+	b3Free(broadPhase);
+}
+
+b3BroadPhase::b3BroadPhase(b3BroadPhaseType type)
+{
+	m_type = type;
+	m_executor = nullptr;
+	m_proxyCount = 0;
+}
 
-	m_pairCapacity = 16;
-	m_pairs = (b3Pair*)b3Alloc(m_pairCapacity * sizeof(b3Pair));
-	memset(m_pairs, 0, m_pairCapacity * sizeof(b3Pair));
-	m_pairCount = 0;
+u32 b3BroadPhase::CreateProxy(const b3AABB& aabb, void* userData, bool isStatic) 
+{
+	b3AABB fatAABB = aabb;
+	fatAABB.Extend(B3_AABB_EXTENSION);	
+	
+	u32 proxyId = InsertProxy(fatAABB, userData, isStatic);
+	
+	++m_proxyCount;
+	
+	return proxyId;
 }
 
-b3BroadPhase::~b3BroadPhase() 
+void b3BroadPhase::DestroyProxy(u32 proxyId) 
 {
-	b3Free(m_moveBuffer);
-	b3Free(m_pairs);
+	--m_proxyCount;
+	RemoveProxy(proxyId);
 }
 
-void b3BroadPhase::BufferMove(u32 proxyId) 
+// Forward a single ray to a packet callback.
+struct b3RayCastPacketWrapper
 {
-	// The proxy has been moved. Add it to the buffer of moved proxies.
-	// Check capacity.
-	if (m_moveBufferCount == m_moveBufferCapacity) 
+	scalar Report(const b3RayCastInput& input, u32 proxyId)
 	{
-		// Duplicate capacity.
-		m_moveBufferCapacity *= 2;
-
-		u32* oldMoveBuffer = m_moveBuffer;
-		m_moveBuffer = (u32*)b3Alloc(m_moveBufferCapacity * sizeof(u32));
-		memcpy(m_moveBuffer, oldMoveBuffer, m_moveBufferCount * sizeof(u32));
-		b3Free(oldMoveBuffer);
+		return fcn(context, input, rayIndex, proxyId);
 	}
 
-	// Add to move buffer.
-	m_moveBuffer[m_moveBufferCount] = proxyId;
-	++m_moveBufferCount;
-}
+	b3RayCastPacketProxyFcn* fcn;
+	void* context;
+	u32 rayIndex;
+};
 
-void b3BroadPhase::UnbufferMove(u32 proxyId)
+void b3BroadPhase::RayCastPacket(b3RayCastPacketProxyFcn* fcn, void* context, const b3RayCastInput* inputs, u32 count) const
 {
-	for (u32 i = 0; i < m_moveBufferCount; ++i)
+	B3_ASSERT(count <= b3_rayPacketSize);
+
+	b3RayCastPacketWrapper wrapper;
+	wrapper.fcn = fcn;
+	wrapper.context = context;
+	
+	for (u32 i = 0; i < count; ++i)
 	{
-		if (m_moveBuffer[i] == proxyId)
-		{
-			m_moveBuffer[i] = B3_NULL_PROXY;
-		}
+		wrapper.rayIndex = i;
+		RayCast(&wrapper, inputs[i]);
 	}
 }
 
-bool b3BroadPhase::TestOverlap(u32 proxy1, u32 proxy2) const 
+void b3BroadPhase::Optimize(u32 maxProxyCount)
 {
-	return m_tree.TestOverlap(proxy1, proxy2);
+	B3_NOT_USED(maxProxyCount);
 }
 
-u32 b3BroadPhase::CreateProxy(const b3AABB& aabb, void* userData) 
+u32 b3BroadPhase::GetTreeHeight() const
 {
-	b3AABB fatAABB = aabb;
-	fatAABB.Extend(B3_AABB_EXTENSION);	
-	
-	u32 proxyId = m_tree.InsertNode(fatAABB, userData);
-	
-	++m_proxyCount;
-	
-	BufferMove(proxyId);
+	return 0;
+}
 
-	return proxyId;
+u32 b3BroadPhase::GetTreeBalance() const
+{
+	return 0;
 }
 
-void b3BroadPhase::DestroyProxy(u32 proxyId) 
+scalar b3BroadPhase::GetTreeQuality() const
 {
-	UnbufferMove(proxyId);
-	--m_proxyCount;
-	m_tree.RemoveNode(proxyId);
+	return scalar(0);
 }
 
 bool b3BroadPhase::MoveProxy(u32 proxyId, const b3AABB& aabb, const b3Vec3& displacement)
 {
-	if (m_tree.GetAABB(proxyId).Contains(aabb))
+	if (GetAABB(proxyId).Contains(aabb))
 	{
 		// Do nothing if the new AABB is contained in the old AABB.
 		return false;
@@ -139,45 +164,8 @@ bool b3BroadPhase::MoveProxy(u32 proxyId, const b3AABB& aabb, const b3Vec3& disp
 	}
 
 	// Update proxy with the extented AABB.
-	m_tree.UpdateNode(proxyId, fatAABB);
-	
-	// Buffer the moved proxy.
-	BufferMove(proxyId);
+	UpdateProxy(proxyId, fatAABB);
 	
 	// Notify the proxy has moved.
 	return true;
 }
-
-void b3BroadPhase::TouchProxy(u32 proxyId)
-{
-	BufferMove(proxyId);
-}
-
-bool b3BroadPhase::Report(u32 proxyId) 
-{
-	if (proxyId == m_queryProxyId) 
-	{
-		// The proxy can't overlap with itself.
-		return true;
-	}
-
-	// Check capacity.
-	if (m_pairCount == m_pairCapacity) 
-	{
-		// Duplicate capacity.
-		m_pairCapacity *= 2;
-		
-		b3Pair* oldPairs = m_pairs;
-		m_pairs = (b3Pair*)b3Alloc(m_pairCapacity * sizeof(b3Pair));
-		memcpy(m_pairs, oldPairs, m_pairCount * sizeof(b3Pair));
-		b3Free(oldPairs);
-	}
-
-	// Add overlapping pair to the pair buffer.
-	m_pairs[m_pairCount].proxy1 = b3Min(proxyId, m_queryProxyId);
-	m_pairs[m_pairCount].proxy2 = b3Max(proxyId, m_queryProxyId);
-	++m_pairCount;
-
-	// Keep looking for overlapping pairs.
-	return true;
-}
\ No newline at end of file
@@ -23,7 +23,8 @@
 
 void b3CollideCapsuleAndSphere(b3Manifold& manifold, 
 	const b3Transform& xf1, const b3CapsuleShape* s1,
-	const b3Transform& xf2, const b3SphereShape* s2)
+	const b3Transform& xf2, const b3SphereShape* s2,
+	scalar margin)
 {
 	// The sphere center in the frame of the capsule.
 	b3Vec3 Q = b3MulT(xf1, b3Mul(xf2, s2->m_center));
@@ -36,7 +37,7 @@ void b3CollideCapsuleAndSphere(b3Manifold& manifold,
 	scalar u = b3Dot(B - Q, AB);
 	scalar v = b3Dot(Q - A, AB);
 	
-	scalar radius = s1->m_radius + s2->m_radius;
+	scalar radius = s1->m_radius + s2->m_radius + margin;
 
 	if (v <= scalar(0))
 	{
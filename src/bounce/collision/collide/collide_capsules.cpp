@@ -155,7 +155,8 @@ static bool b3AreParalell(const b3Capsule& hull1, const b3Capsule& hull2)
 
 void b3CollideCapsuleAndCapsule(b3Manifold& manifold, 
 	const b3Transform& xf1, const b3CapsuleShape* s1,
-	const b3Transform& xf2, const b3CapsuleShape* s2)
+	const b3Transform& xf2, const b3CapsuleShape* s2,
+	scalar margin)
 {
 	b3Capsule hull1;
 	hull1.vertex1 = xf1 * s1->m_vertex1;
@@ -172,7 +173,7 @@ void b3CollideCapsuleAndCapsule(b3Manifold& manifold,
 
 	scalar r1 = s1->m_radius;
 	scalar r2 = s2->m_radius;
-	scalar totalRadius = r1 + r2;
+	scalar totalRadius = r1 + r2 + margin;
 	if (distance > totalRadius)
 	{
 		return;
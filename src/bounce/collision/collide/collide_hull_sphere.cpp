@@ -25,9 +25,10 @@
 
 void b3CollideHullAndSphere(b3Manifold& manifold,
 	const b3Transform& xf1, const b3HullShape* s1,
-	const b3Transform& xf2, const b3SphereShape* s2)
+	const b3Transform& xf2, const b3SphereShape* s2,
+	scalar margin)
 {
-	scalar radius = s1->m_radius + s2->m_radius;
+	scalar radius = s1->m_radius + s2->m_radius + margin;
 	const b3Hull* hull1 = s1->m_hull;
 
 	// Sphere center in the frame of the hull.
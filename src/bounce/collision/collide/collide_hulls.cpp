@@ -22,13 +22,12 @@
 #include <bounce/collision/collide/cluster.h>
 #include <bounce/collision/shapes/hull_shape.h>
 #include <bounce/collision/geometry/hull.h>
-
-bool b3_convexCache = true;
-u32 b3_convexCalls = 0, b3_convexCacheHits = 0;
+#include <bounce/common/stats.h>
 
 static void b3BuildEdgeContact(b3Manifold& manifold,
 	const b3Transform& xf1, u32 index1, const b3HullShape* s1,
-	const b3Transform& xf2, u32 index2, const b3HullShape* s2)
+	const b3Transform& xf2, u32 index2, const b3HullShape* s2,
+	scalar margin)
 {
 	const b3Hull* hull1 = s1->m_hull;
 	const b3HalfEdge* edge1 = hull1->GetEdge(index1);
@@ -72,6 +71,14 @@ static void b3BuildEdgeContact(b3Manifold& manifold,
 	scalar s = inv_den * (b * e - d);
 	scalar t = inv_den * (e - b * d);
 
+	if (margin > scalar(0))
+	{
+		// Keep the closest points on the segments.
+		// The closest points of the lines of separated edges can be far from the segments.
+		s = b3Clamp(s, scalar(0), L1);
+		t = b3Clamp(t, scalar(0), L2);
+	}
+
 	b3Vec3 c1 = P1 + s * N1;
 	b3Vec3 c2 = P2 + t * N2;
 
@@ -98,7 +105,7 @@ static void b3BuildEdgeContact(b3Manifold& manifold,
 static void b3BuildFaceContact(b3Manifold& manifold,
 	const b3Transform& xf1, u32 index1, const b3HullShape* s1,
 	const b3Transform& xf2, const b3HullShape* s2,
-	bool flipNormal)
+	bool flipNormal, scalar margin)
 {
 	const b3Hull* hull1 = s1->m_hull;
 	scalar r1 = s1->m_radius;
@@ -146,7 +153,7 @@ static void b3BuildFaceContact(b3Manifold& manifold,
 		b3ClipVertex v2 = clipPolygon2[i];
 		scalar separation = b3Distance(v2.position, plane1);
 
-		if (separation <= totalRadius)
+		if (separation <= totalRadius + margin)
 		{
 			if (separation < minSeparation)
 			{
@@ -214,7 +221,8 @@ static void b3BuildFaceContact(b3Manifold& manifold,
 
 static void b3CollideHulls(b3Manifold& manifold,
 	const b3Transform& xf1, const b3HullShape* s1,
-	const b3Transform& xf2, const b3HullShape* s2)
+	const b3Transform& xf2, const b3HullShape* s2,
+	scalar margin)
 {
 	B3_ASSERT(manifold.pointCount == 0);
 
@@ -224,7 +232,7 @@ static void b3CollideHulls(b3Manifold& manifold,
 	const b3Hull* hull2 = s2->m_hull;
 	scalar r2 = s2->m_radius;
 
-	scalar totalRadius = r1 + r2;
+	scalar totalRadius = r1 + r2 + margin;
 
 	b3FaceQuery faceQuery1 = b3QueryFaceSeparation(xf1, hull1, xf2, hull2);
 	if (faceQuery1.separation > totalRadius)
@@ -247,17 +255,17 @@ static void b3CollideHulls(b3Manifold& manifold,
 	const scalar kTol = scalar(0.1) * B3_LINEAR_SLOP;
 	if (edgeQuery.separation > b3Max(faceQuery1.separation, faceQuery2.separation) + kTol)
 	{
-		b3BuildEdgeContact(manifold, xf1, edgeQuery.index1, s1, xf2, edgeQuery.index2, s2);
+		b3BuildEdgeContact(manifold, xf1, edgeQuery.index1, s1, xf2, edgeQuery.index2, s2, margin);
 	}
 	else
 	{
 		if (faceQuery1.separation + kTol > faceQuery2.separation)
 		{
-			b3BuildFaceContact(manifold, xf1, faceQuery1.index, s1, xf2, s2, false);
+			b3BuildFaceContact(manifold, xf1, faceQuery1.index, s1, xf2, s2, false, margin);
 		}
 		else
 		{
-			b3BuildFaceContact(manifold, xf2, faceQuery2.index, s2, xf1, s1, true);
+			b3BuildFaceContact(manifold, xf2, faceQuery2.index, s2, xf1, s1, true, margin);
 		}
 	}
 
@@ -270,17 +278,17 @@ static void b3CollideHulls(b3Manifold& manifold,
 	// Heuristic failed. Fallback.
 	if (edgeQuery.separation > b3Max(faceQuery1.separation, faceQuery2.separation))
 	{
-		b3BuildEdgeContact(manifold, xf1, edgeQuery.index1, s1, xf2, edgeQuery.index2, s2);
+		b3BuildEdgeContact(manifold, xf1, edgeQuery.index1, s1, xf2, edgeQuery.index2, s2, margin);
 	}
 	else
 	{
 		if (faceQuery1.separation > faceQuery2.separation)
 		{
-			b3BuildFaceContact(manifold, xf1, faceQuery1.index, s1, xf2, s2, false);
+			b3BuildFaceContact(manifold, xf1, faceQuery1.index, s1, xf2, s2, false, margin);
 		}
 		else
 		{
-			b3BuildFaceContact(manifold, xf2, faceQuery2.index, s2, xf1, s1, true);
+			b3BuildFaceContact(manifold, xf2, faceQuery2.index, s2, xf1, s1, true, margin);
 		}
 	}
 
@@ -374,7 +382,7 @@ static void b3RebuildEdgeContact(b3Manifold& manifold,
 static void b3RebuildFaceContact(b3Manifold& manifold,
 	const b3Transform& xf1, u32 index1, const b3HullShape* s1,
 	const b3Transform& xf2, const b3HullShape* s2, bool flipNormal, 
-	const b3Transform& xf01, const b3Transform& xf02)
+	const b3Transform& xf01, const b3Transform& xf02, scalar margin)
 {
 	b3Quat q01 = xf01.rotation, q1 = xf1.rotation;
 	b3Quat q02 = xf02.rotation, q2 = xf2.rotation;
@@ -403,14 +411,14 @@ static void b3RebuildFaceContact(b3Manifold& manifold,
 
 	if (b3Abs(q.s) > kCosTol)
 	{
-		b3BuildFaceContact(manifold, xf1, index1, s1, xf2, s2, flipNormal);
+		b3BuildFaceContact(manifold, xf1, index1, s1, xf2, s2, flipNormal, margin);
 	}
 }
 
 static void b3CollideCache(b3Manifold& manifold,
 	const b3Transform& xf1, const b3HullShape* s1,
 	const b3Transform& xf2, const b3HullShape* s2,
-	b3FeatureCache* cache)
+	b3FeatureCache* cache, scalar margin)
 {
 	B3_ASSERT(cache->m_featurePair.state == b3SATCacheType::e_empty);
 
@@ -420,7 +428,7 @@ static void b3CollideCache(b3Manifold& manifold,
 	const b3Hull* hull2 = s2->m_hull;
 	scalar r2 = s2->m_radius;
 
-	scalar totalRadius = r1 + r2;
+	scalar totalRadius = r1 + r2 + margin;
 
 	b3FaceQuery faceQuery1 = b3QueryFaceSeparation(xf1, hull1, xf2, hull2);
 	if (faceQuery1.separation > totalRadius)
@@ -449,7 +457,7 @@ static void b3CollideCache(b3Manifold& manifold,
 	const scalar kTol = scalar(0.1) * B3_LINEAR_SLOP;
 	if (edgeQuery.separation > b3Max(faceQuery1.separation, faceQuery2.separation) + kTol)
 	{
-		b3BuildEdgeContact(manifold, xf1, edgeQuery.index1, s1, xf2, edgeQuery.index2, s2);
+		b3BuildEdgeContact(manifold, xf1, edgeQuery.index1, s1, xf2, edgeQuery.index2, s2, margin);
 
 		// Write an overlap cache.		
 		cache->m_featurePair = b3MakeFeaturePair(b3SATCacheType::e_overlap, b3SATFeatureType::e_edge1, edgeQuery.index1, edgeQuery.index2);
@@ -459,7 +467,7 @@ static void b3CollideCache(b3Manifold& manifold,
 	{
 		if (faceQuery1.separation + kTol > faceQuery2.separation)
 		{
-			b3BuildFaceContact(manifold, xf1, faceQuery1.index, s1, xf2, s2, false);
+			b3BuildFaceContact(manifold, xf1, faceQuery1.index, s1, xf2, s2, false, margin);
 			if (manifold.pointCount > 0)
 			{
 				// Write an overlap cache.
@@ -469,7 +477,7 @@ static void b3CollideCache(b3Manifold& manifold,
 		}
 		else
 		{
-			b3BuildFaceContact(manifold, xf2, faceQuery2.index, s2, xf1, s1, true);
+			b3BuildFaceContact(manifold, xf2, faceQuery2.index, s2, xf1, s1, true, margin);
 			if (manifold.pointCount > 0)
 			{
 				// Write an overlap cache.
@@ -482,7 +490,7 @@ static void b3CollideCache(b3Manifold& manifold,
 	// Heuristic failed. Fallback.
 	if (edgeQuery.separation > b3Max(faceQuery1.separation, faceQuery2.separation))
 	{
-		b3BuildEdgeContact(manifold, xf1, edgeQuery.index1, s1, xf2, edgeQuery.index2, s2);
+		b3BuildEdgeContact(manifold, xf1, edgeQuery.index1, s1, xf2, edgeQuery.index2, s2, margin);
 		// Write an overlap cache.		
 		cache->m_featurePair = b3MakeFeaturePair(b3SATCacheType::e_overlap, b3SATFeatureType::e_edge1, edgeQuery.index1, edgeQuery.index2);
 		return;
@@ -491,7 +499,7 @@ static void b3CollideCache(b3Manifold& manifold,
 	{
 		if (faceQuery1.separation > faceQuery2.separation)
 		{
-			b3BuildFaceContact(manifold, xf1, faceQuery1.index, s1, xf2, s2, false);
+			b3BuildFaceContact(manifold, xf1, faceQuery1.index, s1, xf2, s2, false, margin);
 			if (manifold.pointCount > 0)
 			{
 				// Write an overlap cache.
@@ -501,7 +509,7 @@ static void b3CollideCache(b3Manifold& manifold,
 		}
 		else
 		{
-			b3BuildFaceContact(manifold, xf2, faceQuery2.index, s2, xf1, s1, true);
+			b3BuildFaceContact(manifold, xf2, faceQuery2.index, s2, xf1, s1, true, margin);
 			if (manifold.pointCount > 0)
 			{
 				// Write an overlap cache.
@@ -520,7 +528,8 @@ static void b3CollideHulls(b3Manifold& manifold,
 	const b3Transform& xf1, const b3HullShape* s1,
 	const b3Transform& xf2, const b3HullShape* s2,
 	b3FeatureCache* cache, 
-	const b3Transform& xf01, const b3Transform& xf02)
+	const b3Transform& xf01, const b3Transform& xf02,
+	scalar margin)
 {
 	const b3Hull* hull1 = s1->m_hull;
 	scalar r1 = s1->m_radius;
@@ -528,7 +537,7 @@ static void b3CollideHulls(b3Manifold& manifold,
 	const b3Hull* hull2 = s2->m_hull;
 	scalar r2 = s2->m_radius;
 
-	scalar totalRadius = r1 + r2;
+	scalar totalRadius = r1 + r2 + margin;
 
 	// Read cache
 	b3SATCacheType state0 = cache->m_featurePair.state;
@@ -538,7 +547,10 @@ static void b3CollideHulls(b3Manifold& manifold,
 		state1 == b3SATCacheType::e_separation)
 	{
 		// Separation cache hit.
-		++b3_convexCacheHits;
+		if (b3_stepStats)
+		{
+			++b3_stepStats->convexCacheHits;
+		}
 		return;
 	}
 
@@ -555,12 +567,12 @@ static void b3CollideHulls(b3Manifold& manifold,
 		}
 		case b3SATFeatureType::e_face1:
 		{
-			b3RebuildFaceContact(manifold, xf1, cache->m_featurePair.index1, s1, xf2, s2, false, xf01, xf02);
+			b3RebuildFaceContact(manifold, xf1, cache->m_featurePair.index1, s1, xf2, s2, false, xf01, xf02, margin);
 			break;
 		}
 		case b3SATFeatureType::e_face2:
 		{
-			b3RebuildFaceContact(manifold, xf2, cache->m_featurePair.index1, s2, xf1, s1, true, xf02, xf01);
+			b3RebuildFaceContact(manifold, xf2, cache->m_featurePair.index1, s2, xf1, s1, true, xf02, xf01, margin);
 			break;
 		}
 		default:
@@ -572,7 +584,10 @@ static void b3CollideHulls(b3Manifold& manifold,
 		if (manifold.pointCount > 0)
 		{
 			// Overlap cache hit.
-			++b3_convexCacheHits;
+			if (b3_stepStats)
+			{
+				++b3_stepStats->convexCacheHits;
+			}
 			return;
 		}
 	}
@@ -581,24 +596,99 @@ static void b3CollideHulls(b3Manifold& manifold,
 	// Overlap cache miss.
 	// Flush the cache.
 	cache->m_featurePair.state = b3SATCacheType::e_empty;
-	b3CollideCache(manifold, xf1, s1, xf2, s2, cache);
+	b3CollideCache(manifold, xf1, s1, xf2, s2, cache, margin);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+static void b3BuildClosestContact(b3Manifold& manifold,
+	const b3Transform& xf1, const b3Transform& xf2, const b3GJKOutput& gjk)
+{
+	B3_ASSERT(gjk.distance > scalar(0));
+
+	b3Vec3 normal = (gjk.point2 - gjk.point1) / gjk.distance;
+
+	b3FeaturePair pair = b3MakePair(B3_NULL_EDGE, B3_NULL_EDGE, B3_NULL_EDGE, B3_NULL_EDGE);
+
+	manifold.pointCount = 1;
+	manifold.points[0].localNormal1 = b3MulC(xf1.rotation, normal);
+	manifold.points[0].localPoint1 = b3MulT(xf1, gjk.point1);
+	manifold.points[0].localPoint2 = b3MulT(xf2, gjk.point2);
+	manifold.points[0].key = b3MakeKey(pair);
+	manifold.points[0].featurePair = pair;
+	manifold.points[0].edgeContact = false;
+}
+
 void b3CollideHullAndHull(b3Manifold& manifold,
 	const b3Transform& xf1, const b3HullShape* s1,
 	const b3Transform& xf2, const b3HullShape* s2,
-	b3ConvexCache* cache, const b3Transform& xf01, const b3Transform& xf02)
+	b3ConvexCache* cache, const b3Transform& xf01, const b3Transform& xf02,
+	scalar margin)
 {
-	++b3_convexCalls;
+	if (b3_stepStats)
+	{
+		++b3_stepStats->convexCalls;
+	}
+
+	if (margin > scalar(0))
+	{
+		// The features of the separating axis of two separated hulls can be far from each other.
+		// Therefore check the separating axis against the closest points of separated hulls.
+		b3ShapeGJKProxy proxy1(s1, 0);
+		b3ShapeGJKProxy proxy2(s2, 0);
+
+		b3GJKOutput gjk = cache ? b3GJK(xf1, proxy1, xf2, proxy2, false, &cache->simplexCache) : b3GJK(xf1, proxy1, xf2, proxy2, false);
+
+		scalar totalRadius = s1->m_radius + s2->m_radius;
+		if (gjk.distance > totalRadius)
+		{
+			if (gjk.distance > totalRadius + margin)
+			{
+				if (cache)
+				{
+					// Flush the cache.
+					cache->featureCache.m_featurePair.state = b3SATCacheType::e_empty;
+				}
+				return;
+			}
+
+			if (cache)
+			{
+				b3CollideHulls(manifold, xf1, s1, xf2, s2, &cache->featureCache, xf01, xf02, margin);
+			}
+			else
+			{
+				b3CollideHulls(manifold, xf1, s1, xf2, s2, margin);
+			}
+
+			// Keep the face contact if its axis realizes the distance.
+			// Otherwise use the closest points.
+			const scalar kTol = scalar(0.998);
+
+			if (manifold.pointCount > 0 && manifold.points[0].edgeContact == false)
+			{
+				b3Vec3 normal1 = b3Mul(xf1.rotation, manifold.points[0].localNormal1);
+				b3Vec3 normal2 = (gjk.point2 - gjk.point1) / gjk.distance;
+				
+				if (b3Dot(normal1, normal2) >= kTol)
+				{
+					return;
+				}
+			}
+
+			manifold.pointCount = 0;
+
+			b3BuildClosestContact(manifold, xf1, xf2, gjk);
+			return;
+		}
+	}
 
-	if (b3_convexCache)
+	if (cache)
 	{
-		b3CollideHulls(manifold, xf1, s1, xf2, s2, &cache->featureCache, xf01, xf02);
+		b3CollideHulls(manifold, xf1, s1, xf2, s2, &cache->featureCache, xf01, xf02, margin);
 	}
 	else
 	{
-		b3CollideHulls(manifold, xf1, s1, xf2, s2);
+		b3CollideHulls(manifold, xf1, s1, xf2, s2, margin);
 	}
 }
\ No newline at end of file
@@ -23,7 +23,8 @@
 
 void b3CollideSphereAndSphere(b3Manifold& manifold, 
 	const b3Transform& xf1, const b3SphereShape* s1,
-	const b3Transform& xf2, const b3SphereShape* s2)
+	const b3Transform& xf2, const b3SphereShape* s2,
+	scalar margin)
 {
 	b3Vec3 c1 = xf1 * s1->m_center;
 	scalar r1 = s1->m_radius;
@@ -33,7 +34,7 @@ void b3CollideSphereAndSphere(b3Manifold& manifold,
 	
 	b3Vec3 d = c2 - c1;
 	scalar dd = b3Dot(d, d);
-	scalar totalRadius = r1 + r2;
+	scalar totalRadius = r1 + r2 + margin;
 	if (dd > totalRadius * totalRadius)
 	{
 		return;
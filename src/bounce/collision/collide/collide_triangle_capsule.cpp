@@ -26,7 +26,8 @@
 
 static void b3BuildEdgeContact(b3Manifold& manifold,
 	const b3Transform& xf1, const b3TriangleHull* hull1, u32 index1, 
-	const b3Transform& xf2, const b3Capsule* hull2)
+	const b3Transform& xf2, const b3Capsule* hull2,
+	scalar margin)
 {
 	const b3HalfEdge* edge1 = hull1->GetEdge(index1);
 	const b3HalfEdge* twin1 = hull1->GetEdge(index1 + 1);
@@ -64,6 +65,14 @@ static void b3BuildEdgeContact(b3Manifold& manifold,
 	scalar s = inv_den * (b * e - d);
 	scalar t = inv_den * (e - b * d);
 
+	if (margin > scalar(0))
+	{
+		// Keep the closest points on the segments.
+		// The closest points of the lines of separated edges can be far from the segments.
+		s = b3Clamp(s, scalar(0), L1);
+		t = b3Clamp(t, scalar(0), L2);
+	}
+
 	b3Vec3 c1 = P1 + s * N1;
 	b3Vec3 c2 = P2 + t * N2;
 
@@ -87,7 +96,8 @@ static void b3BuildEdgeContact(b3Manifold& manifold,
 
 static void b3BuildFaceContact(b3Manifold& manifold,
 	const b3Transform& xf1, const b3TriangleHull* hull1, u32 index1, scalar r1,
-	const b3Transform& xf2, const b3Capsule* hull2, scalar r2)
+	const b3Transform& xf2, const b3Capsule* hull2, scalar r2,
+	scalar margin)
 {
 	b3Capsule worldHull2(xf2 * hull2->vertex1, xf2 * hull2->vertex2, r2);
 	b3ClipVertex edge2[2];
@@ -101,7 +111,7 @@ static void b3BuildFaceContact(b3Manifold& manifold,
 	b3Plane localPlane1 = hull1->GetPlane(index1);
 	b3Plane plane1 = xf1 * localPlane1;
 
-	scalar totalRadius = r1 + r2;
+	scalar totalRadius = r1 + r2 + margin;
 
 	u32 pointCount = 0;
 	for (u32 i = 0; i < clipCount; ++i)
@@ -127,12 +137,13 @@ static void b3BuildFaceContact(b3Manifold& manifold,
 
 void b3CollideTriangleAndCapsule(b3Manifold& manifold,
 	const b3Transform& xf1, const b3TriangleShape* s1,
-	const b3Transform& xf2, const b3CapsuleShape* s2)
+	const b3Transform& xf2, const b3CapsuleShape* s2,
+	scalar margin)
 {
 	scalar r1 = s1->m_radius;
 	scalar r2 = s2->m_radius;
 
-	scalar totalRadius = r1 + r2;
+	scalar totalRadius = r1 + r2 + margin;
 
 	b3ShapeGJKProxy proxy1(s1, 0);
 	b3ShapeGJKProxy proxy2(s2, 0);
@@ -172,7 +183,7 @@ void b3CollideTriangleAndCapsule(b3Manifold& manifold,
 		{
 			// Reference face found.
 			// Try to build a face contact.
-			b3BuildFaceContact(manifold, xf1, &hull1, index1, r1, xf2, &hull2, r2);
+			b3BuildFaceContact(manifold, xf1, &hull1, index1, r1, xf2, &hull2, r2, margin);
 			if (manifold.pointCount == 2)
 			{
 				return;
@@ -293,10 +304,10 @@ void b3CollideTriangleAndCapsule(b3Manifold& manifold,
 	const scalar kTol = scalar(0.1) * B3_LINEAR_SLOP;
 	if (edgeQuery.separation > faceQuery1.separation + kTol)
 	{
-		b3BuildEdgeContact(manifold, xf1, &hull1, edgeQuery.index1, xf2, &hull2);
+		b3BuildEdgeContact(manifold, xf1, &hull1, edgeQuery.index1, xf2, &hull2, margin);
 	}
 	else
 	{
-		b3BuildFaceContact(manifold, xf1, &hull1, faceQuery1.index, r1, xf2, &hull2, r2);
+		b3BuildFaceContact(manifold, xf1, &hull1, faceQuery1.index, r1, xf2, &hull2, r2, margin);
 	}
 }
\ No newline at end of file
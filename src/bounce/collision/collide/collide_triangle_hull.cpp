@@ -37,6 +37,8 @@ struct b3EdgeMap
 	}
 
 	bool IsEdgeCoplanar(u32 index) const;
+
+	bool IsPointOnCoplanarEdge(const b3Vec3& point) const;
 	
 	const b3TriangleHull* m_triangleHull;
 	bool m_hasWing[3];
@@ -77,11 +79,42 @@ bool b3EdgeMap::IsEdgeCoplanar(u32 halfEdgeIndex) const
 	return false;
 }
 
+bool b3EdgeMap::IsPointOnCoplanarEdge(const b3Vec3& point) const
+{
+	const scalar kTol = scalar(0.1) * B3_LINEAR_SLOP;
+
+	bool onEdge = false;
+	for (u32 i = 0; i < 3; ++i)
+	{
+		u32 j = i + 1 < 3 ? i + 1 : 0;
+
+		b3Vec3 A = m_triangleHull->triangleVertices[i];
+		b3Vec3 B = m_triangleHull->triangleVertices[j];
+
+		b3Vec3 Q = b3ClosestPointOnSegment(point, A, B);
+		if (b3DistanceSquared(point, Q) > kTol * kTol)
+		{
+			continue;
+		}
+
+		// A vertex must be shared by coplanar edges.
+		if (IsEdgeCoplanar(2 * i) == false)
+		{
+			return false;
+		}
+
+		onEdge = true;
+	}
+
+	return onEdge;
+}
+
 void b3CollideTriangleAndHull(b3Manifold& manifold,
 	const b3Transform& xf1, const b3TriangleShape* s1,
 	const b3Transform& xf2, const b3HullShape* s2,
 	b3ConvexCache* cache, 
-	const b3Transform& xf01, const b3Transform& xf02)
+	const b3Transform& xf01, const b3Transform& xf02,
+	scalar margin)
 {
 	b3TriangleHull triangleHull1(s1->m_vertex1, s1->m_vertex2, s1->m_vertex3);
 	const b3Hull* hull2 = s2->m_hull;
@@ -90,7 +123,7 @@ void b3CollideTriangleAndHull(b3Manifold& manifold,
 	hullShape1.m_hull = &triangleHull1;
 	hullShape1.m_radius = s1->m_radius;
 
-	b3CollideHullAndHull(manifold, xf1, &hullShape1, xf2, s2, cache, xf01, xf02);
+	b3CollideHullAndHull(manifold, xf1, &hullShape1, xf2, s2, cache, xf01, xf02, margin);
 
 	// Adjust normals
 	b3EdgeMap edgeMap;
@@ -133,6 +166,30 @@ void b3CollideTriangleAndHull(b3Manifold& manifold,
 
 			if (e1 == B3_NULL_EDGE)
 			{
+				if (pair.inEdge2 == B3_NULL_EDGE && pair.outEdge2 == B3_NULL_EDGE)
+				{
+					// Speculative point built from the closest points of a separated triangle and hull.
+					// The adjacent triangles prevent approaching a coplanar edge from the side.
+					b3Vec3 c1 = xf1 * mp->localPoint1;
+					b3Vec3 c2 = xf2 * mp->localPoint2;
+
+					if (edgeMap.IsPointOnCoplanarEdge(mp->localPoint1))
+					{
+						b3Vec3 n = plane1.normal;
+
+						if (b3Dot(n, c2 - c1) < scalar(0))
+						{
+							n = -n;
+						}
+
+						// The adjacent triangle holds the projection of c2.
+						c1 = c2 - b3Dot(c2 - c1, n) * n;
+
+						mp->localNormal1 = b3MulC(xf1.rotation, n);
+						mp->localPoint1 = b3MulT(xf1, c1);
+					}
+				}
+
 				continue;
 			}
 		}
@@ -150,17 +207,29 @@ void b3CollideTriangleAndHull(b3Manifold& manifold,
 		{
 			b3Vec3 n = plane1.normal;
 			
-			if (b3Dot(n, centroid1 - centroid2) < scalar(0))
+			if (b3Dot(n, centroid2 - centroid1) < scalar(0))
 			{
 				n = -n;
 			}
 
+			mp->localNormal1 = b3MulC(xf1.rotation, n);
+
+			if (s > s1->m_radius + s2->m_radius)
+			{
+				// Speculative point. 
+				// The closest points can be far from each other.
+				// c2 is constant
+				b3Vec3 nc1 = c2 - b3Dot(c2 - c1, n) * n;
+
+				mp->localPoint1 = b3MulT(xf1, nc1);
+				continue;
+			}
+
 			// c1 is constant
 			// c2 = c1 + s * n1
 			// c1 = c2 - s * n1
 			b3Vec3 nc2 = c1 + s * n;
 
-			mp->localNormal1 = b3MulC(xf1.rotation, n);
 			mp->localPoint2 = b3MulT(xf2, nc2);
 		}
 	}
@@ -23,7 +23,8 @@
 
 void b3CollideTriangleAndSphere(b3Manifold& manifold,
 	const b3Transform& xf1, const b3TriangleShape* s1,
-	const b3Transform& xf2, const b3SphereShape* s2)
+	const b3Transform& xf2, const b3SphereShape* s2,
+	scalar margin)
 {
 	// Put the sphere center in the frame of the triangle.
 	b3Vec3 Q = b3MulT(xf1, b3Mul(xf2, s2->m_center));
@@ -31,7 +32,7 @@ void b3CollideTriangleAndSphere(b3Manifold& manifold,
 	// ABC
 	b3Vec3 A = s1->m_vertex1, B = s1->m_vertex2, C = s1->m_vertex3;
 
-	scalar radius = s1->m_radius + s2->m_radius;
+	scalar radius = s1->m_radius + s2->m_radius + margin;
 
 	// Test vertex regions
 	scalar wAB[3], wBC[3], wCA[3];
@@ -17,127 +17,331 @@
 */
 
 #include <bounce/collision/geometry/mesh.h>
+#include <bounce/common/thread/task_executor.h>
+#include <algorithm>
+#include <string.h>
 
 b3Mesh::b3Mesh()
 {
 	triangleWings = nullptr;
+	blob = nullptr;
 }
 
 b3Mesh::~b3Mesh()
 {
-	b3Free(triangleWings);
+	if (blob == nullptr)
+	{
+		b3Free(triangleWings);
+	}
 }
 
 void b3Mesh::BuildTree()
+{
+	b3StaticTreeDef def;
+	BuildTree(def);
+}
+
+// Context of the parallel computation of the triangle AABBs.
+struct b3MeshAABBContext
+{
+	const b3Mesh* mesh;
+	b3AABB* aabbs;
+};
+
+static void b3ComputeAABBsTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	B3_NOT_USED(workerIndex);
+
+	b3MeshAABBContext* ctx = (b3MeshAABBContext*)context;
+	for (u32 i = begin; i < end; ++i)
+	{
+		ctx->aabbs[i] = ctx->mesh->GetTriangleAABB(i);
+	}
+}
+
+void b3Mesh::BuildTree(const b3StaticTreeDef& def, b3StaticTreeStats* stats)
 {
 	b3AABB* aabbs = (b3AABB*)b3Alloc(triangleCount * sizeof(b3AABB));
-	for (u32 i = 0; i < triangleCount; ++i)
+	
+	b3MeshAABBContext context;
+	context.mesh = this;
+	context.aabbs = aabbs;
+
+	if (def.executor)
+	{
+		def.executor->ParallelFor(triangleCount, b3_minTreeBinTaskRange, b3ComputeAABBsTask, &context);
+	}
+	else
 	{
-		aabbs[i] = GetTriangleAABB(i);
+		b3ComputeAABBsTask(0, triangleCount, 0, &context);
 	}
 
-	tree.Build(aabbs, triangleCount);
+	tree.Build(aabbs, triangleCount, def, stats);
 
 	b3Free(aabbs);
 }
 
-void b3Mesh::BuildAdjacency()
+// A triangle edge.
+struct b3MeshEdge
 {
-	B3_ASSERT(triangleWings == nullptr);
-	triangleWings = (b3MeshTriangleWings*)b3Alloc(triangleCount * sizeof(b3MeshTriangleWings));
+	// The edge vertices sorted by index.
+	u32 v1, v2;
+
+	// The edge index. This is 3 * triangle + edge.
+	u32 index;
+};
+
+static B3_FORCE_INLINE bool operator<(const b3MeshEdge& a, const b3MeshEdge& b)
+{
+	if (a.v1 != b.v1)
+	{
+		return a.v1 < b.v1;
+	}
 	
-	// Assume the edges are open edges.
-	for (u32 i = 0; i < triangleCount; ++i)
+	if (a.v2 != b.v2)
 	{
-		b3MeshTriangleWings* ws = triangleWings + i;
-		
-		ws->u1 = B3_NULL_VERTEX;
-		ws->u2 = B3_NULL_VERTEX;
-		ws->u3 = B3_NULL_VERTEX;
+		return a.v2 < b.v2;
 	}
 
-	// Connect the edges.
-	for (u32 i = 0; i < triangleCount; ++i)
-	{
-		b3MeshTriangle* t1 = triangles + i;
-		b3MeshTriangleWings* t1ws = triangleWings + i;
+	return a.index < b.index;
+}
 
-		for (u32 j1 = 0; j1 < 3; ++j1)
-		{
-			u32 k1 = j1 + 1 < 3 ? j1 + 1 : 0;
+static B3_FORCE_INLINE b3MeshEdge b3MakeEdge(const b3MeshTriangle* triangle, u32 triangleIndex, u32 edgeIndex)
+{
+	u32 v1 = triangle->GetVertex(edgeIndex);
+	u32 v2 = triangle->GetVertex(edgeIndex + 1 < 3 ? edgeIndex + 1 : 0);
+
+	b3MeshEdge edge;
+	edge.v1 = b3Min(v1, v2);
+	edge.v2 = b3Max(v1, v2);
+	edge.index = 3 * triangleIndex + edgeIndex;
+	return edge;
+}
 
-			u32 t1v1 = t1->GetVertex(j1);
-			u32 t1v2 = t1->GetVertex(k1);
+// Get the vertex of a triangle that is not in a given edge.
+static B3_FORCE_INLINE u32 b3GetWingVertex(const b3Mesh* mesh, u32 edgeIndex)
+{
+	u32 j = edgeIndex % 3;
+	u32 k = j + 2 < 3 ? j + 2 : j - 1;
+	return mesh->triangles[edgeIndex / 3].GetVertex(k);
+}
 
-			u32& u1 = t1ws->GetVertex(j1);
+// Sort a set of edges and connect the edges having the same vertices.
+// An edge is connected to the first edge of the next triangle that shares its vertices, 
+// in triangle order. This gives the same result as comparing each triangle against 
+// the following triangles. 
+static void b3ConnectEdges(b3Mesh* mesh, b3MeshEdge* edges, u32 count)
+{
+	std::sort(edges, edges + count);
 
+	u32 begin = 0;
+	while (begin < count)
+	{
+		// Find the edges having the same vertices.
+		u32 end = begin + 1;
+		while (end < count && edges[end].v1 == edges[begin].v1 && edges[end].v2 == edges[begin].v2)
+		{
+			++end;
+		}
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			u32 index1 = edges[i].index;
+			u32& u1 = mesh->triangleWings[index1 / 3].GetVertex(index1 % 3);
+			
 			if (u1 != B3_NULL_VERTEX)
 			{
 				// The edge is already connected.
 				continue;
 			}
 
-			for (u32 j = i + 1; j < triangleCount; ++j)
+			for (u32 j = i + 1; j < end; ++j)
 			{
-				b3MeshTriangle* t2 = triangles + j;
-				b3MeshTriangleWings* t2ws = triangleWings + j;
-
-				for (u32 j2 = 0; j2 < 3; ++j2)
+				u32 index2 = edges[j].index;
+				if (index2 / 3 == index1 / 3)
 				{
-					u32 k2 = j2 + 1 < 3 ? j2 + 1 : 0;
+					continue;
+				}
 
-					u32 t2v1 = t2->GetVertex(j2);
-					u32 t2v2 = t2->GetVertex(k2);
+				// The triangles are adjacent.
+				u32& u2 = mesh->triangleWings[index2 / 3].GetVertex(index2 % 3);
+				
+				u1 = b3GetWingVertex(mesh, index2);
+				u2 = b3GetWingVertex(mesh, index1);
+				
+				break;
+			}
+		}
 
-					u32& u2 = t2ws->GetVertex(j2);
+		begin = end;
+	}
+}
 
-					if (t1v1 == t2v2 && t1v2 == t2v1)
-					{
-						// Both triangles have the same order.
+// Get the bucket of an edge in the parallel adjacency build.
+static B3_FORCE_INLINE u32 b3GetEdgeBucket(const b3MeshEdge& edge)
+{
+	u32 hash = edge.v1 * 73856093 ^ edge.v2 * 19349663;
+	return hash % b3_meshAdjacencyBucketCount;
+}
 
-						// The triangles are adjacent.
-						
-						// Non-shared vertex on triangle 1. 
-						u32 k3 = k1 + 1 < 3 ? k1 + 1 : 0;
-						u2 = t1->GetVertex(k3);
+// Parallel adjacency build context. 
+// The edges are distributed to buckets by hash, so edges having the same vertices 
+// are in the same bucket and the buckets can be connected independently.
+struct b3MeshAdjacencyContext
+{
+	b3Mesh* mesh;
+	u32 chunkCount;
+	u32 chunkSize;
+	u32* offsets; // chunkCount * bucketCount
+	u32 bucketStarts[b3_meshAdjacencyBucketCount + 1];
+	b3MeshEdge* edges;
+};
 
-						// Non-shared vertex on triangle 2. 
-						u32 k4 = k2 + 1 < 3 ? k2 + 1 : 0;
-						u1 = t2->GetVertex(k4);
+static void b3CountEdgesTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	B3_NOT_USED(workerIndex);
 
-						break;
-					}
+	b3MeshAdjacencyContext* ctx = (b3MeshAdjacencyContext*)context;
+	const b3Mesh* mesh = ctx->mesh;
 
-					if (t1v1 == t2v1 && t1v2 == t2v2)
-					{
-						// The triangles have different order.
+	for (u32 chunk = begin; chunk < end; ++chunk)
+	{
+		u32* counts = ctx->offsets + chunk * b3_meshAdjacencyBucketCount;
+		for (u32 i = 0; i < b3_meshAdjacencyBucketCount; ++i)
+		{
+			counts[i] = 0;
+		}
 
-						// The triangles are adjacent.
+		u32 triangleBegin = chunk * ctx->chunkSize;
+		u32 triangleEnd = b3Min(triangleBegin + ctx->chunkSize, mesh->triangleCount);
+		for (u32 i = triangleBegin; i < triangleEnd; ++i)
+		{
+			for (u32 j = 0; j < 3; ++j)
+			{
+				++counts[b3GetEdgeBucket(b3MakeEdge(mesh->triangles + i, i, j))];
+			}
+		}
+	}
+}
 
-						// Non-shared vertex on triangle 1. 
-						u32 k3 = k1 + 1 < 3 ? k1 + 1 : 0;
-						u2 = t1->GetVertex(k3);
+static void b3ScatterEdgesTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	B3_NOT_USED(workerIndex);
 
-						// Non-shared vertex on triangle 2. 
-						u32 k4 = k2 + 1 < 3 ? k2 + 1 : 0;
-						u1 = t2->GetVertex(k4);
+	b3MeshAdjacencyContext* ctx = (b3MeshAdjacencyContext*)context;
+	const b3Mesh* mesh = ctx->mesh;
 
-						break;
-					}
-				}
+	for (u32 chunk = begin; chunk < end; ++chunk)
+	{
+		u32* offsets = ctx->offsets + chunk * b3_meshAdjacencyBucketCount;
 
-				if (u1 != B3_NULL_VERTEX)
-				{
-					// The edge has been connected.
-					break;
-				}
+		u32 triangleBegin = chunk * ctx->chunkSize;
+		u32 triangleEnd = b3Min(triangleBegin + ctx->chunkSize, mesh->triangleCount);
+		for (u32 i = triangleBegin; i < triangleEnd; ++i)
+		{
+			for (u32 j = 0; j < 3; ++j)
+			{
+				b3MeshEdge edge = b3MakeEdge(mesh->triangles + i, i, j);
+				ctx->edges[offsets[b3GetEdgeBucket(edge)]++] = edge;
+			}
+		}
+	}
+}
+
+static void b3ConnectBucketsTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	B3_NOT_USED(workerIndex);
+
+	b3MeshAdjacencyContext* ctx = (b3MeshAdjacencyContext*)context;
+
+	for (u32 bucket = begin; bucket < end; ++bucket)
+	{
+		u32 bucketBegin = ctx->bucketStarts[bucket];
+		u32 bucketEnd = ctx->bucketStarts[bucket + 1];
+
+		b3ConnectEdges(ctx->mesh, ctx->edges + bucketBegin, bucketEnd - bucketBegin);
+	}
+}
+
+void b3Mesh::BuildAdjacency(b3TaskExecutor* executor)
+{
+	B3_ASSERT(triangleWings == nullptr);
+	B3_ASSERT(blob == nullptr);
+	triangleWings = (b3MeshTriangleWings*)b3Alloc(triangleCount * sizeof(b3MeshTriangleWings));
+	
+	// Assume the edges are open edges.
+	for (u32 i = 0; i < triangleCount; ++i)
+	{
+		b3MeshTriangleWings* ws = triangleWings + i;
+		
+		ws->u1 = B3_NULL_VERTEX;
+		ws->u2 = B3_NULL_VERTEX;
+		ws->u3 = B3_NULL_VERTEX;
+	}
+
+	u32 edgeCount = 3 * triangleCount;
+	b3MeshEdge* edges = (b3MeshEdge*)b3Alloc(edgeCount * sizeof(b3MeshEdge));
+
+	if (executor == nullptr || triangleCount < b3_minParallelAdjacencyCount)
+	{
+		// Connect the edges.
+		for (u32 i = 0; i < triangleCount; ++i)
+		{
+			for (u32 j = 0; j < 3; ++j)
+			{
+				edges[3 * i + j] = b3MakeEdge(triangles + i, i, j);
 			}
 		}
+
+		b3ConnectEdges(this, edges, edgeCount);
+
+		b3Free(edges);
+		return;
+	}
+
+	b3MeshAdjacencyContext context;
+	context.mesh = this;
+	context.chunkCount = b3_meshAdjacencyChunksPerWorker * executor->GetWorkerCount();
+	context.chunkSize = (triangleCount + context.chunkCount - 1) / context.chunkCount;
+	context.chunkCount = (triangleCount + context.chunkSize - 1) / context.chunkSize;
+	context.offsets = (u32*)b3Alloc(context.chunkCount * b3_meshAdjacencyBucketCount * sizeof(u32));
+	context.edges = edges;
+
+	// Count the edges of each chunk in each bucket.
+	executor->ParallelFor(context.chunkCount, 1, b3CountEdgesTask, &context);
+
+	// Compute where each chunk writes its edges in each bucket. 
+	// The edges of a bucket are stored in chunk order.
+	u32 offset = 0;
+	for (u32 bucket = 0; bucket < b3_meshAdjacencyBucketCount; ++bucket)
+	{
+		context.bucketStarts[bucket] = offset;
+		for (u32 chunk = 0; chunk < context.chunkCount; ++chunk)
+		{
+			u32* count = context.offsets + chunk * b3_meshAdjacencyBucketCount + bucket;
+			u32 chunkCount = *count;
+			*count = offset;
+			offset += chunkCount;
+		}
 	}
+	context.bucketStarts[b3_meshAdjacencyBucketCount] = offset;
+	B3_ASSERT(offset == edgeCount);
+
+	// Distribute the edges to the buckets.
+	executor->ParallelFor(context.chunkCount, 1, b3ScatterEdgesTask, &context);
+	
+	// Connect the edges in each bucket.
+	// A wing vertex is only written by the bucket containing its edge.
+	executor->ParallelFor(b3_meshAdjacencyBucketCount, 1, b3ConnectBucketsTask, &context);
+
+	b3Free(context.offsets);
+	b3Free(edges);
 }
 
 void b3Mesh::Scale(const b3Vec3& scale)
 {
+	B3_ASSERT(blob == nullptr);
+
 	for (u32 i = 0; i < vertexCount; ++i)
 	{
 		vertices[i] = b3Mul(scale, vertices[i]);
@@ -146,6 +350,8 @@ void b3Mesh::Scale(const b3Vec3& scale)
 
 void b3Mesh::Rotate(const b3Quat& rotation)
 {
+	B3_ASSERT(blob == nullptr);
+
 	for (u32 i = 0; i < vertexCount; ++i)
 	{
 		vertices[i] = b3Mul(rotation, vertices[i]);
@@ -154,6 +360,8 @@ void b3Mesh::Rotate(const b3Quat& rotation)
 
 void b3Mesh::Translate(const b3Vec3& translation)
 {
+	B3_ASSERT(blob == nullptr);
+
 	for (u32 i = 0; i < vertexCount; ++i)
 	{
 		vertices[i] += translation;
@@ -162,8 +370,190 @@ void b3Mesh::Translate(const b3Vec3& translation)
 
 void b3Mesh::Transform(const b3Transform& xf, const b3Vec3& scale)
 {
+	B3_ASSERT(blob == nullptr);
+
 	for (u32 i = 0; i < vertexCount; ++i)
 	{
 		vertices[i] = b3Mul(xf, b3Mul(scale, vertices[i]));
 	}
-}
\ No newline at end of file
+}
+
+// Identifies a mesh blob. 
+const u32 b3_meshBlobMagic = 0x424D3342; // "B3MB"
+
+// The header of a mesh blob. 
+// The vertices, triangles, wings and tree follow in aligned sections.
+struct b3MeshBlob
+{
+	u32 magic;
+	u32 endianTag;
+	u32 version;
+	u32 scalarSize;
+	u32 size;
+	u32 vertexCount;
+	u32 verticesOffset;
+	u32 triangleCount;
+	u32 trianglesOffset;
+	u32 wingsOffset; // zero if there is no adjacency
+	u32 treeOffset;
+	u32 treeSize;
+};
+
+u32 b3Mesh::GetBlobSize() const
+{
+	u32 size = b3AlignBlob(sizeof(b3MeshBlob));
+	size += b3AlignBlob(vertexCount * sizeof(b3Vec3));
+	size += b3AlignBlob(triangleCount * sizeof(b3MeshTriangle));
+	if (triangleWings)
+	{
+		size += b3AlignBlob(triangleCount * sizeof(b3MeshTriangleWings));
+	}
+	size += tree.GetBlobSize();
+	return size;
+}
+
+void b3Mesh::WriteBlob(void* data) const
+{
+	B3_ASSERT(b3IsBlobAligned(data));
+
+	u8* bytes = (u8*)data;
+
+	// Clear the padding so that equal meshes give equal blobs.
+	memset(bytes, 0, b3AlignBlob(sizeof(b3MeshBlob)));
+
+	b3MeshBlob header;
+	header.magic = b3_meshBlobMagic;
+	header.endianTag = b3_blobEndianTag;
+	header.version = b3_meshBlobVersion;
+	header.scalarSize = sizeof(scalar);
+	header.size = GetBlobSize();
+	header.vertexCount = vertexCount;
+	header.verticesOffset = b3AlignBlob(sizeof(b3MeshBlob));
+	header.triangleCount = triangleCount;
+	header.trianglesOffset = header.verticesOffset + b3AlignBlob(vertexCount * sizeof(b3Vec3));
+	
+	u32 offset = header.trianglesOffset + b3AlignBlob(triangleCount * sizeof(b3MeshTriangle));
+	if (triangleWings)
+	{
+		header.wingsOffset = offset;
+		offset += b3AlignBlob(triangleCount * sizeof(b3MeshTriangleWings));
+	}
+	else
+	{
+		header.wingsOffset = 0;
+	}
+	
+	header.treeOffset = offset;
+	header.treeSize = tree.GetBlobSize();
+
+	memcpy(bytes, &header, sizeof(b3MeshBlob));
+
+	u32 verticesSize = vertexCount * sizeof(b3Vec3);
+	memset(bytes + header.verticesOffset, 0, b3AlignBlob(verticesSize));
+	memcpy(bytes + header.verticesOffset, vertices, verticesSize);
+	
+	u32 trianglesSize = triangleCount * sizeof(b3MeshTriangle);
+	memset(bytes + header.trianglesOffset, 0, b3AlignBlob(trianglesSize));
+	memcpy(bytes + header.trianglesOffset, triangles, trianglesSize);
+
+	if (triangleWings)
+	{
+		u32 wingsSize = triangleCount * sizeof(b3MeshTriangleWings);
+		memset(bytes + header.wingsOffset, 0, b3AlignBlob(wingsSize));
+		memcpy(bytes + header.wingsOffset, triangleWings, wingsSize);
+	}
+
+	tree.WriteBlob(bytes + header.treeOffset);
+}
+
+bool b3Mesh::ReadBlob(const void* data, u32 size)
+{
+	B3_ASSERT(triangleWings == nullptr);
+	B3_ASSERT(blob == nullptr);
+
+	if (b3IsBlobAligned(data) == false || size < sizeof(b3MeshBlob))
+	{
+		return false;
+	}
+
+	const u8* bytes = (const u8*)data;
+	const b3MeshBlob* header = (const b3MeshBlob*)bytes;
+
+	if (header->magic != b3_meshBlobMagic || 
+		header->endianTag != b3_blobEndianTag || 
+		header->version != b3_meshBlobVersion || 
+		header->scalarSize != sizeof(scalar) || 
+		header->size > size)
+	{
+		return false;
+	}
+
+	u64 verticesSize = u64(header->vertexCount) * sizeof(b3Vec3);
+	u64 trianglesSize = u64(header->triangleCount) * sizeof(b3MeshTriangle);
+	u64 wingsSize = u64(header->triangleCount) * sizeof(b3MeshTriangleWings);
+
+	if (b3IsBlobSection(header->verticesOffset, verticesSize, size) == false ||
+		b3IsBlobSection(header->trianglesOffset, trianglesSize, size) == false ||
+		b3IsBlobSection(header->treeOffset, header->treeSize, size) == false)
+	{
+		return false;
+	}
+
+	if (header->wingsOffset != 0 && b3IsBlobSection(header->wingsOffset, wingsSize, size) == false)
+	{
+		return false;
+	}
+
+	// The triangles must reference the vertices.
+	const b3MeshTriangle* blobTriangles = (const b3MeshTriangle*)(bytes + header->trianglesOffset);
+	for (u32 i = 0; i < header->triangleCount; ++i)
+	{
+		const b3MeshTriangle* triangle = blobTriangles + i;
+		if (triangle->v1 >= header->vertexCount || 
+			triangle->v2 >= header->vertexCount || 
+			triangle->v3 >= header->vertexCount)
+		{
+			return false;
+		}
+	}
+
+	// The wing vertices of the edges that aren't boundaries must reference the vertices.
+	if (header->wingsOffset != 0)
+	{
+		const b3MeshTriangleWings* blobWings = (const b3MeshTriangleWings*)(bytes + header->wingsOffset);
+		for (u32 i = 0; i < header->triangleCount; ++i)
+		{
+			const b3MeshTriangleWings* wings = blobWings + i;
+			for (u32 j = 0; j < 3; ++j)
+			{
+				u32 u = wings->GetVertex(j);
+				if (u != B3_NULL_VERTEX && u >= header->vertexCount)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	if (tree.ReadBlob(bytes + header->treeOffset, header->treeSize) == false)
+	{
+		return false;
+	}
+
+	// The tree proxies are the triangles.
+	if (tree.GetProxyCount() != header->triangleCount)
+	{
+		tree.Clear();
+		return false;
+	}
+
+	// The blob is never written through these pointers.
+	vertexCount = header->vertexCount;
+	vertices = (b3Vec3*)(bytes + header->verticesOffset);
+	triangleCount = header->triangleCount;
+	triangles = (b3MeshTriangle*)(bytes + header->trianglesOffset);
+	triangleWings = header->wingsOffset != 0 ? (b3MeshTriangleWings*)(bytes + header->wingsOffset) : nullptr;
+	blob = data;
+
+	return true;
+}
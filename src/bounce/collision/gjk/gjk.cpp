@@ -18,13 +18,13 @@
 
 #include <bounce/collision/gjk/gjk.h>
 #include <bounce/collision/gjk/gjk_proxy.h>
+#include <bounce/common/stats.h>
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 // Implementation of the GJK (Gilbert-Johnson-Keerthi) algorithm 
 // using Voronoi regions and Barycentric coordinates.
 
-u32 b3_gjkCalls = 0, b3_gjkIters = 0, b3_gjkMaxIters = 0;
 
 // Convert a point Q from Cartesian coordinates to Barycentric coordinates (u, v) 
 // with respect to a segment AB.
@@ -580,8 +580,6 @@ b3GJKOutput b3GJK(const b3Transform& xf1, const b3GJKProxy& proxy1,
 	const b3Transform& xf2, const b3GJKProxy& proxy2,
 	bool applyRadius, b3SimplexCache* cache)
 {
-	++b3_gjkCalls;
-
 	// Initialize the simplex.
 	b3Simplex simplex;
 	simplex.ReadCache(cache, xf1, proxy1, xf2, proxy2);
@@ -670,7 +668,6 @@ b3GJKOutput b3GJK(const b3Transform& xf1, const b3GJKProxy& proxy1,
 
 		// Iteration count is equated to the number of support point calls.
 		++iter;
-		++b3_gjkIters;
 
 		// Check for duplicate support points. 
 		// This is the main termination criteria.
@@ -694,7 +691,12 @@ b3GJKOutput b3GJK(const b3Transform& xf1, const b3GJKProxy& proxy1,
 		++simplex.m_count;
 	}
 
-	b3_gjkMaxIters = b3Max(b3_gjkMaxIters, iter);
+	if (b3_stepStats)
+	{
+		++b3_stepStats->gjkCalls;
+		b3_stepStats->gjkIters += iter;
+		b3_stepStats->gjkMaxIters = b3Max(b3_stepStats->gjkMaxIters, iter);
+	}
 
 	// Prepare result.
 	b3GJKOutput output;
@@ -737,7 +739,6 @@ b3GJKOutput b3GJK(const b3Transform& xf1, const b3GJKProxy& proxy1,
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-u32 b3_gjkCacheHits = 0;
 
 // Implements b3Simplex routines for a cached simplex.
 void b3Simplex::ReadCache(const b3SimplexCache* cache,
@@ -771,9 +772,9 @@ void b3Simplex::ReadCache(const b3SimplexCache* cache,
 			// Flush
 			m_count = 0;
 		}
-		else
+		else if (b3_stepStats)
 		{
-			++b3_gjkCacheHits;
+			++b3_stepStats->gjkCacheHits;
 		}
 	}
 
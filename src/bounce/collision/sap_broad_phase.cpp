@@ -0,0 +1,768 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/collision/sap_broad_phase.h>
+#include <bounce/common/draw.h>
+#include <algorithm>
+#include <string.h>
+
+b3SAPBroadPhase::b3SAPBroadPhase() : b3BroadPhase(e_sweepAndPruneBroadPhase)
+{
+	m_proxyCapacity = 16;
+	m_proxies = (b3Proxy*)b3Alloc(m_proxyCapacity * sizeof(b3Proxy));
+	for (u32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		m_proxies[i].min[0] = B3_NULL_PROXY;
+		m_proxies[i].isTouched = false;
+		m_proxies[i].next = i + 1 < m_proxyCapacity ? i + 1 : B3_NULL_PROXY;
+	}
+	m_freeList = 0;
+	m_removedList = B3_NULL_PROXY;
+	m_removedCount = 0;
+
+	m_endpointCapacity = 2 * m_proxyCapacity;
+	for (u32 i = 0; i < 3; ++i)
+	{
+		m_endpoints[i] = (b3Endpoint*)b3Alloc(m_endpointCapacity * sizeof(b3Endpoint));
+	}
+	m_endpointCount = 0;
+	m_sortedCount = 0;
+
+	m_touchCapacity = 16;
+	m_touchBuffer = (u32*)b3Alloc(m_touchCapacity * sizeof(u32));
+	m_touchCount = 0;
+
+	m_pairCapacity = 16;
+	m_pairs = (b3Pair*)b3Alloc(m_pairCapacity * sizeof(b3Pair));
+	m_pairCount = 0;
+}
+
+b3SAPBroadPhase::~b3SAPBroadPhase()
+{
+	b3Free(m_pairs);
+	b3Free(m_touchBuffer);
+	for (u32 i = 0; i < 3; ++i)
+	{
+		b3Free(m_endpoints[i]);
+	}
+	b3Free(m_proxies);
+}
+
+u32 b3SAPBroadPhase::InsertProxy(const b3AABB& aabb, void* userData, bool isStatic)
+{
+	if (m_freeList == B3_NULL_PROXY)
+	{
+		// Reuse the removed proxies before growing.
+		FreeRemovedProxies();
+	}
+
+	if (m_freeList == B3_NULL_PROXY)
+	{
+		// Duplicate capacity.
+		u32 oldCapacity = m_proxyCapacity;
+		m_proxyCapacity *= 2;
+
+		b3Proxy* oldProxies = m_proxies;
+		m_proxies = (b3Proxy*)b3Alloc(m_proxyCapacity * sizeof(b3Proxy));
+		memcpy(m_proxies, oldProxies, oldCapacity * sizeof(b3Proxy));
+		b3Free(oldProxies);
+
+		// Link the new proxies.
+		for (u32 i = oldCapacity; i < m_proxyCapacity; ++i)
+		{
+			m_proxies[i].min[0] = B3_NULL_PROXY;
+			m_proxies[i].isTouched = false;
+			m_proxies[i].next = i + 1 < m_proxyCapacity ? i + 1 : B3_NULL_PROXY;
+		}
+		m_freeList = oldCapacity;
+	}
+
+	if (m_endpointCount + 2 > m_endpointCapacity)
+	{
+		// Duplicate capacity.
+		m_endpointCapacity *= 2;
+
+		for (u32 i = 0; i < 3; ++i)
+		{
+			b3Endpoint* oldEndpoints = m_endpoints[i];
+			m_endpoints[i] = (b3Endpoint*)b3Alloc(m_endpointCapacity * sizeof(b3Endpoint));
+			memcpy(m_endpoints[i], oldEndpoints, m_endpointCount * sizeof(b3Endpoint));
+			b3Free(oldEndpoints);
+		}
+	}
+
+	u32 proxyId = m_freeList;
+	b3Proxy* proxy = m_proxies + proxyId;
+	m_freeList = proxy->next;
+
+	proxy->aabb = aabb;
+	proxy->userData = userData;
+	proxy->isStatic = isStatic;
+	proxy->isRemoved = false;
+	proxy->next = B3_NULL_PROXY;
+
+	// Append the bounds. 
+	// They are sorted and merged with the sorted bounds in the next call to FindPairs.
+	for (u32 i = 0; i < 3; ++i)
+	{
+		b3Endpoint* endpoints = m_endpoints[i];
+
+		u32 index = m_endpointCount;
+
+		endpoints[index].value = aabb.lowerBound[i];
+		endpoints[index].data = proxyId << 1;
+		proxy->min[i] = index;
+
+		endpoints[index + 1].value = aabb.upperBound[i];
+		endpoints[index + 1].data = (proxyId << 1) | 1;
+		proxy->max[i] = index + 1;
+	}
+
+	m_endpointCount += 2;
+
+	// Find the overlapping proxies in the next call to FindPairs.
+	BufferTouch(proxyId);
+
+	return proxyId;
+}
+
+void b3SAPBroadPhase::RemoveProxy(u32 proxyId)
+{
+	B3_ASSERT(proxyId < m_proxyCapacity);
+	b3Proxy* proxy = m_proxies + proxyId;
+	B3_ASSERT(proxy->min[0] != B3_NULL_PROXY);
+	B3_ASSERT(proxy->isRemoved == false);
+
+	// Shifting the bounds is linear in the number of proxies. 
+	// Defer it so that the bounds of many removed proxies are removed in a single pass. 
+	// The buffered pairs and touches of the proxy are skipped by FindPairs.
+	proxy->isRemoved = true;
+	proxy->userData = nullptr;
+	proxy->next = m_removedList;
+	m_removedList = proxyId;
+	++m_removedCount;
+}
+
+void b3SAPBroadPhase::FreeRemovedProxies()
+{
+	if (m_removedCount == 0)
+	{
+		return;
+	}
+
+	// Remove the bounds and shift the remaining bounds.
+	// The bounds of the new proxies stay after the sorted bounds.
+	u32 sortedCount = m_sortedCount;
+	for (u32 i = 0; i < 3; ++i)
+	{
+		b3Endpoint* endpoints = m_endpoints[i];
+
+		u32 index = 0;
+		for (u32 j = 0; j < m_endpointCount; ++j)
+		{
+			if (j == m_sortedCount)
+			{
+				sortedCount = index;
+			}
+
+			b3Endpoint endpoint = endpoints[j];
+			
+			b3Proxy* proxy = m_proxies + endpoint.GetProxy();
+			if (proxy->isRemoved)
+			{
+				continue;
+			}
+
+			endpoints[index] = endpoint;
+			if (endpoint.IsMax())
+			{
+				proxy->max[i] = index;
+			}
+			else
+			{
+				proxy->min[i] = index;
+			}
+
+			++index;
+		}
+	}
+
+	if (m_sortedCount == m_endpointCount)
+	{
+		sortedCount -= 2 * m_removedCount;
+	}
+
+	m_endpointCount -= 2 * m_removedCount;
+	m_sortedCount = sortedCount;
+
+	// Free the proxies.
+	u32 proxyId = m_removedList;
+	while (proxyId != B3_NULL_PROXY)
+	{
+		b3Proxy* proxy = m_proxies + proxyId;
+		u32 next = proxy->next;
+
+		proxy->min[0] = B3_NULL_PROXY;
+		proxy->isRemoved = false;
+		proxy->next = m_freeList;
+		m_freeList = proxyId;
+
+		proxyId = next;
+	}
+
+	m_removedList = B3_NULL_PROXY;
+	m_removedCount = 0;
+}
+
+void b3SAPBroadPhase::UpdateProxy(u32 proxyId, const b3AABB& aabb)
+{
+	B3_ASSERT(proxyId < m_proxyCapacity);
+	b3Proxy* proxy = m_proxies + proxyId;
+	
+	b3AABB oldAABB = proxy->aabb;
+	proxy->aabb = aabb;
+
+	if (proxy->min[0] >= m_sortedCount)
+	{
+		// The bounds of a new proxy are sorted in the next call to FindPairs.
+		for (u32 i = 0; i < 3; ++i)
+		{
+			m_endpoints[i][proxy->min[i]].value = aabb.lowerBound[i];
+			m_endpoints[i][proxy->max[i]].value = aabb.upperBound[i];
+		}
+		return;
+	}
+
+	for (u32 i = 0; i < 3; ++i)
+	{
+		b3Endpoint* endpoints = m_endpoints[i];
+		
+		endpoints[proxy->min[i]].value = aabb.lowerBound[i];
+		endpoints[proxy->max[i]].value = aabb.upperBound[i];
+
+		// Sort the bounds in an order that doesn't let a bound 
+		// pass the other bound of the same proxy.
+		if (aabb.upperBound[i] > oldAABB.upperBound[i])
+		{
+			SortEndpoint(i, proxy->max[i]);
+			SortEndpoint(i, proxy->min[i]);
+		}
+		else
+		{
+			SortEndpoint(i, proxy->min[i]);
+			SortEndpoint(i, proxy->max[i]);
+		}
+	}
+}
+
+void b3SAPBroadPhase::TouchProxy(u32 proxyId)
+{
+	BufferTouch(proxyId);
+}
+
+bool b3SAPBroadPhase::TestOrder(const b3Proxy* proxy1, const b3Proxy* proxy2) const
+{
+	for (u32 i = 0; i < 3; ++i)
+	{
+		if (proxy1->min[i] > proxy2->max[i] || proxy2->min[i] > proxy1->max[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void b3SAPBroadPhase::SortEndpoint(u32 axis, u32 index)
+{
+	b3Endpoint* endpoints = m_endpoints[axis];
+	
+	b3Endpoint endpoint = endpoints[index];
+	u32 proxyId = endpoint.GetProxy();
+	b3Proxy* proxy = m_proxies + proxyId;
+	
+	// The index of the sorted bound.
+	u32* proxyIndex = endpoint.IsMax() ? proxy->max + axis : proxy->min + axis;
+
+	// Move down.
+	while (index > 0 && endpoint < endpoints[index - 1])
+	{
+		b3Endpoint other = endpoints[index - 1];
+		u32 otherId = other.GetProxy();
+		B3_ASSERT(otherId != proxyId);
+		b3Proxy* otherProxy = m_proxies + otherId;
+		
+		endpoints[index] = other;
+		if (other.IsMax())
+		{
+			otherProxy->max[axis] = index;
+		}
+		else
+		{
+			otherProxy->min[axis] = index;
+		}
+
+		--index;
+		*proxyIndex = index;
+
+		// A lower bound passing an upper bound can start an overlap.
+		// The pair is buffered when the bounds overlap on all the axes.
+		if (endpoint.IsMax() == false && other.IsMax() && otherProxy->isRemoved == false)
+		{
+			if (TestOrder(proxy, otherProxy))
+			{
+				BufferPair(proxyId, otherId);
+			}
+		}
+	}
+
+	// Move up.
+	while (index + 1 < m_sortedCount && endpoints[index + 1] < endpoint)
+	{
+		b3Endpoint other = endpoints[index + 1];
+		u32 otherId = other.GetProxy();
+		B3_ASSERT(otherId != proxyId);
+		b3Proxy* otherProxy = m_proxies + otherId;
+		
+		endpoints[index] = other;
+		if (other.IsMax())
+		{
+			otherProxy->max[axis] = index;
+		}
+		else
+		{
+			otherProxy->min[axis] = index;
+		}
+
+		++index;
+		*proxyIndex = index;
+
+		// An upper bound passing a lower bound can start an overlap.
+		if (endpoint.IsMax() && other.IsMax() == false && otherProxy->isRemoved == false)
+		{
+			if (TestOrder(proxy, otherProxy))
+			{
+				BufferPair(proxyId, otherId);
+			}
+		}
+	}
+
+	endpoints[index] = endpoint;
+	*proxyIndex = index;
+}
+
+void b3SAPBroadPhase::BufferPair(u32 proxy1, u32 proxy2)
+{
+	if (m_proxies[proxy1].isStatic && m_proxies[proxy2].isStatic)
+	{
+		// Static proxies don't collide.
+		return;
+	}
+
+	if (m_proxies[proxy1].isTouched || m_proxies[proxy2].isTouched)
+	{
+		// The pair is found by the sweep.
+		return;
+	}
+
+	// Check capacity.
+	if (m_pairCount == m_pairCapacity) 
+	{
+		// Duplicate capacity.
+		m_pairCapacity *= 2;
+		
+		b3Pair* oldPairs = m_pairs;
+		m_pairs = (b3Pair*)b3Alloc(m_pairCapacity * sizeof(b3Pair));
+		memcpy(m_pairs, oldPairs, m_pairCount * sizeof(b3Pair));
+		b3Free(oldPairs);
+	}
+
+	m_pairs[m_pairCount].proxy1 = b3Min(proxy1, proxy2);
+	m_pairs[m_pairCount].proxy2 = b3Max(proxy1, proxy2);
+	++m_pairCount;
+}
+
+void b3SAPBroadPhase::BufferTouch(u32 proxyId)
+{
+	b3Proxy* proxy = m_proxies + proxyId;
+	if (proxy->isTouched)
+	{
+		return;
+	}
+	proxy->isTouched = true;
+
+	// Check capacity.
+	if (m_touchCount == m_touchCapacity) 
+	{
+		// Duplicate capacity.
+		m_touchCapacity *= 2;
+
+		u32* oldTouchBuffer = m_touchBuffer;
+		m_touchBuffer = (u32*)b3Alloc(m_touchCapacity * sizeof(u32));
+		memcpy(m_touchBuffer, oldTouchBuffer, m_touchCount * sizeof(u32));
+		b3Free(oldTouchBuffer);
+	}
+
+	m_touchBuffer[m_touchCount] = proxyId;
+	++m_touchCount;
+}
+
+void b3SAPBroadPhase::MergeNewEndpoints()
+{
+	if (m_sortedCount == m_endpointCount)
+	{
+		return;
+	}
+
+	u32 newCount = m_endpointCount - m_sortedCount;
+	b3Endpoint* newEndpoints = (b3Endpoint*)b3Alloc(newCount * sizeof(b3Endpoint));
+
+	for (u32 i = 0; i < 3; ++i)
+	{
+		b3Endpoint* endpoints = m_endpoints[i];
+
+		// Sort the new bounds.
+		memcpy(newEndpoints, endpoints + m_sortedCount, newCount * sizeof(b3Endpoint));
+		std::sort(newEndpoints, newEndpoints + newCount);
+
+		// Merge from the back. 
+		// The sorted bounds below the lowest new bound don't move.
+		u32 sortedIndex = m_sortedCount;
+		u32 newIndex = newCount;
+		u32 index = m_endpointCount;
+		while (newIndex > 0)
+		{
+			const b3Endpoint& newEndpoint = newEndpoints[newIndex - 1];
+			
+			--index;
+			if (sortedIndex > 0 && newEndpoint < endpoints[sortedIndex - 1])
+			{
+				endpoints[index] = endpoints[--sortedIndex];
+			}
+			else
+			{
+				endpoints[index] = newEndpoint;
+				--newIndex;
+			}
+		}
+
+		// Fix the indices of the moved bounds.
+		for (u32 j = index; j < m_endpointCount; ++j)
+		{
+			b3Endpoint endpoint = endpoints[j];
+			b3Proxy* proxy = m_proxies + endpoint.GetProxy();
+			if (endpoint.IsMax())
+			{
+				proxy->max[i] = j;
+			}
+			else
+			{
+				proxy->min[i] = j;
+			}
+		}
+	}
+
+	b3Free(newEndpoints);
+
+	m_sortedCount = m_endpointCount;
+}
+
+void b3SAPBroadPhase::FindTouchedPairs(b3AddPairFcn* fcn, void* context)
+{
+	// The sweep can stop at the last upper bound of the touched proxies.
+	u32 lastIndex = 0;
+	u32 touchCount = 0;
+	for (u32 i = 0; i < m_touchCount; ++i)
+	{
+		const b3Proxy* proxy = m_proxies + m_touchBuffer[i];
+		if (proxy->min[0] == B3_NULL_PROXY || proxy->isTouched == false)
+		{
+			// Proxy was removed
+			continue;
+		}
+
+		lastIndex = b3Max(lastIndex, proxy->max[0]);
+		++touchCount;
+	}
+
+	if (touchCount == 0)
+	{
+		return;
+	}
+
+	// The proxies whose bounds on the first axis contain the sweep position.
+	// A touched proxy tests all the active proxies. 
+	// Any other proxy tests only the active touched proxies.
+	u32* active = (u32*)b3Alloc(2 * m_proxyCapacity * sizeof(u32));
+	u32* activeTouched = active + m_proxyCapacity;
+	u32 activeCount = 0;
+	u32 activeTouchedCount = 0;
+
+	// The index of each active proxy in the active lists.
+	u32* activeIndices = (u32*)b3Alloc(2 * m_proxyCapacity * sizeof(u32));
+	u32* activeTouchedIndices = activeIndices + m_proxyCapacity;
+
+	const b3Endpoint* endpoints = m_endpoints[0];
+	for (u32 i = 0; i <= lastIndex; ++i)
+	{
+		b3Endpoint endpoint = endpoints[i];
+		u32 proxyId = endpoint.GetProxy();
+		const b3Proxy* proxy = m_proxies + proxyId;
+
+		if (endpoint.IsMax())
+		{
+			// Remove the proxy from the active lists.
+			u32 index = activeIndices[proxyId];
+			u32 lastId = active[--activeCount];
+			active[index] = lastId;
+			activeIndices[lastId] = index;
+
+			if (proxy->isTouched)
+			{
+				index = activeTouchedIndices[proxyId];
+				lastId = activeTouched[--activeTouchedCount];
+				activeTouched[index] = lastId;
+				activeTouchedIndices[lastId] = index;
+			}
+
+			continue;
+		}
+
+		const u32* others = proxy->isTouched ? active : activeTouched;
+		u32 otherCount = proxy->isTouched ? activeCount : activeTouchedCount;
+		for (u32 j = 0; j < otherCount; ++j)
+		{
+			u32 otherId = others[j];
+			const b3Proxy* otherProxy = m_proxies + otherId;
+
+			if (proxy->isStatic && otherProxy->isStatic)
+			{
+				// Static proxies don't collide.
+				continue;
+			}
+
+			if (b3TestOverlap(proxy->aabb, otherProxy->aabb))
+			{
+				u32 proxy1 = b3Min(proxyId, otherId);
+				u32 proxy2 = b3Max(proxyId, otherId);
+
+				fcn(context, m_proxies[proxy1].userData, m_proxies[proxy2].userData);
+			}
+		}
+
+		// Add the proxy to the active lists.
+		activeIndices[proxyId] = activeCount;
+		active[activeCount++] = proxyId;
+
+		if (proxy->isTouched)
+		{
+			activeTouchedIndices[proxyId] = activeTouchedCount;
+			activeTouched[activeTouchedCount++] = proxyId;
+		}
+	}
+
+	b3Free(activeIndices);
+	b3Free(active);
+}
+
+void b3SAPBroadPhase::FindPairs(b3AddPairFcn* fcn, void* context)
+{
+	FreeRemovedProxies();
+
+	MergeNewEndpoints();
+
+	// Report the buffered pairs that are still overlapping.
+	// Each pair was buffered when its bounds began overlapping on all the axes.
+	for (u32 i = 0; i < m_pairCount; ++i)
+	{
+		const b3Pair* pair = m_pairs + i;
+
+		const b3Proxy* proxy1 = m_proxies + pair->proxy1;
+		const b3Proxy* proxy2 = m_proxies + pair->proxy2;
+
+		if (proxy1->min[0] == B3_NULL_PROXY || proxy2->min[0] == B3_NULL_PROXY)
+		{
+			// Proxy was removed
+			continue;
+		}
+
+		if (proxy1->isTouched || proxy2->isTouched)
+		{
+			// The pair is found by the sweep.
+			continue;
+		}
+
+		if (b3TestOverlap(proxy1->aabb, proxy2->aabb))
+		{
+			fcn(context, proxy1->userData, proxy2->userData);
+		}
+	}
+
+	m_pairCount = 0;
+
+	// Find all the proxies overlapping the touched proxies.
+	FindTouchedPairs(fcn, context);
+
+	for (u32 i = 0; i < m_touchCount; ++i)
+	{
+		m_proxies[m_touchBuffer[i]].isTouched = false;
+	}
+
+	m_touchCount = 0;
+}
+
+void b3SAPBroadPhase::QueryAABB(b3QueryProxyFcn* fcn, void* context, const b3AABB& aabb) const
+{
+	// Scan the sorted bounds until the upper bound of the AABB, then the bounds of the new proxies.
+	const b3Endpoint* endpoints = m_endpoints[0];
+	for (u32 i = 0; i < m_endpointCount; ++i)
+	{
+		b3Endpoint endpoint = endpoints[i];
+		if (i < m_sortedCount && endpoint.value > aabb.upperBound.x)
+		{
+			i = m_sortedCount - 1;
+			continue;
+		}
+
+		if (endpoint.IsMax())
+		{
+			continue;
+		}
+
+		u32 proxyId = endpoint.GetProxy();
+		if (m_proxies[proxyId].isRemoved)
+		{
+			continue;
+		}
+
+		if (b3TestOverlap(m_proxies[proxyId].aabb, aabb))
+		{
+			if (fcn(context, proxyId) == false)
+			{
+				return;
+			}
+		}
+	}
+}
+
+// Test if a segment overlaps an AABB.
+static bool b3TestSegment(const b3AABB& aabb, const b3Vec3& p1, const b3Vec3& p2)
+{
+	b3Vec3 d = p2 - p1;
+
+	scalar lower = scalar(0);
+	scalar upper = scalar(1);
+
+	for (u32 i = 0; i < 3; ++i)
+	{
+		if (d[i] == scalar(0))
+		{
+			// The segment is parallel to the slab.
+			if (p1[i] < aabb.lowerBound[i] || p1[i] > aabb.upperBound[i])
+			{
+				return false;
+			}
+		}
+		else
+		{
+			scalar inv = scalar(1) / d[i];
+			scalar t1 = inv * (aabb.lowerBound[i] - p1[i]);
+			scalar t2 = inv * (aabb.upperBound[i] - p1[i]);
+			
+			lower = b3Max(lower, b3Min(t1, t2));
+			upper = b3Min(upper, b3Max(t1, t2));
+			
+			if (lower > upper)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void b3SAPBroadPhase::RayCast(b3RayCastProxyFcn* fcn, void* context, const b3RayCastInput& input) const
+{
+	b3Vec3 p1 = input.p1;
+	b3Vec3 p2 = input.p2;
+	scalar maxFraction = input.maxFraction;
+
+	b3Vec3 q2 = p1 + maxFraction * (p2 - p1);
+
+	// Scan the sorted bounds until the end of the segment, then the bounds of the new proxies.
+	const b3Endpoint* endpoints = m_endpoints[0];
+	for (u32 i = 0; i < m_endpointCount; ++i)
+	{
+		b3Endpoint endpoint = endpoints[i];
+		if (i < m_sortedCount && endpoint.value > b3Max(p1.x, q2.x))
+		{
+			i = m_sortedCount - 1;
+			continue;
+		}
+
+		if (endpoint.IsMax())
+		{
+			continue;
+		}
+
+		u32 proxyId = endpoint.GetProxy();
+		if (m_proxies[proxyId].isRemoved)
+		{
+			continue;
+		}
+
+		if (b3TestSegment(m_proxies[proxyId].aabb, p1, q2) == false)
+		{
+			continue;
+		}
+
+		b3RayCastInput subInput;
+		subInput.p1 = p1;
+		subInput.p2 = p2;
+		subInput.maxFraction = maxFraction;
+
+		scalar newMaxFraction = fcn(context, subInput, proxyId);
+
+		if (newMaxFraction == scalar(0))
+		{
+			// The client has stopped the query.
+			return;
+		}
+
+		if (newMaxFraction > scalar(0))
+		{
+			// Clip the segment.
+			maxFraction = newMaxFraction;
+			q2 = p1 + maxFraction * (p2 - p1);
+		}
+	}
+}
+
+void b3SAPBroadPhase::Draw() const
+{
+	for (u32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		const b3Proxy* proxy = m_proxies + i;
+		if (proxy->min[0] == B3_NULL_PROXY || proxy->isRemoved)
+		{
+			continue;
+		}
+
+		b3Draw_draw->DrawAABB(proxy->aabb, b3Color_pink);
+	}
+}
@@ -18,9 +18,8 @@
 
 #include <bounce/collision/time_of_impact.h>
 #include <bounce/collision/gjk/gjk.h>
+#include <bounce/common/stats.h>
 
-u32 b3_toiCalls = 0;
-u32 b3_toiMaxIters = 0;
 
 // Compute the closest point on a segment to a point. 
 static b3Vec3 b3ClosestPointOnSegment(const b3Vec3& Q,
@@ -560,8 +559,6 @@ struct b3SeparationFunction
 // CCD via the local separating axis method, a CA improvement.
 b3TOIOutput b3TimeOfImpact(const b3TOIInput& input)
 {
-	++b3_toiCalls;
-
 	b3TOIOutput output;
 	output.state = b3TOIOutput::e_unknown;
 	output.t = input.tMax;
@@ -748,7 +745,11 @@ b3TOIOutput b3TimeOfImpact(const b3TOIInput& input)
 		}
 	}
 
-	b3_toiMaxIters = b3Max(b3_toiMaxIters, iteration);
+	if (b3_stepStats)
+	{
+		++b3_stepStats->toiCalls;
+		b3_stepStats->toiMaxIters = b3Max(b3_stepStats->toiMaxIters, iteration);
+	}
 
 	output.iterations = iteration;
 
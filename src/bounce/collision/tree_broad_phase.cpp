@@ -0,0 +1,544 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/collision/tree_broad_phase.h>
+#include <bounce/common/thread/task_executor.h>
+#include <algorithm>
+
+struct b3PairBuffer
+{
+	void Initialize()
+	{
+		capacity = 16;
+		pairs = (b3Pair*)b3Alloc(capacity * sizeof(b3Pair));
+		count = 0;
+	}
+
+	void Free()
+	{
+		b3Free(pairs);
+	}
+
+	void Add(u32 proxy1, u32 proxy2)
+	{
+		// Check capacity.
+		if (count == capacity) 
+		{
+			// Duplicate capacity.
+			capacity *= 2;
+			
+			b3Pair* oldPairs = pairs;
+			pairs = (b3Pair*)b3Alloc(capacity * sizeof(b3Pair));
+			memcpy(pairs, oldPairs, count * sizeof(b3Pair));
+			b3Free(oldPairs);
+		}
+
+		pairs[count].proxy1 = b3Min(proxy1, proxy2);
+		pairs[count].proxy2 = b3Max(proxy1, proxy2);
+		++count;
+	}
+
+	b3Pair* pairs;
+	u32 count;
+	u32 capacity;
+
+	// Merge cursor
+	u32 index;
+};
+
+b3TreeBroadPhase::b3TreeBroadPhase() : b3BroadPhase(e_dynamicTreeBroadPhase)
+{
+	m_moveBufferCapacity = 16;
+	m_moveBuffer = (u32*)b3Alloc(m_moveBufferCapacity * sizeof(u32));
+	memset(m_moveBuffer, 0, m_moveBufferCapacity * sizeof(u32));
+	m_moveBufferCount = 0;
+
+	m_pairBufferCount = 1;
+	m_pairBuffers = (b3PairBuffer*)b3Alloc(m_pairBufferCount * sizeof(b3PairBuffer));
+	m_pairBuffers[0].Initialize();
+
+	m_staticProxyCount = 0;
+	m_staticInsertCount = 0;
+	m_staticTreeChanged = false;
+}
+
+b3TreeBroadPhase::~b3TreeBroadPhase() 
+{
+	b3Free(m_moveBuffer);
+	
+	for (u32 i = 0; i < m_pairBufferCount; ++i)
+	{
+		m_pairBuffers[i].Free();
+	}
+	b3Free(m_pairBuffers);
+}
+
+void b3TreeBroadPhase::BufferMove(u32 proxyId) 
+{
+	// The proxy has been moved. Add it to the buffer of moved proxies.
+	// Check capacity.
+	if (m_moveBufferCount == m_moveBufferCapacity) 
+	{
+		// Duplicate capacity.
+		m_moveBufferCapacity *= 2;
+
+		u32* oldMoveBuffer = m_moveBuffer;
+		m_moveBuffer = (u32*)b3Alloc(m_moveBufferCapacity * sizeof(u32));
+		memcpy(m_moveBuffer, oldMoveBuffer, m_moveBufferCount * sizeof(u32));
+		b3Free(oldMoveBuffer);
+	}
+
+	// Add to move buffer.
+	m_moveBuffer[m_moveBufferCount] = proxyId;
+	++m_moveBufferCount;
+}
+
+void b3TreeBroadPhase::UnbufferMove(u32 proxyId)
+{
+	for (u32 i = 0; i < m_moveBufferCount; ++i)
+	{
+		if (m_moveBuffer[i] == proxyId)
+		{
+			m_moveBuffer[i] = B3_NULL_PROXY;
+		}
+	}
+}
+
+u32 b3TreeBroadPhase::InsertProxy(const b3AABB& aabb, void* userData, bool isStatic) 
+{
+	u32 proxyId;
+	if (isStatic)
+	{
+		proxyId = MakeProxyId(m_staticTree.InsertNode(aabb, userData), true);
+		
+		++m_staticProxyCount;
+		++m_staticInsertCount;
+		m_staticTreeChanged = true;
+	}
+	else
+	{
+		proxyId = MakeProxyId(m_dynamicTree.InsertNode(aabb, userData), false);
+	}
+	
+	BufferMove(proxyId);
+
+	return proxyId;
+}
+
+void b3TreeBroadPhase::RemoveProxy(u32 proxyId) 
+{
+	UnbufferMove(proxyId);
+	
+	if (IsStatic(proxyId))
+	{
+		--m_staticProxyCount;
+		m_staticTreeChanged = true;
+	}
+
+	GetTree(proxyId)->RemoveNode(GetNode(proxyId));
+}
+
+void b3TreeBroadPhase::UpdateProxy(u32 proxyId, const b3AABB& aabb)
+{
+	GetTree(proxyId)->UpdateNode(GetNode(proxyId), aabb);
+	
+	if (IsStatic(proxyId))
+	{
+		m_staticTreeChanged = true;
+	}
+
+	// Buffer the moved proxy.
+	BufferMove(proxyId);
+}
+
+void b3TreeBroadPhase::TouchProxy(u32 proxyId)
+{
+	BufferMove(proxyId);
+}
+
+// Forward the tree callbacks to the broad-phase client.
+struct b3TreeQueryWrapper
+{
+	bool Report(u32 node)
+	{
+		if (fcn(context, (node << 1) | isStatic) == false)
+		{
+			stopped = true;
+			return false;
+		}
+		return true;
+	}
+
+	b3QueryProxyFcn* fcn;
+	void* context;
+	u32 isStatic;
+	bool stopped;
+};
+
+struct b3TreeRayCastWrapper
+{
+	scalar Report(const b3RayCastInput& input, u32 node)
+	{
+		scalar value = fcn(context, input, (node << 1) | isStatic);
+		
+		if (value == scalar(0))
+		{
+			stopped = true;
+		}
+		else if (value > scalar(0))
+		{
+			maxFraction = value;
+		}
+		
+		return value;
+	}
+
+	b3RayCastProxyFcn* fcn;
+	void* context;
+	u32 isStatic;
+	scalar maxFraction;
+	bool stopped;
+};
+
+struct b3TreeRayCastPacketWrapper
+{
+	scalar Report(const b3RayCastInput& input, u32 rayIndex, u32 node)
+	{
+		scalar value = fcn(context, input, rayIndex, (node << 1) | isStatic);
+		
+		if (value == scalar(0))
+		{
+			// Skip the stopped ray in the next tree.
+			inputs[rayIndex].maxFraction = scalar(-1);
+		}
+		else if (value > scalar(0))
+		{
+			inputs[rayIndex].maxFraction = value;
+		}
+		
+		return value;
+	}
+
+	b3RayCastPacketProxyFcn* fcn;
+	void* context;
+	u32 isStatic;
+	b3RayCastInput* inputs;
+};
+
+void b3TreeBroadPhase::QueryAABB(b3QueryProxyFcn* fcn, void* context, const b3AABB& aabb) const
+{
+	b3TreeQueryWrapper wrapper;
+	wrapper.fcn = fcn;
+	wrapper.context = context;
+	
+	wrapper.isStatic = 1;
+	wrapper.stopped = false;
+	m_staticTree.QueryAABB(&wrapper, aabb);
+
+	if (wrapper.stopped)
+	{
+		return;
+	}
+
+	wrapper.isStatic = 0;
+	m_dynamicTree.QueryAABB(&wrapper, aabb);
+}
+
+void b3TreeBroadPhase::RayCast(b3RayCastProxyFcn* fcn, void* context, const b3RayCastInput& input) const
+{
+	b3TreeRayCastWrapper wrapper;
+	wrapper.fcn = fcn;
+	wrapper.context = context;
+	wrapper.maxFraction = input.maxFraction;
+	wrapper.stopped = false;
+	
+	wrapper.isStatic = 1;
+	m_staticTree.RayCast(&wrapper, input);
+
+	if (wrapper.stopped)
+	{
+		return;
+	}
+
+	// Continue with the clipped ray.
+	b3RayCastInput subInput = input;
+	subInput.maxFraction = wrapper.maxFraction;
+
+	wrapper.isStatic = 0;
+	m_dynamicTree.RayCast(&wrapper, subInput);
+}
+
+void b3TreeBroadPhase::RayCastPacket(b3RayCastPacketProxyFcn* fcn, void* context, const b3RayCastInput* inputs, u32 count) const
+{
+	B3_ASSERT(count <= b3_rayPacketSize);
+
+	// The rays are clipped by the static tree before the dynamic tree.
+	b3RayCastInput subInputs[b3_rayPacketSize];
+	for (u32 i = 0; i < count; ++i)
+	{
+		subInputs[i] = inputs[i];
+	}
+
+	b3TreeRayCastPacketWrapper wrapper;
+	wrapper.fcn = fcn;
+	wrapper.context = context;
+	wrapper.inputs = subInputs;
+
+	wrapper.isStatic = 1;
+	m_staticTree.RayCastPacket(&wrapper, subInputs, count);
+
+	wrapper.isStatic = 0;
+	m_dynamicTree.RayCastPacket(&wrapper, subInputs, count);
+}
+
+static B3_FORCE_INLINE bool operator<(const b3Pair& pair1, const b3Pair& pair2) 
+{
+	if (pair1.proxy1 < pair2.proxy1) 
+	{
+		return true;
+	}
+
+	if (pair1.proxy1 == pair2.proxy1) 
+	{
+		return pair1.proxy2 < pair2.proxy2;
+	}
+
+	return false;
+}
+
+static B3_FORCE_INLINE bool operator==(const b3Pair& pair1, const b3Pair& pair2) 
+{
+	return pair1.proxy1 == pair2.proxy1 && pair1.proxy2 == pair2.proxy2;
+}
+
+// Add the pairs overlapping a moved proxy to a pair buffer.
+struct b3TreePairQuery
+{
+	bool Report(u32 node)
+	{
+		u32 proxyId = (node << 1) | isStatic;
+
+		if (proxyId == queryProxyId) 
+		{
+			// The proxy can't overlap with itself.
+			return true;
+		}
+
+		// Add overlapping pair to the pair buffer.
+		buffer->Add(proxyId, queryProxyId);
+
+		// Keep looking for overlapping pairs.
+		return true;
+	}
+
+	b3PairBuffer* buffer;
+	
+	// The current proxy being queried for overlap with another proxies. 
+	// It is used to avoid a proxy overlap with itself.
+	u32 queryProxyId;
+	
+	// Is the tree being queried the static tree?
+	u32 isStatic;
+};
+
+void b3TreeBroadPhase::QueryPairs(u32 begin, u32 end, b3PairBuffer* buffer) const
+{
+	b3TreePairQuery query;
+	query.buffer = buffer;
+
+	for (u32 i = begin; i < end; ++i) 
+	{
+		query.queryProxyId = m_moveBuffer[i];
+
+		if (query.queryProxyId == B3_NULL_PROXY)
+		{
+			// Proxy was unbuffered
+			continue;
+		}
+
+		const b3AABB& aabb = GetAABB(query.queryProxyId);
+		
+		// Static proxies don't collide with each other.
+		if (IsStatic(query.queryProxyId) == false)
+		{
+			query.isStatic = 1;
+			m_staticTree.QueryAABB(&query, aabb);
+		}
+
+		query.isStatic = 0;
+		m_dynamicTree.QueryAABB(&query, aabb);
+	}
+}
+
+void b3TreeBroadPhase::QueryPairsTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	b3TreeBroadPhase* broadPhase = (b3TreeBroadPhase*)context;
+	broadPhase->QueryPairs(begin, end, broadPhase->m_pairBuffers + workerIndex);
+}
+
+void b3TreeBroadPhase::SortPairsTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	B3_NOT_USED(workerIndex);
+
+	b3TreeBroadPhase* broadPhase = (b3TreeBroadPhase*)context;
+	for (u32 i = begin; i < end; ++i)
+	{
+		b3PairBuffer* buffer = broadPhase->m_pairBuffers + i;
+		std::sort(buffer->pairs, buffer->pairs + buffer->count);
+	}
+}
+
+void b3TreeBroadPhase::FindPairs(b3AddPairFcn* fcn, void* context) 
+{
+	// Rebuild the static tree if many static proxies were inserted.
+	if (m_staticInsertCount >= b3_minStaticTreeRebuildCount && 4 * m_staticInsertCount >= m_staticProxyCount)
+	{
+		m_staticTree.RebuildTopDown();
+		m_staticInsertCount = 0;
+	}
+
+	// Collapse the static tree into a wide tree once it stops changing.
+	// The wide tree is cleared when the static tree changes.
+	if (m_staticTreeChanged == false && m_staticTree.HasWideTree() == false && m_staticProxyCount > 0)
+	{
+		m_staticTree.BuildWideTree();
+	}
+	m_staticTreeChanged = false;
+
+	u32 bufferCount = 1;
+	
+	if (m_executor && m_moveBufferCount >= b3_minParallelMoveCount)
+	{
+		bufferCount = m_executor->GetWorkerCount();
+		
+		// Ensure there is a pair buffer per worker.
+		if (bufferCount > m_pairBufferCount)
+		{
+			b3PairBuffer* oldBuffers = m_pairBuffers;
+			m_pairBuffers = (b3PairBuffer*)b3Alloc(bufferCount * sizeof(b3PairBuffer));
+			memcpy(m_pairBuffers, oldBuffers, m_pairBufferCount * sizeof(b3PairBuffer));
+			b3Free(oldBuffers);
+
+			for (u32 i = m_pairBufferCount; i < bufferCount; ++i)
+			{
+				m_pairBuffers[i].Initialize();
+			}
+			m_pairBufferCount = bufferCount;
+		}
+
+		for (u32 i = 0; i < bufferCount; ++i)
+		{
+			m_pairBuffers[i].count = 0;
+		}
+
+		// The trees are read-only while querying.
+		m_executor->ParallelFor(m_moveBufferCount, b3_minMoveTaskRange, QueryPairsTask, this);
+		m_executor->ParallelFor(bufferCount, 1, SortPairsTask, this);
+	}
+	else
+	{
+		b3PairBuffer* buffer = m_pairBuffers;
+		buffer->count = 0;
+		
+		QueryPairs(0, m_moveBufferCount, buffer);
+		
+		// Sort the (duplicated) overlapping pair buffer to prune duplicated pairs.
+		std::sort(buffer->pairs, buffer->pairs + buffer->count);
+	}
+
+	// Reset the move buffer for the next step.
+	m_moveBufferCount = 0;
+
+	// Merge the sorted buffers and skip the duplicated pairs.
+	// The pairs are reported in ascending order, which doesn't depend 
+	// on the worker that found them.
+	for (u32 i = 0; i < bufferCount; ++i)
+	{
+		m_pairBuffers[i].index = 0;
+	}
+
+	b3Pair lastPair;
+	lastPair.proxy1 = B3_NULL_PROXY;
+	lastPair.proxy2 = B3_NULL_PROXY;
+
+	for (;;)
+	{
+		// Find the smallest pair in the buffers.
+		const b3Pair* minPair = nullptr;
+		u32 minBuffer = 0;
+		for (u32 i = 0; i < bufferCount; ++i)
+		{
+			const b3PairBuffer* buffer = m_pairBuffers + i;
+			if (buffer->index == buffer->count)
+			{
+				continue;
+			}
+
+			const b3Pair* pair = buffer->pairs + buffer->index;
+			if (minPair == nullptr || *pair < *minPair)
+			{
+				minPair = pair;
+				minBuffer = i;
+			}
+		}
+
+		if (minPair == nullptr)
+		{
+			break;
+		}
+
+		++m_pairBuffers[minBuffer].index;
+
+		if (*minPair == lastPair)
+		{
+			// Duplicated pair
+			continue;
+		}
+
+		lastPair = *minPair;
+
+		// Report an unique overlapping pair to the client.
+		fcn(context, GetUserData(lastPair.proxy1), GetUserData(lastPair.proxy2));
+	}
+}
+
+void b3TreeBroadPhase::Optimize(u32 maxProxyCount)
+{
+	m_dynamicTree.Optimize(maxProxyCount);
+}
+
+u32 b3TreeBroadPhase::GetTreeHeight() const
+{
+	return m_dynamicTree.GetHeight();
+}
+
+u32 b3TreeBroadPhase::GetTreeBalance() const
+{
+	return m_dynamicTree.GetMaxBalance();
+}
+
+scalar b3TreeBroadPhase::GetTreeQuality() const
+{
+	return m_dynamicTree.GetAreaRatio();
+}
+
+void b3TreeBroadPhase::Draw() const
+{
+	m_staticTree.Draw();
+	m_dynamicTree.Draw();
+}
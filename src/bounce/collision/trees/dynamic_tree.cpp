@@ -17,6 +17,7 @@
 */
 
 #include <bounce/collision/trees/dynamic_tree.h>
+#include <bounce/collision/trees/static_tree.h>
 #include <bounce/common/draw.h>
 #include <string.h>
 
@@ -29,6 +30,7 @@ b3DynamicTree::b3DynamicTree()
 	m_nodes = (b3Node*) b3Alloc(m_nodeCapacity * sizeof(b3Node));
 	memset(m_nodes, 0, m_nodeCapacity * sizeof(b3Node));
 	m_nodeCount = 0;
+	m_optimizeCursor = 0;
 
 	// Link the allocated nodes and make the first node 
 	// available the the next allocation.
@@ -107,6 +109,8 @@ void b3DynamicTree::AddToFreeList(u32 node)
 
 u32 b3DynamicTree::InsertNode(const b3AABB& aabb, void* userData) 
 {
+	m_wideTree.Clear();
+
 	// Insert into the array.
 	u32 node = AllocateNode();
 	m_nodes[node].aabb = aabb;
@@ -122,6 +126,8 @@ u32 b3DynamicTree::InsertNode(const b3AABB& aabb, void* userData)
 
 void b3DynamicTree::RemoveNode(u32 proxyId) 
 {
+	m_wideTree.Clear();
+
 	// Remove from the tree.
 	RemoveLeaf(proxyId);
 	
@@ -134,6 +140,8 @@ void b3DynamicTree::UpdateNode(u32 proxyId, const b3AABB& aabb)
 	B3_ASSERT(m_root != B3_NULL_NODE_D);
 	B3_ASSERT(m_nodes[proxyId].IsLeaf());
 	
+	m_wideTree.Clear();
+
 	// Remove old AABB from the tree.
 	RemoveLeaf(proxyId);
 	
@@ -257,7 +265,8 @@ void b3DynamicTree::InsertLeaf(u32 leaf)
 	}
 
 	// If we have ancestor nodes then adjust its AABBs.
-	Refit(m_nodes[leaf].parent);
+	// Rotate the nodes the leaf has enlarged.
+	Refit(m_nodes[leaf].parent, true);
 }
 
 void b3DynamicTree::RemoveLeaf(u32 leaf) 
@@ -296,7 +305,7 @@ void b3DynamicTree::RemoveLeaf(u32 leaf)
 		FreeNode(parent);
 
 		// If we have ancestor then nodes adjust its AABBs.
-		Refit(grandParent);
+		Refit(grandParent, false);
 	}
 	else 
 	{
@@ -307,7 +316,7 @@ void b3DynamicTree::RemoveLeaf(u32 leaf)
 	}
 }
 
-void b3DynamicTree::Refit(u32 node) 
+void b3DynamicTree::Refit(u32 node, bool rotate) 
 {
 	while (node != B3_NULL_NODE_D) 
 	{
@@ -322,6 +331,11 @@ void b3DynamicTree::Refit(u32 node)
 		m_nodes[node].height = 1 + b3Max(m_nodes[child1].height, m_nodes[child2].height);
 		m_nodes[node].aabb = b3Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
 
+		if (rotate)
+		{
+			Rotate(node);
+		}
+
 		node = m_nodes[node].parent;
 	}
 }
@@ -470,6 +484,382 @@ u32 b3DynamicTree::Balance(u32 iA)
 
 	return iA;
 }
+
+// Tree rotations from Kopta et al. 
+// "Fast, Effective BVH Updates for Animated Scenes".
+// Node A has children B and C. B has children D and E. C has children F and G.
+// B can be swapped with F or G and C can be swapped with D or E. 
+// The bounds of A don't change, so the ancestors aren't affected.
+// A rotation is rejected if it would make A imbalanced.
+void b3DynamicTree::Rotate(u32 iA)
+{
+	b3Node* A = m_nodes + iA;
+	if (A->height < 2)
+	{
+		return;
+	}
+
+	u32 iB = A->child1;
+	u32 iC = A->child2;
+	b3Node* B = m_nodes + iB;
+	b3Node* C = m_nodes + iC;
+
+	enum b3Rotation
+	{
+		e_none,
+		e_BF,
+		e_BG,
+		e_CD,
+		e_CE
+	};
+
+	b3Rotation bestRotation = e_none;
+	scalar bestCost = scalar(0);
+
+	if (C->IsLeaf() == false)
+	{
+		const b3Node* F = m_nodes + C->child1;
+		const b3Node* G = m_nodes + C->child2;
+
+		scalar areaC = C->aabb.GetSurfaceArea();
+
+		// Swap B and F
+		i32 heightC = 1 + b3Max(B->height, G->height);
+		if (b3Abs(heightC - F->height) <= 1)
+		{
+			scalar cost = b3Combine(B->aabb, G->aabb).GetSurfaceArea() - areaC;
+			if (cost < bestCost)
+			{
+				bestRotation = e_BF;
+				bestCost = cost;
+			}
+		}
+
+		// Swap B and G
+		heightC = 1 + b3Max(B->height, F->height);
+		if (b3Abs(heightC - G->height) <= 1)
+		{
+			scalar cost = b3Combine(B->aabb, F->aabb).GetSurfaceArea() - areaC;
+			if (cost < bestCost)
+			{
+				bestRotation = e_BG;
+				bestCost = cost;
+			}
+		}
+	}
+
+	if (B->IsLeaf() == false)
+	{
+		const b3Node* D = m_nodes + B->child1;
+		const b3Node* E = m_nodes + B->child2;
+
+		scalar areaB = B->aabb.GetSurfaceArea();
+
+		// Swap C and D
+		i32 heightB = 1 + b3Max(C->height, E->height);
+		if (b3Abs(heightB - D->height) <= 1)
+		{
+			scalar cost = b3Combine(C->aabb, E->aabb).GetSurfaceArea() - areaB;
+			if (cost < bestCost)
+			{
+				bestRotation = e_CD;
+				bestCost = cost;
+			}
+		}
+
+		// Swap C and E
+		heightB = 1 + b3Max(C->height, D->height);
+		if (b3Abs(heightB - E->height) <= 1)
+		{
+			scalar cost = b3Combine(C->aabb, D->aabb).GetSurfaceArea() - areaB;
+			if (cost < bestCost)
+			{
+				bestRotation = e_CE;
+				bestCost = cost;
+			}
+		}
+	}
+
+	switch (bestRotation)
+	{
+	case e_none:
+	{
+		break;
+	}
+	case e_BF:
+	{
+		u32 iF = C->child1;
+		u32 iG = C->child2;
+		b3Node* F = m_nodes + iF;
+		b3Node* G = m_nodes + iG;
+
+		A->child1 = iF;
+		F->parent = iA;
+		C->child1 = iB;
+		B->parent = iC;
+
+		C->aabb = b3Combine(B->aabb, G->aabb);
+		C->height = 1 + b3Max(B->height, G->height);
+		A->height = 1 + b3Max(F->height, C->height);
+		break;
+	}
+	case e_BG:
+	{
+		u32 iF = C->child1;
+		u32 iG = C->child2;
+		b3Node* F = m_nodes + iF;
+		b3Node* G = m_nodes + iG;
+
+		A->child1 = iG;
+		G->parent = iA;
+		C->child2 = iB;
+		B->parent = iC;
+
+		C->aabb = b3Combine(B->aabb, F->aabb);
+		C->height = 1 + b3Max(B->height, F->height);
+		A->height = 1 + b3Max(G->height, C->height);
+		break;
+	}
+	case e_CD:
+	{
+		u32 iD = B->child1;
+		u32 iE = B->child2;
+		b3Node* D = m_nodes + iD;
+		b3Node* E = m_nodes + iE;
+
+		A->child2 = iD;
+		D->parent = iA;
+		B->child1 = iC;
+		C->parent = iB;
+
+		B->aabb = b3Combine(C->aabb, E->aabb);
+		B->height = 1 + b3Max(C->height, E->height);
+		A->height = 1 + b3Max(B->height, D->height);
+		break;
+	}
+	case e_CE:
+	{
+		u32 iD = B->child1;
+		u32 iE = B->child2;
+		b3Node* D = m_nodes + iD;
+		b3Node* E = m_nodes + iE;
+
+		A->child2 = iE;
+		E->parent = iA;
+		B->child2 = iC;
+		C->parent = iB;
+
+		B->aabb = b3Combine(C->aabb, D->aabb);
+		B->height = 1 + b3Max(C->height, D->height);
+		A->height = 1 + b3Max(B->height, E->height);
+		break;
+	}
+	default:
+	{
+		B3_ASSERT(false);
+		break;
+	}
+	}
+}
+void b3DynamicTree::RebuildTopDown()
+{
+	if (m_root == B3_NULL_NODE_D)
+	{
+		return;
+	}
+
+	m_wideTree.Clear();
+
+	u32* leaves = (u32*)b3Alloc(m_nodeCount * sizeof(u32));
+	u32 leafCount = 0;
+
+	// Collect the leaves and free the internal nodes.
+	for (u32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodes[i].height < 0)
+		{
+			// Free node
+			continue;
+		}
+
+		if (m_nodes[i].IsLeaf())
+		{
+			leaves[leafCount++] = i;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	// Build a static tree with a leaf per proxy.
+	b3AABB* aabbs = (b3AABB*)b3Alloc(leafCount * sizeof(b3AABB));
+	for (u32 i = 0; i < leafCount; ++i)
+	{
+		aabbs[i] = m_nodes[leaves[i]].aabb;
+	}
+
+	b3StaticTreeDef def;
+	def.maxLeafSize = 1;
+
+	b3StaticTree tree;
+	tree.Build(aabbs, leafCount, def);
+
+	b3Free(aabbs);
+
+	// Copy the hierarchy of the static tree.
+	// The children of a static node follow it, so the nodes are created from the last one.
+	u32* nodeMap = (u32*)b3Alloc(tree.m_nodeCount * sizeof(u32));
+	for (u32 i = tree.m_nodeCount; i > 0; --i)
+	{
+		u32 index = i - 1;
+		const b3StaticTree::b3Node* source = tree.m_nodes + index;
+
+		if (source->IsLeaf())
+		{
+			B3_ASSERT(source->count == 1);
+			nodeMap[index] = leaves[tree.m_proxyIndices[source->index]];
+			continue;
+		}
+
+		u32 child1 = nodeMap[index + 1];
+		u32 child2 = nodeMap[source->child2];
+
+		u32 node = AllocateNode();
+		m_nodes[node].child1 = child1;
+		m_nodes[node].child2 = child2;
+		m_nodes[node].aabb = b3Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+		m_nodes[node].height = 1 + b3Max(m_nodes[child1].height, m_nodes[child2].height);
+
+		m_nodes[child1].parent = node;
+		m_nodes[child2].parent = node;
+
+		nodeMap[index] = node;
+	}
+
+	m_root = nodeMap[tree.m_root];
+	m_nodes[m_root].parent = B3_NULL_NODE_D;
+
+	b3Free(nodeMap);
+	b3Free(leaves);
+
+	Validate(m_root);
+}
+
+void b3DynamicTree::BuildWideTree()
+{
+	if (m_root == B3_NULL_NODE_D)
+	{
+		m_wideTree.Clear();
+		return;
+	}
+
+	// The source nodes have the same indices as the nodes.
+	b3WideTreeSourceNode* sourceNodes = (b3WideTreeSourceNode*)b3Alloc(m_nodeCapacity * sizeof(b3WideTreeSourceNode));
+	for (u32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		const b3Node* node = m_nodes + i;
+		if (node->height < 0)
+		{
+			// Free node
+			continue;
+		}
+
+		b3WideTreeSourceNode* sourceNode = sourceNodes + i;
+		sourceNode->aabb = node->aabb;
+		sourceNode->child1 = node->IsLeaf() ? B3_NULL_NODE_W : node->child1;
+		sourceNode->child2 = node->IsLeaf() ? B3_NULL_NODE_W : node->child2;
+		sourceNode->leaf = i;
+	}
+
+	m_wideTree.Build(sourceNodes, m_nodeCount, m_root);
+
+	b3Free(sourceNodes);
+}
+
+void b3DynamicTree::Optimize(u32 maxLeafCount)
+{
+	if (m_root == B3_NULL_NODE_D || m_nodes[m_root].IsLeaf())
+	{
+		return;
+	}
+
+	m_wideTree.Clear();
+
+	// Reinserting a leaf can allocate a node and grow the pool.
+	// Visit at most one pool of nodes per call.
+	u32 visitCount = m_nodeCapacity;
+	u32 leafCount = 0;
+	for (u32 i = 0; i < visitCount && leafCount < maxLeafCount; ++i)
+	{
+		if (m_optimizeCursor >= m_nodeCapacity)
+		{
+			m_optimizeCursor = 0;
+		}
+
+		u32 node = m_optimizeCursor++;
+
+		if (m_nodes[node].height != 0)
+		{
+			// Free or internal node
+			continue;
+		}
+
+		RemoveLeaf(node);
+		InsertLeaf(node);
+
+		++leafCount;
+	}
+}
+
+scalar b3DynamicTree::GetAreaRatio() const
+{
+	if (m_root == B3_NULL_NODE_D)
+	{
+		return scalar(0);
+	}
+
+	scalar rootArea = m_nodes[m_root].aabb.GetSurfaceArea();
+	if (rootArea == scalar(0))
+	{
+		return scalar(0);
+	}
+
+	scalar totalArea = scalar(0);
+	for (u32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		const b3Node* node = m_nodes + i;
+		if (node->height < 0)
+		{
+			// Free node
+			continue;
+		}
+
+		totalArea += node->aabb.GetSurfaceArea();
+	}
+
+	return totalArea / rootArea;
+}
+
+u32 b3DynamicTree::GetMaxBalance() const
+{
+	u32 maxBalance = 0;
+	for (u32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		const b3Node* node = m_nodes + i;
+		if (node->height <= 1)
+		{
+			// Free node, leaf, or internal node with two leaves
+			continue;
+		}
+
+		i32 balance = b3Abs(m_nodes[node->child2].height - m_nodes[node->child1].height);
+		maxBalance = b3Max(maxBalance, u32(balance));
+	}
+
+	return maxBalance;
+}
+
 void b3DynamicTree::Validate(u32 nodeID) const 
 {
 	if (nodeID == B3_NULL_NODE_D) 
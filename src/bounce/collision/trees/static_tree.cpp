@@ -18,154 +18,1197 @@
 
 #include <bounce/collision/trees/static_tree.h>
 #include <bounce/common/template/stack.h>
+#include <bounce/common/template/array.h>
+#include <bounce/common/thread/task_executor.h>
 #include <bounce/common/draw.h>
 #include <algorithm>
+#include <string.h>
 
 b3StaticTree::b3StaticTree()
 {
 	m_root = B3_NULL_NODE_S;
 	m_nodes = nullptr;
 	m_nodeCount = 0;
+	m_proxyAABBs = nullptr;
+	m_proxyIndices = nullptr;
+	m_proxyCount = 0;
+	m_quantizedNodes = nullptr;
+	m_quantizedProxyAABBs = nullptr;
+	m_blob = nullptr;
 }
 
 b3StaticTree::~b3StaticTree()
 {
-	b3Free(m_nodes);
+	Clear();
 }
 
-struct b3SortPredicate
+void b3StaticTree::Clear()
 {
-	b3SortPredicate() { }
-
-	bool operator()(u32 a, u32 b)
+	if (m_blob == nullptr)
 	{
-		b3Vec3 ca = set[a].GetCenter();
-		b3Vec3 cb = set[b].GetCenter();
+		b3Free(m_nodes);
+		b3Free(m_proxyAABBs);
+		b3Free(m_proxyIndices);
+		b3Free(m_quantizedNodes);
+		b3Free(m_quantizedProxyAABBs);
+	}
+
+	m_root = B3_NULL_NODE_S;
+	m_nodes = nullptr;
+	m_nodeCount = 0;
+	m_proxyAABBs = nullptr;
+	m_proxyIndices = nullptr;
+	m_proxyCount = 0;
+	m_quantizedNodes = nullptr;
+	m_quantizedProxyAABBs = nullptr;
+	m_blob = nullptr;
+	
+	m_wideTree.Clear();
+}
 
-		return ca[axis] < cb[axis];
+// A bin used to evaluate the split candidates along an axis.
+struct b3TreeBin
+{
+	b3AABB aabb;
+	u32 count;
+};
+
+// The bounds and bins of a set of proxies.
+// Each worker fills its own when a large set is binned in parallel.
+struct b3TreeBinSet
+{
+	b3AABB aabb;
+	b3AABB centerAABB;
+	u32 count;
+	b3TreeBin bins[3][b3_maxStaticTreeBins];
+};
+
+// A range of proxies that becomes a node.
+struct b3TreeBuildTask
+{
+	u32 begin, end;
+	u32 parent; // the node having this node as its second child
+};
+
+// A node or a subtree at the top of a tree built in parallel.
+struct b3TreeBuildItem
+{
+	u32 begin, end;
+	b3AABB aabb;
+	u32 child2; // the item that is the second child of a node
+	bool isSubtree;
+	u32 nodeStart; // the index of the first node of this item in the tree
+	u32 nodeCount;
+	void* nodes; // the nodes of a subtree
+};
+
+static B3_FORCE_INLINE u32 b3GetBin(scalar center, scalar lower, scalar scale, u32 binCount)
+{
+	u32 bin = u32((center - lower) * scale);
+	return bin < binCount ? bin : binCount - 1;
+}
+
+struct b3BinPredicate
+{
+	bool operator()(u32 id) const
+	{
+		return b3GetBin(centers[id][axis], lower, scale, binCount) <= splitBin;
 	}
 
-	const b3AABB* set;
+	const b3Vec3* centers;
 	u32 axis;
+	scalar lower;
+	scalar scale;
+	u32 binCount;
+	u32 splitBin;
 };
 
-static u32 b3Partition(const b3AABB& setAABB, const b3AABB* set, u32* ids, u32 count)
+// Builds the nodes of a static tree. 
+// The tree is the same whether it is built serially or in parallel.
+struct b3StaticTreeBuilder
 {
-	// Choose a partitioning axis.
-	u32 splitAxis = setAABB.GetLongestAxisIndex();
+	typedef b3StaticTree::b3Node b3Node;
+
+	// Build the tree and return the number of nodes.
+	u32 Build(b3Node* nodes, u32 count);
 
-	// Choose a split point.
-	scalar splitPos = setAABB.GetCenter()[splitAxis];
+	// Build a subtree in depth-first order and return the number of nodes. 
+	// The second child indices are relative to the first node.
+	u32 BuildSubtree(b3Node* nodes, u32 begin, u32 end) const;
 
-	// Sort along the split axis.
-	b3SortPredicate predicate;
-	predicate.set = set;
-	predicate.axis = splitAxis;
+	// Compute the AABB of a set of proxies and split the set. 
+	// Return the first proxy in the second subset, or zero if the set is a leaf.
+	u32 Partition(b3AABB* aabb, u32 begin, u32 end) const;
 
-	std::sort(ids, ids + count, predicate);
+	// Compute the bounds of a set of proxies and optionally bin them.
+	void Bin(b3TreeBinSet* set, u32 begin, u32 end, bool bin) const;
 
-	// Find the AABB that splits the set in two subsets.
-	u32 left = 0;
-	u32 right = count - 1;
-	u32 middle = left;
-	while (middle < right)
+	static void BoundsTask(u32 begin, u32 end, u32 workerIndex, void* context);
+	static void BinTask(u32 begin, u32 end, u32 workerIndex, void* context);
+	static void SubtreeTask(u32 begin, u32 end, u32 workerIndex, void* context);
+
+	const b3AABB* aabbs;
+	const b3Vec3* centers;
+	u32* ids;
+	u32 maxLeafSize;
+	u32 binCount;
+	
+	b3TaskExecutor* executor;
+	b3TreeBinSet* workerSets;
+	b3TreeBuildItem* items;
+	u32* subtreeItems;
+};
+
+void b3StaticTreeBuilder::Bin(b3TreeBinSet* set, u32 begin, u32 end, bool bin) const
+{
+	for (u32 i = begin; i < end; ++i)
 	{
-		b3Vec3 center = set[ids[middle]].GetCenter();
-		if (center[splitAxis] > splitPos)
+		u32 id = ids[i];
+		
+		if (bin)
 		{
-			// Found median.
-			break;
+			for (u32 axis = 0; axis < 3; ++axis)
+			{
+				scalar lower = set->centerAABB.lowerBound[axis];
+				scalar extent = set->centerAABB.upperBound[axis] - lower;
+				if (extent <= scalar(0))
+				{
+					continue;
+				}
+
+				scalar scale = scalar(binCount) / extent;
+				u32 binIndex = b3GetBin(centers[id][axis], lower, scale, binCount);
+
+				b3TreeBin* b = set->bins[axis] + binIndex;
+				if (b->count == 0)
+				{
+					b->aabb = aabbs[id];
+				}
+				else
+				{
+					b->aabb.Combine(aabbs[id]);
+				}
+				++b->count;
+			}
+		}
+		else
+		{
+			if (set->count == 0)
+			{
+				set->aabb = aabbs[id];
+				set->centerAABB.lowerBound = centers[id];
+				set->centerAABB.upperBound = centers[id];
+			}
+			else
+			{
+				set->aabb.Combine(aabbs[id]);
+				set->centerAABB.lowerBound = b3Min(set->centerAABB.lowerBound, centers[id]);
+				set->centerAABB.upperBound = b3Max(set->centerAABB.upperBound, centers[id]);
+			}
+			++set->count;
+		}
+	}
+}
+
+// Context of the parallel binning of a range of proxies.
+struct b3TreeBinContext
+{
+	const b3StaticTreeBuilder* builder;
+	u32 begin;
+	const b3AABB* centerAABB;
+};
+
+void b3StaticTreeBuilder::BoundsTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	b3TreeBinContext* ctx = (b3TreeBinContext*)context;
+	b3TreeBinSet* set = ctx->builder->workerSets + workerIndex;
+	ctx->builder->Bin(set, ctx->begin + begin, ctx->begin + end, false);
+}
+
+void b3StaticTreeBuilder::BinTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	b3TreeBinContext* ctx = (b3TreeBinContext*)context;
+	b3TreeBinSet* set = ctx->builder->workerSets + workerIndex;
+	set->centerAABB = *ctx->centerAABB;
+	ctx->builder->Bin(set, ctx->begin + begin, ctx->begin + end, true);
+}
+
+u32 b3StaticTreeBuilder::Partition(b3AABB* aabb, u32 begin, u32 end) const
+{
+	u32 n = end - begin;
+	B3_ASSERT(n > 0);
+
+	b3TreeBinSet set;
+	set.count = 0;
+	for (u32 axis = 0; axis < 3; ++axis)
+	{
+		for (u32 i = 0; i < binCount; ++i)
+		{
+			set.bins[axis][i].count = 0;
+		}
+	}
+
+	// Large sets are binned in parallel. 
+	// The AABBs are merged using min and max, so the result is the same.
+	bool parallel = executor && n >= b3_minParallelTreeBinCount;
+	u32 workerCount = parallel ? executor->GetWorkerCount() : 0;
+
+	b3TreeBinContext context;
+	context.builder = this;
+	context.begin = begin;
+	context.centerAABB = &set.centerAABB;
+
+	// Enclose the proxies and their centers.
+	if (parallel)
+	{
+		for (u32 i = 0; i < workerCount; ++i)
+		{
+			workerSets[i].count = 0;
+		}
+
+		executor->ParallelFor(n, b3_minTreeBinTaskRange, BoundsTask, &context);
+
+		for (u32 i = 0; i < workerCount; ++i)
+		{
+			const b3TreeBinSet* workerSet = workerSets + i;
+			if (workerSet->count == 0)
+			{
+				continue;
+			}
+
+			if (set.count == 0)
+			{
+				set.aabb = workerSet->aabb;
+				set.centerAABB = workerSet->centerAABB;
+			}
+			else
+			{
+				set.aabb.Combine(workerSet->aabb);
+				set.centerAABB.lowerBound = b3Min(set.centerAABB.lowerBound, workerSet->centerAABB.lowerBound);
+				set.centerAABB.upperBound = b3Max(set.centerAABB.upperBound, workerSet->centerAABB.upperBound);
+			}
+			set.count += workerSet->count;
 		}
-		++middle;
 	}
+	else
+	{
+		Bin(&set, begin, end, false);
+	}
+
+	*aabb = set.aabb;
+
+	if (n <= maxLeafSize)
+	{
+		return 0;
+	}
+
+	if (parallel)
+	{
+		for (u32 i = 0; i < workerCount; ++i)
+		{
+			for (u32 axis = 0; axis < 3; ++axis)
+			{
+				for (u32 j = 0; j < binCount; ++j)
+				{
+					workerSets[i].bins[axis][j].count = 0;
+				}
+			}
+		}
+
+		executor->ParallelFor(n, b3_minTreeBinTaskRange, BinTask, &context);
+
+		for (u32 i = 0; i < workerCount; ++i)
+		{
+			for (u32 axis = 0; axis < 3; ++axis)
+			{
+				for (u32 j = 0; j < binCount; ++j)
+				{
+					const b3TreeBin* workerBin = workerSets[i].bins[axis] + j;
+					if (workerBin->count == 0)
+					{
+						continue;
+					}
+
+					b3TreeBin* bin = set.bins[axis] + j;
+					if (bin->count == 0)
+					{
+						bin->aabb = workerBin->aabb;
+					}
+					else
+					{
+						bin->aabb.Combine(workerBin->aabb);
+					}
+					bin->count += workerBin->count;
+				}
+			}
+		}
+	}
+	else
+	{
+		Bin(&set, begin, end, true);
+	}
+
+	// Find the split having the smallest SAH cost.
+	scalar bestCost = B3_MAX_SCALAR;
+	u32 bestAxis = 0;
+	u32 bestBin = 0;
+
+	for (u32 axis = 0; axis < 3; ++axis)
+	{
+		if (set.centerAABB.upperBound[axis] - set.centerAABB.lowerBound[axis] <= scalar(0))
+		{
+			continue;
+		}
+
+		const b3TreeBin* bins = set.bins[axis];
+
+		// Sweep from the right to get the area and count on the right side of each split.
+		scalar rightAreas[b3_maxStaticTreeBins];
+		u32 rightCounts[b3_maxStaticTreeBins];
+
+		b3AABB rightAABB;
+		u32 rightCount = 0;
+		for (u32 i = binCount - 1; i > 0; --i)
+		{
+			const b3TreeBin* bin = bins + i;
+			if (bin->count > 0)
+			{
+				rightAABB = rightCount == 0 ? bin->aabb : b3Combine(rightAABB, bin->aabb);
+				rightCount += bin->count;
+			}
+
+			rightAreas[i] = rightCount > 0 ? rightAABB.GetSurfaceArea() : scalar(0);
+			rightCounts[i] = rightCount;
+		}
+
+		// Sweep from the left and evaluate the split after each bin.
+		b3AABB leftAABB;
+		u32 leftCount = 0;
+		for (u32 i = 0; i < binCount - 1; ++i)
+		{
+			const b3TreeBin* bin = bins + i;
+			if (bin->count > 0)
+			{
+				leftAABB = leftCount == 0 ? bin->aabb : b3Combine(leftAABB, bin->aabb);
+				leftCount += bin->count;
+			}
+
+			if (leftCount == 0 || rightCounts[i + 1] == 0)
+			{
+				continue;
+			}
+
+			// The node area and the traversal cost are the same for all splits.
+			scalar splitCost = scalar(leftCount) * leftAABB.GetSurfaceArea() + scalar(rightCounts[i + 1]) * rightAreas[i + 1];
+			if (splitCost < bestCost)
+			{
+				bestCost = splitCost;
+				bestAxis = axis;
+				bestBin = i;
+			}
+		}
+	}
+
+	u32 middle;
+	if (bestCost < B3_MAX_SCALAR)
+	{
+		scalar lower = set.centerAABB.lowerBound[bestAxis];
+		scalar extent = set.centerAABB.upperBound[bestAxis] - lower;
 
-	// Ensure nonempty subsets.
-	u32 count1 = middle;
-	u32 count2 = count - middle;
-	if (count1 == 0 || count2 == 0)
+		b3BinPredicate predicate;
+		predicate.centers = centers;
+		predicate.axis = bestAxis;
+		predicate.lower = lower;
+		predicate.scale = scalar(binCount) / extent;
+		predicate.binCount = binCount;
+		predicate.splitBin = bestBin;
+
+		middle = u32(std::partition(ids + begin, ids + end, predicate) - ids);
+	}
+	else
 	{
-		// Choose median.
-		middle = (left + right) / 2;
+		// All the centers are coincident. 
+		// Split in the middle to respect the leaf size.
+		middle = begin + n / 2;
 	}
 
+	B3_ASSERT(begin < middle && middle < end);
 	return middle;
 }
 
-void b3StaticTree::BuildRecursively(const b3AABB* set, b3Node* node, u32* ids, u32 count, u32 minObjectsPerLeaf, u32 nodeCapacity, u32& leafCount, u32& internalCount)
+u32 b3StaticTreeBuilder::BuildSubtree(b3Node* nodes, u32 begin, u32 end) const
 {
-	B3_ASSERT(count > 0);
-	
-	// Enclose set
-	b3AABB setAABB = set[ids[0]];
-	for (u32 i = 1; i < count; ++i)
+	u32 nodeCount = 0;
+
+	// The nodes are created in depth-first order using an explicit stack, 
+	// so deep trees can't overflow the call stack.
+	b3Stack<b3TreeBuildTask, 256> stack;
+
+	b3TreeBuildTask rootTask;
+	rootTask.begin = begin;
+	rootTask.end = end;
+	rootTask.parent = B3_NULL_NODE_S;
+	stack.Push(rootTask);
+
+	while (stack.IsEmpty() == false)
 	{
-		setAABB = b3Combine(setAABB, set[ids[i]]);
+		b3TreeBuildTask task = stack.Top();
+		stack.Pop();
+
+		u32 nodeIndex = nodeCount++;
+		b3Node* node = nodes + nodeIndex;
+
+		if (task.parent != B3_NULL_NODE_S)
+		{
+			nodes[task.parent].child2 = nodeIndex;
+		}
+
+		u32 middle = Partition(&node->aabb, task.begin, task.end);
+		if (middle == 0)
+		{
+			node->index = task.begin;
+			node->count = task.end - task.begin;
+			continue;
+		}
+
+		node->child2 = B3_NULL_NODE_S;
+		node->count = 0;
+
+		// Push the second child first so the first child is the next node.
+		b3TreeBuildTask task2;
+		task2.begin = middle;
+		task2.end = task.end;
+		task2.parent = nodeIndex;
+		stack.Push(task2);
+
+		b3TreeBuildTask task1;
+		task1.begin = task.begin;
+		task1.end = middle;
+		task1.parent = B3_NULL_NODE_S;
+		stack.Push(task1);
 	}
 
-	node->aabb = setAABB;
+	return nodeCount;
+}
 
-	if (count <= minObjectsPerLeaf)
+void b3StaticTreeBuilder::SubtreeTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	B3_NOT_USED(workerIndex);
+
+	// The subtree is binned on this worker because an executor can't run a loop from a task.
+	b3StaticTreeBuilder builder = *(b3StaticTreeBuilder*)context;
+	builder.executor = nullptr;
+
+	for (u32 i = begin; i < end; ++i)
 	{
-		++leafCount;
-		node->child1 = B3_NULL_NODE_S;
-		node->index = ids[0];
+		b3TreeBuildItem* item = builder.items + builder.subtreeItems[i];
+
+		u32 n = item->end - item->begin;
+		b3Node* nodes = (b3Node*)b3Alloc((2 * n - 1) * sizeof(b3Node));
+		
+		item->nodeCount = builder.BuildSubtree(nodes, item->begin, item->end);
+		item->nodes = nodes;
 	}
-	else
+}
+
+u32 b3StaticTreeBuilder::Build(b3Node* nodes, u32 count)
+{
+	if (executor == nullptr || count < b3_minParallelTreeBuildCount)
 	{
-		++internalCount;
+		return BuildSubtree(nodes, 0, count);
+	}
+
+	u32 workerCount = executor->GetWorkerCount();
+	workerSets = (b3TreeBinSet*)b3Alloc(workerCount * sizeof(b3TreeBinSet));
+
+	// Build the top of the tree until the subtrees are small enough 
+	// to be balanced across the workers. 
+	// The top is built in the same order as a serial build.
+	u32 subtreeSize = b3Max(count / (b3_treeSubtreesPerWorker * workerCount), maxLeafSize);
+
+	b3StackArray<b3TreeBuildItem, 256> topItems;
+	b3StackArray<u32, 256> topSubtreeItems;
+
+	b3Stack<b3TreeBuildTask, 256> stack;
+
+	b3TreeBuildTask rootTask;
+	rootTask.begin = 0;
+	rootTask.end = count;
+	rootTask.parent = B3_NULL_NODE_S;
+	stack.Push(rootTask);
+
+	while (stack.IsEmpty() == false)
+	{
+		b3TreeBuildTask task = stack.Top();
+		stack.Pop();
+
+		u32 itemIndex = topItems.Count();
+		
+		b3TreeBuildItem item;
+		item.begin = task.begin;
+		item.end = task.end;
+		item.child2 = B3_NULL_NODE_S;
+		item.isSubtree = false;
+		item.nodeStart = 0;
+		item.nodeCount = 1;
+		item.nodes = nullptr;
+
+		if (task.parent != B3_NULL_NODE_S)
+		{
+			topItems[task.parent].child2 = itemIndex;
+		}
+
+		if (task.end - task.begin <= subtreeSize)
+		{
+			item.isSubtree = true;
+			topItems.PushBack(item);
+			topSubtreeItems.PushBack(itemIndex);
+			continue;
+		}
+
+		u32 middle = Partition(&item.aabb, task.begin, task.end);
+		B3_ASSERT(middle > 0);
+
+		topItems.PushBack(item);
+
+		b3TreeBuildTask task2;
+		task2.begin = middle;
+		task2.end = task.end;
+		task2.parent = itemIndex;
+		stack.Push(task2);
 
-		// Partition current set
-		u32 middle = b3Partition(setAABB, set, ids, count);
+		b3TreeBuildTask task1;
+		task1.begin = task.begin;
+		task1.end = middle;
+		task1.parent = B3_NULL_NODE_S;
+		stack.Push(task1);
+	}
+
+	// Build the subtrees in parallel. 
+	// The subtrees partition disjoint ranges of proxies.
+	items = topItems.Begin();
+	subtreeItems = topSubtreeItems.Begin();
+
+	executor->ParallelFor(topSubtreeItems.Count(), 1, SubtreeTask, this);
+
+	// Place the items in depth-first order.
+	u32 nodeCount = 0;
+	for (u32 i = 0; i < topItems.Count(); ++i)
+	{
+		topItems[i].nodeStart = nodeCount;
+		nodeCount += topItems[i].nodeCount;
+	}
 
-		// Allocate left subtree
-		B3_ASSERT(m_nodeCount < nodeCapacity);
-		node->child1 = m_nodeCount;
-		++m_nodeCount;
+	for (u32 i = 0; i < topItems.Count(); ++i)
+	{
+		b3TreeBuildItem* item = topItems.Get(i);
+		b3Node* node = nodes + item->nodeStart;
 
-		// Allocate right subtree
-		B3_ASSERT(m_nodeCount < nodeCapacity);
-		node->child2 = m_nodeCount;
-		++m_nodeCount;
+		if (item->isSubtree)
+		{
+			const b3Node* subtreeNodes = (b3Node*)item->nodes;
+			for (u32 j = 0; j < item->nodeCount; ++j)
+			{
+				node[j] = subtreeNodes[j];
+				if (node[j].IsLeaf() == false)
+				{
+					node[j].child2 += item->nodeStart;
+				}
+			}
 
-		// Build left and right subtrees
-		BuildRecursively(set, m_nodes + node->child1, ids, middle, minObjectsPerLeaf, nodeCapacity, leafCount, internalCount);
-		BuildRecursively(set, m_nodes + node->child2, ids + middle, count - middle, minObjectsPerLeaf, nodeCapacity, leafCount, internalCount);
+			b3Free(item->nodes);
+		}
+		else
+		{
+			node->aabb = item->aabb;
+			node->child2 = topItems[item->child2].nodeStart;
+			node->count = 0;
+		}
 	}
+
+	b3Free(workerSets);
+	workerSets = nullptr;
+
+	return nodeCount;
+}
+
+void b3StaticTree::Build(const b3AABB* aabbs, u32 count)
+{
+	b3StaticTreeDef def;
+	Build(aabbs, count, def);
 }
 
-void b3StaticTree::Build(const b3AABB* set, u32 count)
+void b3StaticTree::Build(const b3AABB* aabbs, u32 count, const b3StaticTreeDef& def, b3StaticTreeStats* stats)
 {
 	B3_ASSERT(m_nodes == nullptr && m_nodeCount == 0);
+	B3_ASSERT(m_blob == nullptr);
 	B3_ASSERT(count > 0);
+	B3_ASSERT(def.maxLeafSize > 0);
+	B3_ASSERT(def.binCount > 1 && def.binCount <= b3_maxStaticTreeBins);
+	B3_ASSERT(def.quantize == false || def.wide == false);
+	B3_ASSERT((def.quantize == false && def.wide == false) || (def.maxLeafSize <= b3_maxCompressedLeafSize && count <= b3_maxCompressedProxyCount));
 
 	u32* ids = (u32*)b3Alloc(count * sizeof(u32));
+	b3Vec3* centers = (b3Vec3*)b3Alloc(count * sizeof(b3Vec3));
 	for (u32 i = 0; i < count; ++i)
 	{
 		ids[i] = i;
+		centers[i] = aabbs[i].GetCenter();
 	}
 
-	// Leafs = n, Internals = n - 1, Total = 2n - 1, if we assume
-	// each leaf node contains exactly 1 object.
-	const u32 kMinObjectsPerLeaf = 1;
-
-	u32 internalCapacity = count - 1;
-	u32 leafCapacity = count;
+	// A binary tree has at most 2n - 1 nodes if each leaf has at least one proxy.
 	u32 nodeCapacity = 2 * count - 1;
+	b3Node* nodes = (b3Node*)b3Alloc(nodeCapacity * sizeof(b3Node));
+
+	b3StaticTreeBuilder builder;
+	builder.aabbs = aabbs;
+	builder.centers = centers;
+	builder.ids = ids;
+	builder.maxLeafSize = def.maxLeafSize;
+	builder.binCount = def.binCount;
+	builder.executor = def.executor;
+	builder.workerSets = nullptr;
+	builder.items = nullptr;
+	builder.subtreeItems = nullptr;
+
+	u32 nodeCount = builder.Build(nodes, count);
+	B3_ASSERT(nodeCount <= nodeCapacity);
 
-	u32 internalCount = 0;
-	u32 leafCount = 0;
+	b3Free(centers);
 
+	// Shrink the node array to fit.
 	m_root = 0;
-	m_nodes = (b3Node*)b3Alloc(nodeCapacity * sizeof(b3Node));
-	m_nodeCount = 1;
+	m_nodeCount = nodeCount;
+	m_nodes = (b3Node*)b3Alloc(m_nodeCount * sizeof(b3Node));
+	memcpy(m_nodes, nodes, m_nodeCount * sizeof(b3Node));
+	b3Free(nodes);
 
-	BuildRecursively(set, m_nodes, ids, count, kMinObjectsPerLeaf, nodeCapacity, leafCount, internalCount);
+	// Store the proxies in leaf order.
+	m_proxyCount = count;
+	m_proxyIndices = ids;
+	m_proxyAABBs = (b3AABB*)b3Alloc(m_proxyCount * sizeof(b3AABB));
+	for (u32 i = 0; i < m_proxyCount; ++i)
+	{
+		m_proxyAABBs[i] = aabbs[ids[i]];
+	}
 
-	b3Free(ids);
+	if (stats)
+	{
+		ComputeStats(stats, def.traversalCost);
+	}
+
+	if (def.quantize)
+	{
+		Quantize();
+	}
 
-	B3_ASSERT(leafCount == leafCapacity);
-	B3_ASSERT(internalCount == internalCapacity);
-	B3_ASSERT(m_nodeCount == nodeCapacity);
+	if (def.wide)
+	{
+		Widen();
+	}
+}
+
+// Quantize the lower bound of an AABB relative to the lower bound of its parent. 
+// The result is rounded down, so the decoded bound is never above the bound.
+static u16 b3QuantizeLower(scalar parentLower, scalar scale, scalar lower)
+{
+	if (scale <= scalar(0))
+	{
+		return 0;
+	}
+
+	// Leave a margin of one step for the rounding of the decoding.
+	scalar distance = (lower - parentLower) / scale;
+	u32 q = distance > scalar(1) ? u32(distance) - 1 : 0;
+	q = b3Min(q, u32(B3_MAX_U16));
+
+	while (q > 0 && parentLower + scale * scalar(q) > lower)
+	{
+		--q;
+	}
+
+	return u16(q);
+}
+
+// Quantize the upper bound of an AABB relative to the upper bound of its parent.
+// The result is rounded down, so the decoded bound is never below the bound.
+static u16 b3QuantizeUpper(scalar parentUpper, scalar scale, scalar upper)
+{
+	if (scale <= scalar(0))
+	{
+		return 0;
+	}
+
+	scalar distance = (parentUpper - upper) / scale;
+	u32 q = distance > scalar(1) ? u32(distance) - 1 : 0;
+	q = b3Min(q, u32(B3_MAX_U16));
+
+	while (q > 0 && parentUpper - scale * scalar(q) < upper)
+	{
+		--q;
+	}
+
+	return u16(q);
+}
+
+static void b3Quantize(u16 lower[3], u16 upper[3], const b3AABB& parent, const b3Vec3& scale, const b3AABB& aabb)
+{
+	for (u32 i = 0; i < 3; ++i)
+	{
+		lower[i] = b3QuantizeLower(parent.lowerBound[i], scale[i], aabb.lowerBound[i]);
+		upper[i] = b3QuantizeUpper(parent.upperBound[i], scale[i], aabb.upperBound[i]);
+	}
+}
+
+void b3StaticTree::Quantize()
+{
+	m_rootAABB = m_nodes[m_root].aabb;
+
+	m_quantizedNodes = (b3QuantizedNode*)b3Alloc(m_nodeCount * sizeof(b3QuantizedNode));
+	
+	// Each node is quantized relative to the decoded AABB of its parent.
+	// The root is quantized relative to itself.
+	b3Stack<b3QuantizedStackNode, 256> stack;
+
+	b3QuantizedStackNode root;
+	root.node = m_root;
+	root.aabb = m_rootAABB;
+	stack.Push(root);
+
+	while (stack.IsEmpty() == false)
+	{
+		b3QuantizedStackNode stackNode = stack.Top();
+		stack.Pop();
+
+		const b3Node* node = m_nodes + stackNode.node;
+		b3QuantizedNode* quantizedNode = m_quantizedNodes + stackNode.node;
+
+		b3Vec3 scale = GetQuantizationScale(stackNode.aabb);
+		b3Quantize(quantizedNode->aabb.lower, quantizedNode->aabb.upper, stackNode.aabb, scale, node->aabb);
+
+		b3AABB aabb = Decode(stackNode.aabb, scale, quantizedNode->aabb);
+		B3_ASSERT(aabb.Contains(node->aabb));
+
+		if (node->IsLeaf())
+		{
+			quantizedNode->data = 0x80000000 | PackLeaf(node->index, node->count);
+		}
+		else
+		{
+			quantizedNode->data = node->child2;
+			
+			b3QuantizedStackNode stackNode1;
+			stackNode1.node = stackNode.node + 1;
+			stackNode1.aabb = aabb;
+			stack.Push(stackNode1);
+
+			b3QuantizedStackNode stackNode2;
+			stackNode2.node = node->child2;
+			stackNode2.aabb = aabb;
+			stack.Push(stackNode2);
+		}
+	}
+
+	// The proxies are quantized relative to the root.
+	b3Vec3 rootScale = GetQuantizationScale(m_rootAABB);
+
+	m_quantizedProxyAABBs = (b3QuantizedAABB*)b3Alloc(m_proxyCount * sizeof(b3QuantizedAABB));
+	for (u32 i = 0; i < m_proxyCount; ++i)
+	{
+		b3QuantizedAABB* proxyAABB = m_quantizedProxyAABBs + i;
+		b3Quantize(proxyAABB->lower, proxyAABB->upper, m_rootAABB, rootScale, m_proxyAABBs[i]);
+		B3_ASSERT(GetAABB(i).Contains(m_proxyAABBs[i]));
+	}
+
+	b3Free(m_nodes);
+	m_nodes = nullptr;
+
+	b3Free(m_proxyAABBs);
+	m_proxyAABBs = nullptr;
+}
+
+void b3StaticTree::ComputeStats(b3StaticTreeStats* stats, scalar traversalCost) const
+{
+	stats->sahCost = scalar(0);
+	stats->depth = 0;
+	stats->nodeCount = m_nodeCount;
+	stats->leafCount = 0;
+
+	if (m_nodeCount == 0)
+	{
+		return;
+	}
+
+	scalar rootArea = m_nodes[m_root].aabb.GetSurfaceArea();
+	scalar cost = scalar(0);
+
+	struct b3StackNode
+	{
+		u32 node;
+		u32 depth;
+	};
+
+	b3Stack<b3StackNode, 256> stack;
+	
+	b3StackNode root;
+	root.node = m_root;
+	root.depth = 0;
+	stack.Push(root);
+
+	while (stack.IsEmpty() == false)
+	{
+		b3StackNode stackNode = stack.Top();
+		stack.Pop();
+
+		const b3Node* node = m_nodes + stackNode.node;
+		scalar area = node->aabb.GetSurfaceArea();
+
+		if (node->IsLeaf())
+		{
+			++stats->leafCount;
+			stats->depth = b3Max(stats->depth, stackNode.depth);
+			cost += scalar(node->count) * area;
+		}
+		else
+		{
+			cost += traversalCost * area;
+
+			b3StackNode child1;
+			child1.node = stackNode.node + 1;
+			child1.depth = stackNode.depth + 1;
+			stack.Push(child1);
+
+			b3StackNode child2;
+			child2.node = node->child2;
+			child2.depth = stackNode.depth + 1;
+			stack.Push(child2);
+		}
+	}
+
+	stats->sahCost = rootArea > scalar(0) ? cost / rootArea : scalar(0);
+}
+
+void b3StaticTree::Widen()
+{
+	b3WideTreeSourceNode* sourceNodes = (b3WideTreeSourceNode*)b3Alloc(m_nodeCount * sizeof(b3WideTreeSourceNode));
+	for (u32 i = 0; i < m_nodeCount; ++i)
+	{
+		const b3Node* node = m_nodes + i;
+		b3WideTreeSourceNode* sourceNode = sourceNodes + i;
+
+		sourceNode->aabb = node->aabb;
+		if (node->IsLeaf())
+		{
+			sourceNode->child1 = B3_NULL_NODE_W;
+			sourceNode->child2 = B3_NULL_NODE_W;
+			sourceNode->leaf = PackLeaf(node->index, node->count);
+		}
+		else
+		{
+			sourceNode->child1 = i + 1;
+			sourceNode->child2 = node->child2;
+			sourceNode->leaf = 0;
+		}
+	}
+
+	m_wideTree.Build(sourceNodes, m_nodeCount, m_root);
+
+	b3Free(sourceNodes);
+
+	b3Free(m_nodes);
+	m_nodes = nullptr;
+}
+
+// The header of a tree blob. 
+// The nodes, proxy AABBs and proxy indices follow in aligned sections.
+struct b3StaticTreeBlob
+{
+	u32 format;
+	u32 nodeSize;
+	u32 nodeCount;
+	u32 nodesOffset;
+	u32 nodesSize;
+	u32 proxyAABBSize;
+	u32 proxyCount;
+	u32 proxyAABBsOffset;
+	u32 proxyIndicesOffset;
+	u32 reserved; // Keeps the header free of padding for any scalar type.
+	b3AABB rootAABB;
+};
+
+// The node formats of a tree blob.
+enum b3StaticTreeBlobFormat
+{
+	e_binaryTreeBlob = 0,
+	e_quantizedTreeBlob = 1,
+	e_wideTreeBlob = 2
+};
+
+u32 b3StaticTree::GetBlobSize() const
+{
+	u32 proxyAABBSize = m_quantizedNodes ? sizeof(b3QuantizedAABB) : sizeof(b3AABB);
+
+	u32 size = b3AlignBlob(sizeof(b3StaticTreeBlob));
+	if (m_quantizedNodes)
+	{
+		size += b3AlignBlob(m_nodeCount * sizeof(b3QuantizedNode));
+	}
+	else if (m_wideTree.GetNodeCount() > 0)
+	{
+		size += m_wideTree.GetBlobSize();
+	}
+	else
+	{
+		size += b3AlignBlob(m_nodeCount * sizeof(b3Node));
+	}
+	size += b3AlignBlob(m_proxyCount * proxyAABBSize);
+	size += b3AlignBlob(m_proxyCount * sizeof(u32));
+	return size;
+}
+
+void b3StaticTree::WriteBlob(void* blob) const
+{
+	B3_ASSERT(b3IsBlobAligned(blob));
+
+	u8* bytes = (u8*)blob;
+
+	// Clear the padding so that equal trees give equal blobs.
+	memset(bytes, 0, GetBlobSize());
+
+	bool wide = m_wideTree.GetNodeCount() > 0;
+
+	b3StaticTreeBlob header = {};
+	header.rootAABB.lowerBound.SetZero();
+	header.rootAABB.upperBound.SetZero();
+	if (m_quantizedNodes)
+	{
+		header.format = e_quantizedTreeBlob;
+		header.nodeSize = sizeof(b3QuantizedNode);
+		header.nodesSize = b3AlignBlob(m_nodeCount * sizeof(b3QuantizedNode));
+		header.rootAABB = m_rootAABB;
+	}
+	else if (wide)
+	{
+		// The nodes are a wide tree blob.
+		header.format = e_wideTreeBlob;
+		header.nodeSize = 0;
+		header.nodesSize = m_wideTree.GetBlobSize();
+	}
+	else
+	{
+		header.format = e_binaryTreeBlob;
+		header.nodeSize = sizeof(b3Node);
+		header.nodesSize = b3AlignBlob(m_nodeCount * sizeof(b3Node));
+	}
+	header.nodeCount = m_nodeCount;
+	header.nodesOffset = b3AlignBlob(sizeof(b3StaticTreeBlob));
+	header.proxyAABBSize = m_quantizedNodes ? sizeof(b3QuantizedAABB) : sizeof(b3AABB);
+	header.proxyCount = m_proxyCount;
+	header.proxyAABBsOffset = header.nodesOffset + header.nodesSize;
+	header.proxyIndicesOffset = header.proxyAABBsOffset + b3AlignBlob(m_proxyCount * header.proxyAABBSize);
+
+	const void* proxyAABBs = m_quantizedNodes ? (const void*)m_quantizedProxyAABBs : (const void*)m_proxyAABBs;
+
+	memcpy(bytes, &header, sizeof(b3StaticTreeBlob));
+	if (wide)
+	{
+		m_wideTree.WriteBlob(bytes + header.nodesOffset);
+	}
+	else
+	{
+		const void* nodes = m_quantizedNodes ? (const void*)m_quantizedNodes : (const void*)m_nodes;
+		memcpy(bytes + header.nodesOffset, nodes, m_nodeCount * header.nodeSize);
+	}
+	memcpy(bytes + header.proxyAABBsOffset, proxyAABBs, m_proxyCount * header.proxyAABBSize);
+	memcpy(bytes + header.proxyIndicesOffset, m_proxyIndices, m_proxyCount * sizeof(u32));
+}
+
+bool b3StaticTree::CheckNodes(const b3Node* nodes, const b3QuantizedNode* quantizedNodes, u32 nodeCount, u32 proxyCount)
+{
+	if (nodeCount == 0)
+	{
+		return true;
+	}
+
+	// The nodes are stored in depth-first order. 
+	// The first child of an internal node is the next node and 
+	// the second child is stored after it.
+	bool* visited = (bool*)b3Alloc(nodeCount * sizeof(bool));
+	memset(visited, 0, nodeCount * sizeof(bool));
+
+	b3Stack<u32, 256> stack;
+	stack.Push(0);
+
+	bool valid = true;
+	u32 visitCount = 0;
+	while (stack.IsEmpty() == false)
+	{
+		u32 nodeIndex = stack.Top();
+		stack.Pop();
+
+		if (visited[nodeIndex])
+		{
+			valid = false;
+			break;
+		}
+
+		visited[nodeIndex] = true;
+		++visitCount;
+
+		bool isLeaf;
+		u32 child2, index, count;
+		if (quantizedNodes)
+		{
+			const b3QuantizedNode* node = quantizedNodes + nodeIndex;
+			isLeaf = node->IsLeaf();
+			child2 = node->GetChild2();
+			index = node->GetIndex();
+			count = node->GetCount();
+		}
+		else
+		{
+			const b3Node* node = nodes + nodeIndex;
+			isLeaf = node->IsLeaf();
+			child2 = node->child2;
+			index = node->index;
+			count = node->count;
+		}
+
+		if (isLeaf)
+		{
+			if (u64(index) + count > proxyCount)
+			{
+				valid = false;
+				break;
+			}
+			continue;
+		}
+
+		u32 child1 = nodeIndex + 1;
+		if (child1 >= nodeCount || child2 <= child1 || child2 >= nodeCount)
+		{
+			valid = false;
+			break;
+		}
+
+		stack.Push(child2);
+		stack.Push(child1);
+	}
+
+	b3Free(visited);
+
+	return valid && visitCount == nodeCount;
+}
+
+bool b3StaticTree::ReadBlob(const void* blob, u32 size)
+{
+	B3_ASSERT(m_nodes == nullptr && m_nodeCount == 0);
+	B3_ASSERT(m_blob == nullptr);
+
+	if (b3IsBlobAligned(blob) == false || size < sizeof(b3StaticTreeBlob))
+	{
+		return false;
+	}
+
+	const u8* bytes = (const u8*)blob;
+	const b3StaticTreeBlob* header = (const b3StaticTreeBlob*)bytes;
+
+	if (header->format != e_binaryTreeBlob && header->format != e_quantizedTreeBlob && header->format != e_wideTreeBlob)
+	{
+		return false;
+	}
+
+	bool quantized = header->format == e_quantizedTreeBlob;
+	bool wide = header->format == e_wideTreeBlob;
+	u32 nodeSize = quantized ? sizeof(b3QuantizedNode) : wide ? 0 : sizeof(b3Node);
+	u32 proxyAABBSize = quantized ? sizeof(b3QuantizedAABB) : sizeof(b3AABB);
+
+	if (header->nodeSize != nodeSize || header->proxyAABBSize != proxyAABBSize)
+	{
+		return false;
+	}
+
+	if (wide == false && u64(header->nodeCount) * nodeSize > header->nodesSize)
+	{
+		return false;
+	}
+
+	if (b3IsBlobSection(header->nodesOffset, header->nodesSize, size) == false ||
+		b3IsBlobSection(header->proxyAABBsOffset, u64(header->proxyCount) * proxyAABBSize, size) == false ||
+		b3IsBlobSection(header->proxyIndicesOffset, u64(header->proxyCount) * sizeof(u32), size) == false)
+	{
+		return false;
+	}
+
+	// The proxy indices are the indices of the AABBs passed to Build.
+	const u32* proxyIndices = (const u32*)(bytes + header->proxyIndicesOffset);
+	for (u32 i = 0; i < header->proxyCount; ++i)
+	{
+		if (proxyIndices[i] >= header->proxyCount)
+		{
+			return false;
+		}
+	}
+
+	if (wide)
+	{
+		if (m_wideTree.ReadBlob(bytes + header->nodesOffset, header->nodesSize) == false)
+		{
+			return false;
+		}
+
+		// The leaves must reference the proxies.
+		struct b3LeafCheck
+		{
+			bool Report(u32 leaf)
+			{
+				return u64(GetLeafIndex(leaf)) + GetLeafCount(leaf) <= proxyCount;
+			}
+
+			u32 proxyCount;
+		};
+
+		b3LeafCheck check;
+		check.proxyCount = header->proxyCount;
+		if (m_wideTree.ReportLeaves(&check) == false)
+		{
+			m_wideTree.Clear();
+			return false;
+		}
+	}
+	else
+	{
+		const u8* nodes = bytes + header->nodesOffset;
+		if (CheckNodes(quantized ? nullptr : (const b3Node*)nodes, quantized ? (const b3QuantizedNode*)nodes : nullptr, 
+			header->nodeCount, header->proxyCount) == false)
+		{
+			return false;
+		}
+	}
+
+	// The blob is never written through these pointers.
+	m_root = header->nodeCount > 0 ? 0 : B3_NULL_NODE_S;
+	m_nodeCount = header->nodeCount;
+	m_proxyCount = header->proxyCount;
+	if (quantized)
+	{
+		m_quantizedNodes = (b3QuantizedNode*)(bytes + header->nodesOffset);
+		m_quantizedProxyAABBs = (b3QuantizedAABB*)(bytes + header->proxyAABBsOffset);
+		m_rootAABB = header->rootAABB;
+	}
+	else if (wide)
+	{
+		m_proxyAABBs = (b3AABB*)(bytes + header->proxyAABBsOffset);
+	}
+	else
+	{
+		m_nodes = (b3Node*)(bytes + header->nodesOffset);
+		m_proxyAABBs = (b3AABB*)(bytes + header->proxyAABBsOffset);
+	}
+	m_proxyIndices = (u32*)(bytes + header->proxyIndicesOffset);
+	m_blob = blob;
+
+	return true;
 }
 
 void b3StaticTree::Draw() const
@@ -175,6 +1218,53 @@ void b3StaticTree::Draw() const
 		return;
 	}
 
+	if (m_wideTree.GetNodeCount() > 0)
+	{
+		m_wideTree.Draw();
+		return;
+	}
+
+	if (m_quantizedNodes)
+	{
+		b3Stack<b3QuantizedStackNode, 256> stack;
+
+		b3QuantizedStackNode root;
+		root.node = m_root;
+		root.aabb = m_rootAABB;
+		stack.Push(root);
+
+		while (!stack.IsEmpty())
+		{
+			b3QuantizedStackNode stackNode = stack.Top();
+
+			stack.Pop();
+
+			const b3QuantizedNode* node = m_quantizedNodes + stackNode.node;
+			if (node->IsLeaf())
+			{
+				b3Draw_draw->DrawAABB(stackNode.aabb, b3Color_pink);
+			}
+			else
+			{
+				b3Draw_draw->DrawAABB(stackNode.aabb, b3Color_red);
+
+				b3Vec3 scale = GetQuantizationScale(stackNode.aabb);
+
+				b3QuantizedStackNode stackNode1;
+				stackNode1.node = stackNode.node + 1;
+				stackNode1.aabb = Decode(stackNode.aabb, scale, m_quantizedNodes[stackNode1.node].aabb);
+				stack.Push(stackNode1);
+
+				b3QuantizedStackNode stackNode2;
+				stackNode2.node = node->GetChild2();
+				stackNode2.aabb = Decode(stackNode.aabb, scale, m_quantizedNodes[stackNode2.node].aabb);
+				stack.Push(stackNode2);
+			}
+		}
+
+		return;
+	}
+
 	b3Stack<u32, 256> stack;
 	stack.Push(m_root);
 
@@ -193,7 +1283,7 @@ void b3StaticTree::Draw() const
 		{
 			b3Draw_draw->DrawAABB(node->aabb, b3Color_red);
 			
-			stack.Push(node->child1);
+			stack.Push(nodeIndex + 1);
 			stack.Push(node->child2);
 		}
 	}
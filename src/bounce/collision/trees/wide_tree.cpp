@@ -0,0 +1,327 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/collision/trees/wide_tree.h>
+#include <bounce/common/template/stack.h>
+#include <bounce/common/draw.h>
+#include <string.h>
+
+b3WideTree::b3WideTree()
+{
+	m_nodeCount = 0;
+	m_nodes = nullptr;
+	m_blob = nullptr;
+}
+
+b3WideTree::~b3WideTree()
+{
+	Clear();
+}
+
+void b3WideTree::Clear()
+{
+	if (m_blob == nullptr)
+	{
+		b3Free(m_nodes);
+	}
+	m_nodeCount = 0;
+	m_nodes = nullptr;
+	m_blob = nullptr;
+}
+
+// A binary node to collapse into a wide node.
+struct b3WideTreeBuildTask
+{
+	u32 source;
+	u32 node;
+};
+
+void b3WideTree::Build(const b3WideTreeSourceNode* nodes, u32 nodeCount, u32 root)
+{
+	Clear();
+
+	if (root == B3_NULL_NODE_W)
+	{
+		return;
+	}
+
+	// A wide node replaces at least one internal binary node. 
+	// The number of internal nodes is less than the number of nodes.
+	u32 nodeCapacity = b3Max(nodeCount / 2, u32(1));
+	b3WideNode* wideNodes = (b3WideNode*)b3Alloc(nodeCapacity * sizeof(b3WideNode));
+	u32 wideNodeCount = 1;
+
+	b3Stack<b3WideTreeBuildTask, 256> stack;
+
+	b3WideTreeBuildTask rootTask;
+	rootTask.source = root;
+	rootTask.node = 0;
+	stack.Push(rootTask);
+
+	while (stack.IsEmpty() == false)
+	{
+		b3WideTreeBuildTask task = stack.Top();
+		stack.Pop();
+
+		const b3WideTreeSourceNode* source = nodes + task.source;
+
+		// Collect the children of the wide node. 
+		// Open the internal child with the largest area until the node is full.
+		u32 children[b3_wideTreeWidth];
+		u32 childCount = 0;
+
+		if (source->IsLeaf())
+		{
+			// The root is a leaf.
+			children[childCount++] = task.source;
+		}
+		else
+		{
+			children[childCount++] = source->child1;
+			children[childCount++] = source->child2;
+		}
+
+		while (childCount < b3_wideTreeWidth)
+		{
+			u32 bestIndex = B3_NULL_NODE_W;
+			scalar bestArea = -B3_MAX_SCALAR;
+			for (u32 i = 0; i < childCount; ++i)
+			{
+				const b3WideTreeSourceNode* child = nodes + children[i];
+				if (child->IsLeaf())
+				{
+					continue;
+				}
+
+				scalar area = child->aabb.GetSurfaceArea();
+				if (area > bestArea)
+				{
+					bestArea = area;
+					bestIndex = i;
+				}
+			}
+
+			if (bestIndex == B3_NULL_NODE_W)
+			{
+				break;
+			}
+
+			const b3WideTreeSourceNode* best = nodes + children[bestIndex];
+			children[bestIndex] = best->child1;
+			children[childCount++] = best->child2;
+		}
+
+		b3WideNode* node = wideNodes + task.node;
+		for (u32 lane = 0; lane < b3_wideTreeWidth; ++lane)
+		{
+			if (lane >= childCount)
+			{
+				// Empty AABB
+				node->lowerX[lane] = B3_MAX_SCALAR;
+				node->lowerY[lane] = B3_MAX_SCALAR;
+				node->lowerZ[lane] = B3_MAX_SCALAR;
+				node->upperX[lane] = -B3_MAX_SCALAR;
+				node->upperY[lane] = -B3_MAX_SCALAR;
+				node->upperZ[lane] = -B3_MAX_SCALAR;
+				node->children[lane] = B3_NULL_NODE_W;
+				continue;
+			}
+
+			const b3WideTreeSourceNode* child = nodes + children[lane];
+			
+			node->lowerX[lane] = child->aabb.lowerBound.x;
+			node->lowerY[lane] = child->aabb.lowerBound.y;
+			node->lowerZ[lane] = child->aabb.lowerBound.z;
+			node->upperX[lane] = child->aabb.upperBound.x;
+			node->upperY[lane] = child->aabb.upperBound.y;
+			node->upperZ[lane] = child->aabb.upperBound.z;
+
+			if (child->IsLeaf())
+			{
+				B3_ASSERT(child->leaf <= b3_maxWideTreeLeaf);
+				node->children[lane] = 0x80000000 | child->leaf;
+			}
+			else
+			{
+				B3_ASSERT(wideNodeCount < nodeCapacity);
+				
+				b3WideTreeBuildTask childTask;
+				childTask.source = children[lane];
+				childTask.node = wideNodeCount++;
+				stack.Push(childTask);
+
+				node->children[lane] = childTask.node;
+			}
+		}
+	}
+
+	// Shrink the node array to fit.
+	m_nodeCount = wideNodeCount;
+	m_nodes = (b3WideNode*)b3Alloc(m_nodeCount * sizeof(b3WideNode));
+	memcpy(m_nodes, wideNodes, m_nodeCount * sizeof(b3WideNode));
+	b3Free(wideNodes);
+}
+
+// The header of a wide tree blob. The nodes follow in an aligned section.
+struct b3WideTreeBlob
+{
+	u32 width;
+	u32 nodeSize;
+	u32 nodeCount;
+	u32 nodesOffset;
+};
+
+u32 b3WideTree::GetBlobSize() const
+{
+	u32 size = b3AlignBlob(sizeof(b3WideTreeBlob));
+	size += b3AlignBlob(m_nodeCount * sizeof(b3WideNode));
+	return size;
+}
+
+void b3WideTree::WriteBlob(void* blob) const
+{
+	B3_ASSERT(b3IsBlobAligned(blob));
+
+	u8* bytes = (u8*)blob;
+
+	// Clear the padding so that equal trees give equal blobs.
+	memset(bytes, 0, GetBlobSize());
+
+	b3WideTreeBlob header;
+	header.width = b3_wideTreeWidth;
+	header.nodeSize = sizeof(b3WideNode);
+	header.nodeCount = m_nodeCount;
+	header.nodesOffset = b3AlignBlob(sizeof(b3WideTreeBlob));
+
+	memcpy(bytes, &header, sizeof(b3WideTreeBlob));
+	memcpy(bytes + header.nodesOffset, m_nodes, m_nodeCount * sizeof(b3WideNode));
+}
+
+bool b3WideTree::ReadBlob(const void* blob, u32 size)
+{
+	B3_ASSERT(m_nodes == nullptr && m_blob == nullptr);
+
+	if (b3IsBlobAligned(blob) == false || size < sizeof(b3WideTreeBlob))
+	{
+		return false;
+	}
+
+	const u8* bytes = (const u8*)blob;
+	const b3WideTreeBlob* header = (const b3WideTreeBlob*)bytes;
+
+	// The width depends on the SIMD instruction set.
+	if (header->width != b3_wideTreeWidth || header->nodeSize != sizeof(b3WideNode))
+	{
+		return false;
+	}
+
+	if (b3IsBlobSection(header->nodesOffset, u64(header->nodeCount) * sizeof(b3WideNode), size) == false)
+	{
+		return false;
+	}
+
+	// The nodes must form a tree so that the queries terminate and stay in the blob.
+	// A child node is stored after its parent.
+	const b3WideNode* nodes = (const b3WideNode*)(bytes + header->nodesOffset);
+	u32 nodeCount = header->nodeCount;
+	
+	bool valid = true;
+	u32 visitCount = 0;
+	if (nodeCount > 0)
+	{
+		bool* visited = (bool*)b3Alloc(nodeCount * sizeof(bool));
+		memset(visited, 0, nodeCount * sizeof(bool));
+
+		b3Stack<u32, 256> stack;
+		stack.Push(0);
+
+		while (stack.IsEmpty() == false)
+		{
+			u32 nodeIndex = stack.Top();
+			stack.Pop();
+
+			if (visited[nodeIndex])
+			{
+				valid = false;
+				break;
+			}
+
+			visited[nodeIndex] = true;
+			++visitCount;
+
+			const b3WideNode* node = nodes + nodeIndex;
+			for (u32 lane = 0; lane < b3_wideTreeWidth; ++lane)
+			{
+				u32 child = node->children[lane];
+				if (child == B3_NULL_NODE_W || IsLeaf(child))
+				{
+					continue;
+				}
+
+				if (child <= nodeIndex || child >= nodeCount)
+				{
+					valid = false;
+					break;
+				}
+
+				stack.Push(child);
+			}
+
+			if (valid == false)
+			{
+				break;
+			}
+		}
+
+		b3Free(visited);
+	}
+
+	if (valid == false || visitCount != nodeCount)
+	{
+		return false;
+	}
+
+	// The blob is never written through this pointer.
+	m_nodeCount = header->nodeCount;
+	m_nodes = (b3WideNode*)(bytes + header->nodesOffset);
+	m_blob = blob;
+
+	return true;
+}
+
+void b3WideTree::Draw() const
+{
+	for (u32 i = 0; i < m_nodeCount; ++i)
+	{
+		const b3WideNode* node = m_nodes + i;
+		for (u32 lane = 0; lane < b3_wideTreeWidth; ++lane)
+		{
+			u32 child = node->children[lane];
+			if (child == B3_NULL_NODE_W)
+			{
+				continue;
+			}
+
+			b3AABB aabb;
+			aabb.lowerBound.Set(node->lowerX[lane], node->lowerY[lane], node->lowerZ[lane]);
+			aabb.upperBound.Set(node->upperX[lane], node->upperY[lane], node->upperZ[lane]);
+
+			b3Draw_draw->DrawAABB(aabb, IsLeaf(child) ? b3Color_pink : b3Color_red);
+		}
+	}
+}
@@ -20,6 +20,9 @@
 #include <bounce/common/math/mat33.h>
 #include <bounce/common/math/mat44.h>
 #include <bounce/common/math/transform.h>
+#include <bounce/common/math/simd.h>
+
+const u32 b3_simdWidth = B3_SIMD_WIDTH;
 
 const b3Vec2 b3Vec2_zero(scalar(0), scalar(0));
 const b3Vec2 b3Vec2_x(scalar(1), scalar(0));
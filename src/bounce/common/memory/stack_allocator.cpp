@@ -17,20 +17,33 @@
 */
 
 #include <bounce/common/memory/stack_allocator.h>
+#include <bounce/common/math/math.h>
 #include <string.h>
 
+// Keep the blocks aligned for SIMD loads.
+static const u32 b3_stackAlignment = 16;
+
 b3StackAllocator::b3StackAllocator() 
 {
 	m_blockCapacity = 256;
 	m_blocks = (b3Block*)b3Alloc(m_blockCapacity * sizeof(b3Block));
 	m_blockCount = 0;
-	m_allocatedSize = 0;
+	m_chunks = nullptr;
+	m_chunk = nullptr;
+	m_capacity = 0;
 }
 
 b3StackAllocator::~b3StackAllocator() 
 {
-	B3_ASSERT(m_allocatedSize == 0);
 	B3_ASSERT(m_blockCount == 0);
+	b3Chunk* c = m_chunks;
+	while (c)
+	{
+		B3_ASSERT(c->allocatedSize == 0);
+		b3Chunk* next = c->next;
+		b3Free(c);
+		c = next;
+	}
 	b3Free(m_blocks);
 }
 
@@ -46,22 +59,50 @@ void* b3StackAllocator::Allocate(u32 size)
 		b3Free(oldBlocks);
 	}
 
-	b3Block* block = m_blocks + m_blockCount;
-	block->size = size;
-	if (m_allocatedSize + size > b3_maxStackSize) 
-	{
-		// Allocate with parent allocator.
-		block->data = (u8*) b3Alloc(size);
-		block->parent = true;
-	}
-	else 
+	size = (size + b3_stackAlignment - 1) & ~(b3_stackAlignment - 1);
+
+	b3Chunk* c = m_chunk;
+	if (c == nullptr || c->allocatedSize + size > c->capacity)
 	{
-		// Use this stack memory.
-		block->data = m_memory + m_allocatedSize;
-		block->parent = false;
-		m_allocatedSize += size;
+		// Move to the next chunk. 
+		// The chunks after the current one are empty.
+		b3Chunk** link = c && c->allocatedSize > 0 ? &c->next : &m_chunks;
+		
+		while (*link && (*link)->capacity < size)
+		{
+			// Remove the empty chunk that is too small.
+			b3Chunk* small = *link;
+			*link = small->next;
+			m_capacity -= small->capacity;
+			b3Free(small);
+		}
+
+		if (*link == nullptr)
+		{
+			// Grow geometrically so that only a few chunks are needed.
+			u32 capacity = b3Max(b3_stackChunkSize, m_capacity);
+			capacity = b3Max(capacity, size);
+
+			b3Chunk* chunk = (b3Chunk*)b3Alloc(sizeof(b3Chunk) + capacity + b3_stackAlignment);
+			chunk->memory = (u8*)(((uintptr_t)(chunk + 1) + b3_stackAlignment - 1) & ~(uintptr_t)(b3_stackAlignment - 1));
+			chunk->capacity = capacity;
+			chunk->allocatedSize = 0;
+			chunk->next = nullptr;
+			m_capacity += capacity;
+
+			*link = chunk;
+		}
+
+		c = *link;
 	}
+
+	b3Block* block = m_blocks + m_blockCount;
+	block->size = size;
+	block->data = c->memory + c->allocatedSize;
+	block->chunk = c;
+	c->allocatedSize += size;
 	
+	m_chunk = c;
 	++m_blockCount;
 
 	return block->data;
@@ -69,16 +110,14 @@ void* b3StackAllocator::Allocate(u32 size)
 
 void b3StackAllocator::Free(void* p) 
 {
+	B3_NOT_USED(p);
+
 	B3_ASSERT(m_blockCount > 0);
 	b3Block* block = m_blocks + m_blockCount - 1;
 	B3_ASSERT(block->data == p);
-	if (block->parent) 
-	{
-		b3Free(p);
-	}
-	else 
-	{
-		m_allocatedSize -= block->size;
-	}
+	block->chunk->allocatedSize -= block->size;
 	--m_blockCount;
+
+	// Return to the chunk of the previous block.
+	m_chunk = m_blockCount > 0 ? m_blocks[m_blockCount - 1].chunk : m_chunks;
 }
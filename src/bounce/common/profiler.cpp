@@ -19,7 +19,7 @@
 #include <bounce/common/profiler.h>
 #include <bounce/common/math/math.h>
 
-b3Profiler* b3Profiler_profiler = nullptr;
+thread_local b3Profiler* b3Profiler_profiler = nullptr;
 
 b3Profiler::b3Profiler() : m_nodePool(sizeof(b3ProfilerNode))
 {
@@ -19,19 +19,21 @@
 #include <bounce/common/settings.h>
 #include <bounce/common/common.h>
 #include <bounce/common/math/math.h>
+#include <bounce/common/stats.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 
-u32 b3_allocCalls = 0;
-u32 b3_maxAllocCalls = 0;
-
 b3Version b3_version = { 0, 0, 0 };
 
+thread_local void* b3_allocContext = nullptr;
+
 void* b3Alloc_Default(u32 size) 
 {
-	++b3_allocCalls;
-	b3_maxAllocCalls = b3Max(b3_maxAllocCalls, b3_allocCalls);
+	if (b3_stepStats)
+	{
+		++b3_stepStats->allocCalls;
+	}
 	return malloc(size);
 }
 
@@ -0,0 +1,53 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/common/stats.h>
+#include <bounce/common/math/math.h>
+#include <string.h>
+
+thread_local b3StepStats* b3_stepStats = nullptr;
+
+void b3StepStats::Reset()
+{
+	memset(this, 0, sizeof(b3StepStats));
+}
+
+void b3StepStats::Merge(const b3StepStats& other)
+{
+	allocCalls += other.allocCalls;
+	
+	gjkCalls += other.gjkCalls;
+	gjkIters += other.gjkIters;
+	gjkMaxIters = b3Max(gjkMaxIters, other.gjkMaxIters);
+	gjkCacheHits += other.gjkCacheHits;
+
+	convexCalls += other.convexCalls;
+	convexCacheHits += other.convexCacheHits;
+
+	toiCalls += other.toiCalls;
+	toiMaxIters = b3Max(toiMaxIters, other.toiMaxIters);
+	toiEvents += other.toiEvents;
+
+	pairCount += other.pairCount;
+
+	islandCount += other.islandCount;
+	contactCount += other.contactCount;
+	
+	velocityIterations += other.velocityIterations;
+	positionIterations += other.positionIterations;
+}
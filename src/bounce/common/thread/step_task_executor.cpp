@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/common/thread/step_task_executor.h>
+#include <bounce/common/stats.h>
+
+b3StepTaskExecutor::b3StepTaskExecutor()
+{
+	m_executor = nullptr;
+	m_workerStats = nullptr;
+}
+
+void b3StepTaskExecutor::Set(b3TaskExecutor* executor, b3StepStats* workerStats)
+{
+	m_executor = executor;
+	m_workerStats = workerStats;
+}
+
+u32 b3StepTaskExecutor::GetWorkerCount() const
+{
+	return m_executor->GetWorkerCount();
+}
+
+struct b3StepTaskContext
+{
+	b3TaskFcn* task;
+	void* context;
+	void* allocContext;
+	b3StepStats* workerStats;
+};
+
+static void b3StepTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	b3StepTaskContext* ctx = (b3StepTaskContext*)context;
+
+	// The calling thread can be a worker too, so restore its state.
+	void* oldAllocContext = b3_allocContext;
+	b3StepStats* oldStats = b3_stepStats;
+
+	b3_allocContext = ctx->allocContext;
+	b3_stepStats = ctx->workerStats ? ctx->workerStats + workerIndex : nullptr;
+
+	ctx->task(begin, end, workerIndex, ctx->context);
+
+	b3_allocContext = oldAllocContext;
+	b3_stepStats = oldStats;
+}
+
+void b3StepTaskExecutor::ParallelFor(u32 count, u32 minRange, b3TaskFcn* task, void* context)
+{
+	b3StepTaskContext ctx;
+	ctx.task = task;
+	ctx.context = context;
+	ctx.allocContext = b3_allocContext;
+	ctx.workerStats = m_workerStats;
+
+	m_executor->ParallelFor(count, minRange, b3StepTask, &ctx);
+}
@@ -0,0 +1,211 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/common/thread/thread_pool.h>
+
+b3ThreadPool::b3ThreadPool(u32 threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+		if (threadCount == 0)
+		{
+			threadCount = 1;
+		}
+	}
+
+	m_task = nullptr;
+	m_context = nullptr;
+	m_generation = 0;
+	m_quit = false;
+	m_busyCount.store(0);
+
+	m_workerCount = threadCount;
+	m_workers = (b3Worker*)b3Alloc(m_workerCount * sizeof(b3Worker));
+	for (u32 i = 0; i < m_workerCount; ++i)
+	{
+		b3Worker* worker = new (m_workers + i) b3Worker();
+		worker->head = 0;
+		worker->tail = 0;
+	}
+
+	// The calling thread is the worker zero.
+	for (u32 i = 1; i < m_workerCount; ++i)
+	{
+		m_workers[i].thread = std::thread(&b3ThreadPool::WorkerMain, this, i);
+	}
+}
+
+b3ThreadPool::~b3ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (u32 i = 1; i < m_workerCount; ++i)
+	{
+		m_workers[i].thread.join();
+	}
+
+	for (u32 i = 0; i < m_workerCount; ++i)
+	{
+		m_workers[i].~b3Worker();
+	}
+	b3Free(m_workers);
+}
+
+void b3ThreadPool::WorkerMain(u32 workerIndex)
+{
+	u64 generation = 0;
+	for (;;)
+	{
+		{
+			// Sleep until a new loop starts.
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeCondition.wait(lock, [this, generation] { return m_quit || m_generation != generation; });
+			
+			if (m_quit)
+			{
+				return;
+			}
+			
+			generation = m_generation;
+		}
+
+		Execute(workerIndex);
+
+		m_busyCount.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+bool b3ThreadPool::Pop(u32 workerIndex, b3TaskRange* range)
+{
+	b3Worker* worker = m_workers + workerIndex;
+	
+	std::lock_guard<std::mutex> lock(worker->mutex);
+	if (worker->head == worker->tail)
+	{
+		return false;
+	}
+	
+	*range = worker->ranges[worker->head++];
+	return true;
+}
+
+bool b3ThreadPool::Steal(u32 workerIndex, b3TaskRange* range)
+{
+	for (u32 i = 1; i < m_workerCount; ++i)
+	{
+		b3Worker* victim = m_workers + (workerIndex + i) % m_workerCount;
+
+		std::lock_guard<std::mutex> lock(victim->mutex);
+		if (victim->head < victim->tail)
+		{
+			*range = victim->ranges[--victim->tail];
+			return true;
+		}
+	}
+	return false;
+}
+
+void b3ThreadPool::Execute(u32 workerIndex)
+{
+	// Process own ranges first then help the others.
+	b3TaskRange range;
+	while (Pop(workerIndex, &range) || Steal(workerIndex, &range))
+	{
+		m_task(range.begin, range.end, workerIndex, m_context);
+	}
+}
+
+void b3ThreadPool::ParallelFor(u32 count, u32 minRange, b3TaskFcn* task, void* context)
+{
+	B3_ASSERT(m_task == nullptr);
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (minRange == 0)
+	{
+		minRange = 1;
+	}
+
+	u32 maxRangeCount = m_workerCount * b3_maxTaskRangesPerWorker;
+	u32 rangeSize = count / maxRangeCount + (count % maxRangeCount != 0);
+	if (rangeSize < minRange)
+	{
+		rangeSize = minRange;
+	}
+	
+	u32 rangeCount = count / rangeSize + (count % rangeSize != 0);
+
+	if (m_workerCount == 1 || rangeCount == 1)
+	{
+		// Not worth to wake up the threads.
+		task(0, count, 0, context);
+		return;
+	}
+
+	// Give each worker a contiguous set of ranges. 
+	// No thread is touching the queues at this point.
+	u32 rangesPerWorker = rangeCount / m_workerCount + (rangeCount % m_workerCount != 0);
+	B3_ASSERT(rangesPerWorker <= b3_maxTaskRangesPerWorker);
+	
+	u32 begin = 0;
+	for (u32 i = 0; i < m_workerCount; ++i)
+	{
+		b3Worker* worker = m_workers + i;
+		worker->head = 0;
+		worker->tail = 0;
+
+		for (u32 j = 0; j < rangesPerWorker && begin < count; ++j)
+		{
+			u32 end = count - begin > rangeSize ? begin + rangeSize : count;
+
+			b3TaskRange* range = worker->ranges + worker->tail++;
+			range->begin = begin;
+			range->end = end;
+
+			begin = end;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = task;
+		m_context = context;
+		m_busyCount.store(m_workerCount - 1, std::memory_order_relaxed);
+		++m_generation;
+	}
+	m_wakeCondition.notify_all();
+
+	Execute(0);
+
+	// Wait for the other workers to finish their ranges.
+	while (m_busyCount.load(std::memory_order_acquire) > 0)
+	{
+		std::this_thread::yield();
+	}
+
+	m_task = nullptr;
+	m_context = nullptr;
+}
@@ -0,0 +1,399 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/dynamics/articulation_solver.h>
+#include <bounce/dynamics/body.h>
+#include <bounce/dynamics/fixture.h>
+#include <bounce/dynamics/contacts/contact_solver.h>
+#include <bounce/collision/broad_phase.h>
+#include <bounce/collision/collide/collide.h>
+#include <bounce/collision/shapes/sphere_shape.h>
+#include <bounce/collision/shapes/capsule_shape.h>
+#include <bounce/collision/shapes/triangle_shape.h>
+#include <bounce/collision/shapes/hull_shape.h>
+#include <bounce/collision/shapes/mesh_shape.h>
+#include <bounce/collision/geometry/mesh.h>
+#include <bounce/rope/articulation.h>
+
+// Resolves the contacts between the links of an articulation and the fixtures of a world.
+// Each contact point is visited once. The link impulses are applied to the articulation as 
+// forces during its time step, and the opposite impulses are applied to the bodies.
+struct b3ArticulationSolver::ContactSolver
+{
+	// Collide the link with a fixture.
+	bool Report(u32 proxyId)
+	{
+		b3Fixture* fixture = (b3Fixture*)broadPhase->GetUserData(proxyId);
+		
+		if (fixture->IsSensor())
+		{
+			return true;
+		}
+
+		b3Body* body = fixture->GetBody();
+		if (body == articulation->GetBody())
+		{
+			return true;
+		}
+
+		b3Shape* shape = fixture->GetShape();
+		const b3Transform& xf = body->GetTransform();
+
+		b3Manifold manifold;
+		manifold.Initialize();
+
+		switch (shape->GetType())
+		{
+		case b3Shape::e_sphere:
+		{
+			b3SphereShape* sphere = (b3SphereShape*)shape;
+			if (linkShape->GetType() == b3Shape::e_sphere)
+			{
+				b3CollideSphereAndSphere(manifold, xf, sphere, linkXf, &linkSphere, margin);
+				Solve(manifold, fixture, xf, false);
+			}
+			else
+			{
+				b3CollideCapsuleAndSphere(manifold, linkXf, &linkCapsule, xf, sphere, margin);
+				Solve(manifold, fixture, xf, true);
+			}
+			break;
+		}
+		case b3Shape::e_capsule:
+		{
+			b3CapsuleShape* capsule = (b3CapsuleShape*)shape;
+			if (linkShape->GetType() == b3Shape::e_sphere)
+			{
+				b3CollideCapsuleAndSphere(manifold, xf, capsule, linkXf, &linkSphere, margin);
+			}
+			else
+			{
+				b3CollideCapsuleAndCapsule(manifold, xf, capsule, linkXf, &linkCapsule, margin);
+			}
+			Solve(manifold, fixture, xf, false);
+			break;
+		}
+		case b3Shape::e_triangle:
+		{
+			CollideTriangle((b3TriangleShape*)shape, fixture, xf);
+			break;
+		}
+		case b3Shape::e_hull:
+		{
+			b3HullShape* hull = (b3HullShape*)shape;
+			if (linkShape->GetType() == b3Shape::e_sphere)
+			{
+				b3CollideHullAndSphere(manifold, xf, hull, linkXf, &linkSphere, margin);
+			}
+			else
+			{
+				b3CollideHullAndCapsule(manifold, xf, hull, linkXf, &linkCapsule, margin);
+			}
+			Solve(manifold, fixture, xf, false);
+			break;
+		}
+		case b3Shape::e_mesh:
+		{
+			b3MeshShape* meshShape = (b3MeshShape*)shape;
+
+			B3_ASSERT(meshShape->m_scale.x != scalar(0));
+			B3_ASSERT(meshShape->m_scale.y != scalar(0));
+			B3_ASSERT(meshShape->m_scale.z != scalar(0));
+
+			b3Vec3 inv_scale;
+			inv_scale.x = scalar(1) / meshShape->m_scale.x;
+			inv_scale.y = scalar(1) / meshShape->m_scale.y;
+			inv_scale.z = scalar(1) / meshShape->m_scale.z;
+
+			// Compute the link AABB in the reference frame of the mesh.
+			b3AABB aabb;
+			linkShape->ComputeAABB(&aabb, b3MulT(xf, linkXf));
+			aabb.Extend(margin);
+			aabb.Scale(inv_scale);
+
+			MeshQuery query;
+			query.solver = this;
+			query.fixture = fixture;
+			query.xf = xf;
+			meshShape->m_mesh->tree.QueryAABB(&query, aabb);
+			break;
+		}
+		default:
+		{
+			B3_ASSERT(false);
+			break;
+		}
+		}
+
+		// Keep looking for fixtures.
+		return true;
+	}
+
+	// Collide the link with a mesh triangle.
+	struct MeshQuery
+	{
+		bool Report(u32 proxyId)
+		{
+			b3MeshShape* meshShape = (b3MeshShape*)fixture->GetShape();
+			u32 triangleIndex = meshShape->m_mesh->tree.GetUserData(proxyId);
+
+			b3TriangleShape triangle;
+			meshShape->GetChildTriangle(&triangle, triangleIndex);
+			
+			solver->CollideTriangle(&triangle, fixture, xf);
+			
+			// Keep looking for triangles.
+			return true;
+		}
+
+		ContactSolver* solver;
+		b3Fixture* fixture;
+		b3Transform xf;
+	};
+
+	void CollideTriangle(const b3TriangleShape* triangle, b3Fixture* fixture, const b3Transform& xf)
+	{
+		b3Manifold manifold;
+		manifold.Initialize();
+
+		if (linkShape->GetType() == b3Shape::e_sphere)
+		{
+			b3CollideTriangleAndSphere(manifold, xf, triangle, linkXf, &linkSphere, margin);
+		}
+		else
+		{
+			b3CollideTriangleAndCapsule(manifold, xf, triangle, linkXf, &linkCapsule, margin);
+		}
+
+		Solve(manifold, fixture, xf, false);
+	}
+
+	// Solve the points of a manifold. 
+	// The manifold is flipped if the link is the first shape.
+	void Solve(const b3Manifold& manifold, b3Fixture* fixture, const b3Transform& xf, bool flip)
+	{
+		if (manifold.pointCount == 0)
+		{
+			return;
+		}
+
+		b3Body* body = fixture->GetBody();
+		scalar radius = fixture->GetShape()->m_radius;
+
+		b3WorldManifold wm;
+		if (flip)
+		{
+			wm.Initialize(&manifold, linkShape->m_radius, linkXf, radius, xf);
+		}
+		else
+		{
+			wm.Initialize(&manifold, radius, xf, linkShape->m_radius, linkXf);
+		}
+
+		scalar mB = body->GetInverseMass();
+		b3Mat33 iB = body->GetWorldInverseInertia();
+		b3Vec3 cB = body->GetWorldCenter();
+
+		scalar friction = b3MixFriction(articulation->GetFriction(), fixture->GetFriction());
+
+		for (u32 i = 0; i < wm.pointCount; ++i)
+		{
+			const b3WorldManifoldPoint* wmp = wm.points + i;
+
+			// The normal points from the fixture to the link.
+			b3Vec3 n = flip ? -wmp->normal : wmp->normal;
+			b3Vec3 p = wmp->point;
+			scalar separation = wmp->separation;
+
+			b3Vec3 rA = p - linkXf.translation;
+			b3Vec3 rB = p - cB;
+
+			b3Vec3 vA = v + b3Cross(w, rA);
+			b3Vec3 vB = body->GetLinearVelocity() + b3Cross(body->GetAngularVelocity(), rB);
+			b3Vec3 dv = vA - vB;
+
+			// Non-penetration
+			b3Vec3 rnA = b3Cross(rA, n);
+			b3Vec3 rnB = b3Cross(rB, n);
+			scalar kn = mA + mB + b3Dot(rnA, iA * rnA) + b3Dot(rnB, iB * rnB);
+			if (kn <= scalar(0))
+			{
+				continue;
+			}
+
+			// Allow speculative points to approach.
+			scalar vn_target;
+			if (separation > scalar(0))
+			{
+				vn_target = -separation * inv_h;
+			}
+			else
+			{
+				scalar C = b3Clamp(B3_BAUMGARTE * (separation + B3_LINEAR_SLOP), -B3_MAX_LINEAR_CORRECTION, scalar(0));
+				vn_target = -C * inv_h;
+			}
+
+			scalar vn = b3Dot(dv, n);
+			scalar normalImpulse = b3Max((vn_target - vn) / kn, scalar(0));
+			if (normalImpulse == scalar(0))
+			{
+				continue;
+			}
+
+			b3Vec3 P = normalImpulse * n;
+
+			// Friction
+			b3Vec3 vt = dv - vn * n;
+			scalar vt_length = b3Length(vt);
+			if (vt_length > B3_EPSILON)
+			{
+				b3Vec3 t = vt / vt_length;
+				b3Vec3 rtA = b3Cross(rA, t);
+				b3Vec3 rtB = b3Cross(rB, t);
+				scalar kt = mA + mB + b3Dot(rtA, iA * rtA) + b3Dot(rtB, iB * rtB);
+				
+				scalar tangentImpulse = b3Min(vt_length / kt, friction * normalImpulse);
+				P -= tangentImpulse * t;
+			}
+
+			// Update the link velocity seen by the next points.
+			v += mA * P;
+			w += iA * b3Cross(rA, P);
+
+			articulation->ApplyForce(linkIndex, inv_h * P, p);
+
+			body->ApplyLinearImpulse(-P, p, true);
+		}
+	}
+
+	const b3BroadPhase* broadPhase;
+	b3Articulation* articulation;
+	u32 linkIndex;
+	
+	// Link
+	const b3Shape* linkShape;
+	b3SphereShape linkSphere;
+	b3CapsuleShape linkCapsule;
+	b3Transform linkXf;
+	b3Vec3 v, w;
+	scalar mA;
+	b3Mat33 iA;
+
+	scalar margin;
+	scalar inv_h;
+};
+
+b3ArticulationSolver::b3ArticulationSolver(const b3BroadPhase* broadPhase, const b3Vec3& gravity, scalar dt)
+{
+	m_broadPhase = broadPhase;
+	m_gravity = gravity;
+	m_dt = dt;
+}
+
+void b3ArticulationSolver::Solve(b3Articulation* a) const
+{
+	scalar dt = m_dt;
+	scalar inv_dt = scalar(1) / dt;
+
+	// The base link follows the attached body.
+	b3Body* body = a->m_body;
+	if (body)
+	{
+		b3Transform xf = body->m_xf * a->m_localFrame;
+		
+		b3Vec3 v = body->m_linearVelocity + b3Cross(body->m_angularVelocity, xf.translation - body->m_sweep.worldCenter);
+		b3Vec3 w = body->m_angularVelocity;
+
+		b3Vec3 dv = inv_dt * (v - a->m_baseVelocity0);
+		b3Vec3 dw = inv_dt * (w - a->m_baseAngularVelocity0);
+
+		scalar mass = scalar(0);
+		b3Mat33 I;
+		I.SetZero();
+		if (body->m_type == e_dynamicBody)
+		{
+			mass = body->m_mass;
+			I = b3RotateToFrame(body->m_I, body->m_xf.rotation);
+		}
+
+		a->SetBaseMotion(xf, v, w, dv, dw, mass, I, body->m_sweep.worldCenter);
+	}
+
+	ContactSolver solver;
+	solver.broadPhase = m_broadPhase;
+	solver.articulation = a;
+	solver.margin = B3_AABB_EXTENSION;
+	solver.inv_h = inv_dt;
+
+	for (u32 i = 0; i < a->GetLinkCount(); ++i)
+	{
+		scalar radius = a->GetLinkRadius(i);
+		scalar mass = a->GetLinkMass(i);
+		if (radius == scalar(0) || mass == scalar(0))
+		{
+			continue;
+		}
+
+		if (i == 0 && body)
+		{
+			// The attached body moves the base link.
+			continue;
+		}
+
+		solver.linkIndex = i;
+		solver.linkXf = a->GetLinkTransform(i);
+
+		b3Vec3 anchor = a->GetLinkAnchor(i);
+		if (b3LengthSquared(anchor) > B3_LINEAR_SLOP * B3_LINEAR_SLOP)
+		{
+			solver.linkCapsule.m_vertex1 = anchor;
+			solver.linkCapsule.m_vertex2.SetZero();
+			solver.linkCapsule.m_radius = radius;
+			solver.linkShape = &solver.linkCapsule;
+		}
+		else
+		{
+			solver.linkSphere.m_center.SetZero();
+			solver.linkSphere.m_radius = radius;
+			solver.linkShape = &solver.linkSphere;
+		}
+
+		// Predict the velocity due to gravity so that resting links don't sink.
+		solver.v = a->GetLinkLinearVelocity(i) + dt * m_gravity;
+		solver.w = a->GetLinkAngularVelocity(i);
+		solver.mA = scalar(1) / mass;
+		solver.iA = b3Inverse(a->GetLinkInertia(i));
+
+		b3AABB aabb;
+		solver.linkShape->ComputeAABB(&aabb, solver.linkXf);
+		aabb.Extend(solver.margin);
+
+		m_broadPhase->QueryAABB(&solver, aabb);
+	}
+
+	a->SetGravity(m_gravity);
+	a->Step(dt);
+
+	if (body && body->m_type == e_dynamicBody)
+	{
+		// Apply the reaction of the base link.
+		b3Vec3 x = a->GetLinkTransform(0).translation;
+		body->ApplyLinearImpulse(dt * a->m_reactionForce, x, true);
+		body->ApplyAngularImpulse(dt * a->m_reactionTorque, true);
+	}
+}
@@ -21,6 +21,11 @@
 #include <bounce/dynamics/fixture.h>
 #include <bounce/dynamics/joints/joint.h>
 #include <bounce/dynamics/contacts/contact.h>
+#include <bounce/collision/shapes/sphere_shape.h>
+#include <bounce/collision/shapes/capsule_shape.h>
+#include <bounce/collision/shapes/triangle_shape.h>
+#include <bounce/collision/shapes/hull_shape.h>
+#include <bounce/collision/geometry/hull.h>
 
 b3Body::b3Body(const b3BodyDef& def, b3World* world) 
 {
@@ -38,6 +43,16 @@ b3Body::b3Body(const b3BodyDef& def, b3World* world)
 		m_flags |= e_autoSleepFlag;
 	}
 
+	if (def.bullet)
+	{
+		m_flags |= e_bulletFlag;
+	}
+
+	if (def.speculative)
+	{
+		m_flags |= e_speculativeFlag;
+	}
+
 	if (m_type == e_dynamicBody) 
 	{
 		m_mass = scalar(1);
@@ -92,6 +107,9 @@ b3Body::b3Body(const b3BodyDef& def, b3World* world)
 	m_linearSleepTolerance = def.linearSleepTolerance;
 	m_angularSleepTolerance = def.angularSleepTolerance;
 	m_sleepTime = scalar(0);	
+
+	m_minExtent = scalar(0);
+	m_maxExtent = scalar(0);
 }
 
 b3Fixture* b3Body::CreateFixture(const b3FixtureDef& def) 
@@ -110,11 +128,15 @@ b3Fixture* b3Body::CreateFixture(const b3FixtureDef& def)
 	{
 		ResetMass();
 	}
+	else
+	{
+		ComputeExtents();
+	}
 
 	// Compute the world AABB of the new fixture and assign a broad-phase proxy to it.
 	b3AABB aabb;
 	fixture->ComputeAABB(&aabb);
-	fixture->m_broadPhaseID = m_world->m_contactMan.m_broadPhase.CreateProxy(aabb, fixture);
+	fixture->m_broadPhaseID = m_world->m_contactMan.m_broadPhase->CreateProxy(aabb, fixture, m_type == e_staticBody);
 
 	// Tell the world that a new shape was added so new contacts can be created.
 	m_world->m_flags |= b3World::e_fixtureAddedFlag;
@@ -156,16 +178,28 @@ void b3Body::DestroyFixture(b3Fixture* fixture)
 	fixture->DestroyContacts();
 	
 	// Destroy the broad-phase proxy associated with the fixture.
-	m_world->m_contactMan.m_broadPhase.DestroyProxy(fixture->m_broadPhaseID);
-	
-	b3BlockAllocator* allocator = &m_world->m_blockAllocator;
+	m_world->m_contactMan.m_broadPhase->DestroyProxy(fixture->m_broadPhaseID);
 
-	// Destroy the fixture.
-	fixture->m_body = nullptr;
-	fixture->m_next = nullptr;
-	fixture->Destroy(allocator);
-	fixture->~b3Fixture();
-	allocator->Free(fixture, sizeof(b3Fixture));
+	// New queries must not see the fixture.
+	m_world->WithdrawSnapshot();
+	
+	if (m_world->IsSnapshotAcquired())
+	{
+		// An acquired snapshot might still reference the fixture and its shape.
+		// Free them when the snapshots are released.
+		m_world->m_retiredFixtures.PushFront(fixture);
+	}
+	else
+	{
+		b3BlockAllocator* allocator = &m_world->m_blockAllocator;
+
+		// Destroy the fixture.
+		fixture->m_body = nullptr;
+		fixture->m_next = nullptr;
+		fixture->Destroy(allocator);
+		fixture->~b3Fixture();
+		allocator->Free(fixture, sizeof(b3Fixture));
+	}
 
 	// Recalculate the new inertial properties of this body.
 	ResetMass();
@@ -196,8 +230,10 @@ void b3Body::SynchronizeFixtures()
 	
 	b3Vec3 displacement = xf2.translation - xf1.translation;
 
+	scalar dt = m_world->m_dt;
+
 	// Update all fixture AABBs.
-	b3BroadPhase* broadPhase = &m_world->m_contactMan.m_broadPhase;
+	b3BroadPhase* broadPhase = m_world->m_contactMan.m_broadPhase;
 	for (b3Fixture* f = m_fixtureList.m_head; f; f = f->m_next)
 	{
 		// Compute an AABB that encloses the swept fixture AABB.
@@ -207,10 +243,100 @@ void b3Body::SynchronizeFixtures()
 		
 		b3AABB aabb = b3Combine(aabb1, aabb2);
 
+		if (m_flags & e_speculativeFlag)
+		{
+			// Enclose the motion predicted for the next time step.
+			b3AABB aabb3 = aabb2;
+			aabb3.Translate(dt * m_linearVelocity);
+			aabb3.Extend(dt * b3Length(m_angularVelocity) * m_maxExtent);
+
+			aabb = b3Combine(aabb, aabb3);
+		}
+
 		broadPhase->MoveProxy(f->m_broadPhaseID, aabb, displacement);
 	}
 }
 
+void b3Body::ComputeExtents()
+{
+	m_minExtent = B3_MAX_SCALAR;
+	m_maxExtent = scalar(0);
+
+	b3Vec3 center = m_sweep.localCenter;
+
+	for (b3Fixture* f = m_fixtureList.m_head; f; f = f->m_next)
+	{
+		const b3Shape* shape = f->m_shape;
+		scalar radius = shape->m_radius;
+
+		switch (shape->GetType())
+		{
+		case b3Shape::e_sphere:
+		{
+			const b3SphereShape* sphere = (b3SphereShape*)shape;
+			
+			m_minExtent = b3Min(m_minExtent, radius);
+			m_maxExtent = b3Max(m_maxExtent, b3Distance(sphere->m_center, center) + radius);
+			break;
+		}
+		case b3Shape::e_capsule:
+		{
+			const b3CapsuleShape* capsule = (b3CapsuleShape*)shape;
+
+			scalar d1 = b3Distance(capsule->m_vertex1, center);
+			scalar d2 = b3Distance(capsule->m_vertex2, center);
+			
+			m_minExtent = b3Min(m_minExtent, radius);
+			m_maxExtent = b3Max(m_maxExtent, b3Max(d1, d2) + radius);
+			break;
+		}
+		case b3Shape::e_triangle:
+		{
+			const b3TriangleShape* triangle = (b3TriangleShape*)shape;
+
+			scalar d1 = b3Distance(triangle->m_vertex1, center);
+			scalar d2 = b3Distance(triangle->m_vertex2, center);
+			scalar d3 = b3Distance(triangle->m_vertex3, center);
+
+			m_minExtent = b3Min(m_minExtent, radius);
+			m_maxExtent = b3Max(m_maxExtent, b3Max(d1, b3Max(d2, d3)) + radius);
+			break;
+		}
+		case b3Shape::e_hull:
+		{
+			const b3Hull* hull = ((b3HullShape*)shape)->m_hull;
+
+			// The closest face to the centroid bounds the thickness of the hull.
+			scalar minExtent = B3_MAX_SCALAR;
+			for (u32 i = 0; i < hull->faceCount; ++i)
+			{
+				minExtent = b3Min(minExtent, -b3Distance(hull->centroid, hull->planes[i]));
+			}
+
+			scalar maxExtent = scalar(0);
+			for (u32 i = 0; i < hull->vertexCount; ++i)
+			{
+				maxExtent = b3Max(maxExtent, b3Distance(hull->vertices[i], center));
+			}
+
+			m_minExtent = b3Min(m_minExtent, b3Max(minExtent, scalar(0)) + radius);
+			m_maxExtent = b3Max(m_maxExtent, maxExtent + radius);
+			break;
+		}
+		default:
+		{
+			// Meshes are not swept.
+			break;
+		}
+		}
+	}
+
+	if (m_minExtent == B3_MAX_SCALAR)
+	{
+		m_minExtent = scalar(0);
+	}
+}
+
 bool b3Body::ShouldCollide(const b3Body* other) const
 {
 	// At least one body must be kinematic or dynamic.
@@ -251,6 +377,7 @@ void b3Body::ResetMass()
 		m_sweep.worldCenter0 = m_xf.translation;
 		m_sweep.worldCenter = m_xf.translation;
 		m_sweep.orientation0 = m_sweep.orientation;
+		ComputeExtents();
 		return;
 	}
 
@@ -346,6 +473,8 @@ void b3Body::ResetMass()
 
 	// Update center of mass velocity.
 	m_linearVelocity += b3Cross(m_angularVelocity, m_sweep.worldCenter - oldCenter);
+
+	ComputeExtents();
 }
 
 void b3Body::GetMassData(b3MassData* data) const
@@ -433,6 +562,8 @@ void b3Body::SetMassData(const b3MassData* massData)
 
 	// Update center of mass velocity.
 	m_linearVelocity += b3Cross(m_angularVelocity, m_sweep.worldCenter - oldCenter);
+
+	ComputeExtents();
 }
 
 void b3Body::SetType(b3BodyType type)
@@ -442,6 +573,8 @@ void b3Body::SetType(b3BodyType type)
 		return;
 	}
 
+	bool wasStatic = m_type == e_staticBody;
+
 	m_type = type;
 
 	ResetMass();
@@ -463,10 +596,23 @@ void b3Body::SetType(b3BodyType type)
 	DestroyContacts();
 
 	// Move the fixture proxies so new contacts can be created.
-	b3BroadPhase* phase = &m_world->m_contactMan.m_broadPhase;
+	b3BroadPhase* phase = m_world->m_contactMan.m_broadPhase;
+	bool isStatic = m_type == e_staticBody;
 	for (b3Fixture* f = m_fixtureList.m_head; f; f = f->m_next)
 	{
-		phase->TouchProxy(f->m_broadPhaseID);
+		if (isStatic != wasStatic)
+		{
+			// Recreate the proxy because the broad-phase handles static proxies differently.
+			phase->DestroyProxy(f->m_broadPhaseID);
+
+			b3AABB aabb;
+			f->ComputeAABB(&aabb);
+			f->m_broadPhaseID = phase->CreateProxy(aabb, f, isStatic);
+		}
+		else
+		{
+			phase->TouchProxy(f->m_broadPhaseID);
+		}
 	}
 }
 
@@ -544,6 +690,8 @@ void b3Body::Dump() const
 	b3Log("		bd.fixedRotationX = %d;\n", m_flags & e_fixedRotationX);
 	b3Log("		bd.fixedRotationY = %d;\n", m_flags & e_fixedRotationY);
 	b3Log("		bd.fixedRotationZ = %d;\n", m_flags & e_fixedRotationZ);
+	b3Log("		bd.bullet = %d;\n", m_flags & e_bulletFlag);
+	b3Log("		bd.speculative = %d;\n", m_flags & e_speculativeFlag);
 	b3Log("		bd.linearSleepTolerance = %f;\n", m_linearSleepTolerance);
 	b3Log("		bd.angularSleepTolerance = %f;\n", m_angularSleepTolerance);
 	b3Log("		\n");
@@ -21,15 +21,36 @@
 #include <bounce/dynamics/fixture.h>
 #include <bounce/dynamics/world_listeners.h>
 #include <bounce/common/profiler.h>
+#include <bounce/common/stats.h>
+#include <bounce/common/memory/stack_allocator.h>
+#include <bounce/common/thread/task_executor.h>
 
 b3ContactManager::b3ContactManager()
 {
+	m_broadPhase = b3BroadPhase::Create(e_dynamicTreeBroadPhase);
 	m_contactListener = nullptr;
 	m_contactFilter = nullptr;
+	m_allocator = nullptr;
+	m_stackAllocator = nullptr;
+	m_executor = nullptr;
+	m_workerAllocators = nullptr;
+	m_updates = nullptr;
+	m_updateCapacity = 0;
+}
+
+b3ContactManager::~b3ContactManager()
+{
+	b3Free(m_updates);
+	b3BroadPhase::Destroy(m_broadPhase);
 }
 
 void b3ContactManager::AddPair(void* dataA, void* dataB)
 {
+	if (b3_stepStats)
+	{
+		++b3_stepStats->pairCount;
+	}
+
 	b3Fixture* fixtureA = (b3Fixture*)dataA;
 	b3Fixture* fixtureB = (b3Fixture*)dataB;
 
@@ -137,7 +158,7 @@ void b3ContactManager::SynchronizeFixtures()
 
 void b3ContactManager::FindNewContacts()
 {
-	m_broadPhase.FindPairs(this);
+	m_broadPhase->FindPairs(this);
 
 	b3Contact* c = m_contactList.m_head;
 	while (c)
@@ -151,22 +172,24 @@ void b3ContactManager::UpdateContacts()
 {
 	B3_PROFILE("Update Contacts");
 
-	// Update the state of all contacts.
+	// Ensure capacity.
+	if (m_contactList.m_count > m_updateCapacity)
+	{
+		b3Free(m_updates);
+		m_updateCapacity = b3Max(2 * m_updateCapacity, m_contactList.m_count);
+		m_updates = (b3ContactUpdate*)b3Alloc(m_updateCapacity * sizeof(b3ContactUpdate));
+	}
+
+	// Filter the contacts and gather the active ones.
+	// The contacts are gathered before any of them is updated so that the bodies woken 
+	// by this update don't change the set of updated contacts. This keeps the result 
+	// independent of the task executor.
+	u32 updateCount = 0;
+	
 	b3Contact* c = m_contactList.m_head;
 	while (c)
 	{
-		b3OverlappingPair* pair = &c->m_pair;
-
-		b3Fixture* fixtureA = pair->fixtureA;
-		u32 proxyA = fixtureA->m_broadPhaseID;
-		b3Body* bodyA = fixtureA->m_body;
-
-		b3Fixture* fixtureB = pair->fixtureB;
-		u32 proxyB = fixtureB->m_broadPhaseID;
-		b3Body* bodyB = fixtureB->m_body;
-
-		// Check if the bodies must not collide with each other.
-		if (bodyA->ShouldCollide(bodyB) == false)
+		if (FilterContact(c) == false)
 		{
 			b3Contact* quack = c;
 			c = c->m_next;
@@ -174,42 +197,95 @@ void b3ContactManager::UpdateContacts()
 			continue;
 		}
 
-		// Check for external filtering.
-		if (m_contactFilter)
+		// At least one body must be dynamic or kinematic.
+		if (IsContactActive(c))
 		{
-			if (m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
-			{
-				// The user has stopped the contact.
-				b3Contact* quack = c;
-				c = c->m_next;
-				Destroy(quack);
-				continue;
-			}
+			b3ContactUpdate* update = m_updates + updateCount++;
+			update->contact = c;
+			update->wasTouching = c->IsTouching();
 		}
 
-		// At least one body must be dynamic or kinematic.
-		bool activeA = bodyA->IsAwake() && bodyA->m_type != e_staticBody;
-		bool activeB = bodyB->IsAwake() && bodyB->m_type != e_staticBody;
-		if (activeA == false && activeB == false)
+		c = c->m_next;
+	}
+
+	// Collide the contacts.
+	if (m_executor && updateCount >= b3_minParallelContactCount)
+	{
+		m_executor->ParallelFor(updateCount, b3_minContactTaskRange, UpdateContactsTask, this);
+	}
+	else
+	{
+		for (u32 i = 0; i < updateCount; ++i)
 		{
-			c = c->m_next;
-			continue;
+			m_updates[i].contact->UpdateOverlap(m_stackAllocator);
 		}
+	}
+
+	// Wake the bodies and notify the listener in the contact list order.
+	for (u32 i = 0; i < updateCount; ++i)
+	{
+		b3ContactUpdate* update = m_updates + i;
+		update->contact->ReportOverlap(update->wasTouching, m_contactListener);
+	}
+}
 
-		// Destroy the contact if the shape AABBs are not overlapping.
-		bool overlap = m_broadPhase.TestOverlap(proxyA, proxyB);
-		if (overlap == false)
+bool b3ContactManager::FilterContact(b3Contact* c) const
+{
+	b3OverlappingPair* pair = &c->m_pair;
+
+	b3Fixture* fixtureA = pair->fixtureA;
+	u32 proxyA = fixtureA->m_broadPhaseID;
+	b3Body* bodyA = fixtureA->m_body;
+
+	b3Fixture* fixtureB = pair->fixtureB;
+	u32 proxyB = fixtureB->m_broadPhaseID;
+	b3Body* bodyB = fixtureB->m_body;
+
+	// Check if the bodies must not collide with each other.
+	if (bodyA->ShouldCollide(bodyB) == false)
+	{
+		return false;
+	}
+
+	// Check for external filtering.
+	if (m_contactFilter)
+	{
+		if (m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
 		{
-			b3Contact* quack = c;
-			c = c->m_next;
-			Destroy(quack);
-			continue;
+			// The user has stopped the contact.
+			return false;
 		}
+	}
 
-		// The contact persists.
-		c->Update(m_contactListener);
+	// Destroy the contact if the shape AABBs are not overlapping.
+	// Inactive contacts are kept.
+	if (IsContactActive(c) && m_broadPhase->TestOverlap(proxyA, proxyB) == false)
+	{
+		return false;
+	}
 
-		c = c->m_next;
+	return true;
+}
+
+bool b3ContactManager::IsContactActive(b3Contact* c) const
+{
+	b3Body* bodyA = c->m_pair.fixtureA->m_body;
+	b3Body* bodyB = c->m_pair.fixtureB->m_body;
+
+	bool activeA = bodyA->IsAwake() && bodyA->m_type != e_staticBody;
+	bool activeB = bodyB->IsAwake() && bodyB->m_type != e_staticBody;
+	
+	return activeA || activeB;
+}
+
+void b3ContactManager::UpdateContactsTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	b3ContactManager* contactMan = (b3ContactManager*)context;
+	b3StackAllocator* allocator = contactMan->m_workerAllocators + workerIndex;
+
+	for (u32 i = begin; i < end; ++i)
+	{
+		contactMan->m_updates[i].contact->UpdateOverlap(allocator);
 	}
 }
 
@@ -223,7 +299,7 @@ void b3ContactManager::Destroy(b3Contact* c)
 	// Report to the contact listener the contact will be destroyed.
 	if (m_contactListener)
 	{
-		if (c->IsOverlapping())
+		if (c->IsTouching())
 		{
 			m_contactListener->EndContact(c);
 		}
@@ -69,15 +69,16 @@ void b3Contact::InitializeRegisters()
 	AddType(b3MeshAndSphereContact::Create, b3MeshAndSphereContact::Destroy, b3Shape::e_mesh, b3Shape::e_sphere);
 	AddType(b3MeshAndCapsuleContact::Create, b3MeshAndCapsuleContact::Destroy, b3Shape::e_mesh, b3Shape::e_capsule);
 	AddType(b3MeshAndHullContact::Create, b3MeshAndHullContact::Destroy, b3Shape::e_mesh, b3Shape::e_hull);
+	
+	s_initialized = true;
 }
 
 b3Contact* b3Contact::Create(b3Fixture* fixtureA, b3Fixture* fixtureB, b3BlockAllocator* allocator)
 {
-	if (s_initialized == false)
-	{
-		InitializeRegisters();
-		s_initialized = true;
-	}
+	// Worlds can create contacts on different threads. 
+	// A function-local static is initialized once in a thread-safe way.
+	static bool initialized = (InitializeRegisters(), true);
+	B3_NOT_USED(initialized);
 
 	b3Shape::Type type1 = fixtureA->GetType();
 	b3Shape::Type type2 = fixtureB->GetType();
@@ -105,6 +106,29 @@ b3Contact* b3Contact::Create(b3Fixture* fixtureA, b3Fixture* fixtureB, b3BlockAl
 	}
 }
 
+bool b3Contact::UseConvexCache() const
+{
+	return m_pair.fixtureA->m_body->m_world->m_convexCache;
+}
+
+scalar b3Contact::ComputeSpeculativeMargin() const
+{
+	const b3Body* bodyA = m_pair.fixtureA->m_body;
+	const b3Body* bodyB = m_pair.fixtureB->m_body;
+
+	if (((bodyA->m_flags | bodyB->m_flags) & b3Body::e_speculativeFlag) == 0)
+	{
+		return scalar(0);
+	}
+
+	// Bound the relative speed of any two points of the bodies.
+	scalar speed = b3Length(bodyB->m_linearVelocity - bodyA->m_linearVelocity);
+	speed += b3Length(bodyA->m_angularVelocity) * bodyA->m_maxExtent;
+	speed += b3Length(bodyB->m_angularVelocity) * bodyB->m_maxExtent;
+
+	return bodyA->m_world->m_dt * speed;
+}
+
 void b3Contact::Destroy(b3Contact* contact, b3BlockAllocator* allocator)
 {
 	B3_ASSERT(s_initialized == true);
@@ -141,6 +165,7 @@ b3Contact::b3Contact(b3Fixture* fixtureA, b3Fixture* fixtureB)
 {
 	m_pair.fixtureA = fixtureA;
 	m_pair.fixtureB = fixtureB;
+	m_speculativeMargin = scalar(0);
 }
 
 void b3Contact::GetWorldManifold(b3WorldManifold* out, u32 index) const
@@ -161,37 +186,25 @@ void b3Contact::GetWorldManifold(b3WorldManifold* out, u32 index) const
 	out->Initialize(m, shapeA->m_radius, xfA, shapeB->m_radius, xfB);
 }
 
-void b3Contact::Update(b3ContactListener* listener)
+void b3Contact::UpdateOverlap(b3StackAllocator* allocator)
 {
-	b3Fixture* fixtureA = GetFixtureA();
-	b3Shape* shapeA = fixtureA->GetShape();
-	b3Body* bodyA = fixtureA->GetBody();
-	b3Transform xfA = bodyA->GetTransform();
-
-	b3Fixture* fixtureB = GetFixtureB();
-	b3Shape* shapeB = fixtureB->GetShape();
-	b3Body* bodyB = fixtureB->GetBody();
-	b3Transform xfB = bodyB->GetTransform();
-
-	b3World* world = bodyA->GetWorld();
+	b3World* world = GetFixtureA()->GetBody()->GetWorld();
 
-	b3StackAllocator* stack = &world->m_stackAllocator;
-
-	bool wasOverlapping = IsOverlapping();
 	bool isOverlapping = false;
+	bool isTouching = false;
 	bool isSensorContact = IsSensorContact();
-	bool isDynamicContact = HasDynamicBody();
 
 	if (isSensorContact == true)
 	{
 		isOverlapping = TestOverlap();
+		isTouching = isOverlapping;
 		m_manifoldCount = 0;
 	}
 	else
 	{
 		// Copy the old contact points.
 		u32 oldManifoldCount = m_manifoldCount;
-		b3Manifold* oldManifolds = (b3Manifold*)stack->Allocate(oldManifoldCount * sizeof(b3Manifold));
+		b3Manifold* oldManifolds = (b3Manifold*)allocator->Allocate(oldManifoldCount * sizeof(b3Manifold));
 		memcpy(oldManifolds, m_manifolds, oldManifoldCount * sizeof(b3Manifold));
 
 		// Clear all contact points.
@@ -202,7 +215,9 @@ void b3Contact::Update(b3ContactListener* listener)
 		}
 
 		// Generate new contact points for the solver.
-		Collide();
+		// Speculative contacts also generate the points that might touch during the time step.
+		m_speculativeMargin = ComputeSpeculativeMargin();
+		Collide(allocator);
 
 		// Initialize the new built contact points for warm starting the solver.
 		if (world->m_warmStarting == true)
@@ -218,7 +233,7 @@ void b3Contact::Update(b3ContactListener* listener)
 			}
 		}
 
-		stack->Free(oldManifolds);
+		allocator->Free(oldManifolds);
 
 		// The shapes are overlapping if at least one contact 
 		// point was built.
@@ -230,13 +245,29 @@ void b3Contact::Update(b3ContactListener* listener)
 				break;
 			}
 		}
-	}
 
-	// Wake the bodies associated with the shapes if the contact has began.
-	if (isOverlapping != wasOverlapping)
-	{
-		bodyA->SetAwake(true);
-		bodyB->SetAwake(true);
+		if (m_speculativeMargin > scalar(0))
+		{
+			// The shapes touch if a point is not separated.
+			for (u32 i = 0; i < m_manifoldCount && isTouching == false; ++i)
+			{
+				b3WorldManifold wm;
+				GetWorldManifold(&wm, i);
+				
+				for (u32 j = 0; j < wm.pointCount; ++j)
+				{
+					if (wm.points[j].separation <= scalar(0))
+					{
+						isTouching = true;
+						break;
+					}
+				}
+			}
+		}
+		else
+		{
+			isTouching = isOverlapping;
+		}
 	}
 
 	// Update the contact state.
@@ -249,15 +280,39 @@ void b3Contact::Update(b3ContactListener* listener)
 		m_flags &= ~e_overlapFlag;
 	}
 
+	if (isTouching == true)
+	{
+		m_flags |= e_touchingFlag;
+	}
+	else
+	{
+		m_flags &= ~e_touchingFlag;
+	}
+}
+
+void b3Contact::ReportOverlap(bool wasTouching, b3ContactListener* listener)
+{
+	bool isOverlapping = IsOverlapping();
+	bool isTouching = IsTouching();
+	bool isSensorContact = IsSensorContact();
+	bool isDynamicContact = HasDynamicBody();
+
+	// Wake the bodies associated with the shapes if the contact has began.
+	if (isTouching != wasTouching)
+	{
+		GetFixtureA()->GetBody()->SetAwake(true);
+		GetFixtureB()->GetBody()->SetAwake(true);
+	}
+
 	// Notify the contact listener the new contact state.
 	if (listener != nullptr)
 	{
-		if (wasOverlapping == false && isOverlapping == true)
+		if (wasTouching == false && isTouching == true)
 		{
 			listener->BeginContact(this);
 		}
 
-		if (wasOverlapping == true && isOverlapping == false)
+		if (wasTouching == true && isTouching == false)
 		{
 			listener->EndContact(this);
 		}
@@ -22,6 +22,7 @@
 #include <bounce/dynamics/body.h>
 #include <bounce/common/memory/stack_allocator.h>
 #include <bounce/common/math/mat.h>
+#include <string.h>
 
 // This solver implements PGS for solving velocity constraints and 
 // NGS for solving position constraints.
@@ -38,11 +39,25 @@ b3ContactSolver::b3ContactSolver(const b3ContactSolverDef* def)
 	m_velocityConstraints = (b3ContactVelocityConstraint*)m_allocator->Allocate(m_count * sizeof(b3ContactVelocityConstraint));
 	m_dt = def->dt;
 	m_invDt = m_dt != scalar(0) ? scalar(1) / m_dt : scalar(0);
+	m_simd = def->simd;
+	m_rangeCounts = def->rangeCounts;
+	m_rangeCount = def->rangeCount;
+	m_wideConstraints = nullptr;
+	m_wideCount = 0;
+	m_wideRangeStarts = nullptr;
+	m_batchIndices = nullptr;
 }
 
 b3ContactSolver::~b3ContactSolver()
 {
 	// Reverse free.
+	if (m_wideRangeStarts)
+	{
+		m_allocator->Free(m_wideConstraints);
+		m_allocator->Free(m_batchIndices);
+		m_allocator->Free(m_wideRangeStarts);
+	}
+
 	for (u32 index1 = m_count; index1 > 0; --index1)
 	{
 		u32 i1 = index1 - 1;
@@ -88,13 +103,13 @@ void b3ContactSolver::InitializeConstraints()
 		b3ContactPositionConstraint* pc = m_positionConstraints + i;
 		b3ContactVelocityConstraint* vc = m_velocityConstraints + i;
 
-		pc->indexA = bodyA->m_islandID;
+		pc->indexA = c->m_indexA;
 		pc->invMassA = bodyA->m_invMass;
 		pc->localInvIA = bodyA->m_invI;
 		pc->localCenterA = bodyA->m_sweep.localCenter;
 		pc->radiusA = shapeA->m_radius;
 
-		pc->indexB = bodyB->m_islandID;
+		pc->indexB = c->m_indexB;
 		pc->invMassB = bodyB->m_invMass;
 		pc->localInvIB = bodyB->m_invI;
 		pc->localCenterB = bodyB->m_sweep.localCenter;
@@ -103,11 +118,11 @@ void b3ContactSolver::InitializeConstraints()
 		pc->manifoldCount = manifoldCount;
 		pc->manifolds = (b3PositionConstraintManifold*)m_allocator->Allocate(manifoldCount * sizeof(b3PositionConstraintManifold));
 
-		vc->indexA = bodyA->m_islandID;
+		vc->indexA = c->m_indexA;
 		vc->invMassA = bodyA->m_invMass;
 		vc->invIA = m_inertias[vc->indexA];
 
-		vc->indexB = bodyB->m_islandID;
+		vc->indexB = c->m_indexB;
 		vc->invMassB = bodyB->m_invMass;
 		vc->invIB = m_inertias[vc->indexB];
 
@@ -233,7 +248,12 @@ void b3ContactSolver::InitializeConstraints()
 					b3Vec3 dv = vB + b3Cross(wB, rB) - vA - b3Cross(wA, rA);
 					scalar vn = b3Dot(normal, dv);
 					vcp->velocityBias = scalar(0);
-					if (vn < -B3_VELOCITY_THRESHOLD)
+					if (mp->separation > scalar(0))
+					{
+						// Speculative point. Allow the approach up to the gap.
+						vcp->velocityBias = -mp->separation * m_invDt;
+					}
+					else if (vn < -B3_VELOCITY_THRESHOLD)
 					{
 						vcp->velocityBias = -vc->restitution * vn;
 					}
@@ -281,11 +301,21 @@ void b3ContactSolver::InitializeConstraints()
 			}
 		}
 	}
+
+	if (m_simd)
+	{
+		InitializeWideConstraints();
+	}
 }
 
 void b3ContactSolver::WarmStart()
 {
-	for (u32 i = 0; i < m_count; ++i)
+	WarmStart(0, m_count);
+}
+
+void b3ContactSolver::WarmStart(u32 begin, u32 end)
+{
+	for (u32 i = begin; i < end; ++i)
 	{
 		b3ContactVelocityConstraint* vc = m_velocityConstraints + i;
 
@@ -345,7 +375,18 @@ void b3ContactSolver::WarmStart()
 
 void b3ContactSolver::SolveVelocityConstraints()
 {
-	for (u32 i = 0; i < m_count; ++i)
+	if (m_simd)
+	{
+		SolveWideVelocityConstraints(0, m_wideCount);
+		return;
+	}
+
+	SolveVelocityConstraints(0, m_count);
+}
+
+void b3ContactSolver::SolveVelocityConstraints(u32 begin, u32 end)
+{
+	for (u32 i = begin; i < end; ++i)
 	{
 		b3ContactVelocityConstraint* vc = m_velocityConstraints + i;
 		u32 manifoldCount = vc->manifoldCount;
@@ -461,6 +502,11 @@ void b3ContactSolver::SolveVelocityConstraints()
 
 void b3ContactSolver::StoreImpulses()
 {
+	if (m_simd)
+	{
+		StoreWideImpulses();
+	}
+
 	for (u32 i = 0; i < m_count; ++i)
 	{
 		b3Contact* c = m_contacts[i];
@@ -488,6 +534,361 @@ void b3ContactSolver::StoreImpulses()
 	}
 }
 
+// The conflict keys of a batch of manifolds.
+struct b3ManifoldBatchKey
+{
+	u32 indexA[B3_SIMD_WIDTH];
+	u32 indexB[B3_SIMD_WIDTH];
+	u32 count;
+};
+
+void b3ContactSolver::InitializeWideConstraints()
+{
+	// Only the last batches are searched for a free lane to keep this linear.
+	const u32 kMaxBatchSearch = 8;
+
+	// Without ranges all contacts are in a single range.
+	u32 rangeCount = m_rangeCounts ? m_rangeCount : 1;
+	m_wideRangeStarts = (u32*)m_allocator->Allocate((rangeCount + 1) * sizeof(u32));
+
+	u32 manifoldCount = 0;
+	for (u32 i = 0; i < m_count; ++i)
+	{
+		manifoldCount += m_velocityConstraints[i].manifoldCount;
+	}
+
+	m_batchIndices = (u32*)m_allocator->Allocate(manifoldCount * sizeof(u32));
+	
+	// Assign the manifolds to batches greedily.
+	// The manifolds in a batch must not share bodies. 
+	// Static bodies have a slot per constraint, so they don't conflict.
+	// A batch only holds the manifolds of a single range.
+	b3ManifoldBatchKey* keys = (b3ManifoldBatchKey*)m_allocator->Allocate(manifoldCount * sizeof(b3ManifoldBatchKey));
+	u32 batchCount = 0;
+	
+	u32 manifoldIndex = 0;
+	u32 contactStart = 0;
+	for (u32 range = 0; range < rangeCount; ++range)
+	{
+		u32 rangeStart = batchCount;
+		m_wideRangeStarts[range] = rangeStart;
+
+		u32 contactEnd = contactStart + (m_rangeCounts ? m_rangeCounts[range] : m_count);
+		for (u32 i = contactStart; i < contactEnd; ++i)
+		{
+			b3ContactVelocityConstraint* vc = m_velocityConstraints + i;
+
+			u32 indexA = vc->indexA;
+			u32 indexB = vc->indexB;
+
+			for (u32 j = 0; j < vc->manifoldCount; ++j)
+			{
+				u32 batch = B3_MAX_U32;
+			
+				u32 firstBatch = batchCount > rangeStart + kMaxBatchSearch ? batchCount - kMaxBatchSearch : rangeStart;
+				for (u32 k = firstBatch; k < batchCount; ++k)
+				{
+					b3ManifoldBatchKey* key = keys + k;
+					if (key->count == B3_SIMD_WIDTH)
+					{
+						continue;
+					}
+
+					bool conflict = false;
+					for (u32 l = 0; l < key->count; ++l)
+					{
+						if (key->indexA[l] == indexA || key->indexA[l] == indexB ||
+							key->indexB[l] == indexA || key->indexB[l] == indexB)
+						{
+							conflict = true;
+							break;
+						}
+					}
+
+					if (conflict == false)
+					{
+						batch = k;
+						break;
+					}
+				}
+
+				if (batch == B3_MAX_U32)
+				{
+					batch = batchCount++;
+					keys[batch].count = 0;
+				}
+
+				b3ManifoldBatchKey* key = keys + batch;
+				u32 lane = key->count++;
+				key->indexA[lane] = indexA;
+				key->indexB[lane] = indexB;
+			
+				m_batchIndices[manifoldIndex++] = batch * B3_SIMD_WIDTH + lane;
+			}
+		}
+
+		contactStart = contactEnd;
+	}
+
+	B3_ASSERT(contactStart == m_count);
+	m_wideRangeStarts[rangeCount] = batchCount;
+
+	m_allocator->Free(keys);
+
+	m_wideCount = batchCount;
+	m_wideConstraints = (b3VelocityConstraintManifoldW*)m_allocator->Allocate(m_wideCount * sizeof(b3VelocityConstraintManifoldW));
+	
+	// The unused lanes must have zero mass and impulses.
+	memset(m_wideConstraints, 0, m_wideCount * sizeof(b3VelocityConstraintManifoldW));
+
+	// Transpose the manifolds into the batches.
+	manifoldIndex = 0;
+	for (u32 i = 0; i < m_count; ++i)
+	{
+		b3ContactVelocityConstraint* vc = m_velocityConstraints + i;
+
+		for (u32 j = 0; j < vc->manifoldCount; ++j)
+		{
+			b3VelocityConstraintManifold* vcm = vc->manifolds + j;
+			
+			u32 batchIndex = m_batchIndices[manifoldIndex++];
+			u32 lane = batchIndex % B3_SIMD_WIDTH;
+			b3VelocityConstraintManifoldW* wc = m_wideConstraints + batchIndex / B3_SIMD_WIDTH;
+			
+			wc->indexA[lane] = vc->indexA;
+			wc->indexB[lane] = vc->indexB;
+			wc->manifolds[lane] = vcm;
+			wc->laneCount = b3Max(wc->laneCount, lane + 1);
+			
+			// A manifold without points has zero mass.
+			if (vcm->pointCount == 0)
+			{
+				continue;
+			}
+
+			wc->pointCount = b3Max(wc->pointCount, vcm->pointCount);
+
+			wc->invMassA[lane] = vc->invMassA;
+			wc->invIA.Set(lane, vc->invIA);
+			wc->invMassB[lane] = vc->invMassB;
+			wc->invIB.Set(lane, vc->invIB);
+			wc->friction[lane] = vc->friction;
+
+			wc->rA.Set(lane, vcm->rA);
+			wc->rB.Set(lane, vcm->rB);
+			wc->normal.Set(lane, vcm->normal);
+
+			wc->motorImpulse[lane] = vcm->motorImpulse;
+			wc->motorMass[lane] = vcm->motorMass;
+			wc->motorSpeed[lane] = vcm->motorSpeed;
+
+			wc->tangent1.Set(lane, vcm->tangent1);
+			wc->tangentSpeed1[lane] = vcm->tangentSpeed1;
+			wc->tangent2.Set(lane, vcm->tangent2);
+			wc->tangentSpeed2[lane] = vcm->tangentSpeed2;
+			wc->tangentMass.Set(lane, b3Vec3(vcm->tangentMass.x.x, vcm->tangentMass.y.x, vcm->tangentMass.y.y));
+			wc->tangentImpulse1[lane] = vcm->tangentImpulse.x;
+			wc->tangentImpulse2[lane] = vcm->tangentImpulse.y;
+
+			for (u32 k = 0; k < vcm->pointCount; ++k)
+			{
+				b3VelocityConstraintPoint* vcp = vcm->points + k;
+				b3VelocityConstraintPointW* wcp = wc->points + k;
+
+				wcp->rA.Set(lane, vcp->rA);
+				wcp->rB.Set(lane, vcp->rB);
+				wcp->normal.Set(lane, vcp->normal);
+				wcp->normalMass[lane] = vcp->normalMass;
+				wcp->normalImpulse[lane] = vcp->normalImpulse;
+				wcp->velocityBias[lane] = vcp->velocityBias;
+			}
+		}
+	}
+}
+
+void b3ContactSolver::GetWideRange(u32 range, u32* begin, u32* end) const
+{
+	B3_ASSERT(m_simd);
+	B3_ASSERT(range < (m_rangeCounts ? m_rangeCount : 1));
+	*begin = m_wideRangeStarts[range];
+	*end = m_wideRangeStarts[range + 1];
+}
+
+void b3ContactSolver::SolveWideVelocityConstraints(u32 begin, u32 end)
+{
+	b3FloatW zero = b3SplatW(scalar(0));
+	b3FloatW one = b3SplatW(scalar(1));
+
+	for (u32 i = begin; i < end; ++i)
+	{
+		b3VelocityConstraintManifoldW* wc = m_wideConstraints + i;
+		u32 laneCount = wc->laneCount;
+
+		// Gather the body velocities.
+		b3Vec3Lanes vAs, wAs, vBs, wBs;
+		for (u32 j = 0; j < B3_SIMD_WIDTH; ++j)
+		{
+			if (j < laneCount)
+			{
+				vAs.Set(j, m_velocities[wc->indexA[j]].v);
+				wAs.Set(j, m_velocities[wc->indexA[j]].w);
+				vBs.Set(j, m_velocities[wc->indexB[j]].v);
+				wBs.Set(j, m_velocities[wc->indexB[j]].w);
+			}
+			else
+			{
+				vAs.Set(j, b3Vec3_zero);
+				wAs.Set(j, b3Vec3_zero);
+				vBs.Set(j, b3Vec3_zero);
+				wBs.Set(j, b3Vec3_zero);
+			}
+		}
+
+		b3Vec3W vA = b3LoadW(vAs);
+		b3Vec3W wA = b3LoadW(wAs);
+		b3Vec3W vB = b3LoadW(vBs);
+		b3Vec3W wB = b3LoadW(wBs);
+
+		b3FloatW mA = b3LoadW(wc->invMassA);
+		b3Mat33W iA = b3LoadW(wc->invIA);
+		b3FloatW mB = b3LoadW(wc->invMassB);
+		b3Mat33W iB = b3LoadW(wc->invIB);
+
+		// Solve normal constraints.
+		b3FloatW normalImpulse = zero;
+		for (u32 j = 0; j < wc->pointCount; ++j)
+		{
+			b3VelocityConstraintPointW* wcp = wc->points + j;
+
+			b3Vec3W rA = b3LoadW(wcp->rA);
+			b3Vec3W rB = b3LoadW(wcp->rB);
+			b3Vec3W normal = b3LoadW(wcp->normal);
+
+			b3Vec3W dv = vB + b3Cross(wB, rB) - vA - b3Cross(wA, rA);
+			b3FloatW Cdot = b3Dot(normal, dv);
+
+			b3FloatW impulse = -b3LoadW(wcp->normalMass) * (Cdot - b3LoadW(wcp->velocityBias));
+
+			b3FloatW oldImpulse = b3LoadW(wcp->normalImpulse);
+			b3FloatW newImpulse = b3MaxW(oldImpulse + impulse, zero);
+			b3StoreW(wcp->normalImpulse, newImpulse);
+			impulse = newImpulse - oldImpulse;
+
+			b3Vec3W P = impulse * normal;
+
+			vA = vA - mA * P;
+			wA = wA - iA * b3Cross(rA, P);
+
+			vB = vB + mB * P;
+			wB = wB + iB * b3Cross(rB, P);
+
+			normalImpulse = normalImpulse + newImpulse;
+		}
+
+		b3FloatW maxImpulse = b3LoadW(wc->friction) * normalImpulse;
+
+		b3Vec3W rA = b3LoadW(wc->rA);
+		b3Vec3W rB = b3LoadW(wc->rB);
+
+		// Solve tangent constraints.
+		{
+			b3Vec3W t1 = b3LoadW(wc->tangent1);
+			b3Vec3W t2 = b3LoadW(wc->tangent2);
+
+			b3Vec3W dv = vB + b3Cross(wB, rB) - vA - b3Cross(wA, rA);
+
+			b3FloatW Cdot1 = b3Dot(dv, t1) - b3LoadW(wc->tangentSpeed1);
+			b3FloatW Cdot2 = b3Dot(dv, t2) - b3LoadW(wc->tangentSpeed2);
+
+			b3Vec3W K = b3LoadW(wc->tangentMass);
+			b3FloatW impulse1 = -(K.x * Cdot1 + K.y * Cdot2);
+			b3FloatW impulse2 = -(K.y * Cdot1 + K.z * Cdot2);
+
+			b3FloatW oldImpulse1 = b3LoadW(wc->tangentImpulse1);
+			b3FloatW oldImpulse2 = b3LoadW(wc->tangentImpulse2);
+			b3FloatW newImpulse1 = oldImpulse1 + impulse1;
+			b3FloatW newImpulse2 = oldImpulse2 + impulse2;
+
+			// Clamp the impulse to the friction disk.
+			b3FloatW lengthSquared = newImpulse1 * newImpulse1 + newImpulse2 * newImpulse2;
+			b3FloatW maxImpulseSquared = maxImpulse * maxImpulse;
+			b3FloatW scale = b3SelectGreaterW(lengthSquared, maxImpulseSquared, maxImpulse / b3SqrtW(b3MaxW(lengthSquared, maxImpulseSquared)), one);
+			newImpulse1 = scale * newImpulse1;
+			newImpulse2 = scale * newImpulse2;
+
+			b3StoreW(wc->tangentImpulse1, newImpulse1);
+			b3StoreW(wc->tangentImpulse2, newImpulse2);
+
+			impulse1 = newImpulse1 - oldImpulse1;
+			impulse2 = newImpulse2 - oldImpulse2;
+
+			b3Vec3W P = impulse1 * t1 + impulse2 * t2;
+
+			vA = vA - mA * P;
+			wA = wA - iA * b3Cross(rA, P);
+
+			vB = vB + mB * P;
+			wB = wB + iB * b3Cross(rB, P);
+		}
+
+		// Solve motor constraint.
+		{
+			b3Vec3W normal = b3LoadW(wc->normal);
+
+			b3FloatW Cdot = b3Dot(normal, wB - wA) - b3LoadW(wc->motorSpeed);
+			b3FloatW impulse = -b3LoadW(wc->motorMass) * Cdot;
+			b3FloatW oldImpulse = b3LoadW(wc->motorImpulse);
+			b3FloatW newImpulse = b3ClampW(oldImpulse + impulse, -maxImpulse, maxImpulse);
+			b3StoreW(wc->motorImpulse, newImpulse);
+			impulse = newImpulse - oldImpulse;
+
+			b3Vec3W P = impulse * normal;
+
+			wA = wA - iA * P;
+			wB = wB + iB * P;
+		}
+
+		// Scatter the body velocities.
+		b3StoreW(vAs, vA);
+		b3StoreW(wAs, wA);
+		b3StoreW(vBs, vB);
+		b3StoreW(wBs, wB);
+
+		for (u32 j = 0; j < laneCount; ++j)
+		{
+			m_velocities[wc->indexA[j]].v = vAs.Get(j);
+			m_velocities[wc->indexA[j]].w = wAs.Get(j);
+			m_velocities[wc->indexB[j]].v = vBs.Get(j);
+			m_velocities[wc->indexB[j]].w = wBs.Get(j);
+		}
+	}
+}
+
+void b3ContactSolver::StoreWideImpulses()
+{
+	for (u32 i = 0; i < m_wideCount; ++i)
+	{
+		b3VelocityConstraintManifoldW* wc = m_wideConstraints + i;
+		
+		for (u32 j = 0; j < wc->laneCount; ++j)
+		{
+			b3VelocityConstraintManifold* vcm = wc->manifolds[j];
+			if (vcm->pointCount == 0)
+			{
+				continue;
+			}
+
+			vcm->tangentImpulse.Set(wc->tangentImpulse1[j], wc->tangentImpulse2[j]);
+			vcm->motorImpulse = wc->motorImpulse[j];
+
+			for (u32 k = 0; k < vcm->pointCount; ++k)
+			{
+				vcm->points[k].normalImpulse = wc->points[k].normalImpulse[j];
+			}
+		}
+	}
+}
+
 struct b3ContactPositionSolverPoint
 {
 	void Initialize(const b3ContactPositionConstraint* pc, const b3PositionConstraintPoint* pcp, const b3Transform& xfA, const b3Transform& xfB)
@@ -505,10 +906,15 @@ struct b3ContactPositionSolverPoint
 };
 
 bool b3ContactSolver::SolvePositionConstraints()
+{
+	return SolvePositionConstraints(0, m_count);
+}
+
+bool b3ContactSolver::SolvePositionConstraints(u32 begin, u32 end)
 {
 	scalar minSeparation = scalar(0);
 
-	for (u32 i = 0; i < m_count; ++i)
+	for (u32 i = begin; i < end; ++i)
 	{
 		b3ContactPositionConstraint* pc = m_positionConstraints + i;
 
@@ -46,8 +46,10 @@ bool b3ConvexContact::TestOverlap()
 	return b3TestOverlap(xfA, 0, shapeA, xfB, 0, shapeB, &m_cache);
 }
 
-void b3ConvexContact::Collide() 
+void b3ConvexContact::Collide(b3StackAllocator* allocator) 
 {
+	B3_NOT_USED(allocator);
+
 	b3Transform xfA = GetFixtureA()->GetBody()->GetTransform();
 	b3Transform xfB = GetFixtureB()->GetBody()->GetTransform();
 
@@ -47,5 +47,5 @@ void b3MeshAndCapsuleContact::Evaluate(b3Manifold& manifold, const b3Transform&
 	b3MeshShape* mesh = (b3MeshShape*)GetFixtureA()->GetShape();
 	b3TriangleShape triangle;
 	mesh->GetChildTriangle(&triangle, m_triangles[cacheIndex].index);
-	b3CollideTriangleAndCapsule(manifold, xfA, &triangle, xfB, (b3CapsuleShape*)GetFixtureB()->GetShape());
+	b3CollideTriangleAndCapsule(manifold, xfA, &triangle, xfB, (b3CapsuleShape*)GetFixtureB()->GetShape(), m_speculativeMargin);
 } 
\ No newline at end of file
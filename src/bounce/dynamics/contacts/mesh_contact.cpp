@@ -39,6 +39,9 @@ b3MeshContact::b3MeshContact(b3Fixture* fixtureA, b3Fixture* fixtureB) : b3Conta
 	b3AABB fatAABB;
 	fixtureB->GetShape()->ComputeAABB(&fatAABB, xf);
 
+	// Include the triangles that might be reached during the next time step.
+	fatAABB.Extend(ComputeSpeculativeMargin());
+
 	B3_ASSERT(fixtureA->GetType() == b3Shape::e_mesh);
 
 	b3MeshShape* meshShapeA = (b3MeshShape*)fixtureA->m_shape;
@@ -97,6 +100,9 @@ void b3MeshContact::SynchronizeFixture()
 	b3AABB aabbB;
 	shapeB->ComputeAABB(&aabbB, xf);
 
+	// Include the triangles that might be reached during the next time step.
+	aabbB.Extend(ComputeSpeculativeMargin());
+
 	b3MeshShape* meshShapeA = (b3MeshShape*)shapeA;
 
 	B3_ASSERT(meshShapeA->m_scale.x != scalar(0));
@@ -241,7 +247,7 @@ bool b3MeshContact::TestOverlap()
 	return false;
 }
 
-void b3MeshContact::Collide()
+void b3MeshContact::Collide(b3StackAllocator* allocator)
 {
 	b3Fixture* fixtureA = GetFixtureA();
 	b3Shape* shapeA = fixtureA->GetShape();
@@ -253,8 +259,6 @@ void b3MeshContact::Collide()
 	b3Body* bodyB = fixtureB->GetBody();
 	b3Transform xfB = bodyB->GetTransform();
 
-	b3StackAllocator* allocator = &bodyA->m_world->m_stackAllocator;
-
 	// Create one temporary manifold per overlapping triangle.
 	b3Manifold* manifolds = (b3Manifold*)allocator->Allocate(m_triangleCount * sizeof(b3Manifold));
 	u32 manifoldCount = 0;
@@ -50,5 +50,7 @@ void b3MeshAndHullContact::Evaluate(b3Manifold& manifold, const b3Transform& xfA
 	b3MeshShape* mesh = (b3MeshShape*)GetFixtureA()->GetShape();
 	b3TriangleShape triangle;
 	mesh->GetChildTriangle(&triangle, m_triangles[cacheIndex].index);
-	b3CollideTriangleAndHull(manifold, xfA, &triangle, xfB, (b3HullShape*)GetFixtureB()->GetShape(), &m_triangles[cacheIndex].cache, xf0A, xf0B);
+	b3ConvexCache* cache = UseConvexCache() ? &m_triangles[cacheIndex].cache : nullptr;
+
+	b3CollideTriangleAndHull(manifold, xfA, &triangle, xfB, (b3HullShape*)GetFixtureB()->GetShape(), cache, xf0A, xf0B, m_speculativeMargin);
 }
\ No newline at end of file
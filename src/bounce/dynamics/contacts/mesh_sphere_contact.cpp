@@ -47,5 +47,5 @@ void b3MeshAndSphereContact::Evaluate(b3Manifold& manifold, const b3Transform& x
 	b3MeshShape* mesh = (b3MeshShape*)GetFixtureA()->GetShape();
 	b3TriangleShape triangle;
 	mesh->GetChildTriangle(&triangle, m_triangles[cacheIndex].index);
-	b3CollideTriangleAndSphere(manifold, xfA, &triangle, xfB, (b3SphereShape*)GetFixtureB()->GetShape());
+	b3CollideTriangleAndSphere(manifold, xfA, &triangle, xfB, (b3SphereShape*)GetFixtureB()->GetShape(), m_speculativeMargin);
 }
\ No newline at end of file
@@ -84,7 +84,7 @@ void b3Fixture::DestroyContacts()
 
 const b3AABB& b3Fixture::GetAABB() const
 {
-	return m_body->GetWorld()->m_contactMan.m_broadPhase.GetAABB(m_broadPhaseID);
+	return m_body->GetWorld()->m_contactMan.m_broadPhase->GetAABB(m_broadPhaseID);
 }
 
 void b3Fixture::Dump(u32 bodyIndex) const
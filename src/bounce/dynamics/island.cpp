@@ -18,73 +18,55 @@
 
 #include <bounce/dynamics/island.h>
 #include <bounce/dynamics/body.h>
-#include <bounce/dynamics/world_listeners.h>
 #include <bounce/dynamics/time_step.h>
 #include <bounce/dynamics/joints/joint.h>
 #include <bounce/dynamics/joints/joint_solver.h>
 #include <bounce/dynamics/contacts/contact.h>
 #include <bounce/dynamics/contacts/contact_solver.h>
 #include <bounce/common/memory/stack_allocator.h>
+#include <bounce/common/thread/task_executor.h>
 #include <bounce/common/profiler.h>
-
-b3Island::b3Island(b3StackAllocator* allocator, u32 bodyCapacity, u32 contactCapacity, u32 jointCapacity, b3ContactListener* listener) 
+#include <bounce/common/stats.h>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <string.h>
+
+b3Island::b3Island(b3StackAllocator* allocator, 
+	b3Body** bodies, u32 bodyCount, 
+	b3Contact** contacts, u32 contactCount, 
+	b3Joint** joints, u32 jointCount,
+	const b3IslandCounts* islandCounts, u32 islandCount,
+	b3TaskExecutor* executor) 
 {
 	m_allocator = allocator;
-	m_listener = listener;
-	m_bodyCapacity = bodyCapacity;
-	m_contactCapacity = contactCapacity;
-	m_jointCapacity = jointCapacity;
+	m_executor = executor;
+	
+	m_bodies = bodies;
+	m_bodyCount = bodyCount;
+	
+	m_contacts = contacts;
+	m_contactCount = contactCount;
 	
-	m_bodies = (b3Body**)m_allocator->Allocate(m_bodyCapacity * sizeof(b3Body*));
-	m_velocities = (b3Velocity*)m_allocator->Allocate(m_bodyCapacity * sizeof(b3Velocity));
-	m_positions = (b3Position*)m_allocator->Allocate(m_bodyCapacity * sizeof(b3Position));
-	m_invInertias = (b3Mat33*)m_allocator->Allocate(m_bodyCapacity * sizeof(b3Mat33));
-	m_contacts = (b3Contact**)m_allocator->Allocate(m_contactCapacity * sizeof(b3Contact*));
-	m_joints = (b3Joint**)m_allocator->Allocate(m_jointCapacity * sizeof(b3Joint*));
-
-	m_bodyCount = 0;
-	m_contactCount = 0;
-	m_jointCount = 0;
+	m_joints = joints;
+	m_jointCount = jointCount;
+
+	m_islandCounts = islandCounts;
+	m_islandCount = islandCount;
+
+	m_velocities = (b3Velocity*)m_allocator->Allocate(m_bodyCount * sizeof(b3Velocity));
+	m_positions = (b3Position*)m_allocator->Allocate(m_bodyCount * sizeof(b3Position));
+	m_invInertias = (b3Mat33*)m_allocator->Allocate(m_bodyCount * sizeof(b3Mat33));
+	m_positionsSolved = (bool*)m_allocator->Allocate(m_islandCount * sizeof(bool));
 }
 
 b3Island::~b3Island() 
 {
 	// @note Reverse order of construction.
-	m_allocator->Free(m_joints);
-	m_allocator->Free(m_contacts);
+	m_allocator->Free(m_positionsSolved);
 	m_allocator->Free(m_invInertias);
 	m_allocator->Free(m_positions);
 	m_allocator->Free(m_velocities);
-	m_allocator->Free(m_bodies);
-}
-
-void b3Island::Clear() 
-{
-	m_bodyCount = 0;
-	m_contactCount = 0;
-	m_jointCount = 0;
-}
-
-void b3Island::Add(b3Body* b) 
-{
-	B3_ASSERT(m_bodyCount < m_bodyCapacity);
-	b->m_islandID = m_bodyCount;
-	m_bodies[m_bodyCount] = b;
-	++m_bodyCount;
-}
-
-void b3Island::Add(b3Contact* c) 
-{
-	B3_ASSERT(m_contactCount < m_contactCapacity);
-	m_contacts[m_contactCount] = c;
-	++m_contactCount;
-}
-
-void b3Island::Add(b3Joint* j) 
-{
-	B3_ASSERT(m_jointCount < m_jointCapacity);
-	m_joints[m_jointCount] = j;
-	++m_jointCount;
 }
 
 // Numerical Methods (Erin, p60)
@@ -109,6 +91,590 @@ static B3_FORCE_INLINE b3Vec3 b3SolveGyro(const b3Quat& q, const b3Mat33& Ib, co
 	return w2;
 }
 
+void b3Island::IntegratePositions(u32 begin, u32 end, scalar h)
+{
+	for (u32 i = begin; i < end; ++i) 
+	{
+		b3Body* b = m_bodies[i];
+		
+		b3Vec3 x = m_positions[i].x;
+		b3Quat q = m_positions[i].q;
+		b3Vec3 v = m_velocities[i].v;
+		b3Vec3 w = m_velocities[i].w;
+		b3Mat33 invI = m_invInertias[i];
+
+		if (b->m_type != e_staticBody)
+		{
+			// Prevent numerical instability due to large velocity changes.		
+			b3Vec3 translation = h * v;
+			if (b3Dot(translation, translation) > B3_MAX_TRANSLATION_SQUARED)
+			{
+				scalar ratio = B3_MAX_TRANSLATION / b3Length(translation);
+				v *= ratio;
+			}
+
+			b3Vec3 rotation = h * w;
+			if (b3Dot(rotation, rotation) > B3_MAX_ROTATION_SQUARED)
+			{
+				scalar ratio = B3_MAX_ROTATION / b3Length(rotation);
+				w *= ratio;
+			}
+
+			// Integrate
+			x += h * v;
+			q = b3Integrate(q, w, h);
+			invI = b3RotateToFrame(b->m_invI, q);
+		}
+
+		m_positions[i].x = x;
+		m_positions[i].q = q;
+		m_velocities[i].v = v;
+		m_velocities[i].w = w;
+		m_invInertias[i] = invI;
+	}
+}
+
+// A color of the constraint graph. 
+// The constraints of a color don't share non-static bodies, 
+// therefore they can be solved concurrently.
+struct b3GraphColor
+{
+	u32 jointStart, jointCount;
+	u32 contactStart, contactCount;
+	u32 batchStart, batchCount; // SIMD batches of the contacts
+	bool overflow;
+};
+
+// Find the first color not used by the non-static bodies of a constraint.
+static u32 b3AssignColor(u32* bodyColors, u32 indexA, bool staticA, u32 indexB, bool staticB)
+{
+	u32 usedColors = 0;
+	if (staticA == false)
+	{
+		usedColors |= bodyColors[indexA];
+	}
+	if (staticB == false)
+	{
+		usedColors |= bodyColors[indexB];
+	}
+
+	for (u32 color = 0; color < b3_maxGraphColors; ++color)
+	{
+		u32 bit = 1 << color;
+		if (usedColors & bit)
+		{
+			continue;
+		}
+
+		if (staticA == false)
+		{
+			bodyColors[indexA] |= bit;
+		}
+		if (staticB == false)
+		{
+			bodyColors[indexB] |= bit;
+		}
+
+		return color;
+	}
+
+	return b3_maxGraphColors;
+}
+
+// Sort an array of constraints by color. This keeps the island order inside a color.
+template<class T>
+static void b3SortByColor(b3StackAllocator* allocator, T** constraints, u32 count, const u32* constraintColors, u32* offsets)
+{
+	T** sorted = (T**)allocator->Allocate(count * sizeof(T*));
+	for (u32 i = 0; i < count; ++i)
+	{
+		sorted[offsets[constraintColors[i]]++] = constraints[i];
+	}
+	memcpy(constraints, sorted, count * sizeof(T*));
+	allocator->Free(sorted);
+}
+
+// Greedy coloring of the constraint graph. 
+// Static bodies have one slot per constraint and are only read by the solver, 
+// therefore they don't create conflicts.
+// The constraints are sorted by color and the non-empty colors are returned.
+u32 b3Island::ColorGraph(b3GraphColor* colors)
+{
+	B3_ASSERT(b3_maxGraphColors <= 32);
+
+	// The last color holds the constraints that couldn't be colored.
+	const u32 colorCapacity = b3_maxGraphColors + 1;
+
+	u32 jointCounts[colorCapacity];
+	u32 contactCounts[colorCapacity];
+	for (u32 i = 0; i < colorCapacity; ++i)
+	{
+		jointCounts[i] = 0;
+		contactCounts[i] = 0;
+	}
+
+	u32* bodyColors = (u32*)m_allocator->Allocate(m_bodyCount * sizeof(u32));
+	memset(bodyColors, 0, m_bodyCount * sizeof(u32));
+
+	u32* jointColors = (u32*)m_allocator->Allocate(m_jointCount * sizeof(u32));
+	u32* contactColors = (u32*)m_allocator->Allocate(m_contactCount * sizeof(u32));
+
+	for (u32 i = 0; i < m_jointCount; ++i)
+	{
+		b3Joint* j = m_joints[i];
+		u32 color = b3AssignColor(bodyColors, 
+			j->m_indexA, m_bodies[j->m_indexA]->m_type == e_staticBody, 
+			j->m_indexB, m_bodies[j->m_indexB]->m_type == e_staticBody);
+		jointColors[i] = color;
+		++jointCounts[color];
+	}
+
+	for (u32 i = 0; i < m_contactCount; ++i)
+	{
+		b3Contact* c = m_contacts[i];
+		u32 color = b3AssignColor(bodyColors, 
+			c->m_indexA, m_bodies[c->m_indexA]->m_type == e_staticBody, 
+			c->m_indexB, m_bodies[c->m_indexB]->m_type == e_staticBody);
+		contactColors[i] = color;
+		++contactCounts[color];
+	}
+
+	u32 jointOffsets[colorCapacity];
+	u32 contactOffsets[colorCapacity];
+
+	u32 colorCount = 0;
+	u32 jointStart = 0, contactStart = 0;
+	for (u32 i = 0; i < colorCapacity; ++i)
+	{
+		jointOffsets[i] = jointStart;
+		contactOffsets[i] = contactStart;
+
+		if (jointCounts[i] + contactCounts[i] > 0)
+		{
+			b3GraphColor* color = colors + colorCount++;
+			color->jointStart = jointStart;
+			color->jointCount = jointCounts[i];
+			color->contactStart = contactStart;
+			color->contactCount = contactCounts[i];
+			color->batchStart = 0;
+			color->batchCount = 0;
+			color->overflow = i == b3_maxGraphColors;
+		}
+
+		jointStart += jointCounts[i];
+		contactStart += contactCounts[i];
+	}
+
+	b3SortByColor(m_allocator, m_joints, m_jointCount, jointColors, jointOffsets);
+	b3SortByColor(m_allocator, m_contacts, m_contactCount, contactColors, contactOffsets);
+
+	m_allocator->Free(contactColors);
+	m_allocator->Free(jointColors);
+	m_allocator->Free(bodyColors);
+
+	return colorCount;
+}
+
+enum b3SolverStageType
+{
+	e_warmStartStage,
+	e_solveVelocityStage,
+	e_integratePositionsStage,
+	e_solvePositionStage
+};
+
+// A stage of the graph solver.
+// The items of a stage are split into blocks that are claimed by the threads.
+struct b3SolverStage
+{
+	b3SolverStageType type;
+	u32 color;
+	u32 itemCount;
+	u32 blockSize;
+	u32 blockCount;
+	std::atomic<u32> nextBlock;
+	std::atomic<u32> completedBlocks;
+};
+
+struct b3GraphSolverContext
+{
+	void IntegratePositions(u32 begin, u32 end)
+	{
+		island->IntegratePositions(begin, end, h);
+	}
+
+	b3Island* island;
+	scalar h;
+
+	b3JointSolver* jointSolver;
+	b3ContactSolver* contactSolver;
+	
+	const b3GraphColor* colors;
+	u32 colorCount;
+	
+	b3SolverStage* stages;
+	u32 stageCount;
+
+	u32 velocityIterations;
+	u32 positionIterations;
+	bool warmStart;
+	bool simd;
+
+	// The stage being executed. 
+	// This is B3_MAX_U32 until the solver starts and the stage count after it finishes.
+	std::atomic<u32> currentStage;
+
+	// Set by the first task that starts. This task runs the stages.
+	std::atomic<u32> mainStarted;
+
+	// The profiler of the thread that called the solver. 
+	// The worker running the stages records its scopes into it while the calling thread waits.
+	b3Profiler* profiler;
+	
+	// Set if a position constraint wasn't solved in the current iteration.
+	std::atomic<u32> positionError;
+	
+	bool positionsSolved;
+};
+
+static void b3InitializeStage(b3SolverStage* stage, b3SolverStageType type, u32 color, 
+	const b3GraphColor* colors, u32 bodyCount, u32 workerCount, bool simd)
+{
+	new (stage) b3SolverStage();
+	stage->type = type;
+	stage->color = color;
+	
+	bool serial = false;
+	if (type == e_integratePositionsStage)
+	{
+		stage->itemCount = bodyCount;
+	}
+	else
+	{
+		// The velocity stages solve the contacts in SIMD batches.
+		const b3GraphColor* c = colors + color;
+		u32 contactItemCount = type == e_solveVelocityStage && simd ? c->batchCount : c->contactCount;
+		stage->itemCount = c->jointCount + contactItemCount;
+		serial = c->overflow;
+	}
+
+	if (serial)
+	{
+		// The constraints that couldn't be colored must be solved by a single thread.
+		stage->blockSize = b3Max(stage->itemCount, u32(1));
+	}
+	else
+	{
+		u32 maxBlockCount = 4 * workerCount;
+		u32 blockSize = (stage->itemCount + maxBlockCount - 1) / maxBlockCount;
+		stage->blockSize = b3Max(blockSize, b3_minSolverBlockSize);
+	}
+
+	stage->blockCount = (stage->itemCount + stage->blockSize - 1) / stage->blockSize;
+	stage->nextBlock.store(0, std::memory_order_relaxed);
+	stage->completedBlocks.store(0, std::memory_order_relaxed);
+}
+
+static void b3ExecuteBlock(b3GraphSolverContext* context, const b3SolverStage* stage, u32 block)
+{
+	u32 begin = block * stage->blockSize;
+	u32 end = b3Min(begin + stage->blockSize, stage->itemCount);
+
+	if (stage->type == e_integratePositionsStage)
+	{
+		context->IntegratePositions(begin, end);
+		return;
+	}
+
+	// Joints come first in a color.
+	const b3GraphColor* color = context->colors + stage->color;
+
+	u32 jointBegin = color->jointStart + b3Min(begin, color->jointCount);
+	u32 jointEnd = color->jointStart + b3Min(end, color->jointCount);
+	
+	// The contact items of a velocity stage are SIMD batches if SIMD is enabled.
+	u32 contactItemBegin = begin > color->jointCount ? begin - color->jointCount : 0;
+	u32 contactItemEnd = end > color->jointCount ? end - color->jointCount : 0;
+
+	u32 contactBegin = color->contactStart + contactItemBegin;
+	u32 contactEnd = color->contactStart + contactItemEnd;
+
+	switch (stage->type)
+	{
+	case e_warmStartStage:
+	{
+		context->jointSolver->WarmStart(jointBegin, jointEnd);
+		context->contactSolver->WarmStart(contactBegin, contactEnd);
+		break;
+	}
+	case e_solveVelocityStage:
+	{
+		context->jointSolver->SolveVelocityConstraints(jointBegin, jointEnd);
+		if (context->simd)
+		{
+			u32 batchBegin = color->batchStart + contactItemBegin;
+			u32 batchEnd = color->batchStart + contactItemEnd;
+			context->contactSolver->SolveWideVelocityConstraints(batchBegin, batchEnd);
+		}
+		else
+		{
+			context->contactSolver->SolveVelocityConstraints(contactBegin, contactEnd);
+		}
+		break;
+	}
+	case e_solvePositionStage:
+	{
+		bool jointsSolved = context->jointSolver->SolvePositionConstraints(jointBegin, jointEnd);
+		bool contactsSolved = context->contactSolver->SolvePositionConstraints(contactBegin, contactEnd);
+		if (jointsSolved == false || contactsSolved == false)
+		{
+			context->positionError.store(1, std::memory_order_relaxed);
+		}
+		break;
+	}
+	default:
+	{
+		B3_ASSERT(false);
+		break;
+	}
+	}
+}
+
+static void b3ExecuteStage(b3GraphSolverContext* context, b3SolverStage* stage)
+{
+	for (;;)
+	{
+		u32 block = stage->nextBlock.fetch_add(1, std::memory_order_relaxed);
+		if (block >= stage->blockCount)
+		{
+			break;
+		}
+
+		b3ExecuteBlock(context, stage, block);
+
+		stage->completedBlocks.fetch_add(1, std::memory_order_release);
+	}
+}
+
+// Publish a stage, help executing it, and wait until all its blocks are done.
+static void b3RunStage(b3GraphSolverContext* context, u32 stageIndex)
+{
+	B3_ASSERT(stageIndex < context->stageCount);
+	b3SolverStage* stage = context->stages + stageIndex;
+	
+	context->currentStage.store(stageIndex, std::memory_order_release);
+
+	b3ExecuteStage(context, stage);
+
+	while (stage->completedBlocks.load(std::memory_order_acquire) < stage->blockCount)
+	{
+		std::this_thread::yield();
+	}
+}
+
+// The main thread runs the stages in order.
+static void b3SolveGraphMain(b3GraphSolverContext* context)
+{
+	u32 stageIndex = 0;
+
+	{
+		B3_PROFILE("Solve Velocity Constraints");
+
+		if (context->warmStart)
+		{
+			for (u32 i = 0; i < context->colorCount; ++i)
+			{
+				b3RunStage(context, stageIndex++);
+			}
+		}
+
+		for (u32 i = 0; i < context->velocityIterations; ++i)
+		{
+			for (u32 j = 0; j < context->colorCount; ++j)
+			{
+				b3RunStage(context, stageIndex++);
+			}
+		}
+
+		if (context->warmStart)
+		{
+			context->contactSolver->StoreImpulses();
+		}
+
+		if (b3_stepStats)
+		{
+			b3_stepStats->velocityIterations += context->velocityIterations;
+		}
+	}
+
+	// Integrate positions
+	b3RunStage(context, stageIndex++);
+
+	{
+		B3_PROFILE("Solve Position Constraints");
+
+		for (u32 i = 0; i < context->positionIterations; ++i)
+		{
+			if (b3_stepStats)
+			{
+				++b3_stepStats->positionIterations;
+			}
+
+			context->positionError.store(0, std::memory_order_relaxed);
+
+			for (u32 j = 0; j < context->colorCount; ++j)
+			{
+				b3RunStage(context, stageIndex++);
+			}
+
+			if (context->positionError.load(std::memory_order_relaxed) == 0)
+			{
+				// Early out if the position errors are small.
+				context->positionsSolved = true;
+				break;
+			}
+		}
+	}
+
+	// Release the helpers.
+	context->currentStage.store(context->stageCount, std::memory_order_release);
+}
+
+// A helper thread executes the stages published by the main thread.
+// The main thread is the first task that started, so a helper can wait 
+// for the first stage. The helper leaves when the main thread releases the helpers.
+static void b3SolveGraphHelper(b3GraphSolverContext* context)
+{
+	u32 lastStage = B3_MAX_U32;
+	for (;;)
+	{
+		u32 stageIndex = context->currentStage.load(std::memory_order_acquire);
+		if (stageIndex == context->stageCount)
+		{
+			break;
+		}
+
+		if (stageIndex != B3_MAX_U32 && stageIndex != lastStage)
+		{
+			b3ExecuteStage(context, context->stages + stageIndex);
+			lastStage = stageIndex;
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+static void b3SolveGraphTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	B3_NOT_USED(workerIndex);
+	
+	b3GraphSolverContext* graphContext = (b3GraphSolverContext*)context;
+	for (u32 i = begin; i < end; ++i)
+	{
+		// The executor might not start the tasks in index order.
+		if (graphContext->mainStarted.exchange(1) == 0)
+		{
+			b3Profiler* oldProfiler = b3Profiler_profiler;
+			b3Profiler_profiler = graphContext->profiler;
+
+			b3SolveGraphMain(graphContext);
+
+			b3Profiler_profiler = oldProfiler;
+		}
+		else
+		{
+			b3SolveGraphHelper(graphContext);
+		}
+	}
+}
+
+bool b3Island::SolveGraph(b3JointSolver* jointSolver, b3ContactSolver* contactSolver, 
+	const b3GraphColor* colors, u32 colorCount, 
+	scalar h, u32 velocityIterations, u32 positionIterations, bool warmStart, bool simd)
+{
+	u32 workerCount = m_executor ? m_executor->GetWorkerCount() : 1;
+	
+	u32 stageCount = 0;
+	if (warmStart)
+	{
+		stageCount += colorCount;
+	}
+	stageCount += velocityIterations * colorCount;
+	stageCount += 1;
+	stageCount += positionIterations * colorCount;
+
+	b3SolverStage* stages = (b3SolverStage*)m_allocator->Allocate(stageCount * sizeof(b3SolverStage));
+	
+	u32 stageIndex = 0;
+	
+	if (warmStart)
+	{
+		for (u32 i = 0; i < colorCount; ++i)
+		{
+			b3InitializeStage(stages + stageIndex++, e_warmStartStage, i, colors, m_bodyCount, workerCount, simd);
+		}
+	}
+
+	for (u32 i = 0; i < velocityIterations; ++i)
+	{
+		for (u32 j = 0; j < colorCount; ++j)
+		{
+			b3InitializeStage(stages + stageIndex++, e_solveVelocityStage, j, colors, m_bodyCount, workerCount, simd);
+		}
+	}
+
+	b3InitializeStage(stages + stageIndex++, e_integratePositionsStage, 0, colors, m_bodyCount, workerCount, simd);
+
+	for (u32 i = 0; i < positionIterations; ++i)
+	{
+		for (u32 j = 0; j < colorCount; ++j)
+		{
+			b3InitializeStage(stages + stageIndex++, e_solvePositionStage, j, colors, m_bodyCount, workerCount, simd);
+		}
+	}
+
+	B3_ASSERT(stageIndex == stageCount);
+
+	b3GraphSolverContext context;
+	context.island = this;
+	context.h = h;
+	context.jointSolver = jointSolver;
+	context.contactSolver = contactSolver;
+	context.colors = colors;
+	context.colorCount = colorCount;
+	context.stages = stages;
+	context.stageCount = stageCount;
+	context.velocityIterations = velocityIterations;
+	context.positionIterations = positionIterations;
+	context.warmStart = warmStart;
+	context.simd = simd;
+	context.currentStage.store(B3_MAX_U32, std::memory_order_relaxed);
+	context.mainStarted.store(0, std::memory_order_relaxed);
+	context.positionError.store(0, std::memory_order_relaxed);
+	context.positionsSolved = false;
+	context.profiler = b3Profiler_profiler;
+
+	if (m_executor)
+	{
+		// One main thread and a helper per remaining worker.
+		m_executor->ParallelFor(workerCount, 1, b3SolveGraphTask, &context);
+	}
+	else
+	{
+		b3SolveGraphMain(&context);
+	}
+
+	for (u32 i = 0; i < stageCount; ++i)
+	{
+		stages[i].~b3SolverStage();
+	}
+	m_allocator->Free(stages);
+
+	return context.positionsSolved;
+}
+
 void b3Island::Solve(const b3Vec3& gravity, scalar dt, u32 velocityIterations, u32 positionIterations, u32 flags)
 {
 	scalar h = dt;
@@ -123,9 +689,13 @@ void b3Island::Solve(const b3Vec3& gravity, scalar dt, u32 velocityIterations, u
 		b3Vec3 x = b->m_sweep.worldCenter;
 		b3Quat q = b->m_sweep.orientation;
 
-		// Remember the positions for CCD
-		b->m_sweep.worldCenter0 = b->m_sweep.worldCenter;
-		b->m_sweep.orientation0 = b->m_sweep.orientation;
+		// Remember the positions for CCD.
+		// Static bodies don't move and can be shared with other islands.
+		if (b->m_type != e_staticBody)
+		{
+			b->m_sweep.worldCenter0 = b->m_sweep.worldCenter;
+			b->m_sweep.orientation0 = b->m_sweep.orientation;
+		}
 
 		if (b->m_type == e_dynamicBody) 
 		{
@@ -171,6 +741,25 @@ void b3Island::Solve(const b3Vec3& gravity, scalar dt, u32 velocityIterations, u
 		m_invInertias[i] = b->m_worldInvI;
 	}
 
+	// Color the constraint graph before the solvers copy the constraints.
+	// This is done even without a task executor so that the constraint order 
+	// doesn't depend on the number of threads.
+	bool colored = m_contactCount + m_jointCount >= b3_minParallelIslandConstraints;
+	b3GraphColor colors[b3_maxGraphColors + 1];
+	u32 colorCount = 0;
+	u32 colorContactCounts[b3_maxGraphColors + 1];
+	if (colored)
+	{
+		B3_PROFILE("Color Constraints");
+
+		colorCount = ColorGraph(colors);
+
+		for (u32 i = 0; i < colorCount; ++i)
+		{
+			colorContactCounts[i] = colors[i].contactCount;
+		}
+	}
+
 	b3JointSolverDef jointSolverDef;
 	jointSolverDef.joints = m_joints;
 	jointSolverDef.count = m_jointCount;
@@ -188,99 +777,138 @@ void b3Island::Solve(const b3Vec3& gravity, scalar dt, u32 velocityIterations, u
 	contactSolverDef.velocities = m_velocities;
 	contactSolverDef.invInertias = m_invInertias;
 	contactSolverDef.dt = h;
+	// The SIMD batches of a colored island don't cross colors, so the colors 
+	// can be solved in SIMD batches.
+	contactSolverDef.rangeCounts = colored ? colorContactCounts : nullptr;
+	contactSolverDef.rangeCount = colorCount;
+	contactSolverDef.simd = (flags & e_simdBit) != 0;
 	b3ContactSolver contactSolver(&contactSolverDef);
 
-	// 2. Initialize constraints
+	// The position constraints of each island are solved until its errors are small.
+	for (u32 i = 0; i < m_islandCount; ++i)
 	{
-		B3_PROFILE("Initialize Constraints");
-		
-		contactSolver.InitializeConstraints();
-
-		if (flags & e_warmStartBit)
-		{
-			contactSolver.WarmStart();
-		}
-
-		jointSolver.InitializeConstraints();
-
-		if (flags & e_warmStartBit)
-		{
-			jointSolver.WarmStart();
-		}
+		m_positionsSolved[i] = false;
 	}
 
-	// 3. Solve velocity constraints
+	if (colored)
 	{
-		B3_PROFILE("Solve Velocity Constraints");
+		// The colors mix the constraints of the islands in a batch.
+		B3_ASSERT(m_islandCount == 1);
 
-		for (u32 i = 0; i < velocityIterations; ++i)
+		// 2. Initialize constraints
 		{
-			jointSolver.SolveVelocityConstraints();
-			contactSolver.SolveVelocityConstraints();
-		}
+			B3_PROFILE("Initialize Constraints");
 
-		if (flags & e_warmStartBit)
-		{
-			contactSolver.StoreImpulses();
+			contactSolver.InitializeConstraints();
+			jointSolver.InitializeConstraints();
+
+			if (contactSolverDef.simd)
+			{
+				for (u32 i = 0; i < colorCount; ++i)
+				{
+					u32 batchEnd;
+					contactSolver.GetWideRange(i, &colors[i].batchStart, &batchEnd);
+					colors[i].batchCount = batchEnd - colors[i].batchStart;
+				}
+			}
 		}
-	}
 
-	// 4. Integrate positions
-	for (u32 i = 0; i < m_bodyCount; ++i) 
+		// 3-5. Warm start, solve velocity constraints, integrate positions, 
+		// and solve position constraints by colors
+		m_positionsSolved[0] = SolveGraph(&jointSolver, &contactSolver, colors, colorCount, 
+			h, velocityIterations, positionIterations, (flags & e_warmStartBit) != 0, contactSolverDef.simd);
+	}
+	else
 	{
-		b3Body* b = m_bodies[i];
+		// 2. Initialize constraints
+		{
+			B3_PROFILE("Initialize Constraints");
 		
-		b3Vec3 x = m_positions[i].x;
-		b3Quat q = m_positions[i].q;
-		b3Vec3 v = m_velocities[i].v;
-		b3Vec3 w = m_velocities[i].w;
-		b3Mat33 invI = m_invInertias[i];
+			contactSolver.InitializeConstraints();
 
-		if (b->m_type != e_staticBody)
+			if (flags & e_warmStartBit)
+			{
+				contactSolver.WarmStart();
+			}
+
+			jointSolver.InitializeConstraints();
+
+			if (flags & e_warmStartBit)
+			{
+				jointSolver.WarmStart();
+			}
+		}
+
+		// 3. Solve velocity constraints
 		{
-			// Prevent numerical instability due to large velocity changes.		
-			b3Vec3 translation = h * v;
-			if (b3Dot(translation, translation) > B3_MAX_TRANSLATION_SQUARED)
+			B3_PROFILE("Solve Velocity Constraints");
+
+			for (u32 i = 0; i < velocityIterations; ++i)
 			{
-				scalar ratio = B3_MAX_TRANSLATION / b3Length(translation);
-				v *= ratio;
+				jointSolver.SolveVelocityConstraints();
+				contactSolver.SolveVelocityConstraints();
 			}
 
-			b3Vec3 rotation = h * w;
-			if (b3Dot(rotation, rotation) > B3_MAX_ROTATION_SQUARED)
+			if (flags & e_warmStartBit)
 			{
-				scalar ratio = B3_MAX_ROTATION / b3Length(rotation);
-				w *= ratio;
+				contactSolver.StoreImpulses();
 			}
 
-			// Integrate
-			x += h * v;
-			q = b3Integrate(q, w, h);
-			invI = b3RotateToFrame(b->m_invI, q);
+			if (b3_stepStats)
+			{
+				b3_stepStats->velocityIterations += velocityIterations;
+			}
 		}
 
-		m_positions[i].x = x;
-		m_positions[i].q = q;
-		m_velocities[i].v = v;
-		m_velocities[i].w = w;
-		m_invInertias[i] = invI;
-	}
+		// 4. Integrate positions
+		IntegratePositions(0, m_bodyCount, h);
 
-	// 5. Solve position constraints
-	bool positionsSolved = false;
-	
-	{
-		B3_PROFILE("Solve Position Constraints");
-		
-		for (u32 i = 0; i < positionIterations; ++i) 
+		// 5. Solve position constraints
 		{
-			bool contactsSolved = contactSolver.SolvePositionConstraints();
-			bool jointsSolved = jointSolver.SolvePositionConstraints();
-			if (contactsSolved && jointsSolved)
+			B3_PROFILE("Solve Position Constraints");
+		
+			u32 solvedCount = 0;
+			for (u32 i = 0; i < positionIterations; ++i) 
 			{
-				// Early out if the position errors are small.
-				positionsSolved = true;
-				break;
+				if (b3_stepStats)
+				{
+					++b3_stepStats->positionIterations;
+				}
+
+				// The islands don't share bodies, so each island stops 
+				// when its own position errors are small.
+				u32 contactStart = 0;
+				u32 jointStart = 0;
+				for (u32 k = 0; k < m_islandCount; ++k)
+				{
+					const b3IslandCounts* counts = m_islandCounts + k;
+					
+					u32 contactEnd = contactStart + counts->contactCount;
+					u32 jointEnd = jointStart + counts->jointCount;
+
+					if (m_positionsSolved[k] == false)
+					{
+						bool contactsSolved = contactSolver.SolvePositionConstraints(contactStart, contactEnd);
+						bool jointsSolved = jointSolver.SolvePositionConstraints(jointStart, jointEnd);
+						if (contactsSolved && jointsSolved)
+						{
+							m_positionsSolved[k] = true;
+							++solvedCount;
+						}
+					}
+
+					contactStart = contactEnd;
+					jointStart = jointEnd;
+				}
+
+				B3_ASSERT(contactStart == m_contactCount);
+				B3_ASSERT(jointStart == m_jointCount);
+
+				if (solvedCount == m_islandCount)
+				{
+					// Early out if the position errors are small.
+					break;
+				}
 			}
 		}
 	}
@@ -289,6 +917,11 @@ void b3Island::Solve(const b3Vec3& gravity, scalar dt, u32 velocityIterations, u
 	for (u32 i = 0; i < m_bodyCount; ++i) 
 	{
 		b3Body* b = m_bodies[i];
+		if (b->m_type == e_staticBody)
+		{
+			continue;
+		}
+
 		b->m_sweep.worldCenter = m_positions[i].x;
 		b->m_sweep.orientation = m_positions[i].q;
 		b->m_linearVelocity = m_velocities[i].v;
@@ -298,61 +931,62 @@ void b3Island::Solve(const b3Vec3& gravity, scalar dt, u32 velocityIterations, u
 		b->SynchronizeTransform();
 	}
 
-	// Post solve callback report
-	Report();
-
 	// 7. Put bodies under unconsiderable motion to sleep
 	if (flags & e_sleepBit) 
 	{
-		scalar minSleepTime = B3_MAX_SCALAR;
-
-		for (u32 i = 0; i < m_bodyCount; ++i) 
+		// Each island of the batch sleeps on its own.
+		u32 bodyStart = 0;
+		for (u32 k = 0; k < m_islandCount; ++k)
 		{
-			b3Body* b = m_bodies[i];
-			if (b->m_type == e_staticBody) 
-			{
-				continue;
-			}
+			u32 bodyEnd = bodyStart + m_islandCounts[k].bodyCount;
 
-			// Compute the linear and angular speed of the body.
-			scalar sqrLinVel = b3Dot(b->m_linearVelocity, b->m_linearVelocity);
-			scalar sqrAngVel = b3Dot(b->m_angularVelocity, b->m_angularVelocity);
+			scalar minSleepTime = B3_MAX_SCALAR;
 
-			if (b->IsSleepingAllowed() == false ||
-				sqrLinVel > b->m_linearSleepTolerance * b->m_linearSleepTolerance || 
-				sqrAngVel > b->m_angularSleepTolerance * b->m_angularSleepTolerance) 
+			for (u32 i = bodyStart; i < bodyEnd; ++i) 
 			{
-				b->m_sleepTime = scalar(0);
+				b3Body* b = m_bodies[i];
+				if (b->m_type == e_staticBody) 
+				{
+					continue;
+				}
+
+				// Compute the linear and angular speed of the body.
+				scalar sqrLinVel = b3Dot(b->m_linearVelocity, b->m_linearVelocity);
+				scalar sqrAngVel = b3Dot(b->m_angularVelocity, b->m_angularVelocity);
+
+				if (b->IsSleepingAllowed() == false ||
+					sqrLinVel > b->m_linearSleepTolerance * b->m_linearSleepTolerance || 
+					sqrAngVel > b->m_angularSleepTolerance * b->m_angularSleepTolerance) 
+				{
+					b->m_sleepTime = scalar(0);
+				}
+				else 
+				{
+					b->m_sleepTime += h;
+				}
+
+				minSleepTime = b3Min(minSleepTime, b->m_sleepTime);
 			}
-			else 
+
+			// Put the island to sleep so long as the minimum found sleep time
+			// is below the threshold and the island has solved its position constraints. 
+			if (minSleepTime >= B3_TIME_TO_SLEEP && m_positionsSolved[k]) 
 			{
-				b->m_sleepTime += h;
+				for (u32 i = bodyStart; i < bodyEnd; ++i) 
+				{
+					b3Body* b = m_bodies[i];
+					if (b->m_type == e_staticBody)
+					{
+						continue;
+					}
+
+					b->SetAwake(false);
+				}
 			}
 
-			minSleepTime = b3Min(minSleepTime, b->m_sleepTime);
+			bodyStart = bodyEnd;
 		}
 
-		// Put the island to sleep so long as the minimum found sleep time
-		// is below the threshold. 
-		if (minSleepTime >= B3_TIME_TO_SLEEP && positionsSolved) 
-		{
-			for (u32 i = 0; i < m_bodyCount; ++i) 
-			{
-				m_bodies[i]->SetAwake(false);
-			}
-		}
+		B3_ASSERT(bodyStart == m_bodyCount);
 	}
 }
-
-void b3Island::Report()
-{
-	if (m_listener == nullptr)
-	{
-		return;
-	}
-
-	for (u32 i = 0; i < m_contactCount; ++i)
-	{
-		m_listener->PostSolve(m_contacts[i]);
-	}
-}
\ No newline at end of file
@@ -41,7 +41,12 @@ void b3JointSolver::InitializeConstraints()
 
 void b3JointSolver::WarmStart() 
 {
-	for (u32 i = 0; i < m_count; ++i) 
+	WarmStart(0, m_count);
+}
+
+void b3JointSolver::WarmStart(u32 begin, u32 end) 
+{
+	for (u32 i = begin; i < end; ++i) 
 	{
 		b3Joint* j = m_joints[i];
 		j->WarmStart(&m_solverData);
@@ -50,7 +55,12 @@ void b3JointSolver::WarmStart()
 
 void b3JointSolver::SolveVelocityConstraints() 
 {
-	for (u32 i = 0; i < m_count; ++i) 
+	SolveVelocityConstraints(0, m_count);
+}
+
+void b3JointSolver::SolveVelocityConstraints(u32 begin, u32 end) 
+{
+	for (u32 i = begin; i < end; ++i) 
 	{
 		b3Joint* j = m_joints[i];
 		j->SolveVelocityConstraints(&m_solverData);
@@ -58,9 +68,14 @@ void b3JointSolver::SolveVelocityConstraints()
 }
 
 bool b3JointSolver::SolvePositionConstraints() 
+{
+	return SolvePositionConstraints(0, m_count);
+}
+
+bool b3JointSolver::SolvePositionConstraints(u32 begin, u32 end) 
 {
 	bool jointsSolved = true;
-	for (u32 i = 0; i < m_count; ++i) 
+	for (u32 i = begin; i < end; ++i) 
 	{
 		b3Joint* j = m_joints[i];
 		bool jointSolved = j->SolvePositionConstraints(&m_solverData);
@@ -0,0 +1,330 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/dynamics/toi_solver.h>
+#include <bounce/dynamics/body.h>
+#include <bounce/dynamics/fixture.h>
+#include <bounce/dynamics/time_step.h>
+#include <bounce/dynamics/world_listeners.h>
+#include <bounce/dynamics/contacts/contact_solver.h>
+#include <bounce/collision/broad_phase.h>
+#include <bounce/collision/collide/collide.h>
+#include <bounce/collision/time_of_impact.h>
+#include <bounce/collision/gjk/gjk.h>
+#include <bounce/collision/shapes/mesh_shape.h>
+#include <bounce/collision/geometry/mesh.h>
+
+// The state of a fast body sweeping a sub-step against the broad-phase.
+struct b3TOISolver::QueryCallback
+{
+	struct MeshCallback
+	{
+		bool Report(u32 proxyId)
+		{
+			u32 triangleIndex = callback->meshB->m_mesh->tree.GetUserData(proxyId);
+			callback->Test(triangleIndex);
+			return true;
+		}
+
+		QueryCallback* callback;
+	};
+
+	bool Report(u32 proxyId)
+	{
+		fixtureB = (b3Fixture*)broadPhase->GetUserData(proxyId);
+		if (fixtureB->m_isSensor)
+		{
+			return true;
+		}
+
+		bodyB = fixtureB->m_body;
+		if (bodyB == bodyA)
+		{
+			return true;
+		}
+
+		// Bullets don't tunnel through non-bullet dynamic bodies. 
+		// Other fast bodies only don't tunnel through static and kinematic bodies.
+		if (bodyB->m_type == e_dynamicBody)
+		{
+			if (isBullet == false || (bodyB->m_flags & b3Body::e_bulletFlag))
+			{
+				return true;
+			}
+		}
+
+		if (bodyA->ShouldCollide(bodyB) == false)
+		{
+			return true;
+		}
+
+		if (contactFilter && contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
+		{
+			return true;
+		}
+
+		// The other body is at rest at its final transform.
+		sweepB.localCenter = bodyB->m_sweep.localCenter;
+		sweepB.worldCenter0 = bodyB->m_sweep.worldCenter;
+		sweepB.orientation0 = bodyB->m_sweep.orientation;
+		sweepB.worldCenter = bodyB->m_sweep.worldCenter;
+		sweepB.orientation = bodyB->m_sweep.orientation;
+		sweepB.t0 = scalar(0);
+
+		const b3Shape* shapeB = fixtureB->m_shape;
+
+		if (shapeB->GetType() == b3Shape::e_mesh)
+		{
+			meshB = (b3MeshShape*)shapeB;
+
+			B3_ASSERT(meshB->m_scale.x != scalar(0));
+			B3_ASSERT(meshB->m_scale.y != scalar(0));
+			B3_ASSERT(meshB->m_scale.z != scalar(0));
+
+			b3Vec3 inv_scale;
+			inv_scale.x = scalar(1) / meshB->m_scale.x;
+			inv_scale.y = scalar(1) / meshB->m_scale.y;
+			inv_scale.z = scalar(1) / meshB->m_scale.z;
+
+			const b3Transform& xfB = bodyB->m_xf;
+
+			// Compute the swept aabb in the space of the unscaled tree
+			b3AABB aabb1, aabb2;
+			fixtureA->m_shape->ComputeAABB(&aabb1, b3MulT(xfB, sweepA.GetTransform(scalar(0))));
+			fixtureA->m_shape->ComputeAABB(&aabb2, b3MulT(xfB, sweepA.GetTransform(scalar(1))));
+			
+			b3AABB aabb = b3Combine(aabb1, aabb2);
+			aabb.Scale(inv_scale);
+
+			MeshCallback callback;
+			callback.callback = this;
+
+			meshB->m_mesh->tree.QueryAABB(&callback, aabb);
+
+			return true;
+		}
+
+		// The shape B is convex.
+		Test(0);
+
+		return true;
+	}
+
+	void Test(u32 childIndex)
+	{
+		b3ShapeGJKProxy proxyB(fixtureB->m_shape, childIndex);
+
+		b3TOIInput input;
+		input.proxyA = *proxyA;
+		input.proxyB = proxyB;
+		input.sweepA = sweepA;
+		input.sweepB = sweepB;
+		input.tMax = t;
+
+		b3TOIOutput output = b3TimeOfImpact(input);
+
+		if (output.state != b3TOIOutput::e_touching || output.t >= t)
+		{
+			return;
+		}
+
+		b3Transform xfA = sweepA.GetTransform(output.t);
+		b3Transform xfB = sweepB.GetTransform(output.t);
+
+		b3GJKOutput query = b3GJK(xfA, *proxyA, xfB, proxyB, false);
+		if (query.distance == scalar(0))
+		{
+			return;
+		}
+
+		b3Vec3 n = (query.point2 - query.point1) / query.distance;
+		b3Vec3 p = query.point1 + proxyA->radius * n;
+
+		// Ignore the impact if the body is sliding on or moving away from the other body.
+		// A slow approach is left to the contact solver.
+		scalar alpha = output.t;
+		b3Vec3 cA = (scalar(1) - alpha) * sweepA.worldCenter0 + alpha * sweepA.worldCenter;
+
+		b3Vec3 dv = vA + b3Cross(wA, p - cA) - bodyB->m_linearVelocity - b3Cross(bodyB->m_angularVelocity, p - sweepB.worldCenter);
+		if (h * b3Dot(dv, n) <= B3_LINEAR_SLOP)
+		{
+			return;
+		}
+
+		t = output.t;
+		point = p;
+		normal = n;
+		restitution = b3MixRestitution(fixtureA->m_restitution, fixtureB->m_restitution);
+		fixture = fixtureB;
+	}
+
+	const b3BroadPhase* broadPhase;
+	b3ContactFilter* contactFilter;
+
+	b3Body* bodyA;
+	bool isBullet;
+	b3Fixture* fixtureA;
+	const b3ShapeGJKProxy* proxyA;
+	b3Sweep sweepA;
+	b3Vec3 vA, wA;
+	scalar h; // sub-step duration
+
+	b3Fixture* fixtureB;
+	b3Body* bodyB;
+	b3MeshShape* meshB;
+	b3Sweep sweepB;
+
+	// The earliest impact
+	scalar t;
+	b3Fixture* fixture;
+	b3Vec3 point;
+	b3Vec3 normal;
+	scalar restitution;
+};
+
+b3TOISolver::b3TOISolver(const b3BroadPhase* broadPhase, b3ContactFilter* contactFilter, scalar dt)
+{
+	m_broadPhase = broadPhase;
+	m_contactFilter = contactFilter;
+	m_dt = dt;
+}
+
+u32 b3TOISolver::Solve(b3Body* body, b3TOIImpulse* impulses, u32* impulseCount) const
+{
+	*impulseCount = 0;
+
+	QueryCallback callback;
+	callback.broadPhase = m_broadPhase;
+	callback.contactFilter = m_contactFilter;
+	callback.bodyA = body;
+	callback.isBullet = (body->m_flags & b3Body::e_bulletFlag) != 0;
+	callback.sweepA = body->m_sweep;
+	callback.sweepA.t0 = scalar(0);
+	callback.vA = body->m_linearVelocity;
+	callback.wA = body->m_angularVelocity;
+
+	callback.h = m_dt;
+
+	u32 eventCount = 0;
+
+	for (;;)
+	{
+		callback.t = scalar(1);
+		callback.fixture = nullptr;
+
+		// Find the earliest impact in the sub-step.
+		for (b3Fixture* f = body->m_fixtureList.m_head; f; f = f->m_next)
+		{
+			const b3Shape* shape = f->m_shape;
+			if (f->m_isSensor || shape->GetType() == b3Shape::e_mesh)
+			{
+				continue;
+			}
+
+			b3ShapeGJKProxy proxyA(shape, 0);
+			
+			callback.fixtureA = f;
+			callback.proxyA = &proxyA;
+
+			b3AABB aabb1, aabb2;
+			shape->ComputeAABB(&aabb1, callback.sweepA.GetTransform(scalar(0)));
+			shape->ComputeAABB(&aabb2, callback.sweepA.GetTransform(scalar(1)));
+
+			m_broadPhase->QueryAABB(&callback, b3Combine(aabb1, aabb2));
+		}
+
+		if (callback.fixture == nullptr)
+		{
+			break;
+		}
+
+		++eventCount;
+
+		// Advance the body to the time of impact.
+		scalar alpha = callback.t;
+		b3Vec3 c = (scalar(1) - alpha) * callback.sweepA.worldCenter0 + alpha * callback.sweepA.worldCenter;
+		b3Quat q = callback.sweepA.GetTransform(alpha).rotation;
+
+		if (eventCount == B3_MAX_SUB_STEPS)
+		{
+			// Stop at the impact.
+			callback.sweepA.worldCenter = c;
+			callback.sweepA.orientation = q;
+			break;
+		}
+
+		// Remove the normal velocity at the impact point. 
+		// The impact point is a single witness point and not a contact patch, 
+		// so this only changes the linear velocity of the fast body to avoid spinning it.
+		b3Vec3 n = callback.normal;
+		b3Vec3 r = callback.point - c;
+		
+		b3Body* other = callback.fixture->m_body;
+		b3Vec3 rB = callback.point - other->m_sweep.worldCenter;
+		b3Vec3 dv = callback.vA + b3Cross(callback.wA, r) - other->m_linearVelocity - b3Cross(other->m_angularVelocity, rB);
+		scalar vn = b3Dot(dv, n);
+
+		scalar e = vn > B3_VELOCITY_THRESHOLD ? callback.restitution : scalar(0);
+
+		// Compute the normal impulse from the effective masses.
+		// Static and kinematic bodies have zero inverse mass.
+		scalar mA = body->m_invMass;
+		scalar mB = other->m_invMass;
+		b3Mat33 iB = other->m_worldInvI;
+
+		b3Vec3 rnB = b3Cross(rB, n);
+		scalar K = mA + mB + b3Dot(b3Cross(iB * rnB, rB), n);
+
+		scalar lambda = (scalar(1) + e) * vn / K;
+		b3Vec3 P = lambda * n;
+
+		callback.vA -= mA * P;
+
+		if (other->m_type == e_dynamicBody)
+		{
+			b3TOIImpulse* impulse = impulses + *impulseCount;
+			++*impulseCount;
+			impulse->body = other;
+			impulse->point = callback.point;
+			impulse->impulse = P;
+		}
+
+		// Sweep the remaining time.
+		callback.h *= scalar(1) - alpha;
+
+		callback.sweepA.worldCenter0 = c;
+		callback.sweepA.orientation0 = q;
+		callback.sweepA.worldCenter = c + callback.h * callback.vA;
+		callback.sweepA.orientation = b3Integrate(q, callback.wA, callback.h);
+	}
+
+	if (eventCount == 0)
+	{
+		return 0;
+	}
+
+	// Keep the start of the step so the broad-phase sees the whole motion.
+	body->m_sweep.worldCenter = callback.sweepA.worldCenter;
+	body->m_sweep.orientation = callback.sweepA.orientation;
+	body->m_linearVelocity = callback.vA;
+	body->m_angularVelocity = callback.wA;
+	body->m_worldInvI = b3RotateToFrame(body->m_invI, body->m_sweep.orientation);
+	body->SynchronizeTransform();
+
+	return eventCount;
+}
@@ -17,55 +17,84 @@
 */
 
 #include <bounce/dynamics/world.h>
+#include <bounce/dynamics/world_snapshot.h>
 #include <bounce/dynamics/body.h>
 #include <bounce/dynamics/island.h>
+#include <bounce/dynamics/toi_solver.h>
+#include <bounce/dynamics/articulation_solver.h>
 #include <bounce/dynamics/world_listeners.h>
 #include <bounce/dynamics/fixture.h>
 #include <bounce/dynamics/contacts/contact.h>
+#include <bounce/dynamics/contacts/contact_solver.h>
 #include <bounce/dynamics/joints/joint.h>
 #include <bounce/dynamics/time_step.h>
 #include <bounce/collision/collide/collide.h>
 #include <bounce/collision/time_of_impact.h>
 #include <bounce/collision/gjk/gjk.h>
 #include <bounce/collision/gjk/gjk_proxy.h>
+#include <bounce/collision/shapes/sphere_shape.h>
+#include <bounce/collision/shapes/capsule_shape.h>
+#include <bounce/collision/shapes/triangle_shape.h>
+#include <bounce/collision/shapes/hull_shape.h>
 #include <bounce/collision/shapes/mesh_shape.h>
 #include <bounce/collision/geometry/mesh.h>
 #include <bounce/common/draw.h>
 #include <bounce/common/profiler.h>
+#include <bounce/common/math/simd.h>
+#include <bounce/common/thread/task_executor.h>
+#include <bounce/rope/articulation.h>
 
-extern u32 b3_allocCalls, b3_maxAllocCalls;
-extern u32 b3_convexCalls, b3_convexCacheHits;
-extern u32 b3_gjkCalls, b3_gjkIters, b3_gjkMaxIters;
-extern bool b3_convexCache;
-
-b3Draw* b3Draw_draw = nullptr;
+thread_local b3Draw* b3Draw_draw = nullptr;
 
 b3World::b3World()
 {
-	b3_allocCalls = 0;
-	b3_maxAllocCalls = 0;
-	
-	b3_gjkCalls = 0;
-	b3_gjkIters = 0;
-
-	b3_convexCalls = 0;
-	b3_convexCacheHits = 0;
-
-	b3_convexCache = true;
-
 	m_flags = e_clearForcesFlag;
 	m_sleeping = false;
 	m_warmStarting = true;
+	m_convexCache = true;
+	m_continuous = true;
+	m_collectStats = false;
+	
+	// Fall back to the scalar solver if SIMD isn't available.
+#ifdef B3_SIMD
+	m_simd = true;
+#else
+	m_simd = false;
+#endif
+
 	m_gravity.Set(scalar(0), scalar(-9.8), scalar(0));
+	m_dt = scalar(0);
 	
 	m_drawFlags = 0;
 
 	m_contactMan.m_allocator = &m_blockAllocator;
+	m_contactMan.m_stackAllocator = &m_stackAllocator;
 	m_jointMan.m_allocator = &m_blockAllocator;
+
+	m_allocContext = nullptr;
+	m_taskExecutor = nullptr;
+	m_executorBusy = false;
+	m_workerAllocators = nullptr;
+	m_workerCount = 0;
+
+	m_stepStats.Reset();
+	m_workerStats = nullptr;
+
+	m_querySnapshot = false;
+	m_snapshot = nullptr;
+	m_snapshotList = nullptr;
 }
 
 b3World::~b3World()
 {
+	b3Articulation* a = m_articulationList.m_head;
+	while (a)
+	{
+		b3Articulation* tmp = a;
+		a = a->m_next;
+		DestroyArticulation(tmp);
+	}
+
 	b3Body* b = m_bodyList.m_head;
 	while (b)
 	{
@@ -74,14 +103,105 @@ b3World::~b3World()
 		b = b->m_next;
 	}
 
-	b3_allocCalls = 0;
-	b3_maxAllocCalls = 0;
+	SetTaskExecutor(nullptr);
+
+	// The snapshots must have been released.
+	b3WorldSnapshot* s = m_snapshotList;
+	while (s)
+	{
+		B3_ASSERT(s->m_referenceCount == 0);
+		b3WorldSnapshot* tmp = s;
+		s = s->m_next;
+		tmp->~b3WorldSnapshot();
+		b3Free(tmp);
+	}
+	m_snapshotList = nullptr;
+	m_snapshot = nullptr;
+
+	FreeRetired();
+}
+
+void b3World::SetTaskExecutor(b3TaskExecutor* executor)
+{
+	for (u32 i = 0; i < m_workerCount; ++i)
+	{
+		m_workerAllocators[i].~b3StackAllocator();
+	}
+
+	if (m_workerAllocators)
+	{
+		b3Free(m_workerAllocators);
+		m_workerAllocators = nullptr;
+	}
+
+	if (m_workerStats)
+	{
+		b3Free(m_workerStats);
+		m_workerStats = nullptr;
+	}
+
+	m_taskExecutor = executor;
+	m_workerCount = 0;
+
+	if (m_taskExecutor)
+	{
+		// Each worker needs its own stack allocator.
+		m_workerCount = m_taskExecutor->GetWorkerCount();
+		m_workerAllocators = (b3StackAllocator*)b3Alloc(m_workerCount * sizeof(b3StackAllocator));
+		for (u32 i = 0; i < m_workerCount; ++i)
+		{
+			new (m_workerAllocators + i) b3StackAllocator();
+		}
+
+		// Each worker collects its own statistics.
+		m_workerStats = (b3StepStats*)b3Alloc(m_workerCount * sizeof(b3StepStats));
+	}
+
+	m_contactMan.m_workerAllocators = m_workerAllocators;
+
+	UpdateExecutors();
+}
+
+void b3World::SetStepStats(bool flag)
+{
+	m_collectStats = flag;
+	m_stepStats.Reset();
+
+	UpdateExecutors();
+}
+
+b3TaskExecutor* b3World::GetExecutor()
+{
+	if (m_taskExecutor)
+	{
+		return &m_stepExecutor;
+	}
+	
+	return nullptr;
+}
+
+void b3World::UpdateExecutors()
+{
+	m_stepExecutor.Set(m_taskExecutor, m_collectStats ? m_workerStats : nullptr);
+
+	b3TaskExecutor* executor = GetExecutor();
+	m_contactMan.m_executor = executor;
+	m_contactMan.m_broadPhase->SetTaskExecutor(executor);
+}
 
-	b3_gjkCalls = 0;
-	b3_gjkIters = 0;
+void b3World::SetBroadPhase(b3BroadPhaseType type)
+{
+	b3BroadPhase* broadPhase = m_contactMan.m_broadPhase;
+	B3_ASSERT(broadPhase->GetProxyCount() == 0);
+	
+	if (broadPhase->GetType() == type)
+	{
+		return;
+	}
 
-	b3_convexCalls = 0;
-	b3_convexCacheHits = 0;
+	b3BroadPhase::Destroy(broadPhase);
+	m_contactMan.m_broadPhase = b3BroadPhase::Create(type);
+	m_contactMan.m_broadPhase->SetTaskExecutor(GetExecutor());
 }
 
 void b3World::SetSleeping(bool flag)
@@ -106,11 +226,28 @@ b3Body* b3World::CreateBody(const b3BodyDef& def)
 
 void b3World::DestroyBody(b3Body* b)
 {
+	// Detach the articulations from the body.
+	for (b3Articulation* a = m_articulationList.m_head; a; a = a->m_next)
+	{
+		if (a->m_body == b)
+		{
+			a->m_body = nullptr;
+		}
+	}
+
 	b->DestroyFixtures();
 	b->DestroyJoints();
 	b->DestroyContacts();
 
 	m_bodyList.Remove(b);
+
+	if (IsSnapshotAcquired())
+	{
+		// The retired fixtures of an acquired snapshot might still reference the body.
+		m_retiredBodies.PushFront(b);
+		return;
+	}
+
 	b->~b3Body();
 	m_blockAllocator.Free(b, sizeof(b3Body));
 }
@@ -129,15 +266,26 @@ void b3World::Step(scalar dt, u32 velocityIterations, u32 positionIterations)
 {
 	B3_PROFILE("Step");
 
-	// Clear statistics
-	b3_allocCalls = 0;
+	// Allocate with the context of this world. 
+	// The step executor forwards it to the workers.
+	void* oldAllocContext = b3_allocContext;
+	if (m_allocContext)
+	{
+		b3_allocContext = m_allocContext;
+	}
 
-	b3_convexCalls = 0;
-	b3_convexCacheHits = 0;
+	// Collect the statistics of the calling thread and of each worker.
+	b3StepStats* oldStats = b3_stepStats;
+	if (m_collectStats)
+	{
+		m_stepStats.Reset();
+		for (u32 i = 0; i < m_workerCount; ++i)
+		{
+			m_workerStats[i].Reset();
+		}
 
-	b3_gjkCalls = 0;
-	b3_gjkIters = 0;
-	b3_gjkMaxIters = 0;
+		b3_stepStats = &m_stepStats;
+	}
 
 	if (m_flags & e_fixtureAddedFlag)
 	{
@@ -146,13 +294,208 @@ void b3World::Step(scalar dt, u32 velocityIterations, u32 positionIterations)
 		m_flags &= ~e_fixtureAddedFlag;
 	}
 
+	m_dt = dt;
+
 	// Update contacts. This is where some contacts might be destroyed.
 	m_contactMan.UpdateContacts();
 
 	// Integrate velocities, clear forces and torques, solve constraints, integrate positions.
 	if (dt > scalar(0))
 	{
+		PrepareArticulations();
+
 		Solve(dt, velocityIterations, positionIterations);
+
+		SolveArticulations(dt);
+	}
+
+	if (m_collectStats)
+	{
+		for (u32 i = 0; i < m_workerCount; ++i)
+		{
+			m_stepStats.Merge(m_workerStats[i]);
+		}
+
+		b3_stepStats = oldStats;
+	}
+
+	if (m_querySnapshot)
+	{
+		PublishSnapshot();
+	}
+
+	FreeRetired();
+
+	b3_allocContext = oldAllocContext;
+}
+
+void b3World::SetQuerySnapshot(bool flag)
+{
+	m_querySnapshot = flag;
+	
+	if (flag == false)
+	{
+		WithdrawSnapshot();
+	}
+}
+
+void b3World::PublishSnapshot()
+{
+	B3_PROFILE("Publish Snapshot");
+
+	b3WorldSnapshot* published = m_snapshot.load();
+
+	// Find a snapshot that is neither published nor acquired.
+	b3WorldSnapshot* snapshot = m_snapshotList;
+	while (snapshot)
+	{
+		if (snapshot != published && snapshot->m_referenceCount.load() == 0)
+		{
+			break;
+		}
+		snapshot = snapshot->m_next;
+	}
+
+	if (snapshot == nullptr)
+	{
+		void* mem = b3Alloc(sizeof(b3WorldSnapshot));
+		snapshot = new (mem) b3WorldSnapshot();
+		snapshot->m_next = m_snapshotList;
+		m_snapshotList = snapshot;
+	}
+
+	snapshot->Build(this, GetExecutor());
+
+	m_snapshot.store(snapshot);
+}
+
+void b3World::WithdrawSnapshot()
+{
+	m_snapshot.store(nullptr);
+}
+
+bool b3World::IsSnapshotAcquired() const
+{
+	for (b3WorldSnapshot* s = m_snapshotList; s; s = s->m_next)
+	{
+		if (s->m_referenceCount.load() > 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void b3World::FreeRetired()
+{
+	if (m_retiredFixtures.m_count == 0 && m_retiredBodies.m_count == 0)
+	{
+		return;
+	}
+
+	// The published snapshot was built after the objects were retired. 
+	// A thread can't acquire any other snapshot anymore.
+	b3WorldSnapshot* published = m_snapshot.load();
+	for (b3WorldSnapshot* s = m_snapshotList; s; s = s->m_next)
+	{
+		if (s != published && s->m_referenceCount.load() > 0)
+		{
+			return;
+		}
+	}
+
+	while (m_retiredFixtures.m_head)
+	{
+		b3Fixture* f = m_retiredFixtures.m_head;
+		m_retiredFixtures.Remove(f);
+		f->m_body = nullptr;
+		f->Destroy(&m_blockAllocator);
+		f->~b3Fixture();
+		m_blockAllocator.Free(f, sizeof(b3Fixture));
+	}
+
+	while (m_retiredBodies.m_head)
+	{
+		b3Body* b = m_retiredBodies.m_head;
+		m_retiredBodies.Remove(b);
+		b->~b3Body();
+		m_blockAllocator.Free(b, sizeof(b3Body));
+	}
+}
+
+const b3WorldSnapshot* b3World::AcquireSnapshot() const
+{
+	for (;;)
+	{
+		b3WorldSnapshot* snapshot = m_snapshot.load();
+		if (snapshot == nullptr)
+		{
+			return nullptr;
+		}
+
+		snapshot->m_referenceCount.fetch_add(1);
+
+		// The snapshot might have been replaced and rebuilt since it was loaded. 
+		// If it is still published then it can't be rebuilt until it is released.
+		if (m_snapshot.load() == snapshot)
+		{
+			return snapshot;
+		}
+
+		snapshot->m_referenceCount.fetch_sub(1);
+	}
+}
+
+void b3World::ReleaseSnapshot(const b3WorldSnapshot* snapshot) const
+{
+	B3_ASSERT(snapshot->m_referenceCount.load() > 0);
+	snapshot->m_referenceCount.fetch_sub(1);
+}
+
+// A range of bodies and constraints found by the island search.
+// Small islands are merged into a single range.
+struct b3IslandRange
+{
+	u32 bodyStart, bodyCount;
+	u32 contactStart, contactCount;
+	u32 jointStart, jointCount;
+	u32 islandStart, islandCount;
+};
+
+struct b3SolveIslandsContext
+{
+	const b3IslandRange* islands;
+	const b3IslandCounts* islandCounts;
+	b3Body** bodies;
+	b3Contact** contacts;
+	b3Joint** joints;
+	b3StackAllocator* allocators;
+	b3TaskExecutor* executor;
+	b3Vec3 gravity;
+	scalar dt;
+	u32 velocityIterations;
+	u32 positionIterations;
+	u32 flags;
+};
+
+static void b3SolveIslands(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	b3SolveIslandsContext* ctx = (b3SolveIslandsContext*)context;
+	b3StackAllocator* allocator = ctx->allocators + workerIndex;
+
+	for (u32 i = begin; i < end; ++i)
+	{
+		const b3IslandRange* range = ctx->islands + i;
+
+		b3Island island(allocator, 
+			ctx->bodies + range->bodyStart, range->bodyCount, 
+			ctx->contacts + range->contactStart, range->contactCount, 
+			ctx->joints + range->jointStart, range->jointCount, 
+			ctx->islandCounts + range->islandStart, range->islandCount,
+			ctx->executor);
+
+		// Integrate velocities, clear forces and torques, solve constraints, integrate positions.
+		island.Solve(ctx->gravity, ctx->dt, ctx->velocityIterations, ctx->positionIterations, ctx->flags);
 	}
 }
 
@@ -179,13 +522,29 @@ void b3World::Solve(scalar dt, u32 velocityIterations, u32 positionIterations)
 	u32 islandFlags = 0;
 	islandFlags |= m_warmStarting * b3Island::e_warmStartBit;
 	islandFlags |= m_sleeping * b3Island::e_sleepBit;
+	islandFlags |= m_simd * b3Island::e_simdBit;
 
 	b3Vec3 externalForce = m_gravity;
 
-	// Create a worst case island.
-	b3Island island(&m_stackAllocator, m_bodyList.m_count, m_contactMan.m_contactList.m_count, m_jointMan.m_jointList.m_count, m_contactMan.m_contactListener);
+	// Allocate the island buffers. 
+	// A static body can be added to many islands, but only once per constraint.
+	u32 bodyCapacity = m_bodyList.m_count + m_contactMan.m_contactList.m_count + m_jointMan.m_jointList.m_count;
+	b3Body** bodies = (b3Body**)m_stackAllocator.Allocate(bodyCapacity * sizeof(b3Body*));
+	b3Contact** contacts = (b3Contact**)m_stackAllocator.Allocate(m_contactMan.m_contactList.m_count * sizeof(b3Contact*));
+	b3Joint** joints = (b3Joint**)m_stackAllocator.Allocate(m_jointMan.m_jointList.m_count * sizeof(b3Joint*));
+	b3IslandRange* islands = (b3IslandRange*)m_stackAllocator.Allocate(m_bodyList.m_count * sizeof(b3IslandRange));
+	b3IslandCounts* islandCounts = (b3IslandCounts*)m_stackAllocator.Allocate(m_bodyList.m_count * sizeof(b3IslandCounts));
+	
+	u32 bodyCount = 0;
+	u32 contactCount = 0;
+	u32 jointCount = 0;
+	u32 islandCount = 0;
+	u32 batchCount = 0;
+
+	// The range of the current batch of small islands.
+	b3IslandRange* island = nullptr;
 
-	// Build and simulate awake islands.
+	// Build the awake islands.
 	u32 stackSize = m_bodyList.m_count;
 	b3Body** stack = (b3Body * *)m_stackAllocator.Allocate(stackSize * sizeof(b3Body*));
 	for (b3Body* seed = m_bodyList.m_head; seed; seed = seed->m_next)
@@ -208,8 +567,25 @@ void b3World::Solve(scalar dt, u32 velocityIterations, u32 positionIterations)
 			continue;
 		}
 
+		if (island == nullptr)
+		{
+			// Open a new batch.
+			island = islands + batchCount;
+			++batchCount;
+
+			island->bodyStart = bodyCount;
+			island->contactStart = contactCount;
+			island->jointStart = jointCount;
+			island->islandStart = islandCount;
+		}
+
+		// The solver indices are relative to the batch.
+		// Remember where this island starts in it.
+		u32 bodyStart = bodyCount;
+		u32 contactStart = contactCount;
+		u32 jointStart = jointCount;
+
 		// Perform a depth first search on this body constraint graph.
-		island.Clear();
 		u32 stackCount = 0;
 		stack[stackCount++] = seed;
 		seed->m_flags |= b3Body::e_islandFlag;
@@ -218,17 +594,13 @@ void b3World::Solve(scalar dt, u32 velocityIterations, u32 positionIterations)
 		{
 			// Add this body to the island.
 			b3Body* b = stack[--stackCount];
-			island.Add(b);
+			B3_ASSERT(bodyCount < bodyCapacity);
+			b->m_islandID = bodyCount - island->bodyStart;
+			bodies[bodyCount++] = b;
 
 			// This body must be awake.
 			b->m_flags |= b3Body::e_awakeFlag;
 
-			// Don't propagate islands across static bodies to keep them small.
-			if (b->m_type == e_staticBody)
-			{
-				continue;
-			}
-
 			// Search all contacts connected to this body.
 			for (b3Fixture* f = b->m_fixtureList.m_head; f; f = f->m_next)
 			{
@@ -272,11 +644,32 @@ void b3World::Solve(scalar dt, u32 velocityIterations, u32 positionIterations)
 					}
 
 					// Add contact to the island and mark it.
-					island.Add(contact);
+					contacts[contactCount++] = contact;
 					contact->m_flags |= b3Contact::e_islandFlag;
 
 					b3Body* other = ce->other->GetBody();
 
+					// Don't propagate islands across static bodies to keep them small.
+					// A static body gets a slot per constraint, so constraints 
+					// sharing a static body can be solved in parallel.
+					if (other->m_type == e_staticBody)
+					{
+						B3_ASSERT(bodyCount < bodyCapacity);
+						u32 index = bodyCount - island->bodyStart;
+						bodies[bodyCount++] = other;
+
+						if (contact->GetFixtureA()->GetBody() == other)
+						{
+							contact->m_indexA = index;
+						}
+						else
+						{
+							contact->m_indexB = index;
+						}
+
+						continue;
+					}
+
 					// Skip adjacent vertex if it was visited.
 					if (other->m_flags & b3Body::e_islandFlag)
 					{
@@ -302,11 +695,30 @@ void b3World::Solve(scalar dt, u32 velocityIterations, u32 positionIterations)
 				}
 
 				// Add joint to the island and mark it.
-				island.Add(joint);
+				joints[jointCount++] = joint;
 				joint->m_flags |= b3Joint::e_islandFlag;
 
 				b3Body* other = je->other;
 
+				// Give a static body a slot for this joint.
+				if (other->m_type == e_staticBody)
+				{
+					B3_ASSERT(bodyCount < bodyCapacity);
+					u32 index = bodyCount - island->bodyStart;
+					bodies[bodyCount++] = other;
+
+					if (joint->GetBodyA() == other)
+					{
+						joint->m_indexA = index;
+					}
+					else
+					{
+						joint->m_indexB = index;
+					}
+
+					continue;
+				}
+
 				// The other body must not be on an island.
 				if (other->m_flags & b3Body::e_islandFlag)
 				{
@@ -320,22 +732,188 @@ void b3World::Solve(scalar dt, u32 velocityIterations, u32 positionIterations)
 			}
 		}
 
-		// Integrate velocities, clear forces and torques, solve constraints, integrate positions.
-		island.Solve(externalForce, dt, velocityIterations, positionIterations, islandFlags);
+		// A batch that is colored must contain a single island. 
+		// If this island makes the batch colored then move it to a new batch.
+		// The solver indices of its bodies become relative to the new batch.
+		u32 offset = 0;
+		if (bodyStart > island->bodyStart && 
+			contactCount - island->contactStart + jointCount - island->jointStart >= b3_minParallelIslandConstraints)
+		{
+			offset = bodyStart - island->bodyStart;
+
+			island = islands + batchCount;
+			++batchCount;
+
+			island->bodyStart = bodyStart;
+			island->contactStart = contactStart;
+			island->jointStart = jointStart;
+			island->islandStart = islandCount;
+
+			for (u32 i = bodyStart; i < bodyCount; ++i)
+			{
+				b3Body* b = bodies[i];
+				if (b->m_type != e_staticBody)
+				{
+					b->m_islandID -= offset;
+				}
+			}
+		}
 
-		// Allow static bodies to participate in other islands.
-		for (u32 i = 0; i < island.m_bodyCount; ++i)
+		b3IslandCounts* counts = islandCounts + islandCount;
+		counts->bodyCount = bodyCount - bodyStart;
+		counts->contactCount = contactCount - contactStart;
+		counts->jointCount = jointCount - jointStart;
+		++islandCount;
+
+		island->bodyCount = bodyCount - island->bodyStart;
+		island->contactCount = contactCount - island->contactStart;
+		island->jointCount = jointCount - island->jointStart;
+		island->islandCount = islandCount - island->islandStart;
+
+		// Set the solver indices of the constraints to the non-static bodies.
+		// Shift the indices of the static bodies if the island was moved.
+		for (u32 i = contactStart; i < contactCount; ++i)
 		{
-			b3Body* b = island.m_bodies[i];
-			if (b->m_type == e_staticBody)
+			b3Contact* c = contacts[i];
+			
+			b3Body* bodyA = c->GetFixtureA()->GetBody();
+			if (bodyA->m_type != e_staticBody)
+			{
+				c->m_indexA = bodyA->m_islandID;
+			}
+			else
+			{
+				c->m_indexA -= offset;
+			}
+
+			b3Body* bodyB = c->GetFixtureB()->GetBody();
+			if (bodyB->m_type != e_staticBody)
+			{
+				c->m_indexB = bodyB->m_islandID;
+			}
+			else
 			{
-				b->m_flags &= ~b3Body::e_islandFlag;
+				c->m_indexB -= offset;
 			}
 		}
+
+		for (u32 i = jointStart; i < jointCount; ++i)
+		{
+			b3Joint* j = joints[i];
+			
+			b3Body* bodyA = j->GetBodyA();
+			if (bodyA->m_type != e_staticBody)
+			{
+				j->m_indexA = bodyA->m_islandID;
+			}
+			else
+			{
+				j->m_indexA -= offset;
+			}
+
+			b3Body* bodyB = j->GetBodyB();
+			if (bodyB->m_type != e_staticBody)
+			{
+				j->m_indexB = bodyB->m_islandID;
+			}
+			else
+			{
+				j->m_indexB -= offset;
+			}
+		}
+
+		// Close the batch if it is large enough.
+		if (island->bodyCount + island->contactCount + island->jointCount >= b3_islandBatchSize)
+		{
+			island = nullptr;
+		}
 	}
 
 	m_stackAllocator.Free(stack);
 
+	// Solve the islands. 
+	// The islands are independent, so they can be solved in any order.
+	b3SolveIslandsContext context;
+	context.islands = islands;
+	context.islandCounts = islandCounts;
+	context.bodies = bodies;
+	context.contacts = contacts;
+	context.joints = joints;
+	context.gravity = externalForce;
+	context.dt = dt;
+	context.velocityIterations = velocityIterations;
+	context.positionIterations = positionIterations;
+	context.flags = islandFlags;
+
+	if (b3_stepStats)
+	{
+		b3_stepStats->islandCount += islandCount;
+		b3_stepStats->contactCount += contactCount;
+	}
+
+	b3TaskExecutor* executor = GetExecutor();
+	if (executor)
+	{
+		B3_ASSERT(m_workerCount == executor->GetWorkerCount());
+
+		if (m_workerCount > 1)
+		{
+			// Solve the large islands one at a time on the calling thread.
+			// Their constraints are solved in parallel.
+			context.allocators = &m_stackAllocator;
+			context.executor = executor;
+			
+			u32 smallBatchCount = 0;
+			for (u32 i = 0; i < batchCount; ++i)
+			{
+				const b3IslandRange* range = islands + i;
+				if (range->contactCount + range->jointCount >= b3_minParallelIslandConstraints)
+				{
+					b3SolveIslands(i, i + 1, 0, &context);
+				}
+				else
+				{
+					islands[smallBatchCount++] = *range;
+				}
+			}
+			
+			batchCount = smallBatchCount;
+		}
+
+		// Solve the batches of small islands in parallel.
+		context.allocators = m_workerAllocators;
+		context.executor = nullptr;
+		executor->ParallelFor(batchCount, 1, b3SolveIslands, &context);
+	}
+	else
+	{
+		context.allocators = &m_stackAllocator;
+		context.executor = nullptr;
+		b3SolveIslands(0, batchCount, 0, &context);
+	}
+
+	// Post solve callback report. 
+	// This is done in island order on the calling thread.
+	if (m_contactMan.m_contactListener)
+	{
+		for (u32 i = 0; i < contactCount; ++i)
+		{
+			m_contactMan.m_contactListener->PostSolve(contacts[i]);
+		}
+	}
+
+	m_stackAllocator.Free(islandCounts);
+	m_stackAllocator.Free(islands);
+	m_stackAllocator.Free(joints);
+	m_stackAllocator.Free(contacts);
+	m_stackAllocator.Free(bodies);
+
+	// Prevent the fast bodies from tunneling.
+	if (m_continuous)
+	{
+		SolveTOI(dt);
+	}
+
 	{
 		B3_PROFILE("Find New Pairs");
 
@@ -364,13 +942,265 @@ void b3World::Solve(scalar dt, u32 velocityIterations, u32 positionIterations)
 	}
 }
 
+struct b3SolveTOIContext
+{
+	const b3TOISolver* solver;
+	b3Body** bodies;
+	b3TOIImpulse* impulses;
+	u32* impulseCounts;
+};
+
+static void b3SolveTOITask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	B3_NOT_USED(workerIndex);
+
+	b3SolveTOIContext* ctx = (b3SolveTOIContext*)context;
+
+	u32 eventCount = 0;
+	for (u32 i = begin; i < end; ++i)
+	{
+		eventCount += ctx->solver->Solve(ctx->bodies[i], ctx->impulses + i * B3_MAX_SUB_STEPS, ctx->impulseCounts + i);
+	}
+
+	if (b3_stepStats)
+	{
+		b3_stepStats->toiEvents += eventCount;
+	}
+}
+
+void b3World::SolveTOI(scalar dt)
+{
+	B3_PROFILE("Solve TOI");
+
+	// Find the fast bodies. 
+	// The non-bullets are stored first because the bullets see their final transforms.
+	b3Body** bodies = (b3Body**)m_stackAllocator.Allocate(m_bodyList.m_count * sizeof(b3Body*));
+	u32 bodyCount = 0;
+	u32 bulletCount = 0;
+
+	for (u32 pass = 0; pass < 2; ++pass)
+	{
+		u32 bulletFlag = pass == 0 ? 0 : b3Body::e_bulletFlag;
+
+		for (b3Body* b = m_bodyList.m_head; b; b = b->m_next)
+		{
+			if (b->m_type != e_dynamicBody)
+			{
+				continue;
+			}
+
+			// If a body didn't participate on a island then it didn't move.
+			const u32 flags = b3Body::e_islandFlag | b3Body::e_awakeFlag;
+			if ((b->m_flags & flags) != flags)
+			{
+				continue;
+			}
+
+			if ((b->m_flags & b3Body::e_bulletFlag) != bulletFlag)
+			{
+				continue;
+			}
+
+			// Speculative contacts already keep the body from tunneling.
+			if (b->m_flags & b3Body::e_speculativeFlag)
+			{
+				continue;
+			}
+
+			// A body is fast if it can move more than half of its thinnest fixture in a step.
+			scalar maxMotion = dt * (b3Length(b->m_linearVelocity) + b3Length(b->m_angularVelocity) * b->m_maxExtent);
+			if (maxMotion < scalar(0.5) * b->m_minExtent)
+			{
+				continue;
+			}
+
+			bodies[bodyCount++] = b;
+			bulletCount += pass;
+		}
+	}
+
+	b3TOISolver solver(m_contactMan.m_broadPhase, m_contactMan.m_contactFilter, dt);
+
+	// The impulses on the dynamic bodies hit by the fast bodies.
+	b3TOIImpulse* impulses = (b3TOIImpulse*)m_stackAllocator.Allocate(bodyCount * B3_MAX_SUB_STEPS * sizeof(b3TOIImpulse));
+	u32* impulseCounts = (u32*)m_stackAllocator.Allocate(bodyCount * sizeof(u32));
+
+	b3SolveTOIContext context;
+	context.solver = &solver;
+
+	// A fast body only writes to itself. The non-bullets only read static and kinematic bodies 
+	// and the bullets only read non-bullets, so each group can be solved concurrently.
+	b3TaskExecutor* executor = GetExecutor();
+
+	u32 counts[2] = { bodyCount - bulletCount, bulletCount };
+	u32 start = 0;
+	for (u32 i = 0; i < 2; ++i)
+	{
+		if (counts[i] == 0)
+		{
+			continue;
+		}
+
+		context.bodies = bodies + start;
+		context.impulses = impulses + start * B3_MAX_SUB_STEPS;
+		context.impulseCounts = impulseCounts + start;
+		
+		if (executor)
+		{
+			executor->ParallelFor(counts[i], 1, b3SolveTOITask, &context);
+		}
+		else
+		{
+			b3SolveTOITask(0, counts[i], 0, &context);
+		}
+
+		start += counts[i];
+	}
+
+	// Apply the impulses in body order so the result doesn't depend on the executor.
+	for (u32 i = 0; i < bodyCount; ++i)
+	{
+		for (u32 j = 0; j < impulseCounts[i]; ++j)
+		{
+			b3TOIImpulse* impulse = impulses + i * B3_MAX_SUB_STEPS + j;
+			
+			b3Body* b = impulse->body;
+			b->SetAwake(true);
+			b->m_linearVelocity += b->m_invMass * impulse->impulse;
+			b->m_angularVelocity += b->m_worldInvI * b3Cross(impulse->point - b->m_sweep.worldCenter, impulse->impulse);
+		}
+	}
+
+	m_stackAllocator.Free(impulseCounts);
+	m_stackAllocator.Free(impulses);
+	m_stackAllocator.Free(bodies);
+}
+
+b3Articulation* b3World::CreateArticulation(const b3ArticulationDef& def)
+{
+	void* mem = m_blockAllocator.Allocate(sizeof(b3Articulation));
+	b3Articulation* a = new (mem) b3Articulation(def);
+
+	b3Body* body = def.body;
+	if (body)
+	{
+		B3_ASSERT(body->m_world == this);
+
+		const b3Transform& xf = a->GetLinkTransform(0);
+
+		a->m_body = body;
+		a->m_localFrame = b3MulT(body->m_xf, xf);
+		a->m_baseVelocity0 = body->m_linearVelocity + b3Cross(body->m_angularVelocity, xf.translation - body->m_sweep.worldCenter);
+		a->m_baseAngularVelocity0 = body->m_angularVelocity;
+	}
+
+	m_articulationList.PushFront(a);
+	return a;
+}
+
+void b3World::DestroyArticulation(b3Articulation* a)
+{
+	m_articulationList.Remove(a);
+	a->~b3Articulation();
+	m_blockAllocator.Free(a, sizeof(b3Articulation));
+}
+
+void b3World::PrepareArticulations()
+{
+	for (b3Articulation* a = m_articulationList.m_head; a; a = a->m_next)
+	{
+		b3Body* body = a->m_body;
+		if (body == nullptr)
+		{
+			continue;
+		}
+
+		b3Vec3 x = b3Mul(body->m_xf, a->m_localFrame.translation);
+
+		// Remember the velocity of the base link to compute its acceleration.
+		a->m_baseVelocity0 = body->m_linearVelocity + b3Cross(body->m_angularVelocity, x - body->m_sweep.worldCenter);
+		a->m_baseAngularVelocity0 = body->m_angularVelocity;
+	}
+}
+
+void b3World::SolveArticulations(scalar dt)
+{
+	B3_PROFILE("Solve Articulations");
+
+	b3ArticulationSolver solver(m_contactMan.m_broadPhase, m_gravity, dt);
+
+	for (b3Articulation* a = m_articulationList.m_head; a; a = a->m_next)
+	{
+		solver.Solve(a);
+	}
+}
+
+// The proxies of the world broad-phase.
+struct b3WorldQuerySource
+{
+	template<class T>
+	void QueryAABB(T* callback, const b3AABB& aabb) const
+	{
+		broadPhase->QueryAABB(callback, aabb);
+	}
+
+	template<class T>
+	void RayCast(T* callback, const b3RayCastInput& input) const
+	{
+		broadPhase->RayCast(callback, input);
+	}
+
+	b3Fixture* GetFixture(u32 proxyId) const
+	{
+		return (b3Fixture*)broadPhase->GetUserData(proxyId);
+	}
+
+	b3Transform GetTransform(u32 proxyId, const b3Fixture* fixture) const
+	{
+		B3_NOT_USED(proxyId);
+		return fixture->GetBody()->GetTransform();
+	}
+
+	const b3BroadPhase* broadPhase;
+};
+
+// The proxies of a world snapshot.
+struct b3SnapshotQuerySource
+{
+	template<class T>
+	void QueryAABB(T* callback, const b3AABB& aabb) const
+	{
+		tree->QueryAABB(callback, aabb);
+	}
+
+	template<class T>
+	void RayCast(T* callback, const b3RayCastInput& input) const
+	{
+		tree->RayCast(callback, input);
+	}
+
+	b3Fixture* GetFixture(u32 proxyId) const
+	{
+		return fixtures[tree->GetUserData(proxyId)].fixture;
+	}
+
+	b3Transform GetTransform(u32 proxyId, const b3Fixture* fixture) const
+	{
+		B3_NOT_USED(fixture);
+		return fixtures[tree->GetUserData(proxyId)].xf;
+	}
+
+	const b3StaticTree* tree;
+	const b3SnapshotFixture* fixtures;
+};
+
+template<class S>
 struct b3ShapeRayCastCallback
 {
 	scalar Report(const b3RayCastInput& input, u32 proxyId)
 	{
 		// Get shape associated with the proxy.
-		void* userData = broadPhase->GetUserData(proxyId);
-		b3Fixture* fixture = (b3Fixture*)userData;
+		b3Fixture* fixture = source->GetFixture(proxyId);
 
 		// Does a ray-cast filter prevents the ray-cast?
 		if (filter->ShouldRayCast(fixture) == false)
@@ -381,7 +1211,7 @@ struct b3ShapeRayCastCallback
 
 		// Calculate transformation from shape local space to world space.
 		b3RayCastOutput output;
-		bool hit = fixture->RayCast(&output, input);
+		bool hit = fixture->GetShape()->RayCast(&output, input, source->GetTransform(proxyId, fixture));
 		if (hit)
 		{
 			// Ray hits shape.
@@ -402,30 +1232,38 @@ struct b3ShapeRayCastCallback
 
 	b3RayCastListener* listener;
 	b3RayCastFilter* filter;
-	const b3BroadPhase* broadPhase;
+	const S* source;
 };
 
-void b3World::RayCast(b3RayCastListener* listener, b3RayCastFilter* filter, const b3Vec3& p1, const b3Vec3& p2) const
+template<class S>
+static void b3QueryRayCast(const S& source, b3RayCastListener* listener, b3RayCastFilter* filter, const b3Vec3& p1, const b3Vec3& p2)
 {
 	b3RayCastInput input;
 	input.p1 = p1;
 	input.p2 = p2;
 	input.maxFraction = scalar(1);
 
-	b3ShapeRayCastCallback callback;
+	b3ShapeRayCastCallback<S> callback;
 	callback.listener = listener;
 	callback.filter = filter;
-	callback.broadPhase = &m_contactMan.m_broadPhase;
-	m_contactMan.m_broadPhase.RayCast(&callback, input);
+	callback.source = &source;
+	source.RayCast(&callback, input);
+}
+
+void b3World::RayCast(b3RayCastListener* listener, b3RayCastFilter* filter, const b3Vec3& p1, const b3Vec3& p2) const
+{
+	b3WorldQuerySource source;
+	source.broadPhase = m_contactMan.m_broadPhase;
+	b3QueryRayCast(source, listener, filter, p1, p2);
 }
 
+template<class S>
 struct b3RayCastSingleShapeCallback
 {
 	scalar Report(const b3RayCastInput& input, u32 proxyId)
 	{
 		// Get shape associated with the proxy.
-		void* userData = broadPhase->GetUserData(proxyId);
-		b3Fixture* fixture = (b3Fixture*)userData;
+		b3Fixture* fixture = source->GetFixture(proxyId);
 
 		// Does a ray-cast filter prevents the ray-cast?
 		if (filter->ShouldRayCast(fixture) == false)
@@ -435,7 +1273,7 @@ struct b3RayCastSingleShapeCallback
 		}
 
 		b3RayCastOutput output;
-		bool hit = fixture->RayCast(&output, input);
+		bool hit = fixture->GetShape()->RayCast(&output, input, source->GetTransform(proxyId, fixture));
 		if (hit)
 		{
 			// Track minimum time of impact to require less memory.
@@ -452,25 +1290,26 @@ struct b3RayCastSingleShapeCallback
 
 	b3Fixture* fixture0;
 	b3RayCastOutput output0;
-	const b3BroadPhase* broadPhase;
+	const S* source;
 	b3RayCastFilter* filter;
 };
 
-bool b3World::RayCastSingle(b3RayCastSingleOutput* output, b3RayCastFilter* filter, const b3Vec3& p1, const b3Vec3& p2) const
+template<class S>
+static bool b3QueryRayCastSingle(const S& source, b3RayCastSingleOutput* output, b3RayCastFilter* filter, const b3Vec3& p1, const b3Vec3& p2)
 {
 	b3RayCastInput input;
 	input.p1 = p1;
 	input.p2 = p2;
 	input.maxFraction = scalar(1);
 
-	b3RayCastSingleShapeCallback callback;
+	b3RayCastSingleShapeCallback<S> callback;
 	callback.fixture0 = nullptr;
 	callback.output0.fraction = B3_MAX_SCALAR;
-	callback.broadPhase = &m_contactMan.m_broadPhase;
+	callback.source = &source;
 	callback.filter = filter;
 
 	// Perform the ray cast.
-	m_contactMan.m_broadPhase.RayCast(&callback, input);
+	source.RayCast(&callback, input);
 
 	if (callback.fixture0)
 	{
@@ -490,6 +1329,111 @@ bool b3World::RayCastSingle(b3RayCastSingleOutput* output, b3RayCastFilter* filt
 	return false;
 }
 
+bool b3World::RayCastSingle(b3RayCastSingleOutput* output, b3RayCastFilter* filter, const b3Vec3& p1, const b3Vec3& p2) const
+{
+	b3WorldQuerySource source;
+	source.broadPhase = m_contactMan.m_broadPhase;
+	return b3QueryRayCastSingle(source, output, filter, p1, p2);
+}
+
+struct b3RayCastBatchCallback
+{
+	scalar Report(const b3RayCastInput& input, u32 rayIndex, u32 proxyId)
+	{
+		// Get shape associated with the proxy.
+		void* userData = broadPhase->GetUserData(proxyId);
+		b3Fixture* fixture = (b3Fixture*)userData;
+
+		// Does a ray-cast filter prevents the ray-cast?
+		if (filter->ShouldRayCast(fixture) == false)
+		{
+			// Continue search from where we stopped.
+			return input.maxFraction;
+		}
+
+		b3RayCastOutput output;
+		bool hit = fixture->RayCast(&output, input);
+		if (hit && output.fraction < input.maxFraction)
+		{
+			// Keep the closest intersection and clip the ray.
+			b3RayCastSingleOutput* rayOutput = outputs + rayIndex;
+			rayOutput->fixture = fixture;
+			rayOutput->point = (scalar(1) - output.fraction) * input.p1 + output.fraction * input.p2;
+			rayOutput->normal = output.normal;
+			rayOutput->fraction = output.fraction;
+			
+			return output.fraction;
+		}
+
+		// Continue the search from where we stopped.
+		return input.maxFraction;
+	}
+
+	b3RayCastSingleOutput* outputs;
+	const b3BroadPhase* broadPhase;
+	b3RayCastFilter* filter;
+};
+
+struct b3RayCastBatchContext
+{
+	b3RayCastSingleOutput* outputs;
+	const b3RayCastInput* inputs;
+	u32 count;
+	const b3BroadPhase* broadPhase;
+	b3RayCastFilter* filter;
+};
+
+static void b3RayCastBatchTask(u32 begin, u32 end, u32 workerIndex, void* context)
+{
+	B3_NOT_USED(workerIndex);
+
+	b3RayCastBatchContext* batch = (b3RayCastBatchContext*)context;
+	
+	for (u32 i = begin; i < end; ++i)
+	{
+		u32 first = i * b3_rayPacketSize;
+		u32 count = b3Min(b3_rayPacketSize, batch->count - first);
+
+		for (u32 j = 0; j < count; ++j)
+		{
+			batch->outputs[first + j].fixture = nullptr;
+		}
+
+		b3RayCastBatchCallback callback;
+		callback.outputs = batch->outputs + first;
+		callback.broadPhase = batch->broadPhase;
+		callback.filter = batch->filter;
+
+		batch->broadPhase->RayCastPacket(&callback, batch->inputs + first, count);
+	}
+}
+
+void b3World::RayCastBatch(b3RayCastSingleOutput* outputs, b3RayCastFilter* filter, const b3RayCastInput* inputs, u32 count) const
+{
+	b3RayCastBatchContext context;
+	context.outputs = outputs;
+	context.inputs = inputs;
+	context.count = count;
+	context.broadPhase = m_contactMan.m_broadPhase;
+	context.filter = filter;
+
+	u32 packetCount = (count + b3_rayPacketSize - 1) / b3_rayPacketSize;
+	
+	// Claim the executor. It can't run two loops at a time.
+	if (m_taskExecutor && packetCount > b3_minRayPacketTaskRange && 
+		m_executorBusy.exchange(true, std::memory_order_acquire) == false)
+	{
+		m_taskExecutor->ParallelFor(packetCount, b3_minRayPacketTaskRange, b3RayCastBatchTask, &context);
+
+		m_executorBusy.store(false, std::memory_order_release);
+	}
+	else
+	{
+		b3RayCastBatchTask(0, packetCount, 0, &context);
+	}
+}
+
+template<class S>
 struct b3ShapeCastQueryCallback
 {
 	struct MeshCallback
@@ -498,8 +1442,7 @@ struct b3ShapeCastQueryCallback
 		{
 			u32 triangleIndex = callback->meshB->m_mesh->tree.GetUserData(proxyId);
 
-			b3Body* bodyB = callback->fixtureB->GetBody();
-			b3Transform xfB = bodyB->GetTransform();
+			b3Transform xfB = callback->xfB;
 			b3ShapeGJKProxy proxyB(callback->meshB, triangleIndex);
 
 			b3TOIOutput toi = b3TimeOfImpact(callback->xfA, *callback->proxyA, callback->dA, xfB, proxyB, b3Vec3_zero);
@@ -518,6 +1461,7 @@ struct b3ShapeCastQueryCallback
 				{
 					callback->fraction0 = fraction;
 					callback->fixture0 = callback->fixtureB;
+					callback->xf0 = xfB;
 					callback->childIndex0 = triangleIndex;
 				}
 
@@ -548,15 +1492,13 @@ struct b3ShapeCastQueryCallback
 
 	bool Report(u32 proxyId)
 	{
-		void* userData = broadPhase->GetUserData(proxyId);
-		fixtureB = (b3Fixture*)userData;
+		fixtureB = source->GetFixture(proxyId);
 		if (filter->ShouldShapeCast(fixtureB) == false)
 		{
 			return true;
 		}
 
-		b3Body* bodyB = fixtureB->GetBody();
-		b3Transform xfB = bodyB->GetTransform();
+		xfB = source->GetTransform(proxyId, fixtureB);
 		b3Shape* shapeB = fixtureB->GetShape();
 
 		if (shapeB->GetType() == b3Shape::e_mesh)
@@ -642,6 +1584,7 @@ struct b3ShapeCastQueryCallback
 			{
 				fraction0 = fraction;
 				fixture0 = fixtureB;
+				xf0 = xfB;
 				childIndex0 = 0;
 			}
 
@@ -690,18 +1633,21 @@ struct b3ShapeCastQueryCallback
 
 	b3ShapeCastListener* listener;
 	b3ShapeCastFilter* filter;
-	const b3BroadPhase* broadPhase;
+	const S* source;
 
 	b3Fixture* fixtureB;
+	b3Transform xfB;
 	b3MeshShape* meshB;
 
 	b3Fixture* fixture0;
+	b3Transform xf0;
 	u32 childIndex0;
 	scalar fraction0;
 };
 
-void b3World::ShapeCast(b3ShapeCastListener* listener, b3ShapeCastFilter* filter, 
-	const b3Shape* shape, const b3Transform& xf, const b3Vec3& displacement) const
+template<class S>
+static void b3QueryShapeCast(const S& source, b3ShapeCastListener* listener, b3ShapeCastFilter* filter, 
+	const b3Shape* shape, const b3Transform& xf, const b3Vec3& displacement)
 {
 	// The shape must be convex.
 	B3_ASSERT(shape->m_type != b3Shape::e_mesh);
@@ -742,7 +1688,7 @@ void b3World::ShapeCast(b3ShapeCastListener* listener, b3ShapeCastFilter* filter
 		aabb.upperBound.z += displacement.z;
 	}
 
-	b3ShapeCastQueryCallback callback;
+	b3ShapeCastQueryCallback<S> callback;
 	callback.listener = listener;
 	callback.filter = filter;
 	callback.shapeA = shape;
@@ -753,13 +1699,22 @@ void b3World::ShapeCast(b3ShapeCastListener* listener, b3ShapeCastFilter* filter
 	callback.fixture0 = nullptr;
 	callback.fraction0 = B3_MAX_SCALAR;
 	callback.childIndex0 = B3_MAX_U32;
-	callback.broadPhase = &m_contactMan.m_broadPhase;
+	callback.source = &source;
 
-	m_contactMan.m_broadPhase.QueryAABB(&callback, aabb);
+	source.QueryAABB(&callback, aabb);
 }
 
-bool b3World::ShapeCastSingle(b3ShapeCastSingleOutput* output, b3ShapeCastFilter* filter, 
+void b3World::ShapeCast(b3ShapeCastListener* listener, b3ShapeCastFilter* filter, 
 	const b3Shape* shape, const b3Transform& xf, const b3Vec3& displacement) const
+{
+	b3WorldQuerySource source;
+	source.broadPhase = m_contactMan.m_broadPhase;
+	b3QueryShapeCast(source, listener, filter, shape, xf, displacement);
+}
+
+template<class S>
+static bool b3QueryShapeCastSingle(const S& source, b3ShapeCastSingleOutput* output, b3ShapeCastFilter* filter, 
+	const b3Shape* shape, const b3Transform& xf, const b3Vec3& displacement)
 {
 	B3_ASSERT(shape->m_type != b3Shape::e_mesh);
 	if (shape->m_type == b3Shape::e_mesh)
@@ -799,7 +1754,7 @@ bool b3World::ShapeCastSingle(b3ShapeCastSingleOutput* output, b3ShapeCastFilter
 		aabb.upperBound.z += displacement.z;
 	}
 
-	b3ShapeCastQueryCallback callback;
+	b3ShapeCastQueryCallback<S> callback;
 	callback.listener = nullptr;
 	callback.filter = filter;
 	callback.proxyA = &proxyA;
@@ -810,9 +1765,9 @@ bool b3World::ShapeCastSingle(b3ShapeCastSingleOutput* output, b3ShapeCastFilter
 	callback.fixture0 = nullptr;
 	callback.childIndex0 = B3_MAX_U32;
 	callback.fraction0 = B3_MAX_SCALAR;
-	callback.broadPhase = &m_contactMan.m_broadPhase;
+	callback.source = &source;
 
-	m_contactMan.m_broadPhase.QueryAABB(&callback, aabb);
+	source.QueryAABB(&callback, aabb);
 
 	if (callback.fixture0 == nullptr)
 	{
@@ -821,8 +1776,7 @@ bool b3World::ShapeCastSingle(b3ShapeCastSingleOutput* output, b3ShapeCastFilter
 
 	b3ShapeGJKProxy proxyB(callback.fixture0->GetShape(), callback.childIndex0);
 
-	b3Body* bodyB = callback.fixture0->GetBody();
-	b3Transform xfB = bodyB->GetTransform();
+	b3Transform xfB = callback.xf0;
 	
 	b3Transform xft;
 	xft.translation = xf.translation + callback.fraction0 * displacement;
@@ -839,11 +1793,20 @@ bool b3World::ShapeCastSingle(b3ShapeCastSingleOutput* output, b3ShapeCastFilter
 	return true;
 }
 
+bool b3World::ShapeCastSingle(b3ShapeCastSingleOutput* output, b3ShapeCastFilter* filter, 
+	const b3Shape* shape, const b3Transform& xf, const b3Vec3& displacement) const
+{
+	b3WorldQuerySource source;
+	source.broadPhase = m_contactMan.m_broadPhase;
+	return b3QueryShapeCastSingle(source, output, filter, shape, xf, displacement);
+}
+
+template<class S>
 struct b3QueryAABBCallback
 {
 	bool Report(u32 proxyID)
 	{
-		b3Fixture* fixture = (b3Fixture*)broadPhase->GetUserData(proxyID);
+		b3Fixture* fixture = source->GetFixture(proxyID);
 
 		if (filter->ShouldReport(fixture))
 		{
@@ -855,16 +1818,66 @@ struct b3QueryAABBCallback
 
 	b3QueryListener* listener;
 	b3QueryFilter* filter;
-	const b3BroadPhase* broadPhase;
+	const S* source;
 };
 
-void b3World::QueryAABB(b3QueryListener* listener, b3QueryFilter* filter, const b3AABB& aabb) const
+template<class S>
+static void b3QueryFixtures(const S& source, b3QueryListener* listener, b3QueryFilter* filter, const b3AABB& aabb)
 {
-	b3QueryAABBCallback callback;
+	b3QueryAABBCallback<S> callback;
 	callback.listener = listener;
 	callback.filter = filter;
-	callback.broadPhase = &m_contactMan.m_broadPhase;
-	m_contactMan.m_broadPhase.QueryAABB(&callback, aabb);
+	callback.source = &source;
+	source.QueryAABB(&callback, aabb);
+}
+
+void b3World::QueryAABB(b3QueryListener* listener, b3QueryFilter* filter, const b3AABB& aabb) const
+{
+	b3WorldQuerySource source;
+	source.broadPhase = m_contactMan.m_broadPhase;
+	b3QueryFixtures(source, listener, filter, aabb);
+}
+
+void b3WorldSnapshot::RayCast(b3RayCastListener* listener, b3RayCastFilter* filter, const b3Vec3& p1, const b3Vec3& p2) const
+{
+	b3SnapshotQuerySource source;
+	source.tree = &m_tree;
+	source.fixtures = m_fixtures;
+	b3QueryRayCast(source, listener, filter, p1, p2);
+}
+
+bool b3WorldSnapshot::RayCastSingle(b3RayCastSingleOutput* output, b3RayCastFilter* filter, const b3Vec3& p1, const b3Vec3& p2) const
+{
+	b3SnapshotQuerySource source;
+	source.tree = &m_tree;
+	source.fixtures = m_fixtures;
+	return b3QueryRayCastSingle(source, output, filter, p1, p2);
+}
+
+void b3WorldSnapshot::ShapeCast(b3ShapeCastListener* listener, b3ShapeCastFilter* filter, 
+	const b3Shape* shape, const b3Transform& xf, const b3Vec3& displacement) const
+{
+	b3SnapshotQuerySource source;
+	source.tree = &m_tree;
+	source.fixtures = m_fixtures;
+	b3QueryShapeCast(source, listener, filter, shape, xf, displacement);
+}
+
+bool b3WorldSnapshot::ShapeCastSingle(b3ShapeCastSingleOutput* output, b3ShapeCastFilter* filter, 
+	const b3Shape* shape, const b3Transform& xf, const b3Vec3& displacement) const
+{
+	b3SnapshotQuerySource source;
+	source.tree = &m_tree;
+	source.fixtures = m_fixtures;
+	return b3QueryShapeCastSingle(source, output, filter, shape, xf, displacement);
+}
+
+void b3WorldSnapshot::QueryAABB(b3QueryListener* listener, b3QueryFilter* filter, const b3AABB& aabb) const
+{
+	b3SnapshotQuerySource source;
+	source.tree = &m_tree;
+	source.fixtures = m_fixtures;
+	b3QueryFixtures(source, listener, filter, aabb);
 }
 
 void b3World::Draw() const
@@ -904,7 +1917,7 @@ void b3World::Draw() const
 		{
 			for (b3Fixture* f = b->m_fixtureList.m_head; f; f = f->m_next)
 			{
-				const b3AABB& aabb = m_contactMan.m_broadPhase.GetAABB(f->m_broadPhaseID);
+				const b3AABB& aabb = m_contactMan.m_broadPhase->GetAABB(f->m_broadPhaseID);
 				b3Draw_draw->DrawAABB(aabb, b3Color_pink);
 			}
 		}
@@ -918,6 +1931,14 @@ void b3World::Draw() const
 		}
 	}
 
+	if (flags & e_shapesFlag)
+	{
+		for (b3Articulation* a = m_articulationList.m_head; a; a = a->m_next)
+		{
+			a->Draw();
+		}
+	}
+
 	for (b3Contact* c = m_contactMan.m_contactList.m_head; c; c = c->m_next)
 	{
 		u32 manifoldCount = c->m_manifoldCount;
@@ -0,0 +1,82 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/dynamics/world_snapshot.h>
+#include <bounce/dynamics/body.h>
+#include <bounce/dynamics/fixture.h>
+
+b3WorldSnapshot::b3WorldSnapshot()
+{
+	m_fixtureCount = 0;
+	m_fixtureCapacity = 0;
+	m_fixtures = nullptr;
+	m_aabbs = nullptr;
+	m_referenceCount = 0;
+	m_next = nullptr;
+}
+
+b3WorldSnapshot::~b3WorldSnapshot()
+{
+	b3Free(m_fixtures);
+	b3Free(m_aabbs);
+}
+
+void b3WorldSnapshot::Build(b3World* world, b3TaskExecutor* executor)
+{
+	B3_ASSERT(m_referenceCount == 0);
+
+	u32 fixtureCount = 0;
+	for (b3Body* b = world->GetBodyList().m_head; b; b = b->GetNext())
+	{
+		fixtureCount += b->GetFixtureList().m_count;
+	}
+
+	// Check capacity.
+	if (fixtureCount > m_fixtureCapacity)
+	{
+		b3Free(m_fixtures);
+		b3Free(m_aabbs);
+
+		m_fixtureCapacity = b3Max(fixtureCount, 2 * m_fixtureCapacity);
+		m_fixtures = (b3SnapshotFixture*)b3Alloc(m_fixtureCapacity * sizeof(b3SnapshotFixture));
+		m_aabbs = (b3AABB*)b3Alloc(m_fixtureCapacity * sizeof(b3AABB));
+	}
+
+	// Copy the fixtures, their body transforms, and their broad-phase AABBs.
+	m_fixtureCount = 0;
+	for (b3Body* b = world->GetBodyList().m_head; b; b = b->GetNext())
+	{
+		b3Transform xf = b->GetTransform();
+		for (b3Fixture* f = b->GetFixtureList().m_head; f; f = f->GetNext())
+		{
+			m_fixtures[m_fixtureCount].fixture = f;
+			m_fixtures[m_fixtureCount].xf = xf;
+			m_aabbs[m_fixtureCount] = f->GetAABB();
+			++m_fixtureCount;
+		}
+	}
+
+	m_tree.Clear();
+
+	if (m_fixtureCount > 0)
+	{
+		b3StaticTreeDef def;
+		def.executor = executor;
+		m_tree.Build(m_aabbs, m_fixtureCount, def);
+	}
+}
@@ -0,0 +1,793 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/rope/articulation.h>
+#include <bounce/rope/spatial.h>
+#include <bounce/common/draw.h>
+
+// Convert a rigid transform to a spatial transform.
+static B3_FORCE_INLINE b3SpTransform b3ConvertToSpTransform(const b3Transform& X)
+{
+	// Flip the translation because r should be the vector 
+	// from the origin of the old frame to the origin of the new frame 
+	// in the new frame.
+	return b3SpTransform(b3QuatMat33(X.rotation), -X.translation);
+}
+
+struct b3ArticulationLink
+{
+	b3ArticulationLink() { }
+
+	// J * v
+	b3MotionVec v_J() const
+	{
+		return m_S[0] * m_v[0] + m_S[1] * m_v[1] + m_S[2] * m_v[2];
+	}
+
+	// 
+	b3Transform X_J() const
+	{
+		// Rigid Body Dynamics Algorithms p. 79, 86
+		b3Transform X;
+		
+		switch (m_type)
+		{
+		case e_revoluteArticulationJoint:
+		{
+			b3Quat p;
+			p.SetAxisAngle(m_axis, m_q);
+
+			X.rotation = b3Conjugate(p);
+			X.translation.SetZero();
+			break;
+		}
+		case e_sphericalArticulationJoint:
+		{
+			// E = mat33(inv(p))
+			X.rotation = b3Conjugate(m_p);
+			X.translation.SetZero();
+			break;
+		}
+		case e_prismaticArticulationJoint:
+		{
+			X.rotation.SetIdentity();
+			X.translation = -m_q * m_axis;
+			break;
+		}
+		default:
+		{
+			B3_ASSERT(false);
+			X.SetIdentity();
+			break;
+		}
+		}
+
+		return X;
+	}
+
+	// Shared
+
+	// Body
+
+	//
+	u32 m_parent;
+
+	//
+	scalar m_m;
+
+	//
+	b3Mat33 m_I;
+
+	//
+	scalar m_radius;
+
+	// External force.
+	b3ForceVec m_Fe;
+
+	// Joint
+
+	//
+	b3ArticulationJointType m_type;
+
+	// Number of degrees of freedom.
+	u32 m_dofCount;
+
+	// Unused columns are zero.
+	b3MotionVec m_S[3];
+
+	//
+	b3Transform m_X_i_J;
+
+	// 
+	b3Transform m_X_J_j;
+
+	// Joint axis in the joint frame.
+	b3Vec3 m_axis;
+
+	// Spherical joint position.
+	b3Quat m_p;
+
+	// Revolute or prismatic joint position.
+	scalar m_q;
+
+	//
+	b3Vec3 m_v;
+
+	//
+	b3Vec3 m_tau;
+
+	// Temp
+
+	//
+	b3SpTransform m_X_i_j;
+
+	//
+	b3MotionVec m_sv;
+
+	//
+	b3MotionVec m_sc;
+
+	//
+	b3SpInertia m_I_A;
+
+	//
+	b3ForceVec m_F_A;
+
+	//
+	b3ForceVec m_U[3];
+
+	//
+	b3Mat33 m_invD;
+
+	//
+	b3Vec3 m_u;
+
+	//
+	b3Vec3 m_a;
+
+	//
+	b3MotionVec m_sa;
+
+	//
+	b3Transform m_invX;
+
+	//
+	b3Transform m_X;
+};
+
+b3Articulation::b3Articulation(const b3ArticulationDef& def)
+{
+	B3_ASSERT(def.count > 0);
+	B3_ASSERT(def.links[0].parent == B3_MAX_U32);
+
+	m_gravity.SetZero();
+	m_linearDamping = def.linearDamping;
+	m_angularDamping = def.angularDamping;
+	m_friction = def.friction;
+	m_linkCount = def.count;
+	m_links = (b3ArticulationLink*)b3Alloc(m_linkCount * sizeof(b3ArticulationLink));
+
+	for (u32 i = 0; i < m_linkCount; ++i)
+	{
+		const b3ArticulationLinkDef& ld = def.links[i];
+		b3ArticulationLink* b = m_links + i;
+
+		b->m_parent = ld.parent;
+		b->m_m = ld.mass;
+		b->m_I = ld.inertia;
+		b->m_radius = ld.radius;
+		b->m_Fe.SetZero();
+		b->m_type = ld.jointType;
+		b->m_X.rotation = ld.orientation;
+		b->m_X.translation = ld.position;
+		b->m_p.SetIdentity();
+		b->m_q = scalar(0);
+		b->m_v.SetZero();
+		b->m_tau.SetZero();
+		b->m_sv.SetZero();
+	}
+
+	m_baseMotion = false;
+	m_baseMass = scalar(0);
+	m_baseInertia.SetZero();
+	m_baseCenter.SetZero();
+	m_reactionForce.SetZero();
+	m_reactionTorque.SetZero();
+	m_body = nullptr;
+	m_localFrame.SetIdentity();
+	m_baseVelocity0.SetZero();
+	m_baseAngularVelocity0.SetZero();
+	m_prev = nullptr;
+	m_next = nullptr;
+
+	for (u32 i = 1; i < m_linkCount; ++i)
+	{
+		const b3ArticulationLinkDef& ld = def.links[i];
+		b3ArticulationLink* b = m_links + i;
+
+		B3_ASSERT(b->m_parent < i);
+		b3ArticulationLink* b0 = m_links + b->m_parent;
+
+		B3_ASSERT(b->m_m > scalar(0));
+
+		// The joint frame is aligned with the parent link frame and located at the anchor point.
+		b3Transform X_J;
+		X_J.rotation = b0->m_X.rotation;
+		X_J.translation = ld.anchor;
+
+		b->m_X_i_J = b3MulT(X_J, b0->m_X);
+
+		b->m_X_J_j = b3MulT(b->m_X, X_J);
+
+		b->m_axis = b3MulC(X_J.rotation, ld.axis);
+		b->m_axis.Normalize();
+
+		// Convert the joint motion subspace from the joint frame to the link frame.
+		b3SpTransform X = b3ConvertToSpTransform(b->m_X_J_j);
+
+		switch (b->m_type)
+		{
+		case e_revoluteArticulationJoint:
+		{
+			b->m_dofCount = 1;
+			b->m_S[0] = b3Mul(X, b3MotionVec(b->m_axis, b3Vec3_zero));
+			b->m_S[1].SetZero();
+			b->m_S[2].SetZero();
+			break;
+		}
+		case e_sphericalArticulationJoint:
+		{
+			b->m_dofCount = 3;
+			b->m_S[0] = b3Mul(X, b3MotionVec(b3Vec3_x, b3Vec3_zero));
+			b->m_S[1] = b3Mul(X, b3MotionVec(b3Vec3_y, b3Vec3_zero));
+			b->m_S[2] = b3Mul(X, b3MotionVec(b3Vec3_z, b3Vec3_zero));
+			break;
+		}
+		case e_prismaticArticulationJoint:
+		{
+			b->m_dofCount = 1;
+			b->m_S[0] = b3Mul(X, b3MotionVec(b3Vec3_zero, b->m_axis));
+			b->m_S[1].SetZero();
+			b->m_S[2].SetZero();
+			break;
+		}
+		default:
+		{
+			B3_ASSERT(false);
+			break;
+		}
+		}
+	}
+}
+
+b3Articulation::~b3Articulation()
+{
+	b3Free(m_links);
+}
+
+void b3Articulation::SetPosition(const b3Vec3& position)
+{
+	B3_ASSERT(m_linkCount > 0);
+	m_links->m_X.translation = position;
+
+	// Propagate down transforms
+	for (u32 j = 1; j < m_linkCount; ++j)
+	{
+		b3ArticulationLink* link = m_links + j;
+		b3ArticulationLink* parent = m_links + link->m_parent;
+
+		b3Transform X_i_j = link->m_X_J_j * link->X_J() * link->m_X_i_J;
+
+		link->m_X = parent->m_X * b3Inverse(X_i_j);
+	}
+}
+
+const b3Vec3& b3Articulation::GetPosition() const
+{
+	B3_ASSERT(m_linkCount > 0);
+	return m_links->m_X.translation;
+}
+
+void b3Articulation::SetLinearVelocity(const b3Vec3& linearVelocity)
+{
+	B3_ASSERT(m_linkCount > 0);
+	m_links->m_sv.v = b3MulC(m_links->m_X.rotation, linearVelocity);
+}
+
+b3Vec3 b3Articulation::GetLinearVelocity() const
+{
+	B3_ASSERT(m_linkCount > 0);
+	return b3Mul(m_links->m_X.rotation, m_links->m_sv.v);
+}
+
+void b3Articulation::SetAngularVelocity(const b3Vec3& angularVelocity)
+{
+	B3_ASSERT(m_linkCount > 0);
+	m_links->m_sv.w = b3MulC(m_links->m_X.rotation, angularVelocity);
+}
+
+b3Vec3 b3Articulation::GetAngularVelocity() const
+{
+	B3_ASSERT(m_linkCount > 0);
+	return b3Mul(m_links->m_X.rotation, m_links->m_sv.w);
+}
+
+const b3Transform& b3Articulation::GetLinkTransform(u32 index) const
+{
+	B3_ASSERT(index < m_linkCount);
+	return m_links[index].m_X;
+}
+
+b3ArticulationJointType b3Articulation::GetJointType(u32 index) const
+{
+	B3_ASSERT(index > 0 && index < m_linkCount);
+	return m_links[index].m_type;
+}
+
+scalar b3Articulation::GetJointPosition(u32 index) const
+{
+	B3_ASSERT(index > 0 && index < m_linkCount);
+	B3_ASSERT(m_links[index].m_type != e_sphericalArticulationJoint);
+	return m_links[index].m_q;
+}
+
+void b3Articulation::SetJointVelocity(u32 index, const b3Vec3& velocity)
+{
+	B3_ASSERT(index > 0 && index < m_linkCount);
+	b3ArticulationLink* link = m_links + index;
+	link->m_v = velocity;
+	if (link->m_dofCount == 1)
+	{
+		link->m_v.y = scalar(0);
+		link->m_v.z = scalar(0);
+	}
+}
+
+const b3Vec3& b3Articulation::GetJointVelocity(u32 index) const
+{
+	B3_ASSERT(index > 0 && index < m_linkCount);
+	return m_links[index].m_v;
+}
+
+void b3Articulation::SetJointForce(u32 index, const b3Vec3& force)
+{
+	B3_ASSERT(index > 0 && index < m_linkCount);
+	b3ArticulationLink* link = m_links + index;
+	link->m_tau = force;
+	if (link->m_dofCount == 1)
+	{
+		link->m_tau.y = scalar(0);
+		link->m_tau.z = scalar(0);
+	}
+}
+
+void b3Articulation::ApplyForce(u32 index, const b3Vec3& force, const b3Vec3& point)
+{
+	B3_ASSERT(index < m_linkCount);
+	b3ArticulationLink* link = m_links + index;
+
+	// Convert global force to local force.
+	b3Vec3 torque = b3Cross(point - link->m_X.translation, force);
+
+	link->m_Fe.n += b3MulC(link->m_X.rotation, force);
+	link->m_Fe.f += b3MulC(link->m_X.rotation, torque);
+}
+
+b3Vec3 b3Articulation::GetLinkLinearVelocity(u32 index) const
+{
+	B3_ASSERT(index < m_linkCount);
+	const b3ArticulationLink* link = m_links + index;
+	return b3Mul(link->m_X.rotation, link->m_sv.v);
+}
+
+b3Vec3 b3Articulation::GetLinkAngularVelocity(u32 index) const
+{
+	B3_ASSERT(index < m_linkCount);
+	const b3ArticulationLink* link = m_links + index;
+	return b3Mul(link->m_X.rotation, link->m_sv.w);
+}
+
+scalar b3Articulation::GetLinkMass(u32 index) const
+{
+	B3_ASSERT(index < m_linkCount);
+	return m_links[index].m_m;
+}
+
+b3Mat33 b3Articulation::GetLinkInertia(u32 index) const
+{
+	B3_ASSERT(index < m_linkCount);
+	const b3ArticulationLink* link = m_links + index;
+	b3Mat33 R = b3QuatMat33(link->m_X.rotation);
+	return R * link->m_I * b3Transpose(R);
+}
+
+scalar b3Articulation::GetLinkRadius(u32 index) const
+{
+	B3_ASSERT(index < m_linkCount);
+	return m_links[index].m_radius;
+}
+
+b3Vec3 b3Articulation::GetLinkAnchor(u32 index) const
+{
+	B3_ASSERT(index < m_linkCount);
+	if (index == 0)
+	{
+		return b3Vec3_zero;
+	}
+	return m_links[index].m_X_J_j.translation;
+}
+
+void b3Articulation::SetBaseMotion(const b3Transform& xf, const b3Vec3& v, const b3Vec3& w, const b3Vec3& a, const b3Vec3& alpha,
+	scalar mass, const b3Mat33& I, const b3Vec3& center)
+{
+	B3_ASSERT(m_linkCount > 0);
+	b3ArticulationLink* b = m_links;
+
+	b3Mat33 R = b3QuatMat33(xf.rotation);
+
+	m_baseMass = mass;
+	m_baseInertia = b3Transpose(R) * I * R;
+	m_baseCenter = b3MulT(xf, center);
+
+	b->m_X = xf;
+	b->m_sv.v = b3MulC(xf.rotation, v);
+	b->m_sv.w = b3MulC(xf.rotation, w);
+	
+	// The linear velocity is expressed in the base frame, which rotates.
+	b->m_sa.v = b3MulC(xf.rotation, a) - b3Cross(b->m_sv.w, b->m_sv.v);
+	b->m_sa.w = b3MulC(xf.rotation, alpha);
+
+	m_baseMotion = true;
+}
+
+void b3Articulation::Step(scalar h)
+{
+	// Propagate down.
+	{
+		b3ArticulationLink* b = m_links;
+
+		b->m_invX = b3Inverse(b->m_X);
+
+		if (b->m_m == scalar(0))
+		{
+			b->m_I_A.SetZero();
+			b->m_F_A = -b->m_Fe;
+		}
+		else
+		{
+			// Bias force
+			b3ForceVec Pdot;
+			Pdot.n = b3Cross(b->m_sv.w, b->m_m * b->m_sv.v);
+			Pdot.f = b3Cross(b->m_sv.w, b->m_I * b->m_sv.w);
+
+			// Convert global force to local force.
+			b3ForceVec F;
+			F.n = b->m_m * b3Mul(b->m_invX.rotation, m_gravity);
+			F.f.SetZero();
+
+			// Damping force
+			b3ForceVec Fd;
+			Fd.n = -m_linearDamping * b->m_m * b->m_sv.v;
+			Fd.f = -m_angularDamping * (b->m_I * b->m_sv.w);
+
+			b->m_I_A.SetLocalInertia(b->m_m, b->m_I);
+			b->m_F_A = Pdot - (F + Fd + b->m_Fe);
+		}
+	}
+
+	for (u32 i = 1; i < m_linkCount; ++i)
+	{
+		b3ArticulationLink* link = m_links + i;
+		b3ArticulationLink* parent = m_links + link->m_parent;
+
+		b3Transform X_i_j = link->m_X_J_j * link->X_J() * link->m_X_i_J;
+
+		link->m_invX = X_i_j * parent->m_invX;
+		
+		link->m_X_i_j = b3ConvertToSpTransform(X_i_j);
+
+		b3MotionVec joint_v = link->v_J();
+
+		b3MotionVec parent_v = b3Mul(link->m_X_i_j, parent->m_sv);
+
+		link->m_sv = parent_v + joint_v;
+
+		// v x jv
+		link->m_sc = b3Cross(link->m_sv, joint_v);
+
+		// Bias force
+		b3ForceVec Pdot;
+		Pdot.n = b3Cross(link->m_sv.w, link->m_m * link->m_sv.v);
+		Pdot.f = b3Cross(link->m_sv.w, link->m_I * link->m_sv.w);
+
+		// Damping force
+		b3ForceVec Fd;
+		Fd.n = -m_linearDamping * link->m_m * link->m_sv.v;
+		Fd.f = -m_angularDamping * (link->m_I * link->m_sv.w);
+
+		// Convert global force to local force.
+		b3ForceVec F;
+		F.n = link->m_m * b3Mul(link->m_invX.rotation, m_gravity);
+		F.f.SetZero();
+
+		link->m_I_A.SetLocalInertia(link->m_m, link->m_I);
+		link->m_F_A = Pdot - (F + Fd + link->m_Fe);
+	}
+
+	// Propagate up bias forces and inertias.
+	for (u32 j = m_linkCount - 1; j >= 1; --j)
+	{
+		b3ArticulationLink* link = m_links + j;
+		b3ArticulationLink* parent = m_links + link->m_parent;
+		b3MotionVec* S = link->m_S;
+		b3MotionVec& c = link->m_sc;
+
+		b3SpInertia& I_A = link->m_I_A;
+		b3ForceVec& F_A = link->m_F_A;
+
+		b3ForceVec* U = link->m_U;
+		b3Vec3& u = link->m_u;
+
+		// U
+		U[0] = I_A * S[0];
+		U[1] = I_A * S[1];
+		U[2] = I_A * S[2];
+
+		// D = S^T * U
+		b3Mat33 D;
+
+		D.x.x = b3Dot(S[0], U[0]);
+		D.x.y = b3Dot(S[1], U[0]);
+		D.x.z = b3Dot(S[2], U[0]);
+
+		D.y.x = D.x.y;
+		D.y.y = b3Dot(S[1], U[1]);
+		D.y.z = b3Dot(S[2], U[1]);
+
+		D.z.x = D.x.z;
+		D.z.y = D.y.z;
+		D.z.z = b3Dot(S[2], U[2]);
+
+		// Keep D invertible for joints with a single degree of freedom.
+		// The unused rows of U are zero.
+		if (link->m_dofCount == 1)
+		{
+			D.y.y = scalar(1);
+			D.z.z = scalar(1);
+		}
+
+		// D^-1
+		b3Mat33 invD = b3SymInverse(D);
+		link->m_invD = invD;
+
+		// U * D^-1
+		b3ForceVec U_invD[3];
+		U_invD[0] = invD[0][0] * U[0] + invD[0][1] * U[1] + invD[0][2] * U[2];
+		U_invD[1] = invD[1][0] * U[0] + invD[1][1] * U[1] + invD[1][2] * U[2];
+		U_invD[2] = invD[2][0] * U[0] + invD[2][1] * U[1] + invD[2][2] * U[2];
+
+		// I_a = I_A - U * D^-1 * U^T
+		b3SpInertia M1 = b3Outer(U[0], U_invD[0]);
+		b3SpInertia M2 = b3Outer(U[1], U_invD[1]);
+		b3SpInertia M3 = b3Outer(U[2], U_invD[2]);
+
+		b3SpInertia I_a = link->m_I_A;
+		I_a -= M1;
+		I_a -= M2;
+		I_a -= M3;
+
+		// u = tau - S^T * F_A
+		u[0] = link->m_tau[0] - b3Dot(S[0], F_A);
+		u[1] = link->m_tau[1] - b3Dot(S[1], F_A);
+		u[2] = link->m_tau[2] - b3Dot(S[2], F_A);
+
+		// U * D^-1 * u
+		b3ForceVec U_invD_u = U_invD[0] * u[0] + U_invD[1] * u[1] + U_invD[2] * u[2];
+
+		// F_a = F_A + I_a * c + U * D^-1 * u
+		b3ForceVec F_a = F_A + I_a * c + U_invD_u;
+
+		b3SpInertia I_a_i = b3MulT(link->m_X_i_j, I_a);
+		b3ForceVec F_a_i = b3MulT(link->m_X_i_j, F_a);
+
+		parent->m_I_A += I_a_i;
+		parent->m_F_A += F_a_i;
+	}
+
+	// Propagate down accelerations
+	{
+		b3ArticulationLink* body = m_links;
+
+		if (m_baseMotion)
+		{
+			if (m_baseMass > scalar(0))
+			{
+				// Solve the acceleration of the base link and the body together.
+				// The spatial inertia of the body about the base link origin is 
+				// M = [-m * dx, m * I; I_c - m * dx * dx, m * dx], 
+				// where d is the body center of mass.
+				b3Mat33 dx = b3Skew(m_baseCenter);
+
+				b3SpInertia M;
+				M.A = -m_baseMass * dx;
+				M.B = b3Mat33Diagonal(m_baseMass);
+				M.C = m_baseInertia - m_baseMass * dx * dx;
+
+				// (M + I_A) * a = M * a_body - F_A
+				b3SpInertia I_c = body->m_I_A;
+				I_c += M;
+
+				body->m_sa = I_c.Solve(M * body->m_sa - body->m_F_A);
+			}
+
+			// The support must apply I_A * a + F_A to the base link.
+			b3ForceVec F_s = body->m_I_A * body->m_sa + body->m_F_A;
+
+			// Convert local force to global force. 
+			// The reaction on the support is opposite.
+			m_reactionForce = -b3Mul(body->m_X.rotation, F_s.n);
+			m_reactionTorque = -b3Mul(body->m_X.rotation, F_s.f);
+		}
+		else if (body->m_m == scalar(0))
+		{
+			body->m_sa.SetZero();
+		}
+		else
+		{
+			// a = I^-1 * F 
+			body->m_sa = body->m_I_A.Solve(-body->m_F_A);
+		}
+	}
+
+	for (u32 j = 1; j < m_linkCount; ++j)
+	{
+		b3ArticulationLink* link = m_links + j;
+		b3ArticulationLink* parent = m_links + link->m_parent;
+		b3MotionVec* S = link->m_S;
+		b3MotionVec c = link->m_sc;
+		b3ForceVec* U = link->m_U;
+		b3Vec3 u = link->m_u;
+
+		b3MotionVec parent_a = b3Mul(link->m_X_i_j, parent->m_sa);
+		b3MotionVec a = parent_a + c;
+
+		// u - U^T * a
+		b3Vec3 b;
+		b[0] = u[0] - b3Dot(a, U[0]);
+		b[1] = u[1] - b3Dot(a, U[1]);
+		b[2] = u[2] - b3Dot(a, U[2]);
+
+		// D^-1 * b
+		link->m_a = link->m_invD * b;
+
+		b3MotionVec joint_a = S[0] * link->m_a[0] + S[1] * link->m_a[1] + S[2] * link->m_a[2];
+
+		link->m_sa = a + joint_a;
+	}
+
+	// Integrate
+	
+	// Integrate base
+	if (m_baseMotion)
+	{
+		// The base link motion is prescribed for a single time step.
+		m_baseMotion = false;
+	}
+	else
+	{
+		b3ArticulationLink* b = m_links;
+		
+		b3Vec3 x = b->m_X.translation;
+		b3Quat q = b->m_X.rotation;
+
+		b3Vec3 v = b->m_sv.v;
+		b3Vec3 w = b->m_sv.w;
+
+		b3Vec3 v_dot = b->m_sa.v;
+		b3Vec3 w_dot = b->m_sa.w;
+		
+		// Integrate acceleration
+		v += h * v_dot;
+		w += h * w_dot;
+
+		// Integrate velocity
+		// The linear velocity is expressed in the link frame.
+		x += h * b3Mul(q, v);
+
+		b3Quat q_w(w.x, w.y, w.z, scalar(0));
+		b3Quat q_dot = scalar(0.5) * q * q_w;
+		q += h * q_dot;
+		q.Normalize();
+
+		b->m_sv.v = v;
+		b->m_sv.w = w;
+
+		b->m_X.translation = x;
+		b->m_X.rotation = q;
+
+		b->m_invX = b3Inverse(b->m_X);
+	}
+	
+	// Integrate joints
+	for (u32 i = 1; i < m_linkCount; ++i)
+	{
+		b3ArticulationLink* link = m_links + i;
+
+		// Integrate acceleration
+		link->m_v += h * link->m_a;
+
+		// Integrate velocity
+		if (link->m_type == e_sphericalArticulationJoint)
+		{
+			b3Quat q_w(link->m_v.x, link->m_v.y, link->m_v.z, scalar(0));
+			b3Quat q_dot = scalar(0.5) * link->m_p * q_w;
+
+			link->m_p += h * q_dot;
+			link->m_p.Normalize();
+		}
+		else
+		{
+			link->m_q += h * link->m_v.x;
+		}
+	}
+
+	// Clear external forces
+	for (u32 i = 0; i < m_linkCount; ++i)
+	{
+		m_links[i].m_Fe.SetZero();
+	}
+
+	// Propagate down transforms
+	for (u32 j = 1; j < m_linkCount; ++j)
+	{
+		b3ArticulationLink* link = m_links + j;
+		b3ArticulationLink* parent = m_links + link->m_parent;
+
+		b3Transform X_J = link->X_J();
+		b3Transform X_i_j = link->m_X_J_j * X_J * link->m_X_i_J;
+
+		link->m_invX = X_i_j * parent->m_invX;
+		link->m_X = b3Inverse(link->m_invX);
+	}
+}
+
+void b3Articulation::Draw() const
+{
+	B3_ASSERT(m_linkCount > 0);
+
+	for (u32 i = 0; i < m_linkCount; ++i)
+	{
+		b3ArticulationLink* b = m_links + i;
+
+		b3Draw_draw->DrawTransform(b->m_X);
+		b3Draw_draw->DrawSolidSphere(b->m_X.rotation.GetXAxis(), b->m_X.translation, scalar(0.2), b3Color_green);
+
+		if (i == 0)
+		{
+			continue;
+		}
+
+		b3ArticulationLink* b0 = m_links + b->m_parent;
+
+		b3Transform X_J = b0->m_X * b3Inverse(b->m_X_i_J);
+
+		b3Draw_draw->DrawPoint(X_J.translation, scalar(5), b3Color_red);
+		b3Draw_draw->DrawSegment(b0->m_X.translation, X_J.translation, b3Color_white);
+		b3Draw_draw->DrawSegment(X_J.translation, b->m_X.translation, b3Color_white);
+	}
+}
@@ -0,0 +1,1041 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson 
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/rope/rope_batch.h>
+#include <bounce/rope/spatial.h>
+#include <bounce/common/math/simd.h>
+#include <bounce/common/thread/task_executor.h>
+#include <bounce/common/draw.h>
+#include <algorithm>
+
+// A quaternion of B3_SIMD_WIDTH lanes.
+struct b3QuatW
+{
+	b3Vec3W v;
+	b3FloatW s;
+};
+
+// The lanes of a quaternion stored in memory.
+struct b3QuatLanes
+{
+	b3Vec3Lanes v;
+	scalar s[B3_SIMD_WIDTH];
+
+	void Set(u32 lane, const b3Quat& q)
+	{
+		v.Set(lane, q.v);
+		s[lane] = q.s;
+	}
+
+	b3Quat Get(u32 lane) const
+	{
+		b3Vec3 qv = v.Get(lane);
+		return b3Quat(qv.x, qv.y, qv.z, s[lane]);
+	}
+};
+
+static B3_FORCE_INLINE b3QuatW b3LoadW(const b3QuatLanes& p)
+{
+	b3QuatW r;
+	r.v = b3LoadW(p.v);
+	r.s = b3LoadW(p.s);
+	return r;
+}
+
+static B3_FORCE_INLINE void b3StoreW(b3QuatLanes& p, const b3QuatW& q)
+{
+	b3StoreW(p.v, q.v);
+	b3StoreW(p.s, q.s);
+}
+
+static B3_FORCE_INLINE b3QuatW b3Conjugate(const b3QuatW& q)
+{
+	b3QuatW r;
+	r.v = -q.v;
+	r.s = q.s;
+	return r;
+}
+
+static B3_FORCE_INLINE b3QuatW b3Mul(const b3QuatW& a, const b3QuatW& b)
+{
+	b3QuatW r;
+	r.v = b3Cross(a.v, b.v) + a.s * b.v + b.s * a.v;
+	r.s = a.s * b.s - b3Dot(a.v, b.v);
+	return r;
+}
+
+// Rotate a vector.
+static B3_FORCE_INLINE b3Vec3W b3Mul(const b3QuatW& q, const b3Vec3W& v)
+{
+	b3Vec3W t = b3SplatW(scalar(2)) * b3Cross(q.v, v);
+	return v + q.s * t + b3Cross(q.v, t);
+}
+
+static B3_FORCE_INLINE b3QuatW b3Normalize(const b3QuatW& q)
+{
+	b3FloatW len = b3SqrtW(b3Dot(q.v, q.v) + q.s * q.s);
+	b3FloatW one = b3SplatW(scalar(1));
+	b3FloatW inv_len = b3SelectGreaterW(len, b3SplatW(B3_EPSILON), one / len, one);
+
+	b3QuatW r;
+	r.v = inv_len * q.v;
+	r.s = inv_len * q.s;
+	return r;
+}
+
+static B3_FORCE_INLINE b3Mat33W b3QuatMat33(const b3QuatW& q)
+{
+	b3FloatW x = q.v.x, y = q.v.y, z = q.v.z, w = q.s;
+
+	b3FloatW x2 = x + x, y2 = y + y, z2 = z + z;
+	b3FloatW xx = x * x2, xy = x * y2, xz = x * z2;
+	b3FloatW yy = y * y2, yz = y * z2, zz = z * z2;
+	b3FloatW wx = w * x2, wy = w * y2, wz = w * z2;
+
+	b3FloatW one = b3SplatW(scalar(1));
+
+	b3Mat33W r;
+	r.x.x = one - (yy + zz);
+	r.x.y = xy + wz;
+	r.x.z = xz - wy;
+	r.y.x = xy - wz;
+	r.y.y = one - (xx + zz);
+	r.y.z = yz + wx;
+	r.z.x = xz + wy;
+	r.z.y = yz - wx;
+	r.z.z = one - (xx + yy);
+	return r;
+}
+
+// A 6-by-1 motion vector of B3_SIMD_WIDTH lanes.
+struct b3MotionVecW
+{
+	b3Vec3W w, v;
+};
+
+struct b3MotionVecLanes
+{
+	b3Vec3Lanes w, v;
+
+	void Set(u32 lane, const b3MotionVec& a)
+	{
+		w.Set(lane, a.w);
+		v.Set(lane, a.v);
+	}
+
+	b3MotionVec Get(u32 lane) const
+	{
+		return b3MotionVec(w.Get(lane), v.Get(lane));
+	}
+};
+
+static B3_FORCE_INLINE b3MotionVecW b3LoadW(const b3MotionVecLanes& p)
+{
+	b3MotionVecW r;
+	r.w = b3LoadW(p.w);
+	r.v = b3LoadW(p.v);
+	return r;
+}
+
+static B3_FORCE_INLINE void b3StoreW(b3MotionVecLanes& p, const b3MotionVecW& a)
+{
+	b3StoreW(p.w, a.w);
+	b3StoreW(p.v, a.v);
+}
+
+static B3_FORCE_INLINE b3MotionVecW operator+(const b3MotionVecW& a, const b3MotionVecW& b)
+{
+	b3MotionVecW r;
+	r.w = a.w + b.w;
+	r.v = a.v + b.v;
+	return r;
+}
+
+// A 6-by-1 force vector of B3_SIMD_WIDTH lanes.
+struct b3ForceVecW
+{
+	b3Vec3W n, f;
+};
+
+struct b3ForceVecLanes
+{
+	b3Vec3Lanes n, f;
+
+	void Set(u32 lane, const b3ForceVec& a)
+	{
+		n.Set(lane, a.n);
+		f.Set(lane, a.f);
+	}
+
+	b3ForceVec Get(u32 lane) const
+	{
+		return b3ForceVec(n.Get(lane), f.Get(lane));
+	}
+};
+
+static B3_FORCE_INLINE b3ForceVecW b3LoadW(const b3ForceVecLanes& p)
+{
+	b3ForceVecW r;
+	r.n = b3LoadW(p.n);
+	r.f = b3LoadW(p.f);
+	return r;
+}
+
+static B3_FORCE_INLINE void b3StoreW(b3ForceVecLanes& p, const b3ForceVecW& a)
+{
+	b3StoreW(p.n, a.n);
+	b3StoreW(p.f, a.f);
+}
+
+static B3_FORCE_INLINE b3ForceVecW operator+(const b3ForceVecW& a, const b3ForceVecW& b)
+{
+	b3ForceVecW r;
+	r.n = a.n + b.n;
+	r.f = a.f + b.f;
+	return r;
+}
+
+static B3_FORCE_INLINE b3ForceVecW operator*(const b3FloatW& s, const b3ForceVecW& a)
+{
+	b3ForceVecW r;
+	r.n = s * a.n;
+	r.f = s * a.f;
+	return r;
+}
+
+// a^T * b
+static B3_FORCE_INLINE b3FloatW b3Dot(const b3MotionVecW& a, const b3ForceVecW& b)
+{
+	return b3Dot(a.v, b.n) + b3Dot(a.w, b.f);
+}
+
+// A 6-by-6 spatial inertia matrix of B3_SIMD_WIDTH lanes.
+struct b3SpInertiaW
+{
+	b3Mat33W A, B, C;
+};
+
+struct b3SpInertiaLanes
+{
+	b3Mat33Lanes A, B, C;
+
+	void Set(u32 lane, const b3SpInertia& M)
+	{
+		A.Set(lane, M.A);
+		B.Set(lane, M.B);
+		C.Set(lane, M.C);
+	}
+
+	b3SpInertia Get(u32 lane) const
+	{
+		b3SpInertia M;
+		M.A = A.Get(lane);
+		M.B = B.Get(lane);
+		M.C = C.Get(lane);
+		return M;
+	}
+};
+
+static B3_FORCE_INLINE b3SpInertiaW b3LoadW(const b3SpInertiaLanes& p)
+{
+	b3SpInertiaW r;
+	r.A = b3LoadW(p.A);
+	r.B = b3LoadW(p.B);
+	r.C = b3LoadW(p.C);
+	return r;
+}
+
+static B3_FORCE_INLINE void b3StoreW(b3SpInertiaLanes& p, const b3SpInertiaW& M)
+{
+	b3StoreW(p.A, M.A);
+	b3StoreW(p.B, M.B);
+	b3StoreW(p.C, M.C);
+}
+
+// M * v
+static B3_FORCE_INLINE b3ForceVecW operator*(const b3SpInertiaW& M, const b3MotionVecW& v)
+{
+	b3ForceVecW r;
+	r.n = M.A * v.w + M.B * v.v;
+	r.f = M.C * v.w + b3MulT(M.A, v.v);
+	return r;
+}
+
+// A spatial transformation matrix of B3_SIMD_WIDTH lanes.
+struct b3SpTransformW
+{
+	b3Mat33W E;
+	b3Vec3W r;
+};
+
+// X * v
+static B3_FORCE_INLINE b3MotionVecW b3Mul(const b3SpTransformW& X, const b3MotionVecW& v)
+{
+	b3Vec3W Ew = X.E * v.w;
+
+	b3MotionVecW r;
+	r.w = Ew;
+	r.v = X.E * v.v - b3Cross(X.r, Ew);
+	return r;
+}
+
+// X^-1 * v
+static B3_FORCE_INLINE b3ForceVecW b3MulT(const b3SpTransformW& X, const b3ForceVecW& v)
+{
+	b3ForceVecW r;
+	r.n = b3MulT(X.E, v.n);
+	r.f = b3MulT(X.E, v.f + b3Cross(X.r, v.n));
+	return r;
+}
+
+// X^-1 * I
+static B3_FORCE_INLINE b3SpInertiaW b3MulT(const b3SpTransformW& X, const b3SpInertiaW& I)
+{
+	b3Mat33W E = X.E;
+	b3Mat33W ET = b3Transpose(X.E);
+	b3Mat33W rx = b3Skew(X.r);
+
+	b3Mat33W A_Brx = I.A - I.B * rx;
+
+	b3SpInertiaW r;
+	r.A = ET * A_Brx * E;
+	r.B = ET * I.B * E;
+	r.C = ET * (rx * A_Brx + I.C - b3Transpose(I.A) * rx) * E;
+	return r;
+}
+
+// The rope links at the same depth in the ropes of a packet. 
+// The base link of a rope is the first link.
+struct b3RopeLinkW
+{
+	// Body 
+
+	//
+	scalar m[B3_SIMD_WIDTH], I[B3_SIMD_WIDTH];
+
+	// One if this link belongs to the rope of a lane. 
+	// Zero if it pads a shorter rope.
+	scalar weight[B3_SIMD_WIDTH];
+
+	// Joint
+
+	// Vector from the joint to the center of mass of this link in the link frame.
+	// The motion subspace is S = [e_i, e_i x r].
+	b3Vec3Lanes r;
+
+	//
+	b3QuatLanes p;
+
+	//
+	b3Vec3Lanes v;
+
+	// Temp
+
+	//
+	b3Mat33Lanes E;
+
+	//
+	b3MotionVecLanes sv;
+
+	//
+	b3MotionVecLanes sc;
+
+	//
+	b3SpInertiaLanes I_A;
+
+	//
+	b3ForceVecLanes F_A;
+
+	//
+	b3ForceVecLanes U[3];
+
+	//
+	b3Mat33Lanes invD;
+
+	//
+	b3Vec3Lanes u;
+
+	//
+	b3MotionVecLanes sa;
+
+	//
+	b3QuatLanes invXq;
+	b3Vec3Lanes invXt;
+
+	//
+	b3QuatLanes Xq;
+	b3Vec3Lanes Xt;
+};
+
+// B3_SIMD_WIDTH ropes stepped together.
+struct b3RopePacket
+{
+	// The maximum number of links of the ropes in this packet.
+	u32 linkCount;
+	b3RopeLinkW* links;
+
+	// Number of links of each rope. Zero if a lane is empty.
+	u32 linkCounts[B3_SIMD_WIDTH];
+
+	scalar linearDamping[B3_SIMD_WIDTH];
+	scalar angularDamping[B3_SIMD_WIDTH];
+};
+
+// The packet lane of a rope.
+struct b3RopeLane
+{
+	u32 packet;
+	u32 lane;
+};
+
+b3RopeBatch::b3RopeBatch(const b3RopeDef* defs, u32 count)
+{
+	m_gravity.SetZero();
+	m_executor = nullptr;
+	m_ropeCount = count;
+	m_ropes = (b3RopeLane*)b3Alloc(m_ropeCount * sizeof(b3RopeLane));
+	m_packetCount = (m_ropeCount + B3_SIMD_WIDTH - 1) / B3_SIMD_WIDTH;
+	m_packets = (b3RopePacket*)b3Alloc(m_packetCount * sizeof(b3RopePacket));
+
+	// Sort the ropes by link count so the ropes of a packet have similar link counts.
+	u32* order = (u32*)b3Alloc(m_ropeCount * sizeof(u32));
+	for (u32 i = 0; i < m_ropeCount; ++i)
+	{
+		order[i] = i;
+	}
+
+	std::stable_sort(order, order + m_ropeCount, [defs](u32 a, u32 b) { return defs[a].count > defs[b].count; });
+
+	for (u32 i = 0; i < m_packetCount; ++i)
+	{
+		b3RopePacket* packet = m_packets + i;
+		packet->linkCount = 0;
+
+		for (u32 lane = 0; lane < B3_SIMD_WIDTH; ++lane)
+		{
+			u32 index = i * B3_SIMD_WIDTH + lane;
+			if (index < m_ropeCount)
+			{
+				u32 rope = order[index];
+				const b3RopeDef& def = defs[rope];
+				B3_ASSERT(def.count > 0);
+
+				m_ropes[rope].packet = i;
+				m_ropes[rope].lane = lane;
+
+				packet->linkCounts[lane] = def.count;
+				packet->linearDamping[lane] = def.linearDamping;
+				packet->angularDamping[lane] = def.angularDamping;
+				packet->linkCount = b3Max(packet->linkCount, def.count);
+			}
+			else
+			{
+				packet->linkCounts[lane] = 0;
+				packet->linearDamping[lane] = scalar(0);
+				packet->angularDamping[lane] = scalar(0);
+			}
+		}
+
+		packet->links = (b3RopeLinkW*)b3Alloc(packet->linkCount * sizeof(b3RopeLinkW));
+
+		for (u32 lane = 0; lane < B3_SIMD_WIDTH; ++lane)
+		{
+			u32 index = i * B3_SIMD_WIDTH + lane;
+			const b3RopeDef* def = index < m_ropeCount ? defs + order[index] : nullptr;
+
+			for (u32 j = 0; j < packet->linkCount; ++j)
+			{
+				b3RopeLinkW* link = packet->links + j;
+
+				b3Quat identity;
+				identity.SetIdentity();
+
+				link->p.Set(lane, identity);
+				link->v.Set(lane, b3Vec3_zero);
+				link->sv.Set(lane, b3MotionVec(b3Vec3_zero, b3Vec3_zero));
+				link->Xq.Set(lane, identity);
+
+				if (def && j < def->count)
+				{
+					scalar m = def->masses[j];
+
+					// Simplify r = 1
+					link->m[lane] = m;
+					link->I[lane] = m * scalar(0.4);
+					link->weight[lane] = scalar(1);
+					link->Xt.Set(lane, def->vertices[j]);
+
+					// The joint anchor is the parent link position.
+					b3Vec3 r = j > 0 ? def->vertices[j] - def->vertices[j - 1] : b3Vec3_zero;
+					link->r.Set(lane, r);
+				}
+				else
+				{
+					// Pad the lane with a well conditioned link that doesn't 
+					// affect its parent. The base link of an empty lane is fixed.
+					scalar m = j > 0 ? scalar(1) : scalar(0);
+
+					link->m[lane] = m;
+					link->I[lane] = m * scalar(0.4);
+					link->weight[lane] = scalar(0);
+					link->Xt.Set(lane, b3Vec3_zero);
+					link->r.Set(lane, b3Vec3(scalar(0), scalar(-1), scalar(0)));
+				}
+			}
+		}
+	}
+
+	b3Free(order);
+}
+
+b3RopeBatch::~b3RopeBatch()
+{
+	for (u32 i = 0; i < m_packetCount; ++i)
+	{
+		b3Free(m_packets[i].links);
+	}
+	b3Free(m_packets);
+	b3Free(m_ropes);
+}
+
+void b3RopeBatch::SetPosition(u32 rope, const b3Vec3& position)
+{
+	B3_ASSERT(rope < m_ropeCount);
+	b3RopeLane lane = m_ropes[rope];
+	m_packets[lane.packet].links->Xt.Set(lane.lane, position);
+}
+
+b3Vec3 b3RopeBatch::GetPosition(u32 rope) const
+{
+	B3_ASSERT(rope < m_ropeCount);
+	b3RopeLane lane = m_ropes[rope];
+	return m_packets[lane.packet].links->Xt.Get(lane.lane);
+}
+
+void b3RopeBatch::SetLinearVelocity(u32 rope, const b3Vec3& linearVelocity)
+{
+	B3_ASSERT(rope < m_ropeCount);
+	b3RopeLane lane = m_ropes[rope];
+	b3RopeLinkW* base = m_packets[lane.packet].links;
+	b3Quat q = base->Xq.Get(lane.lane);
+	base->sv.v.Set(lane.lane, b3MulC(q, linearVelocity));
+}
+
+b3Vec3 b3RopeBatch::GetLinearVelocity(u32 rope) const
+{
+	B3_ASSERT(rope < m_ropeCount);
+	b3RopeLane lane = m_ropes[rope];
+	const b3RopeLinkW* base = m_packets[lane.packet].links;
+	b3Quat q = base->Xq.Get(lane.lane);
+	return b3Mul(q, base->sv.v.Get(lane.lane));
+}
+
+void b3RopeBatch::SetAngularVelocity(u32 rope, const b3Vec3& angularVelocity)
+{
+	B3_ASSERT(rope < m_ropeCount);
+	b3RopeLane lane = m_ropes[rope];
+	b3RopeLinkW* base = m_packets[lane.packet].links;
+	b3Quat q = base->Xq.Get(lane.lane);
+	base->sv.w.Set(lane.lane, b3MulC(q, angularVelocity));
+}
+
+b3Vec3 b3RopeBatch::GetAngularVelocity(u32 rope) const
+{
+	B3_ASSERT(rope < m_ropeCount);
+	b3RopeLane lane = m_ropes[rope];
+	const b3RopeLinkW* base = m_packets[lane.packet].links;
+	b3Quat q = base->Xq.Get(lane.lane);
+	return b3Mul(q, base->sv.w.Get(lane.lane));
+}
+
+u32 b3RopeBatch::GetLinkCount(u32 rope) const
+{
+	B3_ASSERT(rope < m_ropeCount);
+	b3RopeLane lane = m_ropes[rope];
+	return m_packets[lane.packet].linkCounts[lane.lane];
+}
+
+b3Transform b3RopeBatch::GetLinkTransform(u32 rope, u32 index) const
+{
+	B3_ASSERT(rope < m_ropeCount);
+	b3RopeLane lane = m_ropes[rope];
+	const b3RopePacket* packet = m_packets + lane.packet;
+	B3_ASSERT(index < packet->linkCounts[lane.lane]);
+	const b3RopeLinkW* link = packet->links + index;
+
+	b3Transform X;
+	X.rotation = link->Xq.Get(lane.lane);
+	X.translation = link->Xt.Get(lane.lane);
+	return X;
+}
+
+// Compute the forces and inertia of the base link of a rope.
+static void b3PrepareBase(b3RopeLinkW* base, u32 lane, const b3Vec3& gravity, scalar linearDamping, scalar angularDamping)
+{
+	scalar m = base->m[lane];
+	scalar I = base->I[lane];
+
+	b3Transform X;
+	X.rotation = base->Xq.Get(lane);
+	X.translation = base->Xt.Get(lane);
+
+	b3Transform invX = b3Inverse(X);
+	base->invXq.Set(lane, invX.rotation);
+	base->invXt.Set(lane, invX.translation);
+
+	b3SpInertia I_A;
+	b3ForceVec F_A;
+
+	if (m == scalar(0))
+	{
+		I_A.SetZero();
+		F_A.SetZero();
+	}
+	else
+	{
+		b3MotionVec sv = base->sv.Get(lane);
+
+		// Uniform inertia results in zero angular momentum.
+		b3ForceVec Pdot;
+		Pdot.n = b3Cross(sv.w, m * sv.v);
+		Pdot.f.SetZero();
+
+		// Convert global force to local force.
+		b3ForceVec F;
+		F.n = b3Mul(invX.rotation, gravity);
+		F.f.SetZero();
+
+		// Damping force
+		b3ForceVec Fd;
+		Fd.n = -linearDamping * m * sv.v;
+		Fd.f = -angularDamping * I * sv.w;
+
+		I_A.SetLocalInertia(m, b3Mat33Diagonal(I));
+		F_A = Pdot - (F + Fd);
+	}
+
+	base->I_A.Set(lane, I_A);
+	base->F_A.Set(lane, F_A);
+}
+
+// Solve the acceleration of the base link of a rope.
+static void b3SolveBase(b3RopeLinkW* base, u32 lane, u32 linkCount)
+{
+	scalar m = base->m[lane];
+	scalar I = base->I[lane];
+
+	b3MotionVec sa;
+
+	if (m == scalar(0))
+	{
+		sa.SetZero();
+	}
+	else
+	{
+		b3ForceVec F_A = base->F_A.Get(lane);
+
+		// a = I^-1 * F 
+		if (linkCount == 1)
+		{
+			scalar inv_m = m > scalar(0) ? scalar(1) / m : scalar(0);
+			scalar invI = I > scalar(0) ? scalar(1) / I : scalar(0);
+
+			sa.w = -invI * F_A.f;
+			sa.v = -inv_m * F_A.n;
+		}
+		else
+		{
+			b3SpInertia I_A = base->I_A.Get(lane);
+			sa = I_A.Solve(-F_A);
+		}
+	}
+
+	base->sa.Set(lane, sa);
+}
+
+// Integrate the base link of a rope.
+static void b3IntegrateBase(b3RopeLinkW* base, u32 lane, scalar h)
+{
+	b3Vec3 x = base->Xt.Get(lane);
+	b3Quat q = base->Xq.Get(lane);
+
+	b3MotionVec sv = base->sv.Get(lane);
+	b3MotionVec sa = base->sa.Get(lane);
+
+	b3Vec3 v = sv.v;
+	b3Vec3 w = sv.w;
+
+	// Integrate acceleration
+	v += h * sa.v;
+	w += h * sa.w;
+
+	// Integrate velocity		
+	x += h * v;
+
+	b3Quat q_w(w.x, w.y, w.z, scalar(0));
+	b3Quat q_dot = scalar(0.5) * q * q_w;
+	q += h * q_dot;
+	q.Normalize();
+
+	base->sv.Set(lane, b3MotionVec(w, v));
+
+	base->Xt.Set(lane, x);
+	base->Xq.Set(lane, q);
+
+	b3Transform X;
+	X.rotation = q;
+	X.translation = x;
+
+	b3Transform invX = b3Inverse(X);
+	base->invXq.Set(lane, invX.rotation);
+	base->invXt.Set(lane, invX.translation);
+}
+
+// Compute the transform of a link relative to the parent link and 
+// the transform of the world frame relative to the link.
+static B3_FORCE_INLINE void b3ComputeTransforms(b3QuatW& invXq, b3Vec3W& invXt, b3SpTransformW& X_i_j,
+	const b3RopeLinkW* link, const b3RopeLinkW* parent)
+{
+	// X_i_j = X_J_j * X_J * X_i_J 
+	// The joint frame of a rope link is the parent link frame translated to the parent position. 
+	// Therefore, X_i_J = identity and X_J_j = (identity, -r).
+	b3QuatW p = b3LoadW(link->p);
+	b3Vec3W r = b3LoadW(link->r);
+
+	b3QuatW q = b3Conjugate(p);
+
+	b3QuatW parent_q = b3LoadW(parent->invXq);
+	b3Vec3W parent_t = b3LoadW(parent->invXt);
+
+	// invX = X_i_j * parent_invX
+	invXq = b3Mul(q, parent_q);
+	invXt = b3Mul(q, parent_t) - r;
+
+	X_i_j.E = b3QuatMat33(q);
+	X_i_j.r = r;
+}
+
+// S * x = [x, x cross r]
+static B3_FORCE_INLINE b3MotionVecW b3MulS(const b3Vec3W& r, const b3Vec3W& x)
+{
+	b3MotionVecW result;
+	result.w = x;
+	result.v = b3Cross(x, r);
+	return result;
+}
+
+static void b3StepPacket(b3RopePacket* packet, const b3Vec3& gravity, scalar h)
+{
+	u32 linkCount = packet->linkCount;
+	b3RopeLinkW* links = packet->links;
+
+	b3FloatW zero = b3SplatW(scalar(0));
+	b3Vec3W g = b3SplatW(gravity);
+	b3FloatW linearDamping = b3LoadW(packet->linearDamping);
+	b3FloatW angularDamping = b3LoadW(packet->angularDamping);
+
+	// The motion subspace axes.
+	b3Vec3W ex = b3SplatW(b3Vec3_x);
+	b3Vec3W ey = b3SplatW(b3Vec3_y);
+	b3Vec3W ez = b3SplatW(b3Vec3_z);
+
+	// Propagate down.
+	for (u32 lane = 0; lane < B3_SIMD_WIDTH; ++lane)
+	{
+		b3PrepareBase(links, lane, gravity, packet->linearDamping[lane], packet->angularDamping[lane]);
+	}
+
+	for (u32 i = 1; i < linkCount; ++i)
+	{
+		b3RopeLinkW* link = links + i;
+		b3RopeLinkW* parent = link - 1;
+
+		b3QuatW invXq;
+		b3Vec3W invXt;
+		b3SpTransformW X_i_j;
+		b3ComputeTransforms(invXq, invXt, X_i_j, link, parent);
+
+		b3StoreW(link->invXq, invXq);
+		b3StoreW(link->invXt, invXt);
+		b3StoreW(link->E, X_i_j.E);
+
+		b3FloatW m = b3LoadW(link->m);
+		b3FloatW I = b3LoadW(link->I);
+
+		b3MotionVecW joint_v = b3MulS(X_i_j.r, b3LoadW(link->v));
+
+		b3MotionVecW parent_v = b3Mul(X_i_j, b3LoadW(parent->sv));
+
+		b3MotionVecW sv = parent_v + joint_v;
+
+		// v x jv
+		b3MotionVecW sc;
+		sc.w = b3Cross(sv.w, joint_v.w);
+		sc.v = b3Cross(sv.v, joint_v.w) + b3Cross(sv.w, joint_v.v);
+
+		b3StoreW(link->sv, sv);
+		b3StoreW(link->sc, sc);
+
+		// Uniform inertia results in zero angular momentum.
+		// F_A = Pdot - (F + Fd)
+		b3ForceVecW F_A;
+		F_A.n = b3Cross(sv.w, m * sv.v) - b3Mul(invXq, g) + (linearDamping * m) * sv.v;
+		F_A.f = (angularDamping * I) * sv.w;
+
+		b3SpInertiaW I_A;
+		I_A.A.x = b3SplatW(b3Vec3_zero);
+		I_A.A.y = I_A.A.x;
+		I_A.A.z = I_A.A.x;
+		I_A.B.x = m * ex;
+		I_A.B.y = m * ey;
+		I_A.B.z = m * ez;
+		I_A.C.x = I * ex;
+		I_A.C.y = I * ey;
+		I_A.C.z = I * ez;
+
+		b3StoreW(link->I_A, I_A);
+		b3StoreW(link->F_A, F_A);
+	}
+
+	// Propagate up bias forces and inertias.
+	for (u32 j = linkCount - 1; j >= 1; --j)
+	{
+		b3RopeLinkW* link = links + j;
+		b3RopeLinkW* parent = link - 1;
+
+		b3SpTransformW X_i_j;
+		X_i_j.E = b3LoadW(link->E);
+		X_i_j.r = b3LoadW(link->r);
+
+		b3Vec3W r = X_i_j.r;
+		b3MotionVecW S[3];
+		S[0] = b3MulS(r, ex);
+		S[1] = b3MulS(r, ey);
+		S[2] = b3MulS(r, ez);
+
+		b3MotionVecW c = b3LoadW(link->sc);
+		b3SpInertiaW I_A = b3LoadW(link->I_A);
+		b3ForceVecW F_A = b3LoadW(link->F_A);
+
+		// U
+		b3ForceVecW U[3];
+		U[0] = I_A * S[0];
+		U[1] = I_A * S[1];
+		U[2] = I_A * S[2];
+
+		// D = S^T * U
+		b3Mat33W D;
+
+		D.x.x = b3Dot(S[0], U[0]);
+		D.x.y = b3Dot(S[1], U[0]);
+		D.x.z = b3Dot(S[2], U[0]);
+
+		D.y.x = D.x.y;
+		D.y.y = b3Dot(S[1], U[1]);
+		D.y.z = b3Dot(S[2], U[1]);
+
+		D.z.x = D.x.z;
+		D.z.y = D.y.z;
+		D.z.z = b3Dot(S[2], U[2]);
+
+		// D^-1
+		b3Mat33W invD = b3SymInverse(D);
+
+		// U * D^-1
+		b3ForceVecW U_invD[3];
+		U_invD[0] = invD.x.x * U[0] + invD.x.y * U[1] + invD.x.z * U[2];
+		U_invD[1] = invD.y.x * U[0] + invD.y.y * U[1] + invD.y.z * U[2];
+		U_invD[2] = invD.z.x * U[0] + invD.z.y * U[1] + invD.z.z * U[2];
+
+		// I_a = I_A - U * D^-1 * U^T
+		b3SpInertiaW I_a = I_A;
+		for (u32 k = 0; k < 3; ++k)
+		{
+			I_a.A = I_a.A - b3Outer(U[k].n, U_invD[k].f);
+			I_a.B = I_a.B - b3Outer(U[k].n, U_invD[k].n);
+			I_a.C = I_a.C - b3Outer(U[k].f, U_invD[k].f);
+		}
+
+		// u = tau - S^T * F_A
+		b3Vec3W u;
+		u.x = -b3Dot(S[0], F_A);
+		u.y = -b3Dot(S[1], F_A);
+		u.z = -b3Dot(S[2], F_A);
+
+		// U * D^-1 * u
+		b3ForceVecW U_invD_u = u.x * U_invD[0] + u.y * U_invD[1] + u.z * U_invD[2];
+
+		// F_a = F_A + I_a * c + U * D^-1 * u
+		b3ForceVecW F_a = F_A + I_a * c + U_invD_u;
+
+		b3StoreW(link->U[0], U[0]);
+		b3StoreW(link->U[1], U[1]);
+		b3StoreW(link->U[2], U[2]);
+		b3StoreW(link->invD, invD);
+		b3StoreW(link->u, u);
+
+		// Padding links don't contribute to their parents.
+		b3FloatW weight = b3LoadW(link->weight);
+
+		b3SpInertiaW I_a_i = b3MulT(X_i_j, I_a);
+		b3ForceVecW F_a_i = b3MulT(X_i_j, F_a);
+
+		b3SpInertiaW parent_I_A = b3LoadW(parent->I_A);
+		parent_I_A.A = parent_I_A.A + weight * I_a_i.A;
+		parent_I_A.B = parent_I_A.B + weight * I_a_i.B;
+		parent_I_A.C = parent_I_A.C + weight * I_a_i.C;
+		b3StoreW(parent->I_A, parent_I_A);
+
+		b3ForceVecW parent_F_A = b3LoadW(parent->F_A);
+		parent_F_A = parent_F_A + weight * F_a_i;
+		b3StoreW(parent->F_A, parent_F_A);
+	}
+
+	// Propagate down accelerations
+	for (u32 lane = 0; lane < B3_SIMD_WIDTH; ++lane)
+	{
+		b3SolveBase(links, lane, packet->linkCounts[lane]);
+	}
+
+	for (u32 j = 1; j < linkCount; ++j)
+	{
+		b3RopeLinkW* link = links + j;
+		b3RopeLinkW* parent = link - 1;
+
+		b3SpTransformW X_i_j;
+		X_i_j.E = b3LoadW(link->E);
+		X_i_j.r = b3LoadW(link->r);
+
+		b3MotionVecW c = b3LoadW(link->sc);
+		b3Vec3W u = b3LoadW(link->u);
+
+		b3MotionVecW parent_a = b3Mul(X_i_j, b3LoadW(parent->sa));
+		b3MotionVecW a = parent_a + c;
+
+		// u - U^T * a
+		b3Vec3W b;
+		b.x = u.x - b3Dot(a, b3LoadW(link->U[0]));
+		b.y = u.y - b3Dot(a, b3LoadW(link->U[1]));
+		b.z = u.z - b3Dot(a, b3LoadW(link->U[2]));
+
+		// D^-1 * b
+		b3Vec3W joint_a = b3LoadW(link->invD) * b;
+
+		b3StoreW(link->sa, a + b3MulS(X_i_j.r, joint_a));
+
+		// Integrate acceleration
+		b3Vec3W v = b3LoadW(link->v) + b3SplatW(h) * joint_a;
+		b3StoreW(link->v, v);
+	}
+
+	// Integrate
+	for (u32 lane = 0; lane < B3_SIMD_WIDTH; ++lane)
+	{
+		b3IntegrateBase(links, lane, h);
+	}
+
+	b3FloatW half_h = b3SplatW(scalar(0.5) * h);
+
+	for (u32 j = 1; j < linkCount; ++j)
+	{
+		b3RopeLinkW* link = links + j;
+		b3RopeLinkW* parent = link - 1;
+
+		// Integrate velocity
+		b3QuatW q_w;
+		q_w.v = b3LoadW(link->v);
+		q_w.s = zero;
+
+		b3QuatW p = b3LoadW(link->p);
+		b3QuatW q_dot = b3Mul(p, q_w);
+
+		p.v = p.v + half_h * q_dot.v;
+		p.s = p.s + half_h * q_dot.s;
+		p = b3Normalize(p);
+
+		b3StoreW(link->p, p);
+
+		// Propagate down transforms
+		b3QuatW invXq;
+		b3Vec3W invXt;
+		b3SpTransformW X_i_j;
+		b3ComputeTransforms(invXq, invXt, X_i_j, link, parent);
+
+		b3StoreW(link->invXq, invXq);
+		b3StoreW(link->invXt, invXt);
+
+		// X = invX^-1
+		b3QuatW Xq = b3Conjugate(invXq);
+		b3StoreW(link->Xq, Xq);
+		b3StoreW(link->Xt, -b3Mul(Xq, invXt));
+	}
+}
+
+void b3RopeBatch::StepPackets(u32 begin, u32 end, scalar dt)
+{
+	for (u32 i = begin; i < end; ++i)
+	{
+		b3StepPacket(m_packets + i, m_gravity, dt);
+	}
+}
+
+struct b3RopeBatchContext
+{
+	b3RopeBatch* batch;
+	scalar dt;
+
+	static void Task(u32 begin, u32 end, u32 workerIndex, void* context)
+	{
+		B3_NOT_USED(workerIndex);
+
+		b3RopeBatchContext* c = (b3RopeBatchContext*)context;
+		c->batch->StepPackets(begin, end, c->dt);
+	}
+};
+
+void b3RopeBatch::Step(scalar dt)
+{
+	if (m_executor && m_packetCount > b3_minRopePacketTaskRange)
+	{
+		b3RopeBatchContext context;
+		context.batch = this;
+		context.dt = dt;
+
+		m_executor->ParallelFor(m_packetCount, b3_minRopePacketTaskRange, &b3RopeBatchContext::Task, &context);
+	}
+	else
+	{
+		StepPackets(0, m_packetCount, dt);
+	}
+}
+
+void b3RopeBatch::Draw() const
+{
+	for (u32 i = 0; i < m_ropeCount; ++i)
+	{
+		u32 linkCount = GetLinkCount(i);
+
+		for (u32 j = 0; j < linkCount; ++j)
+		{
+			b3Transform X = GetLinkTransform(i, j);
+
+			b3Draw_draw->DrawTransform(X);
+			b3Draw_draw->DrawSolidSphere(X.rotation.GetXAxis(), X.translation, scalar(0.2), b3Color_green);
+		}
+	}
+}